@@ -1,8 +1,14 @@
 #version 330 core
+// Variant defines, see ShaderVariants:
+//   NORMAL_MAP     perturb the normal with normalMap
+//   ALPHA_TEST     discard below alphaCutoff, albedo alpha is the coverage
+//   UNLIT          KHR_materials_unlit, albedo only
+//   SH_IRRADIANCE  diffuse IBL from shIrradiance (genIrradianceSH), no irradianceMap
 out vec4 FragColor;
 in vec2 TexCoord;
 in vec3 FragPos;
 in vec3 Normal;
+in vec4 Tangent;
 
 // material parameters
 uniform sampler2D albedoMap;
@@ -12,7 +18,12 @@ uniform sampler2D roughnessMap;
 uniform sampler2D aoMap;
 
 // IBL
+#ifdef SH_IRRADIANCE
+// irradiance / PI as 9 L2 spherical harmonics, see SHIrradiance
+uniform vec3 shIrradiance[9];
+#else
 uniform samplerCube irradianceMap;
+#endif
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
 
@@ -22,24 +33,43 @@ uniform vec3 lightColors[4];
 
 uniform vec3 camPos;
 
+#ifdef ALPHA_TEST
+uniform float alphaCutoff;
+#endif
+
 const float PI = 3.14159265359;
 
-// trick to get tangent normals to world space - according to book source code
+// tangent space normal to world space, with the mesh tangents
 vec3 getNormal()
 {
-    vec3 tangentNormal = texture(normalMap, TexCoord).xyz * 2.0 - 1.0;
-
-    vec3 Q1  = dFdx(FragPos);
-    vec3 Q2  = dFdy(FragPos);
-    vec2 st1 = dFdx(TexCoord);
-    vec2 st2 = dFdy(TexCoord);
-
-    vec3 N   = normalize(Normal);
-    vec3 T   = normalize(Q1*st2.t - Q2*st1.t);
-    vec3 B   = -normalize(cross(N, T));
+#ifndef NORMAL_MAP
+    return normalize(Normal);
+#else
+    // only xy is stored when the map is BC5 compressed, z is rebuilt from the unit length
+    vec3 tangentNormal;
+    tangentNormal.xy = texture(normalMap, TexCoord).xy * 2.0 - 1.0;
+    tangentNormal.z  = sqrt(max(0.0, 1.0 - dot(tangentNormal.xy, tangentNormal.xy)));
+
+    vec3 N = normalize(Normal);
+    vec3 T;
+    float handedness = Tangent.w;
+    if (dot(Tangent.xyz, Tangent.xyz) > 1e-8) {
+        // re-orthogonalize, the interpolated tangent drifts off the normal
+        T = normalize(Tangent.xyz - N * dot(N, Tangent.xyz));
+    } else {
+        // mesh without UVs or tangents: derive one from the screen space derivatives
+        vec3 Q1  = dFdx(FragPos);
+        vec3 Q2  = dFdy(FragPos);
+        vec2 st1 = dFdx(TexCoord);
+        vec2 st2 = dFdy(TexCoord);
+        T = normalize(Q1*st2.t - Q2*st1.t);
+        handedness = -1.0;
+    }
+    vec3 B   = cross(N, T) * handedness;
     mat3 TBN = mat3(T, B, N);
 
     return normalize(TBN * tangentNormal);
+#endif
 }
 
 // distribution approx
@@ -82,9 +112,20 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness)
 
 void main()
 {		
-    vec3 albedo     = pow(texture(albedoMap, TexCoord).rgb, vec3(2.2));
-    float metallic  = texture(metallicMap, TexCoord).r;
-    float roughness = texture(roughnessMap, TexCoord).r;
+    vec4 albedoSample = texture(albedoMap, TexCoord);
+#ifdef ALPHA_TEST
+    if (albedoSample.a < alphaCutoff)
+        discard;
+#endif
+    vec3 albedo     = pow(albedoSample.rgb, vec3(2.2));
+#ifdef UNLIT
+    FragColor = vec4(albedoSample.rgb, 1.0);
+    return;
+#endif
+    // glTF channels: occlusion in r, roughness in g, metallic in b, the
+    // layout TextureCooker packs to. Grayscale maps are swizzled to all three
+    float metallic  = texture(metallicMap, TexCoord).b;
+    float roughness = texture(roughnessMap, TexCoord).g;
     float ao        = texture(aoMap, TexCoord).r;
 
     vec3 N = getNormal(); // function from book
@@ -127,7 +168,20 @@ void main()
     vec3 kd = 1.0 - F;
     kd *= 1.0 - metallic;
 
+#ifdef SH_IRRADIANCE
+    vec3 irradiance = shIrradiance[0]
+                    + shIrradiance[1] * N.y
+                    + shIrradiance[2] * N.z
+                    + shIrradiance[3] * N.x
+                    + shIrradiance[4] * (N.x * N.y)
+                    + shIrradiance[5] * (N.y * N.z)
+                    + shIrradiance[6] * (3.0 * N.z * N.z - 1.0)
+                    + shIrradiance[7] * (N.x * N.z)
+                    + shIrradiance[8] * (N.x * N.x - N.y * N.y);
+    irradiance = max(irradiance, vec3(0.0));
+#else
     vec3 irradiance = texture(irradianceMap, N).rgb;
+#endif
     vec3 diffuse    = irradiance * albedo;
 
     // sample pre-filter map and lut, then combine via split-sum approx
@@ -1,9 +1,17 @@
 #version 330 core
 
 // Input vertex attributes
-layout (location = 0) in vec3 aPos;        // Vertex position
-layout (location = 1) in vec3 aNormal;     // Vertex normal
+layout (location = 0) in vec3 aPos;        // Vertex position, unorm16 in the mesh bounds if quantized
+layout (location = 1) in vec3 aNormal;     // Vertex normal, or octahedral in xy for compact formats
 layout (location = 2) in vec2 aTexCoord;   // Texture coordinates
+layout (location = 3) in vec4 aTangent;    // Tangent + bitangent sign, or octahedral xy + sign in z (0 = none)
+
+// Constant per mesh, set by Mesh::bind()
+layout (location = 4) in vec4 aPosScale;   // xyz position scale, w = 1 for octahedral normals
+layout (location = 5) in vec3 aPosOffset;  // position offset
+
+// Per instance for Model::bindInstances, the identity otherwise (locations 6 to 9)
+layout (location = 6) in mat4 aInstance;
 
 // Uniform matrices
 uniform mat4 model;         // Model transformation matrix
@@ -14,18 +22,37 @@ uniform mat4 projection;    // Projection transformation matrix
 out vec3 FragPos;       // Fragment position in world space
 out vec3 Normal;        // Fragment normal in world space
 out vec2 TexCoord;      // Texture coordinates
+out vec4 Tangent;       // World space tangent, w = bitangent sign. Zero if the mesh has none
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
 
 void main()
 {
+    // Undo quantization, scale 1 and offset 0 for float positions
+    vec3 position = aPosOffset + aPos * aPosScale.xyz;
+    vec3 normal = aPosScale.w > 0.5 ? octDecode(aNormal.xy) : aNormal;
+    vec4 tangent = aTangent;
+    if (aPosScale.w > 0.5) {
+        tangent = aTangent.z == 0.0 ? vec4(0.0) : vec4(octDecode(aTangent.xy), sign(aTangent.z));
+    }
+
     // Transform vertex position to world space
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    mat4 world = model * aInstance;
+    FragPos = vec3(world * vec4(position, 1.0));
     
     // Transform normal to world space (assuming no non-uniform scaling)
-    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Normal = mat3(transpose(inverse(world))) * normal;
+    Tangent = vec4(mat3(world) * tangent.xyz, tangent.w);
     
     // Pass through texture coordinates
     TexCoord = aTexCoord;
     
     // Transform vertex to clip space
     gl_Position = projection * view * vec4(FragPos, 1.0);
-}
\ No newline at end of file
+}
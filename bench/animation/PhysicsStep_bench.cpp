@@ -0,0 +1,342 @@
+//==============================================================================
+// PhysicsStep_bench.cpp - Physics stepping stress scenes for SauceEngine
+//==============================================================================
+//
+// Every benchmark iteration is one physics step of a full scene:
+//   1. integrate all bodies with an ODESolver over Dxdt-style derivatives
+//   2. broad phase with SpatialHashGrid
+//   3. resolve colliding contacts with animation::collision()
+//
+// Bodies are unit mass spheres, matching the identity inertia assumed by
+// DdtStateToArray. "Boxes" in the stack scenes are approximated by their
+// bounding spheres until there is a box narrow phase.
+//
+// Reported counters (per step unless noted):
+//   derivEvals    derivative function evaluations
+//   contacts      contacts generated by the broad phase and ground
+//   contacts/s    contacts processed per second of wall time
+//   allocs        heap allocations made during the step
+//==============================================================================
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+#include "animation/CollisionDetection.hpp"
+#include "animation/DerivFunc.hpp"
+#include "animation/ODEsolver.hpp"
+#include "animation/SpatialHashGrid.hpp"
+
+//==============================================================================
+// Allocation tracking
+//==============================================================================
+
+namespace {
+    std::atomic<size_t> g_allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using namespace animation;
+
+const int STATE_SIZE = 18;
+const double TIMESTEP = 1.0 / 60.0;
+const double RADIUS = 0.5;
+const double RESTITUTION = 0.2;
+
+//==============================================================================
+// Scene
+//==============================================================================
+
+struct Scene {
+    std::vector<double> state;
+    std::vector<double> nextState;
+    std::vector<Eigen::Vector3d> positions;
+    std::vector<Contact> contacts;
+    std::vector<RigidBody> bodies;
+    RigidBody ground;
+    BodyPairList pairs;
+    SpatialHashGrid grid{2.0 * RADIUS};
+    std::unique_ptr<ODESolver> solver;
+    std::vector<double> bodyState = std::vector<double>(STATE_SIZE);
+    size_t derivEvals = 0;
+    double t = 0.0;
+
+    size_t bodyCount() const { return state.size() / STATE_SIZE; }
+};
+
+void addBody(Scene& scene, double x, double y, double z) {
+    const double body[STATE_SIZE] = {
+        x, y, z,
+        1, 0, 0,  0, 1, 0,  0, 0, 1,
+        0, 0, 0,
+        0, 0, 0
+    };
+    scene.state.insert(scene.state.end(), body, body + STATE_SIZE);
+}
+
+void initScene(Scene& scene, const std::string& solverType) {
+    const size_t n = scene.bodyCount();
+    scene.nextState.resize(scene.state.size());
+    scene.positions.resize(n);
+    scene.bodies.resize(n);
+    scene.contacts.reserve(8 * n);
+    scene.pairs.reserve(8 * n);
+    scene.solver = createODESolver(solverType, TIMESTEP);
+
+    scene.ground = RigidBody{};
+    scene.ground.mass = 1e30;
+    scene.ground.Iinv = glm::mat3(0.0f);
+}
+
+/**
+ * dx/dt for every body in the scene, built from the per-body
+ * helpers in DerivFunc.hpp so the benchmark exercises engine code
+ */
+void sceneDxdt(Scene& scene, double t, const std::vector<double>& x, std::vector<double>& xdot) {
+    scene.derivEvals++;
+    const size_t n = x.size() / STATE_SIZE;
+    for (size_t i = 0; i < n; ++i) {
+        ArrayToState(x, scene.bodyState, static_cast<int>(i * STATE_SIZE));
+        ComputeForceAndTorque(t, scene.bodyState);
+        DdtStateToArray(scene.bodyState, xdot, static_cast<int>(i * STATE_SIZE));
+    }
+}
+
+void loadRigidBody(const std::vector<double>& state, size_t i, RigidBody& body) {
+    const double* s = &state[i * STATE_SIZE];
+    body.mass = 1.0;
+    body.x = triple(s[0], s[1], s[2]);
+    body.P = triple(s[12], s[13], s[14]);
+    body.L = triple(s[15], s[16], s[17]);
+    body.v = body.P;
+    body.omega = body.L;
+    body.Iinv = glm::mat3(1.0f);
+}
+
+void storeRigidBody(const RigidBody& body, std::vector<double>& state, size_t i) {
+    double* s = &state[i * STATE_SIZE];
+    s[12] = body.P.x; s[13] = body.P.y; s[14] = body.P.z;
+    s[15] = body.L.x; s[16] = body.L.y; s[17] = body.L.z;
+}
+
+/**
+ * Advance the scene by one TIMESTEP
+ * @return number of contacts generated this step
+ */
+size_t stepScene(Scene& scene) {
+    scene.solver->ode(scene.state, scene.nextState, scene.t, scene.t + TIMESTEP,
+        [&scene](double t, const std::vector<double>& x, std::vector<double>& xdot) {
+            sceneDxdt(scene, t, x, xdot);
+        });
+    scene.state.swap(scene.nextState);
+    scene.t += TIMESTEP;
+
+    const size_t n = scene.bodyCount();
+    for (size_t i = 0; i < n; ++i) {
+        const double* s = &scene.state[i * STATE_SIZE];
+        scene.positions[i] = Eigen::Vector3d(s[0], s[1], s[2]);
+        loadRigidBody(scene.state, i, scene.bodies[i]);
+    }
+
+    // broad phase
+    scene.grid.build(scene.positions);
+    scene.grid.findPairs(RADIUS, scene.pairs);
+
+    // narrow phase: sphere/sphere and sphere/ground contacts
+    scene.contacts.clear();
+    for (const BodyPair& pair : scene.pairs) {
+        RigidBody& a = scene.bodies[pair.a];
+        RigidBody& b = scene.bodies[pair.b];
+        triple n = a.x - b.x;
+        float dist = glm::length(n);
+        if (dist <= 0.0f) {
+            continue;
+        }
+        n /= dist;
+        Contact c{};
+        c.a = &a;
+        c.b = &b;
+        c.n = n;
+        c.p = b.x + n * static_cast<float>(RADIUS);
+        c.vf = true;
+        scene.contacts.push_back(c);
+
+        // split the penetration evenly so stacks don't sink
+        float depth = static_cast<float>(2.0 * RADIUS) - dist;
+        a.x += n * (0.5f * depth);
+        b.x -= n * (0.5f * depth);
+    }
+    for (RigidBody& body : scene.bodies) {
+        if (body.x.y < RADIUS) {
+            Contact c{};
+            c.a = &body;
+            c.b = &scene.ground;
+            c.n = triple(0.0f, 1.0f, 0.0f);
+            c.p = triple(body.x.x, 0.0f, body.x.z);
+            c.vf = true;
+            scene.contacts.push_back(c);
+            body.x.y = static_cast<float>(RADIUS);
+        }
+    }
+
+    // single resolution sweep; FindAllCollisions iterates to convergence
+    // which is unbounded for resting stacks
+    for (Contact& c : scene.contacts) {
+        if (colliding(&c)) {
+            collision(&c, RESTITUTION);
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        const RigidBody& body = scene.bodies[i];
+        double* s = &scene.state[i * STATE_SIZE];
+        s[0] = body.x.x; s[1] = body.x.y; s[2] = body.x.z;
+        storeRigidBody(body, scene.state, i);
+    }
+    return scene.contacts.size();
+}
+
+const char* solverName(int64_t solver) {
+    return solver == 0 ? "euler" : "rk4";
+}
+
+void runScene(benchmark::State& bench, Scene& scene) {
+    size_t contacts = 0;
+    size_t allocs = 0;
+    scene.derivEvals = 0;
+
+    for (auto _ : bench) {
+        size_t before = g_allocations.load(std::memory_order_relaxed);
+        contacts += stepScene(scene);
+        allocs += g_allocations.load(std::memory_order_relaxed) - before;
+        benchmark::ClobberMemory();
+    }
+
+    bench.counters["bodies"] = static_cast<double>(scene.bodyCount());
+    bench.counters["derivEvals"] = benchmark::Counter(static_cast<double>(scene.derivEvals), benchmark::Counter::kAvgIterations);
+    bench.counters["contacts"] = benchmark::Counter(static_cast<double>(contacts), benchmark::Counter::kAvgIterations);
+    bench.counters["contacts/s"] = benchmark::Counter(static_cast<double>(contacts), benchmark::Counter::kIsRate);
+    bench.counters["allocs"] = benchmark::Counter(static_cast<double>(allocs), benchmark::Counter::kAvgIterations);
+}
+
+//==============================================================================
+// Stress scenes
+//==============================================================================
+
+/** N bodies scattered in a volume, falling freely onto the ground */
+void BM_NBodyFreeFall(benchmark::State& bench) {
+    const int count = static_cast<int>(bench.range(0));
+    Scene scene;
+    std::mt19937 rng(1234);
+    double extent = std::cbrt(static_cast<double>(count)) * 4.0 * RADIUS;
+    std::uniform_real_distribution<double> dist(-extent, extent);
+    for (int i = 0; i < count; ++i) {
+        addBody(scene, dist(rng), 2.0 * extent + dist(rng), dist(rng));
+    }
+    initScene(scene, solverName(bench.range(1)));
+    runScene(bench, scene);
+}
+
+/** Independent vertical stacks of ten bodies resting on the ground */
+void BM_BoxStacks(benchmark::State& bench) {
+    const int stacks = static_cast<int>(bench.range(0));
+    const int height = 10;
+    Scene scene;
+    int side = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(stacks))));
+    for (int s = 0; s < stacks; ++s) {
+        double x = (s % side) * 4.0 * RADIUS;
+        double z = (s / side) * 4.0 * RADIUS;
+        for (int h = 0; h < height; ++h) {
+            addBody(scene, x, RADIUS + h * 2.0 * RADIUS, z);
+        }
+    }
+    initScene(scene, solverName(bench.range(1)));
+    runScene(bench, scene);
+}
+
+/** A square pyramid with jittered bodies that collapses as it runs */
+void BM_PyramidCollapse(benchmark::State& bench) {
+    const int base = static_cast<int>(bench.range(0));
+    Scene scene;
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<double> jitter(-0.05 * RADIUS, 0.05 * RADIUS);
+    for (int layer = 0; layer < base; ++layer) {
+        int side = base - layer;
+        double offset = layer * RADIUS;
+        for (int i = 0; i < side; ++i) {
+            for (int k = 0; k < side; ++k) {
+                addBody(scene,
+                    offset + i * 2.0 * RADIUS + jitter(rng),
+                    RADIUS + layer * 2.0 * RADIUS,
+                    offset + k * 2.0 * RADIUS + jitter(rng));
+            }
+        }
+    }
+    initScene(scene, solverName(bench.range(1)));
+    runScene(bench, scene);
+}
+
+/** A random heap that is simulated until settled before timing starts */
+void BM_SettledPile(benchmark::State& bench) {
+    const int count = static_cast<int>(bench.range(0));
+    Scene scene;
+    std::mt19937 rng(7);
+    double extent = std::sqrt(static_cast<double>(count)) * RADIUS;
+    std::uniform_real_distribution<double> dist(-extent, extent);
+    std::uniform_real_distribution<double> height(RADIUS, 6.0 * extent);
+    for (int i = 0; i < count; ++i) {
+        addBody(scene, dist(rng), height(rng), dist(rng));
+    }
+    initScene(scene, solverName(bench.range(1)));
+    for (int i = 0; i < 300; ++i) {
+        stepScene(scene);
+    }
+    runScene(bench, scene);
+}
+
+// second argument selects the solver: 0 = euler, 1 = rk4
+BENCHMARK(BM_NBodyFreeFall)
+    ->ArgNames({"bodies", "rk4"})
+    ->ArgsProduct({{64, 512, 4096}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_BoxStacks)
+    ->ArgNames({"stacks", "rk4"})
+    ->ArgsProduct({{1, 16, 100}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_PyramidCollapse)
+    ->ArgNames({"base", "rk4"})
+    ->ArgsProduct({{5, 10, 20}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK(BM_SettledPile)
+    ->ArgNames({"bodies", "rk4"})
+    ->ArgsProduct({{256, 2048}, {0, 1}})
+    ->Unit(benchmark::kMicrosecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
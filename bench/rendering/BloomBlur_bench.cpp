@@ -0,0 +1,210 @@
+//==============================================================================
+// BloomBlur_bench.cpp - Bloom blur paths of SauceEngine compared on the GPU
+//==============================================================================
+//
+// Every benchmark iteration is one applyBloomWithKernel (or applyBloomMipChain)
+// on a 1280x720 RGBA16F bright texture of random values, followed by glFinish
+// so the GPU time is measured, not just the submission.
+//
+//   fragment   two fullscreen passes, bilinear merged taps (blur.frag)
+//   compute    two dispatches, shared memory tiles plus apron (blur.comp)
+//   mipchain   13-tap downsample, tent upsample (dual filter)
+//
+// Runs headless on a hidden GLFW window. Without a GPU, use Mesa llvmpipe:
+//
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run ./BloomBlur_bench
+//
+// The shaders are loaded from shaders/bloom/, run it from src/rendering.
+//
+// Reported counters:
+//   taps        texture fetches per pixel of one blur direction
+//   maxError    largest difference of the compute result from the fragment
+//               result over the whole image, checked once before timing
+//==============================================================================
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "rendering/Bloom.hpp"
+
+namespace {
+
+const int WIDTH = 1280;
+const int HEIGHT = 720;
+
+//==============================================================================
+// Context
+//==============================================================================
+
+struct Context {
+    GLFWwindow* window = nullptr;
+    GLuint sceneTex = 0;
+    GLuint brightTex = 0;
+    bool ready = false;
+    bool computeAvailable = false;
+};
+
+GLuint createTexture(const std::vector<float>& texels) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WIDTH, HEIGHT, 0, GL_RGBA, GL_FLOAT, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return texture;
+}
+
+// created on first use, lives until the process exits
+Context& context() {
+    static Context ctx;
+    static bool initialized = false;
+    if (initialized) {
+        return ctx;
+    }
+    initialized = true;
+
+    if (!glfwInit()) {
+        return ctx;
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // ask for 4.3 for the compute path, settle for 3.3
+    const int versions[2][2] = {{4, 3}, {3, 3}};
+    for (const auto& version : versions) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, version[0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, version[1]);
+        ctx.window = glfwCreateWindow(1, 1, "BloomBlur_bench", nullptr, nullptr);
+        if (ctx.window) {
+            break;
+        }
+    }
+    if (!ctx.window) {
+        return ctx;
+    }
+    glfwMakeContextCurrent(ctx.window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        return ctx;
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> value(0.f, 4.f);
+    std::vector<float> texels(size_t(WIDTH) * HEIGHT * 4);
+    for (float& t : texels) {
+        t = value(rng);
+    }
+    ctx.brightTex = createTexture(texels);
+    std::fill(texels.begin(), texels.end(), 0.f);
+    ctx.sceneTex = createTexture(texels);
+
+    if (!initBloom(WIDTH, HEIGHT)) {
+        return ctx;
+    }
+    ctx.computeAvailable = setBloomComputeBlur(true);
+    ctx.ready = true;
+    return ctx;
+}
+
+std::vector<float> readTexture(GLuint texture) {
+    std::vector<float> texels(size_t(WIDTH) * HEIGHT * 4);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, texels.data());
+    return texels;
+}
+
+// blur the same input both ways, largest difference of the composites
+double compareBlurPaths(Context& ctx, int radius) {
+    setBloomComputeBlur(false);
+    std::vector<float> fragment = readTexture(applyBloomWithKernel(ctx.sceneTex, ctx.brightTex, radius, -1.f, 1.f));
+    setBloomComputeBlur(true);
+    std::vector<float> compute = readTexture(applyBloomWithKernel(ctx.sceneTex, ctx.brightTex, radius, -1.f, 1.f));
+
+    double maxError = 0.0;
+    for (size_t i = 0; i < fragment.size(); ++i) {
+        maxError = std::max(maxError, double(std::fabs(fragment[i] - compute[i])));
+    }
+    return maxError;
+}
+
+bool prepare(benchmark::State& state, Context*& ctx) {
+    ctx = &context();
+    if (!ctx->ready) {
+        state.SkipWithError("no GL context or bloom shaders, see the header of this file");
+        return false;
+    }
+    return true;
+}
+
+//==============================================================================
+// Benchmarks
+//==============================================================================
+
+void BM_FragmentBlur(benchmark::State& state) {
+    Context* ctx;
+    if (!prepare(state, ctx)) {
+        return;
+    }
+    int radius = int(state.range(0));
+    setBloomComputeBlur(false);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(applyBloomWithKernel(ctx->sceneTex, ctx->brightTex, radius, -1.f, 1.f));
+        glFinish();
+    }
+    state.counters["taps"] = double(1 + 2 * ((radius + 1) / 2));
+}
+
+void BM_ComputeBlur(benchmark::State& state) {
+    Context* ctx;
+    if (!prepare(state, ctx)) {
+        return;
+    }
+    if (!ctx->computeAvailable) {
+        state.SkipWithError("compute blur needs GL 4.3");
+        return;
+    }
+    int radius = int(state.range(0));
+    state.counters["maxError"] = compareBlurPaths(*ctx, radius);
+    setBloomComputeBlur(true);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(applyBloomWithKernel(ctx->sceneTex, ctx->brightTex, radius, -1.f, 1.f));
+        glFinish();
+    }
+    // shared memory reads, one texture fetch per pixel plus the apron
+    state.counters["taps"] = double(1 + 2 * radius);
+}
+
+void BM_MipChain(benchmark::State& state) {
+    Context* ctx;
+    if (!prepare(state, ctx)) {
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(applyBloomMipChain(ctx->sceneTex, ctx->brightTex, -1.f, 1.f));
+        glFinish();
+    }
+}
+
+BENCHMARK(BM_FragmentBlur)
+    ->ArgName("radius")
+    ->Arg(4)->Arg(16)->Arg(63)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ComputeBlur)
+    ->ArgName("radius")
+    ->Arg(4)->Arg(16)->Arg(63)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_MipChain)
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,32 @@
+#ifndef ANIMATION_BROADPHASE_HPP
+#define ANIMATION_BROADPHASE_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace animation {
+
+/**
+ * @brief A pair of bodies whose bounds overlap and need narrow phase testing
+ *
+ * Every broad phase writes its output as a list of these, with a < b,
+ * so the narrow phase does not need to care which structure produced them.
+ */
+struct BodyPair {
+    uint32_t a;
+    uint32_t b;
+};
+
+inline bool operator==(const BodyPair &lhs, const BodyPair &rhs) {
+    return lhs.a == rhs.a && lhs.b == rhs.b;
+}
+
+inline bool operator<(const BodyPair &lhs, const BodyPair &rhs) {
+    return lhs.a < rhs.a || (lhs.a == rhs.a && lhs.b < rhs.b);
+}
+
+typedef std::vector<BodyPair> BodyPairList;
+
+} // namespace animation
+
+#endif // ANIMATION_BROADPHASE_HPP
@@ -5,20 +5,15 @@
 #include <Eigen/Geometry>
 #include <cmath>
 
+#include "animation/ODEsolver.hpp"
+
 namespace animation {
 
-/**
- * @brief Function pointer type for derivative functions in ODE systems
- * 
- * This typedef defines the signature for functions that compute derivatives
- * in ordinary differential equation systems of the form dx/dt = f(t, x).
- * Following the format from Pixar's "Physically Based Modeling" section 3.
- * 
- * @param t Current time value
- * @param x Current state vector array
- * @param xdot Output vector for computed derivatives (dx/dt)
+/*
+ * The DerivFunc type for functions computing dx/dt = f(t, x) is declared in
+ * ODEsolver.hpp, so that derivative functions in this file can be handed
+ * straight to an ODESolver.
  */
-typedef void (*DerivFunc)(double t, const std::vector<double> &x, std::vector<double> &xdot);
 
 /**
  * @brief Main derivative function for rigid body simulation (Section 3 format)
@@ -0,0 +1,125 @@
+#ifndef ANIMATION_SPATIALHASHGRID_HPP
+#define ANIMATION_SPATIALHASHGRID_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <Eigen/Core>
+
+#include "animation/BroadPhase.hpp"
+
+namespace animation {
+
+/**
+ * @brief Uniform spatial hash grid broad phase for many small bodies
+ *
+ * Intended for large numbers of similarly sized bodies (debris, particles)
+ * where a bounding volume hierarchy is overkill. Bodies are bucketed by the
+ * hash of the cell containing their centre and stored cell-sorted, so that
+ * every body in a bucket is contiguous in memory.
+ *
+ * The grid is rebuilt from scratch every step with a two-level parallel
+ * counting sort (first into a fixed number of bins, then into buckets inside
+ * each bin), which is O(n) with memory proportional to the body count.
+ *
+ * Usage:
+ *   SpatialHashGrid grid(2.0 * radius);
+ *   grid.build(positions);
+ *   grid.findPairs(radius, pairs);
+ */
+class SpatialHashGrid {
+public:
+    /**
+     * @param cellSize Edge length of a grid cell, should be at least
+     *                 the diameter of the largest body
+     * @param numThreads Worker threads used by build() and findPairs(),
+     *                   0 picks std::thread::hardware_concurrency()
+     */
+    explicit SpatialHashGrid(double cellSize, unsigned int numThreads = 0);
+
+    void setCellSize(double cellSize);
+    double getCellSize() const { return m_cellSize; }
+
+    void setNumThreads(unsigned int numThreads);
+    unsigned int getNumThreads() const { return m_numThreads; }
+
+    /**
+     * @brief Rebuild the grid from body centres
+     * @param positions World space centre of each body, indexed by body id
+     */
+    void build(const std::vector<Eigen::Vector3d> &positions);
+
+    /**
+     * @brief Call fn(otherBody) for every body sharing a bucket with one of
+     *        the 27 cells surrounding <body>, excluding <body> itself
+     *
+     * Hash collisions can report bodies that are not actually adjacent,
+     * so callers still need an exact overlap test.
+     */
+    template<typename Fn>
+    void forEachNeighbour(uint32_t body, Fn &&fn) const;
+
+    /**
+     * @brief Report every pair of bodies of radius <radius> whose spheres overlap
+     * @param radius Radius shared by all bodies, must be at most cellSize / 2
+     * @param pairs Output list of overlapping pairs with a < b, cleared first
+     */
+    void findPairs(double radius, BodyPairList &pairs) const;
+
+    size_t getBodyCount() const { return m_sortedBodies.size(); }
+    size_t getBucketCount() const { return m_bucketStart.empty() ? 0 : m_bucketStart.size() - 1; }
+
+    /** Body ids in cell-sorted order */
+    const std::vector<uint32_t> &getSortedBodies() const { return m_sortedBodies; }
+
+private:
+    double m_cellSize;
+    double m_invCellSize;
+    unsigned int m_numThreads;
+    uint32_t m_bucketMask = 0;
+
+    // per body, indexed by body id
+    std::vector<Eigen::Vector3i> m_bodyCell;
+    std::vector<uint32_t> m_bodyBucket;
+
+    // cell-sorted storage, m_bucketStart has one extra entry at the end
+    std::vector<uint32_t> m_bucketStart;
+    std::vector<uint32_t> m_sortedBodies;
+    std::vector<Eigen::Vector3d> m_sortedPositions;
+
+    // upper bound on the number of bins used by the first sort level
+    static constexpr uint32_t MAX_BINS = 256;
+
+    // first sort level, body ids grouped by bin and the bin offsets into it
+    std::vector<uint32_t> m_binnedBodies;
+    std::vector<uint32_t> m_binStart;
+
+    // per thread bin histograms reused between builds, MAX_BINS x threads at most
+    std::vector<uint32_t> m_threadCounts;
+
+    uint32_t hashCell(int x, int y, int z) const;
+
+    /**
+     * Collects the distinct buckets of the 27 cells around <cell>,
+     * returns how many were written to <buckets>
+     */
+    int neighbourBuckets(const Eigen::Vector3i &cell, std::array<uint32_t, 27> &buckets) const;
+};
+
+template<typename Fn>
+void SpatialHashGrid::forEachNeighbour(uint32_t body, Fn &&fn) const {
+    std::array<uint32_t, 27> buckets;
+    int n = neighbourBuckets(m_bodyCell[body], buckets);
+    for (int i = 0; i < n; ++i) {
+        for (uint32_t s = m_bucketStart[buckets[i]]; s < m_bucketStart[buckets[i] + 1]; ++s) {
+            uint32_t other = m_sortedBodies[s];
+            if (other != body) {
+                fn(other);
+            }
+        }
+    }
+}
+
+} // namespace animation
+
+#endif // ANIMATION_SPATIALHASHGRID_HPP
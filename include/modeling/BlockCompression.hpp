@@ -0,0 +1,72 @@
+#ifndef BLOCK_COMPRESSION_HPP
+#define BLOCK_COMPRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "modeling/Material.hpp"
+
+namespace modeling {
+
+/**
+ * @brief CPU encoder and decoder for the block formats of TextureFormat
+ *
+ * BC7 blocks are always written in mode 6 (one subset, 7 bit RGBA
+ * endpoints with p-bits, 4 bit indices). That is the cheapest BC7 mode to
+ * search and fine for the smooth content of material textures, it is not
+ * a replacement for an offline encoder searching every mode. The decoder
+ * only understands mode 6, which is all the encoder produces.
+ *
+ * BC5 is two independent BC4 channels, searched exhaustively per texel.
+ */
+class BlockCompression {
+public:
+    /**
+     * @brief Encode one 4x4 block
+     * @param rgba 16 texels, 4 bytes each, row major
+     * @param block Output, 16 bytes
+     */
+    static void encodeBC7Block(const uint8_t* rgba, uint8_t* block);
+
+    /**
+     * @brief Decode one mode 6 block into 16 RGBA texels
+     * @return False if the block uses another mode
+     */
+    static bool decodeBC7Block(const uint8_t* block, uint8_t* rgba);
+
+    /**
+     * @brief Encode one 4x4 block
+     * @param rg 16 texels, 2 bytes each, row major
+     * @param block Output, 16 bytes
+     */
+    static void encodeBC5Block(const uint8_t* rg, uint8_t* block);
+
+    /**
+     * @brief Decode one block into 16 RG texels
+     */
+    static void decodeBC5Block(const uint8_t* block, uint8_t* rg);
+
+    /**
+     * @brief Encode a whole image
+     * @param format BC5 or BC7
+     * @param pixels Raw texels with <channels> bytes each. BC5 takes the first two
+     *               channels, BC7 fills missing channels like OpenGL does (0, 0, 1)
+     * @param blocks Output, Texture::image_size(format, width, height, 0) bytes
+     *
+     * Edge blocks of sizes that aren't a multiple of 4 repeat the last row/column.
+     */
+    static void encodeImage(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height,
+                            uint32_t channels, uint8_t* blocks);
+
+    /**
+     * @brief Decode a whole image
+     * @param pixels Output, RG texels for BC5 and RGBA texels for BC7
+     * @return False if a BC7 block uses an unsupported mode
+     */
+    static bool decodeImage(TextureFormat format, const uint8_t* blocks, uint32_t width, uint32_t height,
+                            uint8_t* pixels);
+};
+
+} // namespace modeling
+
+#endif // BLOCK_COMPRESSION_HPP
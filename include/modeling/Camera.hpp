@@ -1,3 +1,6 @@
+#ifndef CAMERA_HPP
+#define CAMERA_HPP
+
 #include <Eigen/Core>
 #include <Eigen/Dense>
 
@@ -38,8 +41,22 @@ class Camera {
         Vector3f getDirection() { return front; }
 		Matrix4f getView() { return view; }
 
+        /*
+         * perspective projection for the view matrix: view space looks
+         * down +z, which maps to OpenGL clip space (-w <= z <= w) between
+         * <nearPlane> and <farPlane>
+         */
+        Matrix4f getProjection(float aspect, float nearPlane, float farPlane) const;
+
         float getFOV() { return fov; }
 
+        /*
+         * size in pixels of one world unit seen at <point>, on a viewport
+         * <viewportHeight> pixels high. multiply by a distance, e.g. a
+         * mesh LOD error, to get its projected size
+         */
+        float getPixelsPerUnit(Vector3f point, float viewportHeight) const;
+
         Camera(Vector3f pos, Vector3f front);
 
     private:
@@ -54,6 +71,7 @@ class Camera {
         /* view matrix */
         Matrix4f view;
 
+        /* vertical field of view, degrees */
         float fov;
 
         /*
@@ -67,3 +85,5 @@ class Camera {
 		 */
 		static Matrix4f lookat(Vector3f right, Vector3f up, Vector3f direction, Vector3f pos);
 };
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+
+namespace modeling {
+
+/**
+ * @brief The six clip planes of a view volume
+ *
+ * Planes are extracted from a projection matrix (Gribb and Hartmann 2001)
+ * and are in whatever space the matrix maps from: the planes of
+ * projection * view * model are in the model's own space, so bounds can
+ * be tested without transforming them.
+ */
+struct Frustum {
+    enum Plane { PLANE_LEFT, PLANE_RIGHT, PLANE_BOTTOM, PLANE_TOP, PLANE_NEAR, PLANE_FAR, PLANE_COUNT };
+
+    // xyz unit normal pointing inside, w offset: dot(xyz, p) + w >= 0 inside
+    glm::vec4 planes[PLANE_COUNT];
+
+    /**
+     * @brief Planes of an OpenGL style (-w <= z <= w) clip space matrix
+     */
+    static Frustum fromMatrix(const glm::mat4& clipFromSpace);
+
+    /**
+     * @brief false only if the sphere is entirely outside one of the planes
+     *
+     * Conservative: spheres near a corner outside the volume may still pass.
+     */
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+};
+
+} // namespace modeling
+
+#endif // FRUSTUM_HPP
@@ -0,0 +1,120 @@
+#ifndef GEOMETRY_ARENA_HPP
+#define GEOMETRY_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "modeling/VertexFormat.hpp"
+#include "utils/OffsetAllocator.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Where one mesh lives in the GeometryArena
+ *
+ * Indices are relative to the mesh's own first vertex, draws pass
+ * baseVertex (glDrawElementsBaseVertex, or the indirect command field).
+ */
+struct GeometryRange {
+    static constexpr uint32_t NO_POOL = 0xffffffffu;
+
+    uint32_t pool = NO_POOL;
+    // GeometryArena::shutdown() count at allocation, older ranges are stale
+    uint32_t generation = 0;
+    uint32_t baseVertex = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+
+    bool valid() const { return pool != NO_POOL; }
+};
+
+/**
+ * @brief Vertex and index buffers shared by every mesh
+ *
+ * Instead of a VAO, VBO and EBO per mesh, meshes are sub-allocated from a
+ * few large buffers. There is one pool per vertex layout and index type,
+ * each with a single VAO, so switching between meshes of a pool needs no
+ * state change at all and a whole pool can be drawn with one
+ * glMultiDrawElementsIndirect (see GeometryBatch).
+ *
+ * Pools start small and double when full, copying their contents on the
+ * GPU. A pool whose last mesh is freed releases its buffers, so as with
+ * per-mesh buffers, everything is gone once the meshes are.
+ *
+ * The arena outlives any one context, call shutdown() before destroying
+ * the context it uploaded to.
+ *
+ * Main thread only, like every other OpenGL call.
+ */
+class GeometryArena {
+public:
+    // capacity of a new pool, in vertices and indices
+    static constexpr uint32_t INITIAL_VERTICES = 1u << 16;
+    static constexpr uint32_t INITIAL_INDICES = 1u << 18;
+
+    GeometryArena();
+    ~GeometryArena();
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+    /**
+     * @brief Arena used by every Mesh, created on first use
+     */
+    static GeometryArena& shared();
+
+    /**
+     * @brief Upload one mesh
+     * @param vertexData <vertexCount> vertices already encoded with <encoding>
+     * @param indexData <indexCount> 16 bit indices if <shortIndices>, 32 bit otherwise
+     */
+    GeometryRange allocate(const VertexEncoding& encoding, bool shortIndices,
+                           const void* vertexData, uint32_t vertexCount,
+                           const void* indexData, uint32_t indexCount);
+
+    /**
+     * @brief Give the space of a mesh back, ranges from before shutdown() are ignored
+     */
+    void free(const GeometryRange& range);
+
+    /**
+     * @brief Delete the GL objects of every pool, while their context is still current
+     *
+     * Meshes still alive keep stale ranges, they can be destroyed but not
+     * drawn. The arena can be used again with a new context afterwards.
+     */
+    void shutdown();
+
+    /**
+     * @brief Bind the VAO of a pool, its element buffer included
+     *
+     * Also resets the constant instance transform at locations 6 to 9
+     * to the identity.
+     */
+    void bind(uint32_t pool) const;
+
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, and its size in bytes
+    unsigned int getIndexType(uint32_t pool) const;
+    size_t getIndexSize(uint32_t pool) const;
+
+    size_t getPoolCount() const { return pools.size(); }
+
+    // bytes of GPU buffers held, and the part of them meshes use
+    size_t getReservedBytes() const;
+    size_t getUsedBytes() const;
+
+private:
+    struct Pool;
+    std::vector<std::unique_ptr<Pool>> pools;
+    uint32_t generation = 0;
+
+    uint32_t findPool(const VertexEncoding& encoding, bool shortIndices);
+    void grow(Pool& pool, uint32_t vertexCapacity, uint32_t indexCapacity);
+};
+
+} // namespace modeling
+
+#endif // GEOMETRY_ARENA_HPP
@@ -0,0 +1,92 @@
+#ifndef GEOMETRY_BATCH_HPP
+#define GEOMETRY_BATCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "modeling/Mesh.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Draws many meshes with one call per GeometryArena pool
+ *
+ * Collect the meshes (or LOD levels) to draw with add(), then submit()
+ * sorts them by pool and issues a single glMultiDrawElementsIndirect per
+ * pool. The per mesh decode parameters of compact vertex formats
+ * (attributes 4 and 5, see Mesh::bind) come from a per draw buffer that
+ * each command selects through its baseInstance.
+ *
+ * Indirect draws need OpenGL 4.3. On older contexts every pool still binds
+ * its VAO once and the meshes are drawn one by one with
+ * glDrawElementsBaseVertex, so only the draw calls are saved, not the
+ * state changes.
+ *
+ * The bound shader and material state are the caller's, a batch only
+ * draws geometry.
+ */
+class GeometryBatch {
+public:
+    GeometryBatch();
+    ~GeometryBatch();
+
+    GeometryBatch(const GeometryBatch&) = delete;
+    GeometryBatch& operator=(const GeometryBatch&) = delete;
+
+    /**
+     * @brief Queue level <lod> of <mesh>, meshes without GPU data are skipped
+     */
+    void add(const Mesh& mesh, size_t lod = 0);
+
+    void clear() { draws.clear(); }
+    size_t size() const { return draws.size(); }
+
+    /**
+     * @brief Draw everything queued, the queue is kept
+     * @return Number of draw calls issued
+     */
+    size_t submit();
+
+    /**
+     * @brief true if submit() can use indirect draws in the current context
+     */
+    static bool indirectSupported();
+
+private:
+    // layout fixed by glMultiDrawElementsIndirect
+    struct DrawCommand {
+        uint32_t count;
+        uint32_t instanceCount;
+        uint32_t firstIndex;
+        int32_t baseVertex;
+        uint32_t baseInstance;
+    };
+
+    // attributes 4 and 5 of one draw
+    struct DrawParameters {
+        glm::vec4 scale;
+        glm::vec4 offset;
+    };
+
+    struct Draw {
+        uint32_t pool;
+        DrawCommand command;
+        DrawParameters parameters;
+    };
+
+    std::vector<Draw> draws;
+    std::vector<DrawCommand> commands;
+    std::vector<DrawParameters> parameters;
+    unsigned int commandBuffer = 0;
+    unsigned int parameterBuffer = 0;
+
+    size_t submitIndirect();
+    size_t submitDirect();
+};
+
+} // namespace modeling
+
+#endif // GEOMETRY_BATCH_HPP
@@ -2,46 +2,82 @@
 #include "modeling/Material.hpp"
 #include "modeling/Model.hpp"
 #include "modeling/Mesh.hpp"
+#include "modeling/ResidencyManager.hpp"
+#include "utils/FlatHashMap.hpp"
+#include "utils/Shader.hpp"
+#include "utils/ShaderVariants.hpp"
+#include "utils/StringId.hpp"
+#include <Eigen/Core>
 #include <assimp/scene.h>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <optional>
+#include <vector>
 
+namespace modeling {
+    struct ImportedScene;
+    class TextureUploader;
+}
+
+// mutex and condition variable of an AssetManager, see LoadHandle::cancel
+struct LoadSignal;
+
+// Keys are created by AssetManager::model_key and friends. <generation>
+// is the scene's generation when the key was made, keys into a scene that
+// was unloaded since are rejected as stale. Scene generations start at 1,
+// so default constructed keys are always stale.
 struct ModelKey{
     int scene;
     int id;
+    uint32_t generation = 0;
 };
 
 // temporary Key definition
 struct MeshKey{
     int scene;
     int id;
+    uint32_t generation = 0;
 };
 
 // temporary Key definition
 struct MaterialKey{
     int scene;
     MaterialHandle id;
+    uint32_t generation = 0;
 };
 
 // temporary Key definition
 struct TextureKey{
     int scene;
     int id;
+    uint32_t generation = 0;
 };
 
 // loaded GLTF file contents
 struct LoadedContents {
-    MaterialManager materials;
+    std::vector<std::shared_ptr<modeling::Model>> models;
+
+    // indexed by MaterialHandle
+    std::vector<std::shared_ptr<Material>> materials;
+
+    // every distinct mesh and texture referenced by the models
+    std::vector<std::shared_ptr<Mesh>> meshes;
+    std::vector<const Texture*> textures;
 
-    std::vector<modeling::Model> models;
+    // material name -> index into materials
+    FlatHashMap<StringId, size_t> material_lookup;
 
-    std::vector<Mesh> &loaded_meshes;
+    LoadedContents() = default;
 
 private:
     // no copy
     LoadedContents(const LoadedContents&) = delete;
     LoadedContents& operator=(const LoadedContents&) = delete;
-    
+
     // no move
     LoadedContents(LoadedContents&&) = delete;
     LoadedContents& operator=(LoadedContents&&) = delete;
@@ -51,44 +87,231 @@ private:
 struct SceneObjects {
     // Path to GLTF file
     std::string path;
-    
+    StringId id;
+
+    // bumped on every unload, see ModelKey. Never 0
+    uint32_t generation = 1;
+
     // maybe loaded contents
     std::optional<LoadedContents> contents;
 
+    explicit SceneObjects(StringId id): path(id.str()), id(id) {}
+
 private:
     // no copy
     SceneObjects(const SceneObjects&) = delete;
     SceneObjects& operator=(const SceneObjects&) = delete;
-    
+
     // no move
     SceneObjects(SceneObjects&&) = delete;
     SceneObjects& operator=(SceneObjects&&) = delete;
 };
 
+// Lifecycle of an asynchronous load
+enum class LoadState {
+    Queued,     // waiting for a free worker
+    Decoding,   // being imported on a worker thread
+    Decoded,    // CPU work done, waiting for AssetManager::poll to upload it
+    Loaded,     // uploaded, the scene can be queried
+    Failed,     // the file could not be imported
+    Cancelled   // dropped from the queue, unloaded or cancelled before finishing
+};
+
+// Shared handle to a file load started by AssetManager::load_file.
+// Handles can be copied freely and queried from any thread.
+class LoadHandle {
+public:
+    LoadHandle() = default;
+
+    // false for a default constructed handle
+    bool valid() const { return request != nullptr; }
+
+    const std::string& path() const;
+    LoadState state() const;
+
+    // completed fraction of the load in [0, 1]
+    float progress() const;
+
+    // true once the load is Loaded, Failed or Cancelled
+    bool done() const;
+
+    // reason of a Failed or Cancelled load
+    std::string error() const;
+
+    // index of the loaded scene, for ModelKey::scene and friends, -1 until Loaded
+    int scene() const;
+
+    // stop the load if it hasn't been uploaded yet, wakes up wait_all
+    void cancel();
+
+    // becomes ready with the final state once done().
+    // Loads only finish inside AssetManager::poll, so never block on
+    // this from the thread that calls poll.
+    std::shared_future<LoadState> future() const;
+
+private:
+    friend class AssetManager;
+    struct Request;
+    std::shared_ptr<Request> request;
+
+    explicit LoadHandle(std::shared_ptr<Request> request): request(std::move(request)) {}
+};
+
 // Manages all assets from all files
+//
+// Files are imported on ThreadPool::shared() in the background. The frame
+// loop calls poll() once per frame to upload finished imports to the GPU,
+// so a load never stalls rendering for the whole import.
+// Apart from LoadHandle queries, every method must be called from the
+// thread that owns the OpenGL context.
+//
+// Loaded scenes are tracked by a ResidencyManager. When the CPU or GPU
+// memory budget is exceeded, poll() unloads the least recently used
+// unpinned scenes. Getting an asset from an unloaded scene counts as a
+// miss, queues the file again and throws (or returns nullptr from the
+// try_get_* variants).
 class AssetManager {
-    std::vector<SceneObjects> scenes;
+    std::deque<SceneObjects> scenes;
     std::vector<modeling::Model> custom_models;
 
 public:
-    AssetManager() = default;
-    ~AssetManager() = delete;
+    // <shader> is given to every loaded model, nullptr skips GL setup
+    explicit AssetManager(std::shared_ptr<Shader> shader = nullptr);
+    // loaded models take the variant of their material, see
+    // ModelLoader::materialDefines
+    explicit AssetManager(std::shared_ptr<ShaderVariants> variants);
+
+    // cancels queued loads and waits for running imports to stop. With
+    // shaders, destroy the manager before its GL context: it owns the
+    // scenes' textures and the ring they were uploaded through
+    ~AssetManager();
 
     // loading and unloading files
-    void load_file(std::string GLTF_path);
+    //
+    // load_file only queues the file and returns immediately. Loading a file
+    // that is already loaded or queued returns its existing handle.
+    // Without a position the load is queued ahead of all positioned ones.
+    LoadHandle load_file(std::string GLTF_path);
+    LoadHandle load_file(std::string GLTF_path, const Eigen::Vector3f &position);
     void unload_file(std::string GLTF_path);
 
+    // positioned loads closest to this point are imported first
+    void set_viewer_position(const Eigen::Vector3f &position);
+
+    // most loads waiting for a worker. When the queue is full the
+    // farthest load is cancelled to make room
+    void set_max_queued(size_t max_queued);
+
+    // imports that may run at the same time. 0 holds every load in the
+    // queue until it is raised again, see wait_all
+    void set_max_in_flight(size_t max_in_flight);
+
+    // upload up to <max_finalize> decoded files and publish their scenes,
+    // then evict scenes while over the memory budget. Call once per frame.
+    // returns the number of loads that finished (including failures)
+    size_t poll(size_t max_finalize = 1);
+
+    // block until every queued load is done, uploading as they decode.
+    // Returns early, leaving them queued, if loads are held by
+    // set_max_in_flight(0) since they would never start
+    void wait_all();
+
+    // loads not done yet
+    size_t pending_count() const;
+
+    // memory budget of loaded scenes, ResidencyManager::UNLIMITED by default
+    void set_memory_budget(size_t cpu_bytes, size_t gpu_bytes);
+
+    // pinned files are never evicted, even when over budget
+    void pin_file(std::string GLTF_path);
+    void unpin_file(std::string GLTF_path);
+
+    // hit/miss/eviction counters and resident sizes
+    const ResidencyStats& residency_stats() const { return this->residency.stats(); }
+
+    // index of the scene slot of a file, -1 if it was never loaded
+    int find_scene(const std::string &GLTF_path) const;
+
+    // keys into a loaded scene, valid until the file is unloaded
+    ModelKey model_key(int scene, int id) const;
+    MeshKey mesh_key(int scene, int id) const;
+    TextureKey texture_key(int scene, int id) const;
+
+    // key of a material by name, throws std::out_of_range if the scene
+    // isn't loaded or has no such material
+    MaterialKey material_key(int scene, const std::string &name) const;
+
+    // getters count as a use of the scene for eviction.
+    // A key from before the scene was unloaded throws std::invalid_argument,
+    // an id past the scene's assets throws std::out_of_range
     const modeling::Model& get_model(ModelKey id);
     const Material& get_material(MaterialKey id);
     const Texture& get_texture(TextureKey id);
     const Mesh& get_mesh(MeshKey id);
 
+    // like the getters, but return nullptr instead of throwing when the
+    // key is stale or out of range, or the scene isn't resident (a miss
+    // still queues it).
+    // Meant for the frame loop, where eviction can happen any frame
+    const modeling::Model* try_get_model(ModelKey id);
+    const Material* try_get_material(MaterialKey id);
+    const Texture* try_get_texture(TextureKey id);
+    const Mesh* try_get_mesh(MeshKey id);
+
 private:
+    typedef std::shared_ptr<LoadHandle::Request> RequestPtr;
+
+    std::shared_ptr<Shader> shader;
+    std::shared_ptr<ShaderVariants> variants;
+    ResidencyManager residency;
+
+    // texture staging ring of the GL context, created on the first upload
+    std::unique_ptr<modeling::TextureUploader> uploader;
+
+    // path -> index into scenes
+    FlatHashMap<StringId, size_t> scene_lookup;
+
+    // everything below is shared with the workers and guarded by
+    // signal->mutex. Requests share the signal so it outlives the manager
+    std::shared_ptr<LoadSignal> signal;
+    std::vector<RequestPtr> queued;
+    std::vector<RequestPtr> decoded;
+    FlatHashMap<StringId, RequestPtr> active;
+    Eigen::Vector3f viewer = Eigen::Vector3f::Zero();
+    size_t max_queued = 64;
+    size_t max_in_flight = 2;
+    size_t in_flight = 0;
+    uint64_t next_sequence = 0;
+
+    LoadHandle enqueue(const std::string &path, std::optional<Eigen::Vector3f> position);
+
+    // start imports while workers are free, mutex must be held
+    void dispatch();
+    void decode(RequestPtr request);
+
+    // finish a load, mutex must be held
+    void finish(const RequestPtr &request, LoadState state, const std::string &error);
+    void finalize(const RequestPtr &request);
+
+    // closest to the viewer first, unpositioned loads before all others
+    bool loads_before(const RequestPtr &a, const RequestPtr &b) const;
+
+    // contents of <scene>, throws if <generation> is stale,
+    // throws and queues a reload if it isn't resident
+    LoadedContents& resident_contents(int scene, uint32_t generation);
+
+    // same without throwing, nullptr if stale or not resident
+    LoadedContents* find_resident(int scene, uint32_t generation);
+    void evict_over_budget();
+
+    // index of the scene slot for <path>, created if needed
+    size_t scene_for(StringId path);
+
     // no copy
     AssetManager(const AssetManager&) = delete;
     AssetManager& operator=(const AssetManager&) = delete;
-    
+
     // no move
     AssetManager(AssetManager&&) = delete;
     AssetManager& operator=(AssetManager&&) = delete;
-};
\ No newline at end of file
+};
@@ -4,28 +4,65 @@
 #include "assimp/material.h"
 #include <memory>
 #include <vector>
+
+class Shader;
+
+// how the bytes of a `Texture` are encoded
+enum class TextureFormat : uint32_t {
+    // n_channels bytes per texel
+    RAW,
+    // 4x4 blocks of two channels (BC5/RGTC2), used for normal maps:
+    // only x and y are stored, shaders reconstruct z
+    BC5,
+    // 4x4 blocks of RGBA (BC7/BPTC)
+    BC7,
+};
+
 struct Texture {
+    // every mip level back to back, largest first
     const std::unique_ptr<const uint8_t[]> data;
     const uint32_t width;
     const uint32_t height;
     const uint32_t n_channels;
-    const uint32_t id;
+
+    // OpenGL texture name, 0 until a TextureUploader uploaded it
+    uint32_t id;
+
+    // number of mip levels in data, 1 means mips are generated on upload
+    const uint32_t levels;
+    const TextureFormat format;
 
     Texture(
         std::unique_ptr<const uint8_t[]> data,
         uint32_t width,
         uint32_t height,
         uint32_t n_channels,
-        uint32_t id
+        uint32_t id,
+        uint32_t levels = 1,
+        TextureFormat format = TextureFormat::RAW
     ): 
         data(std::move(data)),
         width(width),
         height(height),
         n_channels(n_channels),
-        id(id) {}
+        id(id),
+        levels(levels),
+        format(format) {}
 
     Texture() = delete;
-    ~Texture() = default;
+    // deletes the GL texture if it was uploaded
+    ~Texture();
+
+    // dimensions of mip <level>, never less than 1
+    uint32_t level_width(uint32_t level) const;
+    uint32_t level_height(uint32_t level) const;
+
+    // bytes of mip <level>, and of all levels together
+    size_t level_size(uint32_t level) const;
+    size_t byte_size() const;
+
+    // bytes of a <width> x <height> image in <format>
+    static size_t image_size(TextureFormat format, uint32_t width, uint32_t height, uint32_t n_channels);
     
 private:
     // no copy
@@ -75,9 +112,17 @@ struct Material {
     {};
     ~Material() = default;
 
-    // constructs a `Material` from an imported aiMaterial
+    // constructs a `Material` from an imported aiMaterial, using the
+    // shared CPU side white texture everywhere (upload a material from
+    // modeling::TextureLoader instead). Textures need the whole scene to resolve,
+    // use modeling::TextureLoader::buildMaterials for textured materials
     static Material from_aiMaterial(aiMaterial *material);
 
+    // points the material samplers of <shader> at the texture units they
+    // are drawn from, see modeling::TEXTURE_SLOT_SAMPLERS. Once after linking,
+    // ModelLoader::finalizeScene does so for the shader of its models
+    static void setSamplers(Shader &shader);
+
 private:
     // prevent copies
     Material(const Material&) = delete;
@@ -94,6 +139,7 @@ private:
 struct MaterialHandle {
 public:
     friend class MaterialManager;
+    friend class AssetManager;
 
     // creates a `MaterialHandle` without checking if its valid
     static MaterialHandle new_unchecked(size_t id);
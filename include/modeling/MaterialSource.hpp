@@ -0,0 +1,65 @@
+#ifndef MATERIAL_SOURCE_HPP
+#define MATERIAL_SOURCE_HPP
+
+#include <array>
+#include <string>
+
+namespace modeling {
+
+/**
+ * @brief Texture references of a Material, in member declaration order
+ */
+enum TextureSlot {
+    TEXTURE_BASE_COLOR,
+    TEXTURE_NORMAL,
+    TEXTURE_ALBEDO,
+    TEXTURE_METALLIC,
+    TEXTURE_ROUGHNESS,
+    TEXTURE_AMBIENT_OCCLUSION,
+    TEXTURE_SLOT_COUNT
+};
+
+/**
+ * @brief Sampler of assets/default.frag reading each TextureSlot, nullptr if none
+ *
+ * Slot N is drawn from texture unit N (see rendering::RenderQueue::submit),
+ * Material::setSamplers points these samplers at the same units.
+ */
+constexpr const char* TEXTURE_SLOT_SAMPLERS[TEXTURE_SLOT_COUNT] = {
+    nullptr,  // base color, the same image as albedo
+    "normalMap",
+    "albedoMap",
+    "metallicMap",
+    "roughnessMap",
+    "aoMap",
+};
+
+/**
+ * @brief Where the textures of a material come from
+ *
+ * Each texture is either a normalized file path, "*N" for texture N
+ * embedded in the scene, or empty for the default texture. Equal strings
+ * mean the same image, which is how textures are deduplicated.
+ */
+struct MaterialSource {
+    std::string name;
+    std::array<std::string, TEXTURE_SLOT_COUNT> textures;
+    // KHR_materials_unlit, drawn with the base color only
+    bool unlit = false;
+
+    /**
+     * @return True if any texture is embedded, i.e. needs the aiScene to decode
+     */
+    bool hasEmbeddedTextures() const {
+        for (const std::string& texture : textures) {
+            if (!texture.empty() && texture[0] == '*') {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace modeling
+
+#endif // MATERIAL_SOURCE_HPP
@@ -1,47 +1,175 @@
 #ifndef MESH_HPP
 #define MESH_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <glm/glm.hpp>
 
-#include "shared/Shader.hpp"
+#include "modeling/GeometryArena.hpp"
+#include "modeling/MeshData.hpp"
+#include "modeling/MeshletCuller.hpp"
+#include "modeling/VertexFormat.hpp"
+#include "utils/Span.hpp"
 
 using namespace std;
 
-/*
- * Note: order of parameters matters for struct Vertex,
- * since it will be passed raw to openGL
- */
-struct Vertex {
-	glm::vec3 Position;
-	glm::vec3 Normal;
-	glm::vec2 TexCoords;
-};
-
 class Mesh {
     public:
-		// mesh data
-		vector<Vertex> vertices;
-		vector<unsigned int> indices;
-		Mesh(vector<Vertex> vertices, vector<unsigned int> indices, bool setupGL = true);
+		/*
+		 * <format> is the preferred GPU layout, see chooseVertexEncoding.
+		 * the CPU side vertices stay full floats whatever is uploaded.
+		 * the vectors are moved into the mesh, pass them with std::move
+		 * to avoid copying the geometry
+		 */
+		Mesh(vector<Vertex> vertices, vector<unsigned int> indices, bool setupGL = true,
+			VertexFormat format = VertexFormat::FLOAT, MeshLodView lods = MeshLodView());
+
+		/*
+		 * construct from borrowed buffers, e.g. a mapped MeshCache entry.
+		 * the GPU upload reads straight from <vertices>/<indices>. if
+		 * keepCpuData is set the CPU side data is kept too: as a view
+		 * when <owner> keeps the buffers alive, as a copy otherwise
+		 */
+		Mesh(const Vertex *vertices, size_t vertexCount,
+			const unsigned int *indices, size_t indexCount,
+			bool setupGL = true, bool keepCpuData = true,
+			VertexFormat format = VertexFormat::FLOAT, MeshLodView lods = MeshLodView(),
+			shared_ptr<const void> owner = nullptr);
+
+		/*
+		 * free the CPU side copy once the geometry is on the GPU, it is
+		 * only needed for CPU work like physics or picking. no-op for
+		 * meshes without GPU data, the CPU copy is all they have
+		 */
+		void releaseCpuData();
+		bool hasCpuData() const { return !getVertices().empty(); }
+
+		/*
+		 * read access to the CPU side data, owned or borrowed, for CPU
+		 * work like physics. empty after releaseCpuData
+		 */
+		Span<const Vertex> getVertices() const { return cpuOwner ? borrowedVertices : Span<const Vertex>(vertices); }
+		Span<const unsigned int> getIndices() const { return cpuOwner ? borrowedIndices : Span<const unsigned int>(indices); }
+
+		/* largest QUANTIZED position error allowed before falling back to PACKED */
+		static constexpr float POSITION_TOLERANCE = 1e-4f;
+
+		// frees its GeometryArena range, a Mesh owns it so it can't be copied
+		~Mesh();
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
 
 			// Rendering methods
-		void bind() const;        // Bind VAO for rendering
+		/*
+		 * Bind the VAO of the mesh's arena pool, shared with every mesh of
+		 * the same layout. also sets the constant attributes
+		 * 4 (position scale, w = 1 for octahedral normals) and
+		 * 5 (position offset) that shaders use to decode compact formats
+		 */
+		void bind() const;
+
+		// layout of the GPU vertex buffer
+		const VertexEncoding &getVertexEncoding() const { return encoding; }
+
+		/*
+		 * where the mesh lives in the GeometryArena. GPU indices are
+		 * relative to baseVertex, LOD and meshlet ranges to firstIndex
+		 */
+		const modeling::GeometryRange &getGeometry() const { return geometry; }
+
+		/*
+		 * GL type of the GPU index buffer: GL_UNSIGNED_SHORT when every
+		 * index fits 16 bits, GL_UNSIGNED_INT otherwise. the CPU side
+		 * indices are always unsigned int
+		 */
+		unsigned int getIndexType() const;
+
+		/*
+		 * levels of detail, all in the one index buffer. level 0 is the
+		 * full mesh, the CPU side indices only ever hold level 0
+		 */
+		size_t getLodCount() const { return lods.size(); }
+		const MeshLod &getLod(size_t level) const { return lods[level]; }
+
+		/*
+		 * coarsest level whose error stays below <maxPixelError> pixels on
+		 * screen. <pixelsPerUnit> is the projected size of one mesh unit at
+		 * the mesh, see Camera::getPixelsPerUnit
+		 */
+		size_t selectLod(float pixelsPerUnit, float maxPixelError = 1.f) const;
+
+		/*
+		 * clusters of level 0, see MeshletBuilder. the ranges must lie in
+		 * the index buffer, throws otherwise. meshes without meshlets are
+		 * never culled by cullMeshlets
+		 */
+		void setMeshlets(const Meshlet *meshlets, size_t count);
+		const vector<Meshlet> &getMeshlets() const { return meshlets; }
+
+		/*
+		 * fill <list> with the parts of level 0 that may be visible.
+		 * <frustum> and <eye> are in mesh space, see MeshletCuller.
+		 * returns the number of triangles left to draw
+		 */
+		size_t cullMeshlets(const modeling::Frustum &frustum, const glm::vec3 &eye,
+			modeling::MeshletDrawList &list) const;
+
+		// draw the ranges of a culled list, the VAO must be bound
+		void draw(const modeling::MeshletDrawList &list) const;
+
+		/*
+		 * axis aligned bounds of the positions in mesh space, valid
+		 * even when the CPU side copy was not kept
+		 */
+		const glm::vec3 &getBoundsMin() const { return boundsMin; }
+		const glm::vec3 &getBoundsMax() const { return boundsMax; }
+
+		// counts are valid even when the CPU side copy was not kept
+		size_t getVertexCount() const { return vertexCount; }
+		size_t getIndexCount() const { return indexCount; }
+
+		/*
+		 * bytes held by the CPU side copy and by the GPU buffers.
+		 * borrowed views are not counted, their owner holds the memory
+		 */
+		size_t getCpuBytes() const;
+		size_t getGpuBytes() const;
 
 	private:
+		/*
+		 * owned CPU side data, empty once releaseCpuData was called or when
+		 * the mesh views borrowed buffers. getVertices/getIndices cover both
+		 */
+		vector<Vertex> vertices;
+		vector<unsigned int> indices;
 		// render data
-		unsigned int VAO, VBO, EBO;
+		modeling::GeometryRange geometry;
 		bool glSetup;
-		void setupMesh();
+		size_t vertexCount;
+		size_t indexCount;
+		VertexEncoding encoding;
+		bool shortIndices;
+		vector<MeshLod> lods;
+		vector<Meshlet> meshlets;
+		glm::vec3 boundsMin;
+		glm::vec3 boundsMax;
+		// keeps borrowed CPU side data alive, null when it is owned
+		shared_ptr<const void> cpuOwner;
+		Span<const Vertex> borrowedVertices;
+		Span<const unsigned int> borrowedIndices;
+		void computeBounds(const Vertex *vertexData);
+		void setupMesh(const Vertex *vertexData, const unsigned int *indexData, const MeshLodView &lodData);
+		void setupLods(const MeshLodView &lodData);
+		size_t indexSize() const;
 
 		/*
 		 * helper function, ensure vertices/indices/textures are aligned:
 		 * - no indices outside the range of vertices
 		 * - at least 1 vertex, at least 2 indices
 		 */
-		bool validate();
+		bool validate(const Vertex *vertexData, const unsigned int *indexData) const;
 
 		/*
 		 * getters
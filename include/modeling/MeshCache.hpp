@@ -0,0 +1,181 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "modeling/MaterialSource.hpp"
+#include "modeling/MeshData.hpp"
+#include "modeling/ModelProperties.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Identifies the exact import a cache file was cooked from
+ *
+ * A cache file is only used when the import flags and cooking options
+ * (e.g. LodSettings) match, and the source is the one it was cooked
+ * from. The source is first compared by sourceStamp, the size and
+ * modification time of the asset and its buffers, which only needs a
+ * stat. sourceHash, a hash of their contents, is only needed when the
+ * stamps differ, e.g. after a checkout touched an unchanged file.
+ */
+struct MeshCacheKey {
+    uint64_t sourceHash = 0;
+    uint64_t sourceStamp = 0;
+    uint32_t importFlags = 0;
+    uint64_t optionsHash = 0;
+
+    bool operator==(const MeshCacheKey& other) const {
+        return sourceHash == other.sourceHash && sourceStamp == other.sourceStamp &&
+               importFlags == other.importFlags && optionsHash == other.optionsHash;
+    }
+};
+
+/**
+ * @brief Zero-copy view of one cached mesh
+ *
+ * Points directly into the mapped cache file, valid for as long as the
+ * owning MeshCache is alive. Vertex data is in the exact Vertex layout
+ * so it can be handed to glBufferData or the physics code as-is.
+ */
+struct MeshView {
+    std::string name;
+    const Vertex* vertices = nullptr;
+    uint32_t vertexCount = 0;
+    const uint32_t* indices = nullptr;
+    uint32_t indexCount = 0;
+    uint32_t materialIndex = 0;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    // coarser levels of detail, also pointing into the file
+    MeshLodView lods;
+    // clusters of the full detail indices
+    const Meshlet* meshlets = nullptr;
+    uint32_t meshletCount = 0;
+};
+
+/**
+ * @brief Cooked binary cache of an imported model file
+ *
+ * Produced by ModelLoader after a successful Assimp import and stored next
+ * to the source file (or in setCacheDirectory()). The layout is:
+ *
+ *   FileHeader
+ *   MeshEntry[meshCount]
+ *   MaterialEntry[materialCount]
+ *   uint32_t modelMeshes[modelCount]   (mesh index of each model, in node order)
+ *   float modelTransforms[modelCount][16]  (node to world of each model, column major)
+ *   ExtensionEntry[extensionCount]     (glTF extensions of the scene)
+ *   string blob                        (mesh and material names, texture sources)
+ *   vertex, index, LOD index, MeshLod
+ *   and Meshlet blobs of each mesh     (16 byte aligned)
+ *
+ * Files are written in native endianness and are not meant to be portable
+ * between machines, they are a local cache only.
+ */
+class MeshCache {
+public:
+    ~MeshCache();
+
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    /**
+     * @brief Compute the cache key of a source file
+     * @param sourcePath Path to the model file
+     * @param importFlags Assimp post processing flags used for the import
+     * @return The key, sourceStamp is 0 if the file could not be read.
+     *         sourceHash is left 0, fill it with hashSource() if needed
+     *
+     * Only stats the file. For .gltf files the external buffers referenced
+     * by "uri" are stamped too, which reads the (small) .gltf itself.
+     */
+    static MeshCacheKey computeKey(const std::string& sourcePath, uint32_t importFlags);
+
+    /**
+     * @brief Hash the contents of a source file, and of its buffers for .gltf
+     * @return The hash, 0 if the file could not be read
+     */
+    static uint64_t hashSource(const std::string& sourcePath);
+
+    /**
+     * @brief Path of the cache file for a source file
+     * @param extension Suffix of the cache file, other cooked assets share the cache directory
+     */
+    static std::string cachePathFor(const std::string& sourcePath, const std::string& extension = ".smc");
+
+    /**
+     * @brief Store cache files in <directory> instead of next to the sources
+     * Pass an empty string to go back to the default.
+     */
+    static void setCacheDirectory(const std::string& directory);
+
+    /**
+     * @brief Map a cache file
+     * @param cachePath Path returned by cachePathFor()
+     * @param key Expected key, the file is rejected unless its sourceStamp
+     *            or sourceHash match (zero never matches) along with the
+     *            import flags and options
+     * @return The mapped cache, or nullptr if missing, stale or corrupt
+     */
+    static std::unique_ptr<MeshCache> open(const std::string& cachePath, const MeshCacheKey& key);
+
+    /**
+     * @brief Store key.sourceStamp in an existing cache file
+     *
+     * For a file that was accepted by its sourceHash, so the next open()
+     * matches on the stamp alone again.
+     * @return true on success
+     */
+    static bool restamp(const std::string& cachePath, const MeshCacheKey& key);
+
+    /**
+     * @brief Write a cache file
+     * @param cachePath Destination, written atomically through a temporary file
+     * @param key Key of the import that produced <meshes>
+     * @param meshes Converted meshes, invalid ones are stored empty
+     * @param materials Name and textures of each material referenced by materialIndex
+     * @param modelMeshes Mesh index of each model, in the order models are created
+     * @param modelTransforms World transform of each model, identity for all if empty
+     * @param extensions glTF extensions of the scene, see ModelLoader::loadGLTFExtensions
+     * @return true on success
+     */
+    static bool write(
+        const std::string& cachePath,
+        const MeshCacheKey& key,
+        const std::vector<MeshData>& meshes,
+        const std::vector<MaterialSource>& materials,
+        const std::vector<uint32_t>& modelMeshes,
+        const std::vector<glm::mat4>& modelTransforms = {},
+        const std::unordered_map<std::string, PropertyValue>& extensions = {}
+    );
+
+    size_t getMeshCount() const { return meshes.size(); }
+    const MeshView& getMesh(size_t i) const { return meshes[i]; }
+    const std::vector<MeshView>& getMeshes() const { return meshes; }
+    const std::vector<MaterialSource>& getMaterials() const { return materials; }
+    const std::vector<uint32_t>& getModelMeshes() const { return modelMeshes; }
+    const std::vector<glm::mat4>& getModelTransforms() const { return modelTransforms; }
+    const std::unordered_map<std::string, PropertyValue>& getExtensions() const { return extensions; }
+
+private:
+    struct Mapping;
+    std::unique_ptr<Mapping> mapping;
+
+    std::vector<MeshView> meshes;
+    std::vector<MaterialSource> materials;
+    std::vector<uint32_t> modelMeshes;
+    std::vector<glm::mat4> modelTransforms;
+    std::unordered_map<std::string, PropertyValue> extensions;
+
+    MeshCache();
+    bool parse(const MeshCacheKey& key);
+};
+
+} // namespace modeling
+
+#endif // MESH_CACHE_HPP
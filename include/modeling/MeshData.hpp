@@ -0,0 +1,93 @@
+#ifndef MESH_DATA_HPP
+#define MESH_DATA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+/*
+ * Note: order of parameters matters for struct Vertex,
+ * since it will be passed raw to openGL
+ */
+struct Vertex {
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 TexCoords;
+	/* xyz tangent, w the sign of the bitangent (cross(Normal, Tangent) * w) */
+	glm::vec4 Tangent;
+};
+
+// Vertex is memcpy'd to the GPU and to/from the mesh cache as-is
+static_assert(std::is_trivially_copyable<Vertex>::value, "Vertex must be trivially copyable");
+
+/*
+ * one level of detail: a range of a mesh's index buffer drawing a
+ * simplified version of the mesh with the same vertices. error is the
+ * largest distance from the full detail surface, in mesh units
+ */
+struct MeshLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;
+};
+
+/*
+ * borrowed view of the coarser levels of a mesh. levels index into
+ * <indices>, level 0 (the full mesh) is implicit and not included
+ */
+struct MeshLodView {
+	const unsigned int *indices = nullptr;
+	size_t indexCount = 0;
+	const MeshLod *levels = nullptr;
+	size_t levelCount = 0;
+};
+
+/*
+ * cluster of at most MeshletBuilder::MAX_VERTICES vertices and
+ * MAX_TRIANGLES triangles, a contiguous range of level 0 of a mesh's
+ * index buffer. the bounding sphere and normal cone let whole clusters
+ * be culled against the frustum and for facing away, see MeshletCuller
+ */
+struct Meshlet {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t vertexCount;
+	glm::vec3 center;
+	float radius;
+	/*
+	 * every triangle normal is within the cone around coneAxis.
+	 * coneCutoff is the sine of its half angle, 1 when the cone is too
+	 * wide to ever be back facing
+	 */
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+static_assert(std::is_trivially_copyable<Meshlet>::value, "Meshlet must be trivially copyable");
+
+/*
+ * CPU side geometry of a single mesh, not yet uploaded.
+ * Produced by the model loader on worker threads and by the mesh cache.
+ */
+struct MeshData {
+	std::string name;
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	unsigned int materialIndex = 0;
+	bool valid = false;
+	/* coarser levels of detail, see MeshSimplifier::generateLods */
+	std::vector<unsigned int> lodIndices;
+	std::vector<MeshLod> lods;
+	/* clusters of <indices>, see MeshletBuilder::build */
+	std::vector<Meshlet> meshlets;
+
+	MeshLodView lodView() const {
+		return MeshLodView{lodIndices.data(), lodIndices.size(), lods.data(), lods.size()};
+	}
+};
+
+#endif
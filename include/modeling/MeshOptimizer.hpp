@@ -0,0 +1,110 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "modeling/MeshData.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Post transform vertex cache efficiency of an index buffer
+ *
+ * Measured with a FIFO cache of MeshOptimizer::CACHE_SIZE entries.
+ * ACMR is the number of vertex shader invocations per triangle
+ * (0.5 is ideal for large regular grids, 3 the worst case), ATVR the
+ * invocations per unique vertex (1 is ideal).
+ */
+struct VertexCacheStats {
+    float acmr = 0.0f;
+    float atvr = 0.0f;
+};
+
+/**
+ * @brief Statistics of one optimized mesh, before and after
+ */
+struct MeshOptimizationStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    // vertices dropped because no triangle referenced them
+    size_t unusedVertices = 0;
+};
+
+/**
+ * @brief Engine side mesh optimization
+ *
+ * Reorders the triangles and vertices of a converted mesh for the GPU:
+ *  1. vertex cache: Tipsify (Sander et al. 2007), linear time ordering
+ *     that keeps recently used vertices in the post transform cache,
+ *  2. overdraw: the Tipsify clusters are split further where that costs
+ *     little cache efficiency, then drawn outward facing first so the
+ *     depth test rejects more of the hidden fragments,
+ *  3. vertex fetch: vertices are renumbered in the order the index buffer
+ *     first uses them, so the vertex buffer is read mostly sequentially.
+ *
+ * ModelLoader runs it on the worker threads before writing the mesh cache,
+ * so it runs once per asset, and optimizeMeshlets() again after clustering. Indices stay 32 bit on the CPU, Mesh narrows
+ * them to 16 bit on upload when the vertex count allows.
+ */
+class MeshOptimizer {
+public:
+    // entries of the simulated post transform cache, a conservative size for current GPUs
+    static constexpr uint32_t CACHE_SIZE = 16;
+
+    // cache efficiency the overdraw pass may give up, as a factor of ACMR
+    static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+    /**
+     * @brief Run every pass on <mesh>
+     * @return ACMR/ATVR before and after
+     */
+    static MeshOptimizationStats optimize(MeshData& mesh);
+
+    /**
+     * @brief Tipsify triangle reordering
+     * @param indices Triangle list, reordered in place
+     * @return Index of the first triangle of each cluster, where the ordering
+     *         had to restart from a dead end. Starts with 0.
+     */
+    static std::vector<uint32_t> optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                                                     uint32_t cacheSize = CACHE_SIZE);
+
+    /**
+     * @brief Sort triangle clusters to reduce overdraw
+     * @param indices Triangle list in vertex cache order, reordered in place
+     * @param clusters Cluster starts returned by optimizeVertexCache()
+     * @param threshold Allowed ACMR increase, 1.05 allows 5%
+     */
+    static void optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                                 const std::vector<uint32_t>& clusters, float threshold = OVERDRAW_THRESHOLD,
+                                 uint32_t cacheSize = CACHE_SIZE);
+
+    /**
+     * @brief Restore the cache and overdraw order of a mesh split into meshlets
+     *
+     * MeshletBuilder regroups the triangles, so each meshlet is reordered with
+     * Tipsify on its own, the meshlets are sorted with the key of
+     * optimizeOverdraw(), then the vertices are renumbered for fetch.
+     * Meshlets stay contiguous ranges of mesh.indices, their bounds unchanged.
+     * @return Number of vertices dropped
+     */
+    static size_t optimizeMeshlets(MeshData& mesh);
+
+    /**
+     * @brief Renumber vertices in order of first use, dropping unreferenced ones
+     * @return Number of vertices dropped
+     */
+    static size_t optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+    /**
+     * @brief Simulate the post transform cache over a triangle list
+     */
+    static VertexCacheStats analyzeVertexCache(const unsigned int* indices, size_t indexCount,
+                                               size_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+};
+
+} // namespace modeling
+
+#endif // MESH_OPTIMIZER_HPP
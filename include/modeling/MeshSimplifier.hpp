@@ -0,0 +1,70 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "modeling/MeshData.hpp"
+
+namespace modeling {
+
+/**
+ * @brief How many levels of detail to build per mesh, see ModelLoader::setLodSettings
+ */
+struct LodSettings {
+    // coarser levels built on top of the full mesh, 0 disables LOD generation
+    uint32_t maxLevels = 4;
+    // each level aims for this fraction of the triangles of the previous one
+    float reduction = 0.5f;
+    // largest error any level may have, relative to the mesh bounding radius
+    float targetError = 0.05f;
+    // meshes with fewer triangles are drawn at full detail only
+    uint32_t minTriangles = 256;
+
+    uint64_t hash() const;
+};
+
+/**
+ * @brief Quadric error metric mesh simplification
+ *
+ * Edge collapse simplification after Garland and Heckbert 1997. Vertices
+ * are only ever collapsed onto one of their neighbours, so every level of
+ * detail reuses the vertex buffer of the full mesh and only needs its own
+ * index range.
+ *
+ * Vertices are classified by their topology: open borders may only slide
+ * along themselves, and attribute seams (UV or normal discontinuities,
+ * where one position has two vertices) only collapse along the seam, with
+ * both sides collapsing together. Corners where more seams meet never move.
+ */
+class MeshSimplifier {
+public:
+    /**
+     * @brief Simplify a triangle list
+     * @param targetIndexCount Stop once the result has this many indices or fewer
+     * @param targetError Largest error allowed, as a distance in mesh units
+     * @param resultError Set to the error of the result when not null
+     * @return Indices of the simplified mesh, into the same <vertices>
+     */
+    static std::vector<unsigned int> simplify(
+        const std::vector<Vertex>& vertices,
+        const std::vector<unsigned int>& indices,
+        size_t targetIndexCount,
+        float targetError,
+        float* resultError = nullptr
+    );
+
+    /**
+     * @brief Fill mesh.lods and mesh.lodIndices
+     *
+     * Levels are simplified from the full mesh with increasing triangle
+     * reduction until the error budget or <settings>.maxLevels is used up.
+     * Each level is ordered for the vertex cache.
+     */
+    static void generateLods(MeshData& mesh, const LodSettings& settings);
+};
+
+} // namespace modeling
+
+#endif // MESH_SIMPLIFIER_HPP
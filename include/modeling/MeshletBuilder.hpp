@@ -0,0 +1,54 @@
+#ifndef MESHLET_BUILDER_HPP
+#define MESHLET_BUILDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "modeling/MeshData.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Splits meshes into small clusters that can be culled on their own
+ *
+ * Triangles are grouped greedily: a meshlet grows over the triangles next
+ * to the vertices it already has, preferring those that add the fewest new
+ * vertices and then the ones closest to its center, so meshlets stay
+ * connected and compact. A meshlet is closed when it is full or nothing
+ * connected fits any more.
+ *
+ * The index buffer is reordered so each meshlet is a contiguous range of
+ * it, a visible set of meshlets is then drawn straight from the mesh's own
+ * element buffer with glMultiDrawElements. The limits match what mesh
+ * shading hardware handles well, should that path be added later.
+ */
+class MeshletBuilder {
+public:
+    static constexpr uint32_t MAX_VERTICES = 64;
+    static constexpr uint32_t MAX_TRIANGLES = 124;
+
+    /**
+     * @brief Fill mesh.meshlets, reordering mesh.indices
+     *
+     * Only level 0 is clustered, LODs are unaffected.
+     * @return Number of meshlets
+     */
+    static size_t build(MeshData& mesh);
+
+    /**
+     * @brief Cluster a triangle list
+     * @param indices Triangle list, reordered in place so meshlets are contiguous
+     */
+    static std::vector<Meshlet> build(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices);
+
+    /**
+     * @brief Bounding sphere and normal cone of a range of triangles
+     * @param meshlet firstIndex and indexCount select the triangles, the rest is filled in
+     */
+    static void computeBounds(Meshlet& meshlet, const unsigned int* indices, const std::vector<Vertex>& vertices);
+};
+
+} // namespace modeling
+
+#endif // MESHLET_BUILDER_HPP
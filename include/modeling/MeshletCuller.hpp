@@ -0,0 +1,84 @@
+#ifndef MESHLET_CULLER_HPP
+#define MESHLET_CULLER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "modeling/Frustum.hpp"
+#include "modeling/MeshData.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Visible part of a mesh, as glMultiDrawElements arguments
+ *
+ * Kept by the caller across frames so the vectors are only allocated once.
+ */
+struct MeshletDrawList {
+    // index count, element buffer byte offset and base vertex of each draw
+    std::vector<int> counts;
+    std::vector<const void*> offsets;
+    std::vector<int> baseVertices;
+    // meshlets that passed culling, indices into the mesh's meshlets
+    std::vector<uint32_t> visible;
+    size_t triangleCount = 0;
+
+    void clear() {
+        counts.clear();
+        offsets.clear();
+        baseVertices.clear();
+        visible.clear();
+        triangleCount = 0;
+    }
+};
+
+/**
+ * @brief CPU culling of meshlets, see MeshletBuilder
+ *
+ * A meshlet is rejected when its bounding sphere is outside the frustum or
+ * when its normal cone shows every triangle faces away from the eye.
+ * Everything is tested in the meshlets' own space: pass the frustum of
+ * projection * view * model and the eye transformed by the inverse model
+ * matrix. Both tests are conservative, culled meshlets are never visible.
+ */
+class MeshletCuller {
+public:
+    /**
+     * @brief Collect the meshlets that may be visible
+     * @param visible Cleared, then filled with the indices of the meshlets that passed
+     * @return Number of meshlets that passed
+     */
+    static size_t cull(const Meshlet* meshlets, size_t count, const Frustum& frustum, const glm::vec3& eye,
+                       std::vector<uint32_t>& visible);
+
+    /**
+     * @brief true if no triangle of <meshlet> can face <eye>
+     */
+    static bool isBackFacing(const Meshlet& meshlet, const glm::vec3& eye);
+
+    /**
+     * @brief Turn list.visible into draw ranges
+     *
+     * Meshlets are contiguous in the index buffer, so runs of visible
+     * neighbours become a single draw.
+     * @param indexSize Bytes per index in the element buffer
+     * @param firstIndex Where the mesh starts in the element buffer, see GeometryRange
+     * @param baseVertex Added to every index, see GeometryRange
+     */
+    static void buildDrawList(const Meshlet* meshlets, size_t indexSize, MeshletDrawList& list,
+                              uint32_t firstIndex = 0, int baseVertex = 0);
+
+    /**
+     * @brief Concatenate the triangles of the visible meshlets
+     *
+     * For drawing from a streamed index buffer with a single draw call
+     * instead of a multi-draw from the static one.
+     */
+    static void compactIndices(const unsigned int* indices, const Meshlet* meshlets,
+                               const std::vector<uint32_t>& visible, std::vector<unsigned int>& output);
+};
+
+} // namespace modeling
+
+#endif // MESHLET_CULLER_HPP
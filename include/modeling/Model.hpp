@@ -3,6 +3,8 @@
 
 #include "modeling/Mesh.hpp"
 #include "modeling/Material.hpp"
+#include "utils/Shader.hpp"
+#include "utils/Span.hpp"
 #include <vector>
 #include <memory>
 
@@ -16,11 +18,50 @@ public:
 
     // We need a list of meshes and a list of materials, one material per mesh
     ~Model();
-    std::vector<std::shared_ptr<Mesh>> getMeshes() const;
-    std::vector<std::shared_ptr<Material>> getMaterials() const;
+    // owns a GL buffer
+    Model(const Model&) = delete;
+    Model& operator=(const Model&) = delete;
+    // Views into the model, valid until the next addMesh
+    Span<const std::shared_ptr<Mesh>> getMeshes() const;
+    Span<const std::shared_ptr<Material>> getMaterials() const;
     void addMesh(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material);
 
+    // Union of the mesh bounds in model space, false if there are no meshes
+    bool getBounds(glm::vec3& min, glm::vec3& max) const;
+
+    /**
+     * @brief Add a placement of the whole model, e.g. the node transform of
+     * one of the scene nodes referencing its meshes
+     *
+     * A model without instances is drawn once, untransformed.
+     */
+    void addInstance(const glm::mat4& transform);
+    Span<const glm::mat4> getInstances() const;
+    size_t getInstanceCount() const;
+
+    /**
+     * @brief Copy the instance transforms to a GL buffer, again after adding more
+     */
+    void uploadInstances();
+
+    /**
+     * @brief Feed the instance transforms to the mat4 attribute at
+     * locations 6 to 9 of the bound vertex array, one per instance
+     * @return false before uploadInstances()
+     *
+     * Draw getInstanceCount() instances, then unbindInstances(). See
+     * rendering::RenderQueue::add.
+     */
+    bool bindInstances() const;
+
+    /**
+     * @brief Back to the identity transform of non-instanced draws, the
+     * vertex array is shared by the whole geometry pool
+     */
+    static void unbindInstances();
+
     std::shared_ptr<Shader> getShader();
+    void setShader(std::shared_ptr<Shader> shader);
 
     // Rendering methods
     void setupForRendering();  // Prepare all meshes and bind shader
@@ -30,6 +71,8 @@ private:
     std::vector<std::shared_ptr<Material>> materials;
     std::shared_ptr<Shader> shader;
 
+    std::vector<glm::mat4> instances;
+    unsigned int instanceBuffer = 0;
 
 };
 
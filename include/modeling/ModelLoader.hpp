@@ -2,6 +2,7 @@
 #define MODEL_LOADER_HPP
 
 #include <vector>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -14,11 +15,51 @@
 #include "modeling/Model.hpp"
 #include "modeling/Mesh.hpp"
 #include "modeling/Material.hpp"
+#include "modeling/MaterialSource.hpp"
+#include "modeling/MeshCache.hpp"
+#include "modeling/MeshSimplifier.hpp"
 #include "modeling/ModelProperties.hpp"
-#include "shared/Shader.hpp"
+#include "utils/Shader.hpp"
+#include "utils/ShaderVariants.hpp"
 
 namespace modeling {
 
+class TextureUploader;
+
+/**
+ * @brief A scene that has been imported and converted but not yet uploaded
+ *
+ * Either comes from Assimp (importer/scene/meshes are set), or from a
+ * valid mesh cache file (only cache is set, no geometry was parsed).
+ * Materials, their decoded textures and the glTF extensions are set in
+ * both cases.
+ * Owns the Assimp importer so the aiScene stays alive until finalization.
+ */
+struct ImportedScene {
+    std::string filePath;
+    std::unique_ptr<Assimp::Importer> importer;
+    const aiScene* scene = nullptr;
+
+    // set when loaded from a cooked cache file, shared with the meshes
+    // that view its mapping as their CPU side data
+    std::shared_ptr<MeshCache> cache;
+
+    // indexed like scene->mMeshes
+    std::vector<MeshData> meshes;
+    std::vector<MaterialSource> materialSources;
+    std::vector<std::shared_ptr<Material>> materials;
+    // decoded but not yet uploaded, shared with the materials using them
+    std::vector<std::shared_ptr<Texture>> textures;
+    std::unordered_map<std::string, PropertyValue> extensions;
+};
+
+/**
+ * @brief Progress callback for ModelLoader::importScene
+ *
+ * Called from the importing thread with the completed fraction in [0, 1].
+ * Returning false aborts the import.
+ */
+typedef std::function<bool(float)> ImportProgress;
 
 class ModelLoader {
 public:
@@ -27,55 +68,166 @@ public:
      * @param filePath Path to the 3D model file
      * @param shader Shared pointer to the shader to use for all models
      * @return Vector of loaded models
+     *
+     * Equivalent to finalizeScene(*importScene(filePath), shader).
+     * A mesh referenced by several nodes loads as one model with an
+     * instance per node, see Model::addInstance.
      */
     static std::vector<std::shared_ptr<Model>> loadModels(
         const std::string& filePath, 
         std::shared_ptr<Shader> shader
     );
 
-private:
-    
     /**
-     * @brief Process the entire scene and extract all models
-     * @param scene Assimp scene object
-     * @param shader Shader to assign to models
+     * @brief Read a file and convert all of its meshes to engine buffers
+     * @param filePath Path to the 3D model file
+     * @param progress Optional progress callback, see ImportProgress
+     * @return The imported scene, or nullptr if the file could not be read
+     *         or the import was aborted
+     *
+     * Pure CPU work: meshes are converted in parallel on ThreadPool::shared().
+     * Safe to call from any thread.
+     *
+     * If a matching mesh cache exists it is mapped instead of running Assimp,
+     * otherwise one is written after the import (see MeshCache).
+     */
+    static std::unique_ptr<ImportedScene> importScene(
+        const std::string& filePath,
+        ImportProgress progress = nullptr
+    );
+
+    /**
+     * @brief Enable or disable reading and writing mesh cache files (default on)
+     */
+    static void setMeshCacheEnabled(bool enabled);
+
+    /**
+     * @brief Preferred GPU vertex layout of loaded meshes (default QUANTIZED)
+     *
+     * Chosen per mesh: meshes too large to quantize within
+     * Mesh::POSITION_TOLERANCE use PACKED instead. Shaders must decode
+     * the compact formats, see assets/default.vert.
+     */
+    static void setVertexFormat(VertexFormat format);
+
+    /**
+     * @brief Keep a CPU side copy of the geometry of uploaded meshes (default on)
+     *
+     * Turn off when nothing reads Mesh::getVertices after loading, the
+     * geometry then only takes GPU memory. Meshes loaded without a GL
+     * context always keep their data.
+     */
+    static void setKeepCpuData(bool keep);
+
+    /**
+     * @brief How many levels of detail to generate per mesh
+     *
+     * LODs are generated once per asset and stored in the mesh cache,
+     * changing the settings re-cooks cached files on their next load.
+     */
+    static void setLodSettings(const LodSettings& settings);
+    static LodSettings getLodSettings();
+
+    /**
+     * @brief Upload an imported scene and build its models
+     * @param imported Scene returned by importScene(), its mesh buffers are moved from
+     * @param shader Shader to assign to models, nullptr skips GL setup
+     * @param uploader Ring to stream textures through, nullptr uses a temporary one
      * @return Vector of loaded models
+     *
+     * All GL uploads happen here in a single batch. Must be called on the
+     * thread owning the OpenGL context <uploader> was created in.
      */
-    static std::vector<std::shared_ptr<Model>> processScene(
-        const aiScene* scene, 
-        std::shared_ptr<Shader> shader
+    static std::vector<std::shared_ptr<Model>> finalizeScene(
+        ImportedScene& imported,
+        std::shared_ptr<Shader> shader,
+        TextureUploader* uploader = nullptr
+    );
+
+    /**
+     * @brief Upload an imported scene, each model drawn with the variant of its material
+     * @param variants Built from assets/default.vert and .frag, see materialDefines()
+     *
+     * Models share their shader with <variants>. A material whose variant
+     * doesn't compile falls back to the variant without defines.
+     */
+    static std::vector<std::shared_ptr<Model>> finalizeScene(
+        ImportedScene& imported,
+        std::shared_ptr<ShaderVariants> variants,
+        TextureUploader* uploader = nullptr
     );
+
+    /**
+     * @brief Features of assets/default.frag a material uses: NORMAL_MAP
+     * with a normal texture, UNLIT for KHR_materials_unlit
+     */
+    static ShaderVariants::Defines materialDefines(const MaterialSource& source);
+
+private:
     
     /**
      * @brief Recursively process scene nodes to build models
      * @param node Current scene node
      * @param scene Assimp scene object
+     * @param parentTransform World transform of the parent node
      * @param models Output vector to add models to
+     * @param meshModels Model created for each mesh so far, indexed like scene->mMeshes
+     * @param meshes Uploaded meshes, indexed like scene->mMeshes
      * @param materials Vector of loaded materials
      * @param shader Shader to assign to models
+     *
+     * The first node referencing a mesh creates its model, every node
+     * referencing it adds an instance with the node's world transform.
      */
     static void processNode(
         aiNode* node, 
         const aiScene* scene,
+        const glm::mat4& parentTransform,
         std::vector<std::shared_ptr<Model>>& models,
+        std::vector<std::shared_ptr<Model>>& meshModels,
+        const std::vector<std::shared_ptr<Mesh>>& meshes,
         const std::vector<std::shared_ptr<Material>>& materials,
         std::shared_ptr<Shader> shader
     );
 
-  
     /**
-     * @brief Load mesh data from an Assimp mesh object
-     * @param mesh Assimp mesh object
-     * @param scene Assimp scene object (for additional context)
-     * @return Shared pointer to the loaded Mesh object
-     * 
-     * IMPLEMENTATION NOTES:
-     * - Extract vertices (position, normal, texture coordinates)
-     * - Extract indices for triangulated faces
-     * - Handle multiple texture coordinate sets if needed
-     * - Validate mesh data before creating Mesh object
+     * @brief Build models straight from the buffers of a mapped mesh cache
+     */
+    static std::vector<std::shared_ptr<Model>> finalizeCachedScene(
+        ImportedScene& imported,
+        std::shared_ptr<Shader> shader,
+        TextureUploader* uploader
+    );
+
+    /**
+     * @brief Collect the mesh index and world transform of every mesh reference processNode() visits
+     * @param node Current scene node
+     * @param parentTransform World transform of the parent node
+     * @param modelMeshes Output list, in node traversal order
+     * @param modelTransforms Output list, one transform per modelMeshes entry
+     */
+    static void collectModelMeshes(
+        const aiNode* node,
+        const glm::mat4& parentTransform,
+        std::vector<uint32_t>& modelMeshes,
+        std::vector<glm::mat4>& modelTransforms
+    );
+
+    /**
+     * @brief Convert, optimize and simplify every mesh of the scene in parallel
+     * @param scene Assimp scene object
+     * @param lodSettings Levels of detail to generate for each mesh
+     * @return Converted meshes, indexed like scene->mMeshes
+     */
+    static std::vector<MeshData> convertMeshes(const aiScene* scene, const LodSettings& lodSettings);
+
+    /**
+     * @brief Create the engine Mesh for converted mesh data
+     * @param data Converted mesh, its buffers are moved into the Mesh
+     * @param setupGL Whether to upload the mesh to the GPU
+     * @return Shared pointer to the loaded Mesh object, nullptr on failure
      */
-    static std::shared_ptr<Mesh> loadMeshFromNode(aiMesh* mesh, const aiScene* scene, std::shared_ptr<Shader> shader);
+    static std::shared_ptr<Mesh> uploadMesh(MeshData& data, bool setupGL);
     
     /**
      * @brief Process and validate mesh data
@@ -88,36 +240,38 @@ private:
      * - Convert Assimp vertex format to engine Vertex struct
      * - Ensure proper winding order for faces
      * - Handle cases where normals or texture coordinates are missing
+     * - Called concurrently for different meshes, must not touch shared state
      */
     static bool processMesh(aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
 
-    // TODO: Implement these functions for material loading
-    
     /**
-     * @brief Load all materials from the scene
+     * @brief Describe the textures of every material in the scene
      * @param scene Assimp scene object
-     * @return Vector of loaded materials
-     * 
-     * IMPLEMENTATION NOTES:
-     * - Process all materials in scene->mMaterials
-     * - Extract textures for each material type (diffuse, normal, metallic, etc.)
-     * - Handle missing textures with default values
-     * - Create Material objects using the existing Material::from_aiMaterial method or similar
+     * @param directory Directory of the model file, for relative texture paths
+     * @return One entry per scene->mMaterials, or a single "default" entry if there are none
      */
-    static std::vector<std::shared_ptr<Material>> loadMaterials(const aiScene* scene);
-    
+    static std::vector<MaterialSource> describeMaterials(const aiScene* scene, const std::string& directory);
+
     /**
-     * @brief Process a single material from Assimp data
-     * @param aiMat Assimp material object
-     * @param scene Assimp scene object (for texture loading)
-     * @return Shared pointer to the loaded Material object
-     * 
-     * IMPLEMENTATION NOTES:
-     * - Extract material properties (colors, factors, etc.)
-     * - Load and process embedded or referenced textures
-     * - Handle different material models (PBR, Phong, etc.)
+     * @brief Decode the textures of <sources> and create the materials
+     * @param sources Result of describeMaterials() or of a mesh cache
+     * @param scene Assimp scene for embedded textures, nullptr when loading from a cache
+     * @param textures Output, every decoded texture, to be uploaded by finalizeScene
+     * @return One material per source
+     *
+     * Only CPU work, safe to call from a worker thread.
+     */
+    static std::vector<std::shared_ptr<Material>> loadMaterials(
+        const std::vector<MaterialSource>& sources,
+        const aiScene* scene,
+        std::vector<std::shared_ptr<Texture>>& textures
+    );
+
+    /**
+     * @brief Upload the decoded textures of a scene, through <uploader> or a temporary ring
+     * Must be called on the thread owning the OpenGL context.
      */
-    static std::shared_ptr<Material> processMaterial(aiMaterial* aiMat, const aiScene* scene);
+    static void uploadTextures(ImportedScene& imported, TextureUploader* uploader);
 
     // TODO: Implement these functions for GLTF extension loading
     
@@ -41,7 +41,8 @@ namespace modeling {
 
         /**
          * Do the various buffer setups to prepare the model
-         * for the shader program and bind vertex data
+         * for the shader program. vertex data is bound per
+         * visible mesh, see rendering::CullingStage
         */
         void update(const animation::AnimationProperties &animProps);
 
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Hit, miss and eviction counters of a ResidencyManager
+struct ResidencyStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // bytes currently resident
+    size_t cpu_bytes = 0;
+    size_t gpu_bytes = 0;
+};
+
+// Tracks which assets are resident and how much memory they use,
+// and picks least recently used assets to evict when over budget.
+//
+// Pure bookkeeping: assets are dense integer ids (AssetManager scene
+// indices), freeing the evicted assets is up to the caller.
+// Not thread safe.
+class ResidencyManager {
+public:
+    static constexpr size_t UNLIMITED = std::numeric_limits<size_t>::max();
+
+    explicit ResidencyManager(size_t cpu_budget = UNLIMITED, size_t gpu_budget = UNLIMITED);
+
+    void set_budget(size_t cpu_budget, size_t gpu_budget);
+    size_t cpu_budget() const { return this->cpu_limit; }
+    size_t gpu_budget() const { return this->gpu_limit; }
+
+    // mark <id> resident with the given sizes, it counts as used this frame
+    void add(size_t id, size_t cpu_bytes, size_t gpu_bytes);
+
+    // mark <id> as no longer resident
+    void remove(size_t id);
+
+    bool resident(size_t id) const;
+
+    // record a use of <id>: a hit if resident, a miss otherwise
+    // returns whether it was resident
+    bool touch(size_t id);
+
+    // pinned assets are never evicted, pins survive remove()
+    void pin(size_t id);
+    void unpin(size_t id);
+    bool pinned(size_t id) const;
+
+    // advance the frame counter used for recency
+    void next_frame() { this->frame++; }
+    uint64_t current_frame() const { return this->frame; }
+
+    // returns whether the resident bytes exceed either budget
+    bool over_budget() const;
+
+    // remove least recently used, unpinned assets until within budget and
+    // return their ids, oldest first. Assets used in the current frame are
+    // never picked, so the result may leave the manager over budget.
+    std::vector<size_t> evict();
+
+    const ResidencyStats& stats() const { return this->counters; }
+    void reset_counters();
+
+private:
+    struct Entry {
+        bool resident = false;
+        bool pinned = false;
+        uint64_t last_use = 0;
+        size_t cpu_bytes = 0;
+        size_t gpu_bytes = 0;
+    };
+
+    std::vector<Entry> entries;
+    size_t cpu_limit;
+    size_t gpu_limit;
+    uint64_t frame = 0;
+    ResidencyStats counters;
+
+    Entry& entry(size_t id);
+};
@@ -0,0 +1,112 @@
+#ifndef TEXTURE_COOKER_HPP
+#define TEXTURE_COOKER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "modeling/Material.hpp"
+
+namespace modeling {
+
+/**
+ * @brief What the texels of a texture mean, decides how it is filtered and compressed
+ */
+enum class TextureUsage {
+    // sRGB encoded color, filtered in linear light, alpha is linear
+    COLOR,
+    // tangent space normals, renormalized after filtering, BC5 when compressed
+    NORMAL,
+    // linear data such as the packed occlusion/roughness/metallic texture
+    DATA,
+};
+
+/**
+ * @brief Settings of the texture cooking step, see TextureLoader::setCookOptions
+ */
+struct TextureCookOptions {
+    // generate mips on the CPU and pack occlusion/roughness/metallic
+    bool enabled = true;
+    // encode BC7 (color, data) and BC5 (normals),
+    // needs GL 4.2 or ARB_texture_compression_bptc to upload without decoding
+    bool compress = false;
+    // read and write cooked textures in the engine cache directory
+    bool cache = true;
+};
+
+/**
+ * @brief Offline processing of decoded textures
+ *
+ * Turns a freshly decoded texture into what the GPU should receive:
+ * a full mip chain filtered with a Lanczos kernel (instead of the box
+ * filter of glGenerateMipmap), optionally block compressed. Results are
+ * stored as .stc files next to the mesh cache, so later loads only read
+ * them back.
+ *
+ * Everything here is CPU work and safe to run on ThreadPool::shared().
+ */
+class TextureCooker {
+public:
+    /**
+     * @brief Filter the full mip chain of a single level RAW texture
+     * @return RAW texture with every level down to 1x1
+     */
+    static std::shared_ptr<Texture> generateMips(const Texture& source, TextureUsage usage);
+
+    /**
+     * @brief Pack the three scalar material maps into one RGB texture
+     * @return R = occlusion, G = roughness, B = metallic, at the size of the largest input
+     *
+     * Follows the glTF convention so a glTF metallicRoughness texture can be
+     * passed as both <roughness> and <metallic>: occlusion is read from red,
+     * roughness from green and metallic from blue, or from the only channel
+     * of single channel textures. Smaller inputs are resampled.
+     */
+    static std::shared_ptr<Texture> packOcclusionRoughnessMetallic(
+        const Texture& occlusion,
+        const Texture& roughness,
+        const Texture& metallic
+    );
+
+    /**
+     * @brief Block compress every level of a RAW texture
+     * @return BC5 for normal maps, BC7 otherwise
+     */
+    static std::shared_ptr<Texture> compress(const Texture& source, TextureUsage usage);
+
+    /**
+     * @brief Mips, then compression if <options> ask for it
+     */
+    static std::shared_ptr<Texture> cook(const Texture& source, TextureUsage usage, const TextureCookOptions& options);
+
+    /**
+     * @brief Key of a cooked texture, changes with the source files and the settings
+     * @param sourcePaths Image files the texture is cooked from, empty strings are allowed.
+     *        Each is keyed on its path, size and modification time, not its contents
+     * @return The key, 0 if a source could not be stat'ed
+     */
+    static uint64_t computeKey(const std::vector<std::string>& sourcePaths, TextureUsage usage,
+                               const TextureCookOptions& options);
+
+    /**
+     * @brief Path of the cache file for a cooked texture named <name>
+     */
+    static std::string cachePathFor(const std::string& name);
+
+    /**
+     * @brief Read a cooked texture
+     * @return The texture, nullptr if missing, stale or corrupt
+     */
+    static std::shared_ptr<Texture> readCache(const std::string& cachePath, uint64_t key);
+
+    /**
+     * @brief Write a cooked texture, atomically through a temporary file
+     * @return true on success
+     */
+    static bool writeCache(const std::string& cachePath, uint64_t key, const Texture& texture);
+};
+
+} // namespace modeling
+
+#endif // TEXTURE_COOKER_HPP
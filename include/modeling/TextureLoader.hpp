@@ -0,0 +1,119 @@
+#ifndef TEXTURE_LOADER_HPP
+#define TEXTURE_LOADER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <assimp/scene.h>
+
+#include "modeling/Material.hpp"
+#include "modeling/MaterialSource.hpp"
+#include "modeling/TextureCooker.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Resolves, deduplicates and decodes material textures
+ *
+ * All decoding is CPU work and runs on ThreadPool::shared(), nothing here
+ * touches OpenGL. Decoded textures have id 0 until a TextureUploader
+ * uploads them on the GL thread.
+ *
+ * Unless cooking is disabled with setCookOptions(), textures come out of
+ * TextureCooker with their mip chain, and the occlusion, roughness and
+ * metallic maps of a material are packed into one texture bound to all
+ * three slots (R = occlusion, G = roughness, B = metallic).
+ */
+class TextureLoader {
+public:
+    /**
+     * @brief Describe the textures an Assimp material references
+     * @param material Assimp material
+     * @param scene Scene owning the material, used to resolve embedded textures
+     * @param directory Directory of the model file, relative paths are resolved against it
+     */
+    static MaterialSource describe(const aiMaterial* material, const aiScene* scene, const std::string& directory);
+
+    /**
+     * @brief Decode the textures of every material and create the materials
+     * @param sources One entry per material
+     * @param scene Scene for embedded textures, may be nullptr if none are embedded
+     * @param textures Output, every distinct decoded texture
+     * @return One material per source, textures that fail to decode use the default
+     *
+     * Each distinct texture is decoded (or read from the cook cache) once,
+     * all of them in parallel. Materials keep their textures alive.
+     * Missing textures share one makeDefaultTexture() per call, which is
+     * added to <textures> so it is uploaded along with the rest.
+     */
+    static std::vector<std::shared_ptr<Material>> buildMaterials(
+        const std::vector<MaterialSource>& sources,
+        const aiScene* scene,
+        std::vector<std::shared_ptr<Texture>>& textures
+    );
+
+    /**
+     * @brief Decode an image file (any format stb_image reads)
+     * @return The texture, nullptr on failure
+     */
+    static std::shared_ptr<Texture> decodeFile(const std::string& path);
+
+    /**
+     * @brief Decode a texture embedded in a scene, compressed or raw texels
+     * @return The texture, nullptr on failure
+     */
+    static std::shared_ptr<Texture> decodeEmbedded(const aiTexture* texture);
+
+    /**
+     * @brief Decode a MaterialSource texture reference, a path or "*N"
+     * @return The texture, nullptr if empty or on failure
+     */
+    static std::shared_ptr<Texture> decodeSource(const std::string& source, const aiScene* scene);
+
+    /**
+     * @brief Change how textures are cooked, applies to later buildMaterials() calls
+     */
+    static void setCookOptions(const TextureCookOptions& options);
+    static TextureCookOptions getCookOptions();
+
+    /**
+     * @brief New 1x1 white texture for missing or broken textures
+     *
+     * Every loaded scene gets its own, so its GL name belongs to the
+     * context the scene was uploaded to and is deleted with the scene.
+     */
+    static std::shared_ptr<Texture> makeDefaultTexture();
+
+    /**
+     * @brief Shared 1x1 white texture for CPU side use only
+     *
+     * Never uploaded (its id stays 0): it outlives every GL context.
+     * Upload makeDefaultTexture() instead.
+     */
+    static Texture& whiteTexture();
+
+    /**
+     * @brief Material using a new default texture in every slot
+     * @param textures Output, receives the default texture to upload
+     */
+    static std::shared_ptr<Material> makeDefaultMaterial(const std::string& name,
+                                                         std::vector<std::shared_ptr<Texture>>& textures);
+
+private:
+    // sources turned into one Texture, a single image or three packed scalar maps
+    struct CookUnit {
+        std::string name;
+        TextureUsage usage;
+        std::vector<std::string> sources;
+        bool packed;
+    };
+
+    static std::shared_ptr<Texture> loadUnit(const CookUnit& unit, const aiScene* scene,
+                                             const TextureCookOptions& options);
+    static std::string cacheName(const CookUnit& unit);
+};
+
+} // namespace modeling
+
+#endif // TEXTURE_LOADER_HPP
@@ -0,0 +1,85 @@
+#ifndef TEXTURE_UPLOADER_HPP
+#define TEXTURE_UPLOADER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+#include <glad/glad.h>
+
+#include "modeling/Material.hpp"
+
+namespace modeling {
+
+/**
+ * @brief Streams decoded textures to the GPU through a ring of pixel buffer memory
+ *
+ * Pixels are copied into a GL_PIXEL_UNPACK_BUFFER and glTexImage2D reads
+ * from it, so the driver can do the transfer asynchronously instead of
+ * blocking on a client memory copy. Every upload is fenced; the ring only
+ * waits when it wraps around onto a region the GPU hasn't consumed yet.
+ *
+ * With GL 4.4 / ARB_buffer_storage the buffer is persistently mapped once,
+ * otherwise each upload maps its region unsynchronized.
+ *
+ * Owns GL objects of the context current at construction: create one per
+ * context and destroy it before the context goes away. Must only be used
+ * on the thread owning that context.
+ */
+class TextureUploader {
+public:
+    static constexpr size_t DEFAULT_RING_SIZE = 32u << 20;
+
+    /**
+     * @param ringSize Size of the staging ring in bytes, textures larger than this are uploaded directly
+     */
+    explicit TextureUploader(size_t ringSize = DEFAULT_RING_SIZE);
+    ~TextureUploader();
+
+    TextureUploader(const TextureUploader&) = delete;
+    TextureUploader& operator=(const TextureUploader&) = delete;
+
+    /**
+     * @brief Create the GL texture of <texture>
+     *
+     * Uploads every level of cooked textures, single level textures get
+     * their mipmaps generated. Block compressed textures the context can't
+     * sample are decoded on the CPU first. Does nothing if the texture
+     * already has an id.
+     */
+    void upload(Texture& texture);
+
+    /**
+     * @return True if the current context can sample <format> directly
+     */
+    static bool supportsFormat(TextureFormat format);
+
+    /**
+     * @return True if the ring is persistently mapped
+     */
+    bool isPersistent() const { return persistent; }
+
+private:
+    struct Region {
+        size_t begin;
+        size_t end;
+        GLsync fence;
+    };
+
+    GLuint buffer = 0;
+    uint8_t* mapped = nullptr;
+    size_t size;
+    size_t head = 0;
+    bool persistent = false;
+    std::deque<Region> inFlight;
+
+    /**
+     * @brief Find room for <bytes> in the ring, waiting for the GPU if needed
+     * @return Offset of the region in the ring
+     */
+    size_t reserve(size_t bytes);
+};
+
+} // namespace modeling
+
+#endif // TEXTURE_UPLOADER_HPP
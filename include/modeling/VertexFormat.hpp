@@ -0,0 +1,85 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "modeling/MeshData.hpp"
+
+/*
+ * GPU side layout of a mesh's vertex buffer. The CPU side copy of a
+ * Mesh is always plain Vertex, only the uploaded buffer is encoded.
+ */
+enum class VertexFormat : uint32_t {
+	/* Vertex as is, 48 bytes */
+	FLOAT,
+	/* PackedVertex: float positions, octahedral normal/tangent, 16 bit UVs, 24 bytes */
+	PACKED,
+	/* QuantizedVertex: PACKED with unorm16 positions in the mesh bounds, 20 bytes */
+	QUANTIZED,
+};
+
+/*
+ * normals are octahedral snorm16, tangents octahedral snorm8 with the
+ * bitangent sign in Tangent[2], 0 when the mesh has no tangents. TexCoords are unorm16 when every UV of
+ * the mesh is in [0,1], half floats otherwise.
+ */
+struct PackedVertex {
+	glm::vec3 Position;
+	int16_t Normal[2];
+	int8_t Tangent[4];
+	uint16_t TexCoords[2];
+};
+
+struct QuantizedVertex {
+	/* Position = offset + unorm * scale, w is padding */
+	uint16_t Position[4];
+	int16_t Normal[2];
+	int8_t Tangent[4];
+	uint16_t TexCoords[2];
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex must stay tightly packed");
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must stay tightly packed");
+
+/*
+ * everything needed to decode a mesh's vertex buffer, chosen per mesh
+ */
+struct VertexEncoding {
+	VertexFormat format = VertexFormat::FLOAT;
+	/* unorm16 instead of half float TexCoords */
+	bool unormTexCoords = false;
+	/* dequantization of QUANTIZED positions, identity otherwise */
+	glm::vec3 positionOffset = glm::vec3(0.f);
+	glm::vec3 positionScale = glm::vec3(1.f);
+
+	size_t stride() const;
+};
+
+/*
+ * pick the encoding of a mesh: <preferred> if the mesh allows it, else
+ * the next larger format. QUANTIZED needs the position step
+ * (bounds / 65535) to stay within <positionTolerance> on every axis.
+ */
+VertexEncoding chooseVertexEncoding(const Vertex *vertices, size_t count,
+	VertexFormat preferred, float positionTolerance);
+
+/* encode <count> vertices into the GPU layout of <encoding> */
+std::vector<uint8_t> encodeVertices(const Vertex *vertices, size_t count,
+	const VertexEncoding &encoding);
+
+/* decode vertex <index> of an encoded buffer, the inverse of encodeVertices */
+Vertex decodeVertex(const uint8_t *data, size_t index, const VertexEncoding &encoding);
+
+/* octahedral mapping of a unit vector to [-1,1]^2 and back */
+glm::vec2 octEncode(glm::vec3 n);
+glm::vec3 octDecode(glm::vec2 e);
+
+/* IEEE half float conversion, rounding to nearest */
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
+
+#endif
@@ -1,4 +1,6 @@
 #pragma once
+#include <vector>
+
 #include <glad/glad.h>
 
 /**
@@ -16,7 +18,8 @@ bool initBloom(int width, int height);
  *              ensure MRT is used in fragment shader before this.
  *
  * @param sceneTex The original scene texture.
- * @param brightTex The bright parts texture.
+ * @param brightTex The bright parts texture, sampled with GL_LINEAR: the
+ *                  blur merges pairs of taps into one bilinear fetch.
  * @param iterations The number of iterations for the bloom effect.
  * @param exposure The exposure adjustment.
  * @return GLuint The ID of the bloom texture, or 0 on failure.
@@ -32,7 +35,8 @@ GLuint applyBloom(
  *        NOTE: You need to call initBloom(width, height) first AND
  *              ensure MRT is used in fragment shader before this.
  * @param sceneTex The original scene texture.
- * @param brightTex The bright parts texture.
+ * @param brightTex The bright parts texture, sampled with GL_LINEAR: the
+ *                  blur merges pairs of taps into one bilinear fetch.
  * @param kernelRadius The radius of the Gaussian kernel (MUST be odd).
  * @param sigma The standard deviation for the Gaussian kernel (use -1 for auto).
  * @param exposure The exposure adjustment.
@@ -44,6 +48,58 @@ GLuint applyBloomWithKernel(GLuint sceneTex,
                             float sigma,
                             float exposure);
 
+/**
+ * @brief Apply bloom effect over a mip pyramid (dual filter): the bright
+ *        parts are downsampled level by level with a 13-tap filter, then
+ *        tent filtered back up, each level added onto the next larger one.
+ *        Costs about two fullscreen passes whatever the bloom width.
+ *        NOTE: You need to call initBloom(width, height) first AND
+ *              ensure MRT is used in fragment shader before this.
+ *
+ * @param sceneTex The original scene texture.
+ * @param brightTex The bright parts texture.
+ * @param filterRadius Radius of the upsample tent in texture coordinates (use -1 for 0.005).
+ * @param exposure The exposure adjustment.
+ * @return GLuint The ID of the bloom texture, or 0 on failure.
+ */
+GLuint applyBloomMipChain(GLuint sceneTex,
+                          GLuint brightTex,
+                          float filterRadius,
+                          float exposure);
+
+/**
+ * @brief Choose between the compute and the fragment blur used by
+ *        applyBloom and applyBloomWithKernel. The compute blur needs
+ *        GL 4.3; without it the fragment blur is used whatever is chosen.
+ *        Compute is chosen by default.
+ *
+ * @param enabled true to use the compute blur where available.
+ * @return true if the compute blur is now in use.
+ */
+bool setBloomComputeBlur(bool enabled);
+
+/**
+ * @brief Whether the blur runs in a compute shader.
+ *
+ * @return true if the compute blur is loaded and chosen.
+ */
+bool isBloomComputeBlurActive();
+
+/**
+ * @brief Merge a discrete one-sided kernel into bilinear taps. Texels i and
+ *        i + 1 become a single fetch at their weighted centroid, so a radius
+ *        r kernel needs 1 + ceil(r / 2) fetches per side. The sampled
+ *        texture must use GL_LINEAR filtering.
+ *
+ * @param weights Kernel weights, weights[0] is the center.
+ * @param offsetsOut Tap offsets in texels, offsetsOut[0] is 0.
+ * @param weightsOut Tap weights, each applied on both sides but the center.
+ * @return true if successful, false otherwise.
+ */
+bool mergeLinearTaps(const std::vector<float> &weights,
+                     std::vector<float> *offsetsOut,
+                     std::vector<float> *weightsOut);
+
 /**
  * @brief Destroy bloom effect resources.
  *
@@ -0,0 +1,143 @@
+#ifndef CULLING_STAGE_HPP
+#define CULLING_STAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "modeling/Camera.hpp"
+#include "modeling/Frustum.hpp"
+#include "utils/Span.hpp"
+
+namespace modeling {
+    class Model;
+}
+
+namespace rendering {
+
+/**
+ * Axis aligned boxes stored as structure of arrays, so one SIMD register
+ * holds the same coordinate of four or eight boxes
+ */
+struct BoxList {
+    std::vector<float> minX, minY, minZ;
+    std::vector<float> maxX, maxY, maxZ;
+
+    void add(const glm::vec3 &min, const glm::vec3 &max);
+    void clear();
+    size_t size() const { return minX.size(); }
+};
+
+/**
+ * A mesh that passed culling: mesh <mesh> of the model added as <object>
+*/
+struct VisibleMesh {
+    uint32_t object;
+    uint32_t mesh;
+};
+
+/**
+ * Decides what to draw each frame
+ *
+ * Objects are added with their model and world transform, cull() then
+ * tests them against the camera frustum in two levels: the bounds of the
+ * whole model first, then, for models crossing the frustum border, the
+ * bounds of each of their meshes. Models entirely inside the frustum
+ * skip the second level. The result is a compact list of visible meshes
+ * in the order they were added.
+ *
+ * Boxes are tested eight at a time with AVX, four at a time with SSE,
+ * one by one otherwise.
+*/
+class CullingStage {
+public:
+    CullingStage();
+
+    /**
+     * The stage RenderProperties submit their objects to, cleared and
+     * culled once per frame by Scene::update
+    */
+    static CullingStage &shared();
+
+    /**
+     * Use the frustum of <camera>, with a perspective projection of
+     * <aspect> and the given clip distances
+    */
+    void setCamera(Camera &camera, float aspect, float nearPlane, float farPlane);
+
+    /**
+     * Use planes that are already in world space
+    */
+    void setFrustum(const modeling::Frustum &frustum) { this->frustum = frustum; }
+    const modeling::Frustum &getFrustum() const { return frustum; }
+
+    /**
+     * Queue <model> placed by <transform> for this frame, the model must
+     * outlive the next cull(). Returns the object index used in VisibleMesh.
+     * A single model instance is folded into the transform, several are
+     * culled as one box around all of them and keep all their meshes
+    */
+    uint32_t addObject(const modeling::Model &model, const glm::mat4 &transform);
+
+    /**
+     * Cull every object added since clear()
+     * @return Number of visible meshes
+    */
+    size_t cull();
+
+    Span<const VisibleMesh> getVisible() const { return visible; }
+    const modeling::Model &getModel(uint32_t object) const { return *objects[object].model; }
+    const glm::mat4 &getTransform(uint32_t object) const { return objects[object].transform; }
+    // several model instances, queued with their model, see RenderQueue::add
+    bool isInstanced(uint32_t object) const { return objects[object].instanced; }
+
+    /**
+     * Forget the objects of the previous frame, keeps the allocations
+    */
+    void clear();
+
+    size_t getObjectCount() const { return objects.size(); }
+    // boxes tested by the last cull(), objects and meshes
+    size_t getTestedBoxes() const { return testedBoxes; }
+
+    /**
+     * Indices of the boxes not entirely outside a plane of <frustum>.
+     * If <inside> is set it receives the boxes entirely inside all planes,
+     * a subset of <visible>. Both lists are in ascending order
+    */
+    static void cullBoxes(const modeling::Frustum &frustum, const BoxList &boxes,
+                          std::vector<uint32_t> &visible, std::vector<uint32_t> *inside = nullptr);
+
+    /**
+     * Bounds of the box <min>, <max> after <transform>
+    */
+    static void transformBox(const glm::mat4 &transform, const glm::vec3 &min, const glm::vec3 &max,
+                             glm::vec3 &outMin, glm::vec3 &outMax);
+
+private:
+    struct Entry {
+        const modeling::Model *model;
+        glm::mat4 transform;
+        // drawn once per model instance, the mesh boxes don't apply
+        bool instanced;
+    };
+
+    modeling::Frustum frustum;
+    std::vector<Entry> objects;
+    BoxList objectBoxes;
+    std::vector<VisibleMesh> visible;
+    size_t testedBoxes = 0;
+
+    // scratch space of cull()
+    std::vector<uint32_t> visibleObjects;
+    std::vector<uint32_t> insideObjects;
+    BoxList meshBoxes;
+    std::vector<uint32_t> meshIndices;
+    std::vector<uint32_t> visibleMeshes;
+};
+
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef IBL_CACHE_HPP
+#define IBL_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+namespace rendering {
+
+/**
+ * Pixels of every face and mip level of one texture, as read back from GL
+*/
+struct IBLTextureData {
+    uint32_t internalFormat = 0;
+    // 0 for compressed formats, uploaded with glCompressedTexImage2D
+    uint32_t format = 0;
+    uint32_t type = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // 6 for cubemaps, 1 for 2D textures
+    uint32_t faces = 0;
+    uint32_t levels = 0;
+    // levels * faces images, level major: images[level * faces + face]
+    std::vector<std::vector<uint8_t>> images;
+
+    bool compressed() const { return format == 0; }
+};
+
+/**
+ * On disk cache of the maps pbrPreProcessing renders at startup
+ *
+ * The environment cubemap, irradiance map and prefiltered map are keyed
+ * by a hash of the HDR file they come from and their resolution, so a
+ * changed environment simply misses. The BRDF LUT doesn't depend on the
+ * environment and is stored under a source hash of 0.
+ *
+ * A miss renders as before and store() reads the result back once; a hit
+ * is one file read and a glTexImage2D (or glCompressedTexImage2D) per face
+ * and level. Half float formats are read back as GL_HALF_FLOAT.
+ *
+ * File layout, one file per texture named after its key, close to KTX 1
+ * (mip level major, every face of a level in a row):
+ *
+ *   char magic[4] = "IBL1"
+ *   uint32_t version
+ *   uint64_t key
+ *   uint32_t internalFormat, format, type
+ *   uint32_t width, height, faces, levels
+ *   levels * faces times:
+ *     uint32_t imageSize
+ *     uint8_t image[imageSize]
+*/
+class IBLCache {
+public:
+    enum Kind : uint32_t {
+        ENVIRONMENT = 0,
+        IRRADIANCE,
+        PREFILTER,
+        BRDF_LUT
+    };
+
+    /**
+     * Hash of the contents of the file at <path>
+     * @return 0 if the file can't be read
+    */
+    static uint64_t hashFile(const std::string &path);
+
+    // key of a <size> sized map of <kind> computed from a source with hash <sourceHash>
+    static uint64_t computeKey(Kind kind, uint64_t sourceHash, uint32_t size);
+
+    /**
+     * Store cache files in <directory>, created on the first store.
+     * An empty string turns the cache off
+    */
+    static void setDirectory(const std::string &directory);
+    static std::string getDirectory();
+
+    /**
+     * A new texture of <target> (GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP) with
+     * every level cached under <key>, clamped and linearly filtered
+     * @return 0 on a miss
+    */
+    static GLuint load(uint64_t key, GLenum target);
+
+    /**
+     * Read back every level of <texture> and write it under <key>
+    */
+    static bool store(GLuint texture, GLenum target, uint64_t key);
+
+    // Serialization of one entry, exposed for tests
+    static bool writeFile(const std::string &path, uint64_t key, const IBLTextureData &data);
+    static bool readFile(const std::string &path, uint64_t key, IBLTextureData &data);
+
+    static std::string pathFor(uint64_t key);
+};
+
+}
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef RENDER_PROPERTIES_HPP
 #define RENDER_PROPERTIES_HPP
 
+#include <glm/glm.hpp>
+
 #include "modeling/ModelProperties.hpp"
 
 namespace rendering {
@@ -27,9 +29,19 @@ public:
     void unload();
 
     /**
-     * Run shaders for this object
+     * Submit this object's model to CullingStage::shared(),
+     * the renderer draws what survives culling
     */
     void update(const modeling::ModelProperties &modelProps, const animation::AnimationProperties &animProps);
+
+    /**
+     * Where the object's model is placed in the world
+    */
+    void setTransform(const glm::mat4 &transform) { this->transform = transform; }
+    const glm::mat4 &getTransform() const { return transform; }
+
+private:
+    glm::mat4 transform = glm::mat4(1.f);
 };
 
 }
@@ -0,0 +1,162 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "modeling/Material.hpp"
+#include "modeling/Mesh.hpp"
+#include "utils/FlatHashMap.hpp"
+#include "utils/Span.hpp"
+
+class Shader;
+
+namespace modeling {
+    class Model;
+}
+
+namespace rendering {
+
+/**
+ * Passes are drawn in this order. PASS_ prefixed, wingdi.h defines
+ * OPAQUE and TRANSPARENT
+*/
+enum RenderPass : uint8_t {
+    PASS_OPAQUE,
+    // alpha tested, after the opaque pass so early depth rejects most of it
+    PASS_MASKED,
+    // blended, sorted back to front instead of by state
+    PASS_TRANSPARENT,
+    PASS_OVERLAY,
+};
+
+/**
+ * One queued draw of a mesh LOD level
+*/
+struct DrawItem {
+    uint64_t key;
+    Shader *shader;
+    const Material *material;
+    const Mesh *mesh;
+    uint32_t lod;
+    // caller data handed back at submission, e.g. a CullingStage object index
+    uint32_t object;
+    // drawn once per instance of this model, null for a single draw
+    const modeling::Model *instances = nullptr;
+};
+
+/**
+ * Draws a frame's meshes in an order that minimizes GL state changes
+ *
+ * Every draw gets a 64 bit key, most significant field first:
+ *
+ *   pass (4) | shader (12) | material (16) | geometry pool (8) | depth (24)
+ *
+ * so sorting the keys groups draws by program, then by textures, then by
+ * vertex array, and orders each group front to back for early depth
+ * rejection. Transparent draws ignore state and sort back to front.
+ * Shaders and materials are numbered in the order they are first added
+ * each frame; past the width of their field they share the last number,
+ * which only costs grouping, never correctness.
+ *
+ * submit() walks the sorted draws and only calls glUseProgram,
+ * glBindTexture and glBindVertexArray when the value actually changes.
+ * The program is set with glUseProgram directly, Shader::bind state is
+ * not updated.
+*/
+class RenderQueue {
+public:
+    static constexpr int PASS_BITS = 4;
+    static constexpr int SHADER_BITS = 12;
+    static constexpr int MATERIAL_BITS = 16;
+    static constexpr int GEOMETRY_BITS = 8;
+    static constexpr int DEPTH_BITS = 24;
+
+    // texture units the material textures are bound to, in TextureSlot order
+    static constexpr int MATERIAL_TEXTURES = 6;
+
+    /**
+     * Called once per draw after its state is bound and before it is drawn,
+     * to set per draw uniforms such as the model matrix
+    */
+    using DrawCallback = std::function<void(const DrawItem &item)>;
+
+    // state changes made by the last submit()
+    struct Stats {
+        size_t draws = 0;
+        size_t programBinds = 0;
+        size_t textureBinds = 0;
+        size_t vertexArrayBinds = 0;
+    };
+
+    /**
+     * Queue level <lod> of <mesh>. <depth> is the view distance to the
+     * mesh, any monotonic measure works. <material> may be null for
+     * meshes drawn without textures. With <instances> the mesh is drawn
+     * in one call per instance of that model, see Model::bindInstances
+    */
+    void add(RenderPass pass, Shader &shader, const Material *material, const Mesh &mesh,
+             float depth, uint32_t object = 0, size_t lod = 0,
+             const modeling::Model *instances = nullptr);
+
+    /**
+     * Order the queued draws by key
+    */
+    void sort();
+
+    /**
+     * Sort if needed, then draw everything queued. Meshes without GPU data
+     * are skipped. The queue is kept
+     * @return Number of draw calls issued
+    */
+    size_t submit(const DrawCallback &beforeDraw = nullptr);
+
+    /**
+     * Forget this frame's draws and numbering, keeps the allocations
+    */
+    void clear();
+
+    size_t size() const { return items.size(); }
+    // in submission order once sorted
+    Span<const DrawItem> getItems() const { return items; }
+    const Stats &getStats() const { return stats; }
+
+    /**
+     * Pack the key fields, each is truncated to its width. <depth> must not
+     * be negative
+    */
+    static uint64_t makeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t geometry, float depth);
+
+    /**
+     * Stable LSD radix sort of <items> by key, a byte per pass. Passes
+     * where every key has the same byte are skipped
+    */
+    static void radixSort(std::vector<DrawItem> &items, std::vector<DrawItem> &scratch);
+
+private:
+    std::vector<DrawItem> items;
+    std::vector<DrawItem> scratch;
+    bool sorted = true;
+    Stats stats;
+
+    // pointers are aligned, mix the high bits into the slot index
+    struct PointerHash {
+        size_t operator()(const void *pointer) const {
+            uint64_t bits = uint64_t(reinterpret_cast<uintptr_t>(pointer));
+            return size_t((bits * 0x9E3779B97F4A7C15ull) >> 32);
+        }
+    };
+    using IdMap = FlatHashMap<const void *, uint32_t, PointerHash>;
+
+    // per frame numbering of shaders and materials
+    IdMap shaderIds;
+    IdMap materialIds;
+
+    static uint32_t numberOf(IdMap &ids, const void *object, int bits);
+};
+
+}
+
+#endif
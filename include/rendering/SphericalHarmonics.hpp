@@ -0,0 +1,49 @@
+#ifndef SPHERICAL_HARMONICS_HPP
+#define SPHERICAL_HARMONICS_HPP
+
+class Shader;
+
+namespace rendering {
+
+/**
+ * Diffuse irradiance of an environment as 9 L2 spherical harmonics
+ *
+ * The coefficients are already convolved with the clamped cosine lobe and
+ * scaled by the basis constants, so the irradiance towards n is one
+ * polynomial in n's coordinates:
+ *
+ *   c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2)
+ *
+ * Like the irradiance map from genIrradianceMap, the result is irradiance
+ * divided by PI, ready to be multiplied by the albedo.
+*/
+struct SHIrradiance {
+    // coefficient i of channel c
+    float rgb[9][3] = {};
+
+    // irradiance / PI towards the unit direction (x, y, z)
+    void evaluate(float x, float y, float z, float out[3]) const;
+};
+
+/**
+ * Project an equirectangular HDR image into SHIrradiance
+ *
+ * <pixels> holds <height> rows of <width> pixels with <components>
+ * interleaved floats each, bottom row first as stbi_loadf returns them
+ * with vertical flipping on, and is mapped to directions the way
+ * equirect_to_cube.frag samples it. Rows are summed in parallel on
+ * ThreadPool::shared(), four pixels at a time with SSE.
+ *
+ * Pure CPU work, safe to run off the GL thread.
+*/
+SHIrradiance projectEquirectSH(const float *pixels, int width, int height, int components);
+
+/**
+ * Set uniform vec3 shIrradiance[9] of <shader>, see default.frag built
+ * with SH_IRRADIANCE
+*/
+void setIrradianceSH(Shader &shader, const SHIrradiance &sh);
+
+}
+
+#endif
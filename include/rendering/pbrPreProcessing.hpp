@@ -3,8 +3,11 @@
 
 #include <glad/glad.h>
 #include <Eigen/Geometry>
+#include <cstdint>
 #include <string>
 
+#include "rendering/SphericalHarmonics.hpp"
+
 #define PI 3.14159265358979323846f
 
 
@@ -16,23 +19,38 @@ namespace rendering {
 /**
  * given an HDR environment map, generate a cubemap
  * @param hdrEnvMap path to the HDR environment map
+ * @param sourceHash where to store the hash of the HDR file, pass it to the
+ *        maps derived from this cubemap so they are cached with it. May be null
  * @return the OpenGL ID of the cubemap texture
  */
-GLuint genEnvCubemap(const std::string hdrEnvMap);
+GLuint genEnvCubemap(const std::string hdrEnvMap, uint64_t* sourceHash = nullptr);
 
 /**
  * given an environment cubemap, generate an irradiance map
  * @param envCubemap the OpenGL ID of the environment cubemap texture
+ * @param sourceHash hash of the HDR file from genEnvCubemap, 0 skips the cache
  * @return the OpenGL ID of the irradiance cubemap texture
  */
-GLuint genIrradianceMap(const GLuint& envCubemap);
+GLuint genIrradianceMap(const GLuint& envCubemap, const uint64_t sourceHash = 0);
+
+/**
+ * given an HDR environment map, project its diffuse irradiance into 9 SH
+ * coefficients on the CPU, an alternative to genIrradianceMap: upload them
+ * with setIrradianceSH and build default.frag with SH_IRRADIANCE. Doesn't
+ * touch GL, so a changing sky can be reprojected on a worker thread
+ * @param hdrEnvMap path to the HDR environment map
+ * @param irradiance where to store the coefficients
+ * @return true if the map could be loaded
+ */
+bool genIrradianceSH(const std::string hdrEnvMap, SHIrradiance* irradiance);
 
  /**
   * given an environment cubemap, generate a pre-filtered environment map
   * @param envCubemap the OpenGL ID of the environment cubemap texture
+  * @param sourceHash hash of the HDR file from genEnvCubemap, 0 skips the cache
   * @return the OpenGL ID of the pre-filtered cubemap texture
   */
-GLuint genPrefilterMap(const GLuint& envCubemap);
+GLuint genPrefilterMap(const GLuint& envCubemap, const uint64_t sourceHash = 0);
 
 /**
  * given an environment cubemap, generate a BRDF lookup texture
@@ -0,0 +1,19 @@
+#ifndef ATOMIC_FILE_HPP
+#define ATOMIC_FILE_HPP
+
+#include <fstream>
+#include <functional>
+#include <string>
+
+/**
+ * Write <path> through a temporary file next to it, renamed into place
+ * once complete: a concurrent reader sees the old file or the whole new
+ * one, never half of it. How the on disk caches are written.
+ *
+ * <write> fills the binary stream and returns false to abandon the file,
+ * which then leaves <path> as it was.
+ * @return false if <path> wasn't replaced, I/O failures are logged
+ */
+bool writeFileAtomically(const std::string& path, const std::function<bool(std::ofstream&)>& write);
+
+#endif
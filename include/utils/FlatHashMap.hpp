@@ -0,0 +1,189 @@
+#ifndef FLAT_HASH_MAP_HPP
+#define FLAT_HASH_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/**
+ * Open addressing hash map with linear probing.
+ *
+ * Keys and values live in one flat array, so a lookup is a hash and a
+ * short forward scan over adjacent slots instead of a chase through
+ * std::unordered_map's node lists. Erasing shifts the following entries
+ * back, so there are no tombstones and probe lengths stay short.
+ *
+ * Meant for small, cheap to hash keys (ids, handles, StringId) mapping to
+ * dense indices. Pointers to values are invalidated by insertions.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>, typename Equal = std::equal_to<Key>>
+class FlatHashMap {
+public:
+    FlatHashMap() = default;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    /**
+     * @return The value for key, or nullptr if not present
+     */
+    Value* find(const Key& key) {
+        size_t slot = findSlot(key);
+        return slot == NOT_FOUND ? nullptr : &slots[slot].value;
+    }
+
+    const Value* find(const Key& key) const {
+        size_t slot = findSlot(key);
+        return slot == NOT_FOUND ? nullptr : &slots[slot].value;
+    }
+
+    bool contains(const Key& key) const { return findSlot(key) != NOT_FOUND; }
+
+    /**
+     * @brief Insert or overwrite the value for key
+     * @return Reference to the stored value
+     */
+    Value& insert(const Key& key, Value value) {
+        Value& stored = (*this)[key];
+        stored = std::move(value);
+        return stored;
+    }
+
+    /**
+     * @return The value for key, default constructed if it wasn't present
+     */
+    Value& operator[](const Key& key) {
+        size_t slot = findSlot(key);
+        if (slot != NOT_FOUND) {
+            return slots[slot].value;
+        }
+
+        // keep the load factor at or below 3/4
+        if ((count + 1) * 4 > slots.size() * 3) {
+            rehash(slots.empty() ? 16 : slots.size() * 2);
+        }
+
+        size_t mask = slots.size() - 1;
+        slot = hasher(key) & mask;
+        while (slots[slot].used) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot].used = true;
+        slots[slot].key = key;
+        slots[slot].value = Value();
+        count++;
+        return slots[slot].value;
+    }
+
+    /**
+     * @return true if key was present
+     */
+    bool erase(const Key& key) {
+        size_t slot = findSlot(key);
+        if (slot == NOT_FOUND) {
+            return false;
+        }
+
+        // backward shift: move later entries of the probe chain into the hole
+        size_t mask = slots.size() - 1;
+        size_t hole = slot;
+        size_t next = (hole + 1) & mask;
+        while (slots[next].used) {
+            size_t home = hasher(slots[next].key) & mask;
+            // can the entry at <next> move to <hole> without passing its home slot?
+            if (((next - home) & mask) >= ((next - hole) & mask)) {
+                slots[hole].key = std::move(slots[next].key);
+                slots[hole].value = std::move(slots[next].value);
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        slots[hole].used = false;
+        slots[hole].key = Key();
+        slots[hole].value = Value();
+        count--;
+        return true;
+    }
+
+    void clear() {
+        slots.clear();
+        count = 0;
+    }
+
+    /**
+     * @brief Make room for n entries without rehashing
+     */
+    void reserve(size_t n) {
+        size_t capacity = 16;
+        while (capacity * 3 < n * 4) {
+            capacity *= 2;
+        }
+        if (capacity > slots.size()) {
+            rehash(capacity);
+        }
+    }
+
+    /**
+     * @brief Call fn(key, value) for every entry, in no particular order
+     */
+    template<typename Fn>
+    void forEach(Fn&& fn) const {
+        for (const Slot& slot : slots) {
+            if (slot.used) {
+                fn(slot.key, slot.value);
+            }
+        }
+    }
+
+private:
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    struct Slot {
+        Key key = Key();
+        Value value = Value();
+        bool used = false;
+    };
+
+    std::vector<Slot> slots; // size is 0 or a power of two
+    size_t count = 0;
+    Hash hasher;
+    Equal equal;
+
+    size_t findSlot(const Key& key) const {
+        if (slots.empty()) {
+            return NOT_FOUND;
+        }
+        size_t mask = slots.size() - 1;
+        size_t slot = hasher(key) & mask;
+        while (slots[slot].used) {
+            if (equal(slots[slot].key, key)) {
+                return slot;
+            }
+            slot = (slot + 1) & mask;
+        }
+        return NOT_FOUND;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.resize(capacity);
+        size_t mask = capacity - 1;
+        for (Slot& entry : old) {
+            if (!entry.used) {
+                continue;
+            }
+            size_t slot = hasher(entry.key) & mask;
+            while (slots[slot].used) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot].used = true;
+            slots[slot].key = std::move(entry.key);
+            slots[slot].value = std::move(entry.value);
+        }
+    }
+};
+
+#endif // FLAT_HASH_MAP_HPP
@@ -0,0 +1,66 @@
+#ifndef OFFSET_ALLOCATOR_HPP
+#define OFFSET_ALLOCATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+/**
+ * Sub-allocates ranges of a fixed size space, e.g. elements of a large GPU
+ * buffer. Only offsets are handed out, the allocator never touches the
+ * memory itself.
+ *
+ * Best fit over the free ranges, which are kept sorted both by size and by
+ * offset: allocating and freeing are O(log n) and freed ranges merge with
+ * free neighbours right away, so the space doesn't fragment into slivers.
+ *
+ * Units are whatever the caller counts in (vertices, indices, bytes).
+ * Not thread safe.
+ */
+class OffsetAllocator {
+public:
+    static constexpr uint32_t NO_SPACE = 0xffffffffu;
+
+    explicit OffsetAllocator(uint32_t capacity = 0);
+
+    /**
+     * Reserve <size> units
+     * @return The offset of the range, or NO_SPACE if no free range is large enough
+     */
+    uint32_t allocate(uint32_t size);
+
+    /**
+     * Give back a range returned by allocate(), with the same size
+     */
+    void free(uint32_t offset, uint32_t size);
+
+    /**
+     * Extend the space to <capacity> units, the new units are free.
+     * The space never shrinks.
+     */
+    void grow(uint32_t capacity);
+
+    uint32_t capacity() const { return total; }
+    uint32_t used() const { return allocated; }
+    uint32_t largestFree() const;
+    size_t freeRangeCount() const { return byOffset.size(); }
+
+private:
+    using SizeMap = std::multimap<uint32_t, uint32_t>;
+
+    struct FreeRange {
+        uint32_t size;
+        SizeMap::iterator bySizeEntry;
+    };
+
+    // offset -> free range, and size -> offset of the same ranges
+    std::map<uint32_t, FreeRange> byOffset;
+    SizeMap bySize;
+    uint32_t total = 0;
+    uint32_t allocated = 0;
+
+    void insertFree(uint32_t offset, uint32_t size);
+    void eraseFree(std::map<uint32_t, FreeRange>::iterator range);
+};
+
+#endif // OFFSET_ALLOCATOR_HPP
@@ -0,0 +1,75 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/Shader.hpp"
+
+/**
+ * On disk cache of linked shader programs, see Shader::loadFromSources.
+ *
+ * A program is stored with glGetProgramBinary under a key hashing its
+ * sources, its defines and the GL vendor, renderer and version strings,
+ * so a driver update or an edited shader simply misses. The driver may
+ * still reject a binary it wrote itself (glProgramBinary then leaves the
+ * program unlinked); the caller compiles from source and the entry is
+ * rewritten.
+ *
+ * File layout, one file per program named after its key:
+ *
+ *   char magic[4] = "SPB1"
+ *   uint32_t version
+ *   uint64_t key
+ *   uint32_t binaryFormat
+ *   uint32_t binarySize
+ *   uint8_t binary[binarySize]
+ */
+class ProgramCache {
+public:
+    /**
+     * Hash sources and defines for <driver>, see driverString(). The order
+     * of <sources> doesn't matter
+     */
+    static uint64_t computeKey(const std::unordered_map<SHADER_TYPE, std::string>& sources,
+                               const std::string& defines, const std::string& driver);
+
+    // vendor, renderer and version of the current context
+    static std::string driverString();
+
+    /**
+     * True if the context can hand out program binaries, GL 4.1 or
+     * ARB_get_program_binary with at least one binary format
+     */
+    static bool isSupported();
+
+    /**
+     * Store cache files in <directory>, created on the first store.
+     * An empty string turns the cache off. Defaults to shader-cache in
+     * the temporary directory, or off if there is none
+     */
+    static void setDirectory(const std::string& directory);
+    static std::string getDirectory();
+
+    /**
+     * Link <program> from the binary cached under <key>
+     * @return true if the program is linked and ready to use
+     */
+    static bool load(GLuint program, uint64_t key);
+
+    /**
+     * Write the binary of linked <program> under <key>. <program> must have
+     * been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+     */
+    static bool store(GLuint program, uint64_t key);
+
+    // Serialization of one entry, exposed for tests
+    static bool writeFile(const std::string& path, uint64_t key, GLenum format, const std::vector<uint8_t>& binary);
+    static bool readFile(const std::string& path, uint64_t key, GLenum& format, std::vector<uint8_t>& binary);
+
+    static std::string pathFor(uint64_t key);
+};
+
+#endif
@@ -1,5 +1,6 @@
 #ifndef SHADER_JAVA
 #define SHADER_JAVA
+#include <cstdint>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -17,6 +18,7 @@
 #include "glad/glad.h"
 #include <GLFW/glfw3.h>
 #include "utils/Logger.hpp"
+#include "utils/UniformBuffer.hpp"
 
 enum SHADER_TYPE {
   UNINITIALIZED,
@@ -34,9 +36,19 @@ std::vector<GLuint> shaders; // Store multiple shader objects
 std::unordered_map<SHADER_TYPE, GLuint> shaderMap; // Map shader types to their OpenGL IDs
 std::unordered_map<std::string, GLint> uniformCache; // Cache uniform locations
 
+// Sources of the last load, the program may have come from ProgramCache without compiling them
+std::unordered_map<SHADER_TYPE, std::string> programSources;
+std::string programDefines;
+uint64_t programKey = 0;
+bool loadedFromCache = false;
+// set between beginLoadFromSources and finishLoad
+bool linkPending = false;
+bool storeBinary = false;
+
 // Helper methods
 GLenum getGLShaderType(SHADER_TYPE type);
-bool compileShader(GLuint& shader, SHADER_TYPE shaderType, const std::string& source);
+bool compileShader(GLuint& shader, SHADER_TYPE shaderType, const std::string& source, bool checkStatus = true);
+bool compileCachedSources();
 void checkCompileErrors(GLuint shader, const std::string& type);
 void ensureShaderActive(std::function<void()> uniformSetter);
 
@@ -47,6 +59,11 @@ inline bool is_bound() {
 	return bound;
 }
 
+// OpenGL program name, 0 until linked
+inline GLuint getProgram() const {
+	return shaderProgram;
+}
+
 // Shader loading and compilation
 bool addShader(SHADER_TYPE shaderType, const std::string& source);
 bool replaceShader(SHADER_TYPE shaderType, const std::string& source);
@@ -55,6 +72,29 @@ bool linkProgram();
 bool loadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& shaderFiles);
 bool loadFromSources(const std::unordered_map<SHADER_TYPE, std::string>& shaderSources);
 
+// Split loading: begin issues the compile and link without waiting on them, finishLoad
+// checks the result. Beginning several shaders before finishing any lets drivers with
+// GL_KHR_parallel_shader_compile build them concurrently. Both go through ProgramCache.
+bool beginLoadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& shaderFiles);
+bool beginLoadFromSources(const std::unordered_map<SHADER_TYPE, std::string>& shaderSources);
+bool finishLoad();
+// false while the driver is still compiling a begun load, finishLoad would block
+bool isLoadReady();
+// Preprocessor defines for the next load, injected after #version in every stage.
+// "NAME" or "NAME=VALUE". Part of the program cache key. See ShaderVariants.
+void setDefines(const std::vector<std::string>& defines);
+inline const std::string& getDefines() const {
+	return programDefines;
+}
+// #define lines of <defines>, sorted and without duplicates so equal sets give equal text
+static std::string buildDefineBlock(const std::vector<std::string>& defines);
+// <source> with <defineBlock> after its #version line, line numbers of the rest unchanged
+static std::string injectDefines(const std::string& source, const std::string& defineBlock);
+// true if the last load linked from a cached program binary
+inline bool isLoadedFromCache() const {
+	return loadedFromCache;
+}
+
 // Uniform handling
 GLint getUniformLocation(const std::string& name);
 void setUniform(const std::string& name, float value);
@@ -69,6 +109,24 @@ void setUniform(const std::string& name, const Eigen::Affine3d& mat);
 
 void setUniform(const std::string& name, const Eigen::Matrix4f& mat4);
 
+// Pre-resolved handles from getUniformLocation, skip the name lookup. -1 is ignored.
+// With GL 4.1 these set the value with glProgramUniform, no program switch needed.
+void setUniform(GLint location, float value);
+void setUniform(GLint location, int value);
+void setUniform(GLint location, float x, float y);
+void setUniform(GLint location, float x, float y, float z);
+void setUniform(GLint location, float x, float y, float z, float w);
+// <count> floats from <values> into an array starting at <location>, in one call
+void setUniformArray(GLint location, const float* values, GLsizei count);
+// <count> vec3s (3 * <count> floats) from <values> into a vec3 array starting at <location>, in one call
+void setUniformVec3Array(GLint location, const float* values, GLsizei count);
+
+// Uniform blocks, fed from a UniformRing or any other uniform buffer
+// Point block <blockName> at the uniform buffer binding <binding>, false if the program has no such block
+bool bindUniformBlock(const std::string& blockName, GLuint binding);
+// std140 or shared layout of block <blockName> as linked, false if the program has no such block
+bool getUniformBlockLayout(const std::string& blockName, UniformBlockLayout& layout);
+
 void bind();
 void unbind();
 
@@ -0,0 +1,78 @@
+#ifndef SHADER_VARIANTS_HPP
+#define SHADER_VARIANTS_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/FlatHashMap.hpp"
+#include "utils/Shader.hpp"
+
+/**
+ * Compiled permutations of one effect, one program per set of #defines.
+ *
+ * Features such as NORMAL_MAP, ALPHA_TEST or UNLIT (see assets/default.frag)
+ * become static branches: each combination in use is compiled on its first
+ * get() and kept, so no fragment pays for a feature its material doesn't
+ * have. Variants listed in precompile() are built up front, all begun
+ * before any is finished so drivers with parallel compilation overlap them.
+ * Every variant goes through ProgramCache like any other Shader.
+ *
+ * Must be used on the thread owning the GL context.
+ */
+class ShaderVariants {
+public:
+    using Defines = std::vector<std::string>;
+
+    /**
+     * Read the sources every variant is built from, drops compiled variants
+     * @return false if a file can't be read
+     */
+    bool loadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& shaderFiles);
+    void setSources(const std::unordered_map<SHADER_TYPE, std::string>& shaderSources);
+
+    /**
+     * The variant for <defines>, compiled on first use. Order and
+     * duplicates in <defines> don't matter
+     * @return nullptr if the variant doesn't compile, it isn't retried
+     */
+    Shader* get(const Defines& defines);
+
+    /**
+     * An already built variant by key, without hashing any strings
+     * @return nullptr if get() or precompile() didn't build it
+     */
+    Shader* find(uint64_t key) const;
+
+    /**
+     * Build every variant of <variants> that isn't built yet
+     * @return Number of listed variants that failed to compile
+     */
+    size_t precompile(const std::vector<Defines>& variants);
+
+    /**
+     * Key of a define set, equal for equal sets
+     */
+    static uint64_t variantKey(const Defines& defines);
+
+    // variants built so far, failed ones included
+    size_t size() const { return variants.size(); }
+
+private:
+    struct Variant {
+        std::string defineBlock;
+        std::unique_ptr<Shader> shader;
+        bool failed = false;
+    };
+
+    std::unordered_map<SHADER_TYPE, std::string> sources;
+    std::vector<Variant> variants;
+    FlatHashMap<uint64_t, uint32_t> byKey;
+
+    // the variant for <defineBlock>, created and its load begun if new. nullptr on a key collision
+    Variant* beginVariant(uint64_t key, const std::string& defineBlock, const Defines& defines, bool& begun);
+};
+
+#endif
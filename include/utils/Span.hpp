@@ -0,0 +1,49 @@
+#ifndef SPAN_HPP
+#define SPAN_HPP
+
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Non-owning view of a contiguous array, a stand-in for C++20 std::span.
+ *
+ * Lets accessors hand out their storage without copying it (or, for
+ * vectors of shared_ptr, without touching every reference count). Valid
+ * for as long as the viewed storage is alive and not reallocated.
+ */
+template<typename T>
+class Span {
+public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using iterator = T*;
+
+    Span() = default;
+    Span(T* data, size_t size) : ptr(data), count(size) {}
+
+    template<typename U, typename Alloc,
+             typename = std::enable_if_t<std::is_convertible_v<U(*)[], T(*)[]>>>
+    Span(std::vector<U, Alloc>& vector) : ptr(vector.data()), count(vector.size()) {}
+
+    template<typename U, typename Alloc,
+             typename = std::enable_if_t<std::is_convertible_v<const U(*)[], T(*)[]>>>
+    Span(const std::vector<U, Alloc>& vector) : ptr(vector.data()), count(vector.size()) {}
+
+    T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](size_t i) const { return ptr[i]; }
+    T& front() const { return ptr[0]; }
+    T& back() const { return ptr[count - 1]; }
+
+    iterator begin() const { return ptr; }
+    iterator end() const { return ptr + count; }
+
+private:
+    T* ptr = nullptr;
+    size_t count = 0;
+};
+
+#endif // SPAN_HPP
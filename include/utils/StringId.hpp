@@ -0,0 +1,66 @@
+#ifndef STRING_ID_HPP
+#define STRING_ID_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * Interned string.
+ *
+ * Every distinct string is stored once in a process wide table, together
+ * with its hash computed at registration. Comparing two StringIds is a
+ * pointer compare and hashing one is free, which makes them cheap keys
+ * for FlatHashMap lookups by name or path.
+ *
+ * Interning is thread safe. Interned strings are never freed.
+ */
+class StringId {
+public:
+    // the empty, invalid id
+    StringId() = default;
+
+    // intern <text>, registering it if it wasn't already
+    explicit StringId(std::string_view text);
+
+    /**
+     * @brief Find an already interned string without registering it
+     * @return The id, or an invalid id if <text> was never interned
+     */
+    static StringId lookup(std::string_view text);
+
+    static constexpr uint64_t HASH_SEED = 14695981039346656037ull;
+
+    // 64 bit FNV-1a, the hash stored for every interned string. Pass a
+    // previous hash as <seed> to continue it over more bytes
+    static uint64_t hashOf(std::string_view text, uint64_t seed = HASH_SEED);
+
+    bool valid() const { return entry != nullptr; }
+    uint64_t hash() const { return entry ? entry->hash : 0; }
+    const std::string& str() const;
+
+    bool operator==(const StringId& other) const { return entry == other.entry; }
+    bool operator!=(const StringId& other) const { return entry != other.entry; }
+
+private:
+    friend struct StringTable;
+
+    struct Entry {
+        std::string text;
+        uint64_t hash;
+    };
+    const Entry* entry = nullptr;
+
+    explicit StringId(const Entry* entry) : entry(entry) {}
+};
+
+namespace std {
+    template<>
+    struct hash<StringId> {
+        size_t operator()(const StringId& id) const { return static_cast<size_t>(id.hash()); }
+    };
+}
+
+#endif // STRING_ID_HPP
@@ -0,0 +1,123 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * Fixed size pool of worker threads for CPU side engine work
+ * (asset decoding, mesh processing, ...).
+ *
+ * Nothing submitted here may touch OpenGL, only the main thread owns
+ * the context. Produce CPU buffers on the pool and upload them afterwards.
+ */
+class ThreadPool {
+public:
+    // 0 picks std::thread::hardware_concurrency()
+    explicit ThreadPool(unsigned int numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Shared engine wide pool, created on first use
+     */
+    static ThreadPool& shared();
+
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()); }
+
+    /**
+     * Queue fn to run on a worker thread.
+     * Exceptions thrown by fn are rethrown by future::get().
+     */
+    template<typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<std::decay_t<Fn>>>;
+
+    /**
+     * Run fn(i) for every i in [0, count) across the pool and block until done.
+     * The calling thread also takes work, so this is safe to call from
+     * inside a pool task. The first exception thrown by fn is rethrown here.
+     */
+    template<typename Fn>
+    void parallelFor(size_t count, Fn&& fn);
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    bool stopping = false;
+
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+};
+
+template<typename Fn>
+auto ThreadPool::submit(Fn&& fn) -> std::future<std::invoke_result_t<std::decay_t<Fn>>> {
+    using Result = std::invoke_result_t<std::decay_t<Fn>>;
+
+    // std::function needs a copyable target, packaged_task is move only
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Fn>(fn));
+    std::future<Result> future = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return future;
+}
+
+template<typename Fn>
+void ThreadPool::parallelFor(size_t count, Fn&& fn) {
+    if (count == 0) {
+        return;
+    }
+
+    // shared so helpers that only get scheduled after we return stay valid
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    auto body = [state, count, &fn]() {
+        size_t i;
+        while ((i = state->next.fetch_add(1)) < count) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+            if (state->done.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min<size_t>(size(), count - 1);
+    for (size_t h = 0; h < helpers; ++h) {
+        // a helper that starts late finds no work left and never calls fn
+        enqueue(body);
+    }
+    body();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done.load() == count; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+#endif // THREAD_POOL_HPP
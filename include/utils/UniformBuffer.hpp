@@ -0,0 +1,159 @@
+#ifndef UNIFORM_BUFFER_HPP
+#define UNIFORM_BUFFER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glad/glad.h"
+
+/**
+ * Types a std140 block can hold, arrays are declared with a count
+ */
+enum class Std140Type {
+    FLOAT,
+    INT,
+    VEC2,
+    VEC3,
+    VEC4,
+    MAT3,
+    MAT4,
+};
+
+/**
+ * Computes std140 offsets for a uniform block declared on the CPU side, in
+ * the same order as its GLSL declaration. Lets C++ code fill a block without
+ * a program to reflect, e.g. per frame constants shared by many shaders.
+ *
+ * std140 rules: scalars align to 4, vec2 to 8, vec3 and vec4 to 16. Array
+ * elements and matrix columns are padded to 16 bytes each, and the block
+ * size is rounded up to 16.
+ */
+class Std140Layout {
+public:
+    /**
+     * Append a member of <type>, <count> elements if it is an array
+     * @return Byte offset of the member
+     */
+    size_t add(Std140Type type, size_t count = 1);
+
+    // bytes between array elements, 0 for non-arrays
+    size_t getArrayStride(size_t member) const { return members[member].arrayStride; }
+    size_t getOffset(size_t member) const { return members[member].offset; }
+    size_t getMemberCount() const { return members.size(); }
+    size_t size() const;
+
+private:
+    struct Member {
+        size_t offset;
+        size_t arrayStride;
+    };
+    std::vector<Member> members;
+    size_t end = 0;
+};
+
+/**
+ * One member of a uniform block, as the linked program lays it out
+ */
+struct UniformMember {
+    GLint offset = -1;
+    // bytes between array elements and between matrix columns, 0 if not one
+    GLint arrayStride = 0;
+    GLint matrixStride = 0;
+    GLint arraySize = 1;
+    GLenum type = 0;
+};
+
+/**
+ * Layout of a uniform block reflected from a linked program, see
+ * Shader::getUniformBlockLayout. Array members are listed once, by the
+ * name of their first element ("weights[0]")
+ */
+struct UniformBlockLayout {
+    GLuint index = GL_INVALID_INDEX;
+    GLint size = 0;
+    std::unordered_map<std::string, UniformMember> members;
+
+    // nullptr if the block has no such member
+    const UniformMember *find(const std::string &name) const;
+};
+
+/**
+ * Space handed out by UniformRing::allocate, write <size> bytes to <data>
+ * before binding it
+ */
+struct UniformAllocation {
+    void *data = nullptr;
+    GLintptr offset = 0;
+    GLsizeiptr size = 0;
+};
+
+/**
+ * A uniform buffer used as a ring of per frame regions, so per frame and
+ * per draw constants cost a memcpy and a glBindBufferRange instead of a
+ * hash lookup and a glUniform call per value.
+ *
+ * With GL 4.4 or ARB_buffer_storage the buffer is persistently and
+ * coherently mapped, writes land in GPU visible memory directly. Otherwise
+ * allocations come from a CPU copy that bind() uploads with glBufferSubData.
+ * Either way a frame's region is only reused once the fence placed by
+ * endFrame() <frames> frames ago has signalled.
+ *
+ * Must be used on the thread owning the GL context.
+ */
+class UniformRing {
+public:
+    UniformRing() = default;
+    ~UniformRing();
+    UniformRing(const UniformRing &) = delete;
+    UniformRing &operator=(const UniformRing &) = delete;
+
+    /**
+     * Create the buffer, <frames> regions of <bytesPerFrame> each
+     * @return false if the buffer couldn't be created
+     */
+    bool create(size_t bytesPerFrame, int frames = 3);
+    void destroy();
+
+    /**
+     * Move to the next region, waiting for the GPU if it still reads it
+     */
+    void beginFrame();
+
+    /**
+     * Fence the current region, call once its draws are submitted
+     */
+    void endFrame();
+
+    /**
+     * Reserve <size> bytes in the current region, aligned for glBindBufferRange
+     * @return The allocation, data is null if the region is full
+     */
+    UniformAllocation allocate(size_t size);
+
+    /**
+     * Bind <allocation> to the uniform buffer binding point <binding>
+     */
+    void bind(GLuint binding, const UniformAllocation &allocation);
+
+    bool isPersistent() const { return persistent; }
+    GLuint getBuffer() const { return buffer; }
+    // bytes allocated in the current region, padding included
+    size_t getUsed() const { return head; }
+
+private:
+    GLuint buffer = 0;
+    uint8_t *mapped = nullptr;
+    std::vector<uint8_t> shadow;
+    bool persistent = false;
+
+    size_t frameSize = 0;
+    size_t alignment = 256;
+    size_t head = 0;
+    int frame = 0;
+    std::vector<GLsync> fences;
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include "animation/SpatialHashGrid.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+namespace animation {
+
+namespace {
+
+    /**
+     * Splits [0, count) into one contiguous chunk per thread and runs
+     * fn(begin, end, threadIndex) on each. The calling thread takes chunk 0.
+     */
+    template<typename Fn>
+    void parallelChunks(size_t count, unsigned int numThreads, Fn &&fn) {
+        if (numThreads <= 1 || count < 2 * numThreads) {
+            fn(size_t(0), count, 0u);
+            return;
+        }
+
+        size_t chunk = (count + numThreads - 1) / numThreads;
+        std::vector<std::thread> workers;
+        workers.reserve(numThreads - 1);
+        for (unsigned int t = 1; t < numThreads; ++t) {
+            size_t begin = std::min(count, t * chunk);
+            size_t end = std::min(count, begin + chunk);
+            workers.emplace_back([&fn, begin, end, t]() { fn(begin, end, t); });
+        }
+        fn(size_t(0), std::min(count, chunk), 0u);
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t nextPowerOfTwo(size_t v) {
+        uint32_t p = 1;
+        while (p < v && p < (1u << 31)) {
+            p <<= 1;
+        }
+        return p;
+    }
+}
+
+SpatialHashGrid::SpatialHashGrid(double cellSize, unsigned int numThreads) {
+    setCellSize(cellSize);
+    setNumThreads(numThreads);
+}
+
+void SpatialHashGrid::setCellSize(double cellSize) {
+    if (cellSize <= 0.0) {
+        throw std::invalid_argument("Cell size must be positive");
+    }
+    m_cellSize = cellSize;
+    m_invCellSize = 1.0 / cellSize;
+}
+
+void SpatialHashGrid::setNumThreads(unsigned int numThreads) {
+    if (numThreads == 0) {
+        numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_numThreads = numThreads;
+}
+
+uint32_t SpatialHashGrid::hashCell(int x, int y, int z) const {
+    // Teschner et al. 2003, "Optimized Spatial Hashing for Collision Detection of Deformable Objects"
+    uint32_t h = (static_cast<uint32_t>(x) * 73856093u) ^
+                 (static_cast<uint32_t>(y) * 19349663u) ^
+                 (static_cast<uint32_t>(z) * 83492791u);
+    return h & m_bucketMask;
+}
+
+int SpatialHashGrid::neighbourBuckets(const Eigen::Vector3i &cell, std::array<uint32_t, 27> &buckets) const {
+    int n = 0;
+    for (int dz = -1; dz <= 1; ++dz) {
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                uint32_t bucket = hashCell(cell.x() + dx, cell.y() + dy, cell.z() + dz);
+                // distinct cells can collide into the same bucket, visit it only once
+                if (std::find(buckets.begin(), buckets.begin() + n, bucket) == buckets.begin() + n) {
+                    buckets[n++] = bucket;
+                }
+            }
+        }
+    }
+    return n;
+}
+
+void SpatialHashGrid::build(const std::vector<Eigen::Vector3d> &positions) {
+    const size_t nbodies = positions.size();
+    const unsigned int nthreads = m_numThreads;
+
+    // one bucket per body keeps collisions rare
+    const uint32_t nbuckets = nextPowerOfTwo(std::max<size_t>(nbodies, 1));
+    m_bucketMask = nbuckets - 1;
+
+    // Buckets are grouped into at most MAX_BINS contiguous bins by their high
+    // bits. Threads only histogram bins, so the per-thread state stays fixed
+    // size no matter how many buckets there are.
+    uint32_t binShift = 0;
+    while ((nbuckets >> binShift) > MAX_BINS) {
+        ++binShift;
+    }
+    const uint32_t nbins = nbuckets >> binShift;
+
+    m_bodyCell.resize(nbodies);
+    m_bodyBucket.resize(nbodies);
+    m_binnedBodies.resize(nbodies);
+    m_sortedBodies.resize(nbodies);
+    m_sortedPositions.resize(nbodies);
+    m_bucketStart.resize(static_cast<size_t>(nbuckets) + 1);
+    m_binStart.resize(static_cast<size_t>(nbins) + 1);
+    m_threadCounts.resize(static_cast<size_t>(nbins) * nthreads);
+    std::fill(m_threadCounts.begin(), m_threadCounts.end(), 0u);
+
+    // Pass 1: cell coordinates, bucket and a per-thread bin histogram
+    parallelChunks(nbodies, nthreads, [&](size_t begin, size_t end, unsigned int t) {
+        uint32_t *counts = m_threadCounts.data() + static_cast<size_t>(t) * nbins;
+        for (size_t i = begin; i < end; ++i) {
+            Eigen::Vector3i cell(
+                static_cast<int>(std::floor(positions[i].x() * m_invCellSize)),
+                static_cast<int>(std::floor(positions[i].y() * m_invCellSize)),
+                static_cast<int>(std::floor(positions[i].z() * m_invCellSize))
+            );
+            uint32_t bucket = hashCell(cell.x(), cell.y(), cell.z());
+            m_bodyCell[i] = cell;
+            m_bodyBucket[i] = bucket;
+            counts[bucket >> binShift]++;
+        }
+    });
+
+    // Pass 2: exclusive prefix sum over (bin, thread) so each thread
+    // gets its own write cursor inside every bin, keeping the sort stable
+    uint32_t running = 0;
+    for (uint32_t b = 0; b < nbins; ++b) {
+        m_binStart[b] = running;
+        for (unsigned int t = 0; t < nthreads; ++t) {
+            uint32_t &count = m_threadCounts[static_cast<size_t>(t) * nbins + b];
+            uint32_t c = count;
+            count = running;
+            running += c;
+        }
+    }
+    m_binStart[nbins] = running;
+
+    // Pass 3: scatter body ids into bin order
+    parallelChunks(nbodies, nthreads, [&](size_t begin, size_t end, unsigned int t) {
+        uint32_t *cursor = m_threadCounts.data() + static_cast<size_t>(t) * nbins;
+        for (size_t i = begin; i < end; ++i) {
+            m_binnedBodies[cursor[m_bodyBucket[i] >> binShift]++] = static_cast<uint32_t>(i);
+        }
+    });
+
+    // Pass 4: counting sort inside each bin. Bins own disjoint bucket ranges
+    // and body ranges, so they are sorted independently with m_bucketStart
+    // doubling as the histogram and the write cursor.
+    parallelChunks(nbins, nthreads, [&](size_t begin, size_t end, unsigned int) {
+        for (size_t bin = begin; bin < end; ++bin) {
+            const uint32_t lo = static_cast<uint32_t>(bin) << binShift;
+            const uint32_t hi = lo + (1u << binShift);
+            const uint32_t first = m_binStart[bin];
+            const uint32_t last = m_binStart[bin + 1];
+
+            std::fill(m_bucketStart.begin() + lo, m_bucketStart.begin() + hi, 0u);
+            for (uint32_t s = first; s < last; ++s) {
+                m_bucketStart[m_bodyBucket[m_binnedBodies[s]]]++;
+            }
+
+            // inclusive sum, the backwards scatter below turns it into bucket starts
+            uint32_t sum = first;
+            for (uint32_t b = lo; b < hi; ++b) {
+                sum += m_bucketStart[b];
+                m_bucketStart[b] = sum;
+            }
+
+            for (uint32_t s = last; s-- > first;) {
+                uint32_t body = m_binnedBodies[s];
+                uint32_t slot = --m_bucketStart[m_bodyBucket[body]];
+                m_sortedBodies[slot] = body;
+                m_sortedPositions[slot] = positions[body];
+            }
+        }
+    });
+    m_bucketStart[nbuckets] = static_cast<uint32_t>(nbodies);
+}
+
+void SpatialHashGrid::findPairs(double radius, BodyPairList &pairs) const {
+    pairs.clear();
+    if (2.0 * radius > m_cellSize) {
+        throw std::invalid_argument("Body diameter exceeds grid cell size");
+    }
+
+    const size_t nbodies = m_sortedBodies.size();
+    const double maxDistSq = 4.0 * radius * radius;
+    std::vector<BodyPairList> threadPairs(m_numThreads);
+
+    // walk bodies in sorted order so neighbouring buckets stay in cache
+    parallelChunks(nbodies, m_numThreads, [&](size_t begin, size_t end, unsigned int t) {
+        BodyPairList &out = threadPairs[t];
+        std::array<uint32_t, 27> buckets;
+        for (size_t s = begin; s < end; ++s) {
+            uint32_t body = m_sortedBodies[s];
+            const Eigen::Vector3d &p = m_sortedPositions[s];
+            int n = neighbourBuckets(m_bodyCell[body], buckets);
+            for (int i = 0; i < n; ++i) {
+                for (uint32_t o = m_bucketStart[buckets[i]]; o < m_bucketStart[buckets[i] + 1]; ++o) {
+                    uint32_t other = m_sortedBodies[o];
+                    // each pair is seen from both sides, keep the one where a < b
+                    if (other <= body) {
+                        continue;
+                    }
+                    if ((m_sortedPositions[o] - p).squaredNorm() < maxDistSq) {
+                        out.push_back({body, other});
+                    }
+                }
+            }
+        }
+    });
+
+    size_t total = 0;
+    for (const auto &list : threadPairs) {
+        total += list.size();
+    }
+    pairs.reserve(total);
+    for (const auto &list : threadPairs) {
+        pairs.insert(pairs.end(), list.begin(), list.end());
+    }
+}
+
+} // namespace animation
@@ -6,6 +6,7 @@
 
 #include <iostream>
 
+#include "modeling/GeometryArena.hpp"
 #include "shared/Scene.hpp"
 
 void initGLFW();
@@ -43,6 +44,7 @@ int main()
         glfwPollEvents();
     }
 
+    modeling::GeometryArena::shared().shutdown();
     glfwTerminate();
     return 0;
 }
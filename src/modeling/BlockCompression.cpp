@@ -0,0 +1,366 @@
+#include "modeling/BlockCompression.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace modeling {
+
+namespace {
+
+    // interpolation weights of 4 bit BC7 indices, out of 64
+    const int WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    class BitWriter {
+    public:
+        explicit BitWriter(uint8_t* out) : out(out) { std::memset(out, 0, 16); }
+
+        void write(uint32_t value, int bits) {
+            for (int i = 0; i < bits; i++, position++) {
+                if (value & (1u << i)) {
+                    out[position >> 3] |= uint8_t(1u << (position & 7));
+                }
+            }
+        }
+
+    private:
+        uint8_t* out;
+        int position = 0;
+    };
+
+    class BitReader {
+    public:
+        explicit BitReader(const uint8_t* in) : in(in) {}
+
+        uint32_t read(int bits) {
+            uint32_t value = 0;
+            for (int i = 0; i < bits; i++, position++) {
+                value |= uint32_t((in[position >> 3] >> (position & 7)) & 1) << i;
+            }
+            return value;
+        }
+
+    private:
+        const uint8_t* in;
+        int position = 0;
+    };
+
+    // mode 6 endpoints: 7 bits per channel plus one p-bit per endpoint
+    struct Endpoints {
+        int color[2][4];
+        int pbit[2];
+
+        int expanded(int endpoint, int channel) const {
+            return (color[endpoint][channel] << 1) | pbit[endpoint];
+        }
+    };
+
+    // closest representable endpoint to <target>, trying both p-bits
+    void quantize(const float* target, int* color, int& pbit) {
+        float best = -1.0f;
+        for (int p = 0; p < 2; p++) {
+            int q[4];
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                q[c] = std::clamp(static_cast<int>(std::lround((target[c] - p) * 0.5f)), 0, 127);
+                float d = float((q[c] << 1) | p) - target[c];
+                error += d * d;
+            }
+            if (best < 0.0f || error < best) {
+                best = error;
+                pbit = p;
+                std::copy(q, q + 4, color);
+            }
+        }
+    }
+
+    // pick the best index for every texel, returns the squared error
+    int assignIndices(const Endpoints& endpoints, const uint8_t* rgba, int* indices) {
+        int palette[16][4];
+        for (int i = 0; i < 16; i++) {
+            for (int c = 0; c < 4; c++) {
+                palette[i][c] = ((64 - WEIGHTS4[i]) * endpoints.expanded(0, c) +
+                                 WEIGHTS4[i] * endpoints.expanded(1, c) + 32) >> 6;
+            }
+        }
+        int total = 0;
+        for (int t = 0; t < 16; t++) {
+            int best = -1;
+            for (int i = 0; i < 16; i++) {
+                int error = 0;
+                for (int c = 0; c < 4; c++) {
+                    int d = palette[i][c] - rgba[t * 4 + c];
+                    error += d * d;
+                }
+                if (best < 0 || error < best) {
+                    best = error;
+                    indices[t] = i;
+                }
+            }
+            total += best;
+        }
+        return total;
+    }
+
+    // least squares endpoints for fixed indices, false if degenerate
+    bool refit(const uint8_t* rgba, const int* indices, float (&lo)[4], float (&hi)[4]) {
+        float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+        float ax[4] = {}, bx[4] = {};
+        for (int t = 0; t < 16; t++) {
+            float b = WEIGHTS4[indices[t]] / 64.0f;
+            float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < 4; c++) {
+                ax[c] += a * rgba[t * 4 + c];
+                bx[c] += b * rgba[t * 4 + c];
+            }
+        }
+        float det = aa * bb - ab * ab;
+        if (std::fabs(det) < 1e-6f) {
+            return false;
+        }
+        for (int c = 0; c < 4; c++) {
+            lo[c] = std::clamp((bb * ax[c] - ab * bx[c]) / det, 0.0f, 255.0f);
+            hi[c] = std::clamp((aa * bx[c] - ab * ax[c]) / det, 0.0f, 255.0f);
+        }
+        return true;
+    }
+
+    void encodeBC4(const uint8_t* values, int stride, uint8_t* block) {
+        uint8_t lo = 255, hi = 0;
+        for (int t = 0; t < 16; t++) {
+            lo = std::min(lo, values[t * stride]);
+            hi = std::max(hi, values[t * stride]);
+        }
+
+        // with r0 > r1 the palette is r0, r1 and 6 values in between
+        int palette[8] = { hi, lo };
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * hi + (i - 1) * lo) / 7;
+        }
+
+        block[0] = hi;
+        block[1] = lo;
+        uint64_t bits = 0;
+        if (hi != lo) {
+            for (int t = 0; t < 16; t++) {
+                int best = 0;
+                for (int i = 1; i < 8; i++) {
+                    if (std::abs(palette[i] - values[t * stride]) < std::abs(palette[best] - values[t * stride])) {
+                        best = i;
+                    }
+                }
+                bits |= uint64_t(best) << (3 * t);
+            }
+        }
+        for (int i = 0; i < 6; i++) {
+            block[2 + i] = uint8_t(bits >> (8 * i));
+        }
+    }
+
+    void decodeBC4(const uint8_t* block, uint8_t* values, int stride) {
+        int r0 = block[0], r1 = block[1];
+        int palette[8] = { r0, r1 };
+        if (r0 > r1) {
+            for (int i = 2; i < 8; i++) {
+                palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+            }
+        } else {
+            for (int i = 2; i < 6; i++) {
+                palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+            }
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+        uint64_t bits = 0;
+        for (int i = 0; i < 6; i++) {
+            bits |= uint64_t(block[2 + i]) << (8 * i);
+        }
+        for (int t = 0; t < 16; t++) {
+            values[t * stride] = uint8_t(palette[(bits >> (3 * t)) & 7]);
+        }
+    }
+}
+
+void BlockCompression::encodeBC7Block(const uint8_t* rgba, uint8_t* block) {
+    // principal axis of the texels, by power iteration on the covariance
+    float mean[4] = {};
+    for (int t = 0; t < 16; t++) {
+        for (int c = 0; c < 4; c++) {
+            mean[c] += rgba[t * 4 + c] / 16.0f;
+        }
+    }
+    float covariance[4][4] = {};
+    for (int t = 0; t < 16; t++) {
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                covariance[i][j] += (rgba[t * 4 + i] - mean[i]) * (rgba[t * 4 + j] - mean[j]);
+            }
+        }
+    }
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {};
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 4; j++) {
+                next[i] += covariance[i][j] * axis[j];
+            }
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+        if (length < 1e-6f) {
+            break; // flat block, any axis works
+        }
+        for (int c = 0; c < 4; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float tmin = 0.0f, tmax = 0.0f;
+    for (int t = 0; t < 16; t++) {
+        float projection = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            projection += (rgba[t * 4 + c] - mean[c]) * axis[c];
+        }
+        tmin = std::min(tmin, projection);
+        tmax = std::max(tmax, projection);
+    }
+    float lo[4], hi[4];
+    for (int c = 0; c < 4; c++) {
+        lo[c] = std::clamp(mean[c] + tmin * axis[c], 0.0f, 255.0f);
+        hi[c] = std::clamp(mean[c] + tmax * axis[c], 0.0f, 255.0f);
+    }
+
+    Endpoints best;
+    int bestIndices[16];
+    int bestError = -1;
+    for (int pass = 0; pass < 3; pass++) {
+        Endpoints endpoints;
+        quantize(lo, endpoints.color[0], endpoints.pbit[0]);
+        quantize(hi, endpoints.color[1], endpoints.pbit[1]);
+        int indices[16];
+        int error = assignIndices(endpoints, rgba, indices);
+        if (bestError < 0 || error < bestError) {
+            bestError = error;
+            best = endpoints;
+            std::copy(indices, indices + 16, bestIndices);
+        }
+        if (error == 0 || !refit(rgba, indices, lo, hi)) {
+            break;
+        }
+    }
+
+    // the first index is stored with 3 bits, so it must be below 8
+    if (bestIndices[0] >= 8) {
+        std::swap(best.color[0], best.color[1]);
+        std::swap(best.pbit[0], best.pbit[1]);
+        for (int& index : bestIndices) {
+            index = 15 - index;
+        }
+    }
+
+    BitWriter writer(block);
+    writer.write(1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        writer.write(best.color[0][c], 7);
+        writer.write(best.color[1][c], 7);
+    }
+    writer.write(best.pbit[0], 1);
+    writer.write(best.pbit[1], 1);
+    writer.write(bestIndices[0], 3);
+    for (int t = 1; t < 16; t++) {
+        writer.write(bestIndices[t], 4);
+    }
+}
+
+bool BlockCompression::decodeBC7Block(const uint8_t* block, uint8_t* rgba) {
+    BitReader reader(block);
+    if (reader.read(7) != (1u << 6)) {
+        return false;
+    }
+    Endpoints endpoints;
+    for (int c = 0; c < 4; c++) {
+        endpoints.color[0][c] = reader.read(7);
+        endpoints.color[1][c] = reader.read(7);
+    }
+    endpoints.pbit[0] = reader.read(1);
+    endpoints.pbit[1] = reader.read(1);
+    for (int t = 0; t < 16; t++) {
+        int index = reader.read(t == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++) {
+            rgba[t * 4 + c] = uint8_t(((64 - WEIGHTS4[index]) * endpoints.expanded(0, c) +
+                                       WEIGHTS4[index] * endpoints.expanded(1, c) + 32) >> 6);
+        }
+    }
+    return true;
+}
+
+void BlockCompression::encodeBC5Block(const uint8_t* rg, uint8_t* block) {
+    encodeBC4(rg, 2, block);
+    encodeBC4(rg + 1, 2, block + 8);
+}
+
+void BlockCompression::decodeBC5Block(const uint8_t* block, uint8_t* rg) {
+    decodeBC4(block, rg, 2);
+    decodeBC4(block + 8, rg + 1, 2);
+}
+
+void BlockCompression::encodeImage(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height,
+                                   uint32_t channels, uint8_t* blocks) {
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const int components = (format == TextureFormat::BC5) ? 2 : 4;
+
+    ThreadPool::shared().parallelFor(blocksY, [&](size_t by) {
+        uint8_t texels[16 * 4];
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            for (uint32_t t = 0; t < 16; t++) {
+                uint32_t x = std::min(bx * 4 + t % 4, width - 1);
+                uint32_t y = std::min(uint32_t(by) * 4 + t / 4, height - 1);
+                const uint8_t* texel = pixels + (size_t(y) * width + x) * channels;
+                for (int c = 0; c < components; c++) {
+                    texels[t * components + c] = uint32_t(c) < channels ? texel[c] : (c == 3 ? 255 : 0);
+                }
+            }
+            uint8_t* block = blocks + (size_t(by) * blocksX + bx) * 16;
+            if (format == TextureFormat::BC5) {
+                encodeBC5Block(texels, block);
+            } else {
+                encodeBC7Block(texels, block);
+            }
+        }
+    });
+}
+
+bool BlockCompression::decodeImage(TextureFormat format, const uint8_t* blocks, uint32_t width, uint32_t height,
+                                   uint8_t* pixels) {
+    const uint32_t blocksX = (width + 3) / 4;
+    const uint32_t blocksY = (height + 3) / 4;
+    const int components = (format == TextureFormat::BC5) ? 2 : 4;
+
+    bool ok = true;
+    uint8_t texels[16 * 4];
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            const uint8_t* block = blocks + (size_t(by) * blocksX + bx) * 16;
+            if (format == TextureFormat::BC5) {
+                decodeBC5Block(block, texels);
+            } else if (!decodeBC7Block(block, texels)) {
+                ok = false;
+                std::memset(texels, 0, sizeof(texels));
+            }
+            for (uint32_t t = 0; t < 16; t++) {
+                uint32_t x = bx * 4 + t % 4;
+                uint32_t y = by * 4 + t / 4;
+                if (x < width && y < height) {
+                    std::memcpy(pixels + (size_t(y) * width + x) * components, texels + t * components, components);
+                }
+            }
+        }
+    }
+    return ok;
+}
+
+} // namespace modeling
@@ -1,6 +1,7 @@
 #include "modeling/Camera.hpp"
 
 #define _USE_MATH_DEFINES
+#include <algorithm>
 #include <cmath>
 
 #include <Eigen/Geometry>
@@ -10,6 +11,7 @@ using namespace Eigen;
 Camera::Camera(Vector3f pos, Vector3f front) {
     this->pos=pos;
     this->up=Vector3f(0.f,1.f,0.f);
+    this->fov=45.f;
     LookAt(front);
 }
 
@@ -39,6 +41,26 @@ void Camera::LookAt(float yaw, float pitch) {
     );
 }
 
+float Camera::getPixelsPerUnit(Vector3f point, float viewportHeight) const {
+	/*
+	 * distance rather than view depth, so turning the camera doesn't
+	 * switch levels of detail. clamped to avoid blowing up at the eye
+	 */
+	float distance = std::max((point - pos).norm(), 1e-3f);
+	return viewportHeight / (2.f * distance * tan(radians(fov) * 0.5f));
+}
+
+Matrix4f Camera::getProjection(float aspect, float nearPlane, float farPlane) const {
+	float f = 1.f / tan(radians(fov) * 0.5f);
+	float depth = farPlane - nearPlane;
+	return Matrix4f {
+		{f / aspect, 0.f, 0.f,                             0.f},
+		{0.f,        f,   0.f,                             0.f},
+		{0.f,        0.f, (farPlane + nearPlane) / depth,  -2.f * farPlane * nearPlane / depth},
+		{0.f,        0.f, 1.f,                             0.f}
+	};
+}
+
 void Camera::rotate(float radians, Vector3f axis) {
 	LookAt(AngleAxisf(radians, axis).toRotationMatrix() * getDirection());
 }
@@ -46,9 +68,9 @@ void Camera::rotate(float radians, Vector3f axis) {
 Matrix4f Camera::lookat(Vector3f right, Vector3f up, Vector3f direction, Vector3f pos) {
 	auto pose = Vector3f(pos(0),pos(1),pos(2));
 	return Matrix4f {
-		{right(0),     right(1),     right(2),     pose.dot(right)},
-		{up(0),        up(1),        up(2),        pose.dot(up)},
-		{direction(0), direction(1), direction(2), pose.dot(direction)},
+		{right(0),     right(1),     right(2),     -pose.dot(right)},
+		{up(0),        up(1),        up(2),        -pose.dot(up)},
+		{direction(0), direction(1), direction(2), -pose.dot(direction)},
 		{0.f,		   0.f,			 0.f,           1.f}
 	};
 }
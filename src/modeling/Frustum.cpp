@@ -0,0 +1,41 @@
+#include "modeling/Frustum.hpp"
+
+#include <cmath>
+
+namespace modeling {
+
+Frustum Frustum::fromMatrix(const glm::mat4& m) {
+    // row i of a column major matrix
+    auto row = [&m](int i) {
+        return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+    };
+    glm::vec4 x = row(0), y = row(1), z = row(2), w = row(3);
+
+    Frustum frustum;
+    frustum.planes[PLANE_LEFT] = glm::vec4(w.x + x.x, w.y + x.y, w.z + x.z, w.w + x.w);
+    frustum.planes[PLANE_RIGHT] = glm::vec4(w.x - x.x, w.y - x.y, w.z - x.z, w.w - x.w);
+    frustum.planes[PLANE_BOTTOM] = glm::vec4(w.x + y.x, w.y + y.y, w.z + y.z, w.w + y.w);
+    frustum.planes[PLANE_TOP] = glm::vec4(w.x - y.x, w.y - y.y, w.z - y.z, w.w - y.w);
+    frustum.planes[PLANE_NEAR] = glm::vec4(w.x + z.x, w.y + z.y, w.z + z.z, w.w + z.w);
+    frustum.planes[PLANE_FAR] = glm::vec4(w.x - z.x, w.y - z.y, w.z - z.z, w.w - z.w);
+
+    // unit normals, so plane distances compare directly against radii
+    for (glm::vec4& plane : frustum.planes) {
+        float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        if (length > 0.0f) {
+            plane = glm::vec4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+        }
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const {
+    for (const glm::vec4& plane : planes) {
+        if (plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace modeling
@@ -0,0 +1,239 @@
+#include <glad/glad.h>
+
+#include "modeling/GeometryArena.hpp"
+#include "utils/Logger.hpp"
+
+#include <algorithm>
+
+namespace modeling {
+
+struct GeometryArena::Pool {
+    VertexFormat format;
+    bool unormTexCoords;
+    bool shortIndices;
+    size_t stride;
+    unsigned int vao = 0;
+    unsigned int vbo = 0;
+    unsigned int ebo = 0;
+    OffsetAllocator vertices;
+    OffsetAllocator indices;
+
+    size_t indexSize() const {
+        return shortIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+};
+
+namespace {
+
+    /*
+     * Attribute locations are the same for every format:
+     * 0 position, 1 normal, 2 texture coords, 3 tangent.
+     * Compact formats use normalized integers, so shaders only need to
+     * decode the octahedral normal/tangent and the position bounds, which
+     * come from attributes 4 and 5 (see Mesh::bind and GeometryBatch).
+     * Expects the pool's VAO and vertex buffer to be bound.
+     */
+    void setupAttributes(VertexFormat format, bool unormTexCoords, GLsizei stride) {
+        GLenum uvType = unormTexCoords ? GL_UNSIGNED_SHORT : GL_HALF_FLOAT;
+        GLboolean uvNormalized = unormTexCoords ? GL_TRUE : GL_FALSE;
+        for (GLuint location = 0; location < 4; location++) {
+            glEnableVertexAttribArray(location);
+        }
+        switch (format) {
+        case VertexFormat::FLOAT:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Position));
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Normal));
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, TexCoords));
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(Vertex, Tangent));
+            break;
+
+        case VertexFormat::PACKED:
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(PackedVertex, Position));
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(PackedVertex, Normal));
+            glVertexAttribPointer(2, 2, uvType, uvNormalized, stride, (void*)offsetof(PackedVertex, TexCoords));
+            glVertexAttribPointer(3, 3, GL_BYTE, GL_TRUE, stride, (void*)offsetof(PackedVertex, Tangent));
+            break;
+
+        case VertexFormat::QUANTIZED:
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, Position));
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, Normal));
+            glVertexAttribPointer(2, 2, uvType, uvNormalized, stride, (void*)offsetof(QuantizedVertex, TexCoords));
+            glVertexAttribPointer(3, 3, GL_BYTE, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, Tangent));
+            break;
+        }
+    }
+
+    /*
+     * replace <buffer> with a larger one holding the same first <oldBytes>.
+     * uses the copy targets only, so no VAO's element buffer changes
+     */
+    void resizeBuffer(unsigned int& buffer, size_t oldBytes, size_t newBytes) {
+        unsigned int resized;
+        glGenBuffers(1, &resized);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, resized);
+        glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newBytes, nullptr, GL_STATIC_DRAW);
+        if (buffer != 0) {
+            if (oldBytes > 0) {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)oldBytes);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        buffer = resized;
+    }
+
+    void upload(unsigned int buffer, size_t offset, size_t size, const void* data) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)offset, (GLsizeiptr)size, data);
+    }
+
+} // namespace
+
+GeometryArena::GeometryArena() = default;
+
+// shutdown() has released the buffers, or they belong to a context that is gone by now and died with it
+GeometryArena::~GeometryArena() = default;
+
+GeometryArena& GeometryArena::shared() {
+    static GeometryArena arena;
+    return arena;
+}
+
+uint32_t GeometryArena::findPool(const VertexEncoding& encoding, bool shortIndices) {
+    // FLOAT texture coordinates are always floats
+    bool unormTexCoords = encoding.format != VertexFormat::FLOAT && encoding.unormTexCoords;
+    for (size_t i = 0; i < pools.size(); i++) {
+        const Pool& pool = *pools[i];
+        if (pool.format == encoding.format && pool.unormTexCoords == unormTexCoords &&
+            pool.shortIndices == shortIndices) {
+            return uint32_t(i);
+        }
+    }
+    auto pool = std::make_unique<Pool>();
+    pool->format = encoding.format;
+    pool->unormTexCoords = unormTexCoords;
+    pool->shortIndices = shortIndices;
+    pool->stride = encoding.stride();
+    pools.push_back(std::move(pool));
+    return uint32_t(pools.size() - 1);
+}
+
+void GeometryArena::grow(Pool& pool, uint32_t vertexCapacity, uint32_t indexCapacity) {
+    if (vertexCapacity > pool.vertices.capacity()) {
+        resizeBuffer(pool.vbo, pool.vertices.capacity() * pool.stride, vertexCapacity * pool.stride);
+        pool.vertices.grow(vertexCapacity);
+    }
+    if (indexCapacity > pool.indices.capacity()) {
+        resizeBuffer(pool.ebo, pool.indices.capacity() * pool.indexSize(), indexCapacity * pool.indexSize());
+        pool.indices.grow(indexCapacity);
+    }
+
+    // the buffers may have been replaced, point the VAO at the current ones
+    if (pool.vao == 0) {
+        glGenVertexArrays(1, &pool.vao);
+    }
+    glBindVertexArray(pool.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.vbo);
+    setupAttributes(pool.format, pool.unormTexCoords, (GLsizei)pool.stride);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.ebo);
+    glBindVertexArray(0);
+
+    LOG_DEBUG_F("Geometry pool grown to {} vertices, {} indices", pool.vertices.capacity(), pool.indices.capacity());
+}
+
+GeometryRange GeometryArena::allocate(const VertexEncoding& encoding, bool shortIndices,
+                                      const void* vertexData, uint32_t vertexCount,
+                                      const void* indexData, uint32_t indexCount) {
+    GeometryRange range;
+    range.pool = findPool(encoding, shortIndices);
+    range.generation = generation;
+    range.vertexCount = vertexCount;
+    range.indexCount = indexCount;
+    Pool& pool = *pools[range.pool];
+
+    // doubling keeps the number of GPU side copies logarithmic in the total size
+    range.baseVertex = pool.vertices.allocate(vertexCount);
+    if (range.baseVertex == OffsetAllocator::NO_SPACE) {
+        uint32_t capacity = pool.vertices.capacity();
+        grow(pool, std::max({ INITIAL_VERTICES, capacity * 2, capacity + vertexCount }), pool.indices.capacity());
+        range.baseVertex = pool.vertices.allocate(vertexCount);
+    }
+    range.firstIndex = pool.indices.allocate(indexCount);
+    if (range.firstIndex == OffsetAllocator::NO_SPACE) {
+        uint32_t capacity = pool.indices.capacity();
+        grow(pool, pool.vertices.capacity(), std::max({ INITIAL_INDICES, capacity * 2, capacity + indexCount }));
+        range.firstIndex = pool.indices.allocate(indexCount);
+    }
+
+    upload(pool.vbo, range.baseVertex * pool.stride, vertexCount * pool.stride, vertexData);
+    upload(pool.ebo, range.firstIndex * pool.indexSize(), indexCount * pool.indexSize(), indexData);
+    return range;
+}
+
+void GeometryArena::free(const GeometryRange& range) {
+    if (!range.valid() || range.generation != generation || range.pool >= pools.size()) {
+        return;
+    }
+    Pool& pool = *pools[range.pool];
+    pool.vertices.free(range.baseVertex, range.vertexCount);
+    pool.indices.free(range.firstIndex, range.indexCount);
+
+    // last mesh gone, unloading a scene gives its memory back
+    if (pool.vertices.used() == 0) {
+        glDeleteVertexArrays(1, &pool.vao);
+        glDeleteBuffers(1, &pool.vbo);
+        glDeleteBuffers(1, &pool.ebo);
+        pool.vao = pool.vbo = pool.ebo = 0;
+        pool.vertices = OffsetAllocator();
+        pool.indices = OffsetAllocator();
+    }
+}
+
+void GeometryArena::shutdown() {
+    if (getUsedBytes() != 0) {
+        LOG_WARN("Geometry arena shut down while meshes are still alive, they can no longer be drawn");
+    }
+    for (const auto& pool : pools) {
+        glDeleteVertexArrays(1, &pool->vao);
+        glDeleteBuffers(1, &pool->vbo);
+        glDeleteBuffers(1, &pool->ebo);
+    }
+    pools.clear();
+    generation++;
+}
+
+void GeometryArena::bind(uint32_t pool) const {
+    glBindVertexArray(pools[pool]->vao);
+
+    // instance transform for draws without an instance buffer, see Model::bindInstances
+    glVertexAttrib4f(6, 1.f, 0.f, 0.f, 0.f);
+    glVertexAttrib4f(7, 0.f, 1.f, 0.f, 0.f);
+    glVertexAttrib4f(8, 0.f, 0.f, 1.f, 0.f);
+    glVertexAttrib4f(9, 0.f, 0.f, 0.f, 1.f);
+}
+
+unsigned int GeometryArena::getIndexType(uint32_t pool) const {
+    return pools[pool]->shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t GeometryArena::getIndexSize(uint32_t pool) const {
+    return pools[pool]->indexSize();
+}
+
+size_t GeometryArena::getReservedBytes() const {
+    size_t bytes = 0;
+    for (const auto& pool : pools) {
+        bytes += pool->vertices.capacity() * pool->stride + pool->indices.capacity() * pool->indexSize();
+    }
+    return bytes;
+}
+
+size_t GeometryArena::getUsedBytes() const {
+    size_t bytes = 0;
+    for (const auto& pool : pools) {
+        bytes += pool->vertices.used() * pool->stride + pool->indices.used() * pool->indexSize();
+    }
+    return bytes;
+}
+
+} // namespace modeling
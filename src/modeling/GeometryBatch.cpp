@@ -0,0 +1,133 @@
+#include <glad/glad.h>
+
+#include "modeling/GeometryBatch.hpp"
+
+#include <algorithm>
+
+namespace modeling {
+
+GeometryBatch::GeometryBatch() = default;
+
+GeometryBatch::~GeometryBatch() {
+    if (commandBuffer != 0) {
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &parameterBuffer);
+    }
+}
+
+bool GeometryBatch::indirectSupported() {
+#ifdef GL_VERSION_4_3
+    return GLAD_GL_VERSION_4_3 != 0;
+#else
+    return false;
+#endif
+}
+
+void GeometryBatch::add(const Mesh& mesh, size_t lod) {
+    const GeometryRange& geometry = mesh.getGeometry();
+    if (!geometry.valid() || lod >= mesh.getLodCount()) {
+        return;
+    }
+    const MeshLod& level = mesh.getLod(lod);
+    const VertexEncoding& encoding = mesh.getVertexEncoding();
+
+    Draw draw;
+    draw.pool = geometry.pool;
+    draw.command.count = level.indexCount;
+    draw.command.instanceCount = 1;
+    draw.command.firstIndex = geometry.firstIndex + level.firstIndex;
+    draw.command.baseVertex = int32_t(geometry.baseVertex);
+    draw.command.baseInstance = 0;
+    // same values Mesh::bind sets as constant attributes
+    float octahedral = encoding.format == VertexFormat::FLOAT ? 0.0f : 1.0f;
+    draw.parameters.scale = glm::vec4(encoding.positionScale, octahedral);
+    draw.parameters.offset = glm::vec4(encoding.positionOffset, 0.0f);
+    draws.push_back(draw);
+}
+
+size_t GeometryBatch::submit() {
+    if (draws.empty()) {
+        return 0;
+    }
+    std::stable_sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) {
+        return a.pool < b.pool;
+    });
+    size_t calls = indirectSupported() ? submitIndirect() : submitDirect();
+    glBindVertexArray(0);
+    return calls;
+}
+
+size_t GeometryBatch::submitIndirect() {
+#ifdef GL_VERSION_4_3
+    commands.resize(draws.size());
+    parameters.resize(draws.size());
+    for (size_t i = 0; i < draws.size(); i++) {
+        commands[i] = draws[i].command;
+        // instanced attributes are fetched at baseInstance, one parameter entry per draw
+        commands[i].baseInstance = uint32_t(i);
+        parameters[i] = draws[i].parameters;
+    }
+
+    if (commandBuffer == 0) {
+        glGenBuffers(1, &commandBuffer);
+        glGenBuffers(1, &parameterBuffer);
+    }
+    // orphaned every frame, the driver hands out fresh memory instead of waiting on the last frame
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, parameterBuffer);
+    glBufferData(GL_ARRAY_BUFFER, parameters.size() * sizeof(DrawParameters), parameters.data(), GL_STREAM_DRAW);
+
+    GeometryArena& arena = GeometryArena::shared();
+    size_t calls = 0;
+    for (size_t start = 0; start < draws.size();) {
+        uint32_t pool = draws[start].pool;
+        size_t end = start;
+        while (end < draws.size() && draws[end].pool == pool) {
+            end++;
+        }
+
+        arena.bind(pool);
+        glBindBuffer(GL_ARRAY_BUFFER, parameterBuffer);
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(DrawParameters), (void*)offsetof(DrawParameters, scale));
+        glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(DrawParameters), (void*)offsetof(DrawParameters, offset));
+        glVertexAttribDivisor(4, 1);
+        glVertexAttribDivisor(5, 1);
+        glEnableVertexAttribArray(4);
+        glEnableVertexAttribArray(5);
+
+        glMultiDrawElementsIndirect(GL_TRIANGLES, arena.getIndexType(pool),
+                                    (void*)(start * sizeof(DrawCommand)), GLsizei(end - start), 0);
+        calls++;
+
+        // back to the constant attributes Mesh::bind sets
+        glDisableVertexAttribArray(4);
+        glDisableVertexAttribArray(5);
+        start = end;
+    }
+    return calls;
+#else
+    // glad generated without 4.3, indirectSupported() is false and this is never reached
+    return submitDirect();
+#endif
+}
+
+size_t GeometryBatch::submitDirect() {
+    GeometryArena& arena = GeometryArena::shared();
+    uint32_t boundPool = GeometryRange::NO_POOL;
+    for (const Draw& draw : draws) {
+        if (draw.pool != boundPool) {
+            arena.bind(draw.pool);
+            boundPool = draw.pool;
+        }
+        const DrawParameters& p = draw.parameters;
+        glVertexAttrib4f(4, p.scale.x, p.scale.y, p.scale.z, p.scale.w);
+        glVertexAttrib3f(5, p.offset.x, p.offset.y, p.offset.z);
+        size_t offset = draw.command.firstIndex * arena.getIndexSize(draw.pool);
+        glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(draw.command.count), arena.getIndexType(draw.pool),
+                                 (void*)offset, draw.command.baseVertex);
+    }
+    return draws.size();
+}
+
+} // namespace modeling
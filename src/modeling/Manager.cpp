@@ -1,62 +1,567 @@
 #include "modeling/Manager.hpp"
+#include "modeling/ModelLoader.hpp"
+#include "modeling/TextureUploader.hpp"
+#include "utils/Logger.hpp"
+#include "utils/ThreadPool.hpp"
 #include "stb_image.h"
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <string>
 
+namespace {
+    // share of the progress covered by the worker side import,
+    // the GL upload in poll() accounts for the rest
+    const float DECODE_PROGRESS = 0.9f;
 
-void AssetManager::load_file(std::string GLTF_path) {
-    for (auto &scene: this->scenes){
-        if (scene.path == GLTF_path) {        // file found
-            if (!scene.contents.has_value()){ // value was unloaded
-                // load scene
-                throw std::runtime_error("TODO: depends on loading from GLTF");
-            }
-            return;
+    // <items>[<id>], nullptr if <id> is out of range
+    template<typename T>
+    const T* element(const std::vector<T> &items, size_t id) {
+        return id < items.size() ? &items[id] : nullptr;
+    }
+
+    // <items>[<id>], throws std::out_of_range if <id> is out of range
+    template<typename T>
+    const T& checked_element(const std::vector<T> &items, size_t id, const std::string &path) {
+        if (const T *item = element(items, id)) {
+            return *item;
         }
+        throw std::out_of_range("asset " + std::to_string(id) + " out of range in " + path);
+    }
+}
+
+struct LoadSignal {
+    std::mutex mutex;
+    std::condition_variable changed;
+};
+
+// state of one load, shared by the manager, the worker and all handles
+struct LoadHandle::Request {
+    const std::string path;
+    const StringId id;
+    const std::optional<Eigen::Vector3f> position;
+    const uint64_t sequence;
+
+    std::atomic<LoadState> state{LoadState::Queued};
+    std::atomic<float> progress{0.0f};
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> scene{-1};
+
+    // guards error
+    mutable std::mutex mutex;
+    std::string error;
+
+    std::promise<LoadState> promise;
+    std::shared_future<LoadState> future;
+
+    // result of the worker side import, consumed by poll()
+    std::unique_ptr<modeling::ImportedScene> imported;
+
+    // of the manager that started the load
+    const std::shared_ptr<LoadSignal> signal;
+
+    Request(StringId id, std::optional<Eigen::Vector3f> position, uint64_t sequence,
+            std::shared_ptr<LoadSignal> signal):
+        path(id.str()),
+        id(id),
+        position(std::move(position)),
+        sequence(sequence),
+        future(promise.get_future().share()),
+        signal(std::move(signal)) {}
+};
+
+const std::string& LoadHandle::path() const {
+    return request->path;
+}
+
+LoadState LoadHandle::state() const {
+    return request->state.load();
+}
+
+float LoadHandle::progress() const {
+    return request->progress.load();
+}
+
+bool LoadHandle::done() const {
+    LoadState s = state();
+    return s == LoadState::Loaded || s == LoadState::Failed || s == LoadState::Cancelled;
+}
+
+std::string LoadHandle::error() const {
+    std::lock_guard<std::mutex> lock(request->mutex);
+    return request->error;
+}
+
+int LoadHandle::scene() const {
+    return request->scene.load();
+}
+
+void LoadHandle::cancel() {
+    // under the manager's mutex, so a waiter can't miss the wake up
+    std::lock_guard<std::mutex> lock(request->signal->mutex);
+    request->cancelled = true;
+    request->signal->changed.notify_all();
+}
+
+std::shared_future<LoadState> LoadHandle::future() const {
+    return request->future;
+}
+
+AssetManager::AssetManager(std::shared_ptr<Shader> shader):
+    shader(std::move(shader)),
+    signal(std::make_shared<LoadSignal>()) {}
+
+AssetManager::AssetManager(std::shared_ptr<ShaderVariants> variants):
+    variants(std::move(variants)),
+    signal(std::make_shared<LoadSignal>()) {}
+
+AssetManager::~AssetManager() {
+    std::unique_lock<std::mutex> lock(this->signal->mutex);
+
+    // make running imports abort at their next progress update
+    this->active.forEach([](const StringId &, const RequestPtr &request) {
+        request->cancelled = true;
+    });
+    for (auto &request: this->queued) {
+        this->finish(request, LoadState::Cancelled, "asset manager destroyed");
+    }
+    this->queued.clear();
+
+    // workers reference this manager until they are done
+    this->signal->changed.wait(lock, [this]() { return this->in_flight == 0; });
+
+    for (auto &request: this->decoded) {
+        this->finish(request, LoadState::Cancelled, "asset manager destroyed");
     }
+    this->decoded.clear();
+}
+
+LoadHandle AssetManager::load_file(std::string GLTF_path) {
+    return this->enqueue(GLTF_path, std::nullopt);
+}
+
+LoadHandle AssetManager::load_file(std::string GLTF_path, const Eigen::Vector3f &position) {
+    return this->enqueue(GLTF_path, position);
+}
+
+LoadHandle AssetManager::enqueue(const std::string &path, std::optional<Eigen::Vector3f> position) {
+    StringId id(path);
+    std::lock_guard<std::mutex> lock(this->signal->mutex);
+
+    const RequestPtr *running = this->active.find(id);
+    if (running && !(*running)->cancelled) { // already on its way
+        return LoadHandle(*running);
+    }
+
+    auto request = std::make_shared<LoadHandle::Request>(id, position, this->next_sequence++, this->signal);
+
+    const size_t *index = this->scene_lookup.find(id);
+    if (index && this->scenes[*index].contents.has_value()) { // file already loaded
+        this->residency.touch(*index);
+        request->scene = static_cast<int>(*index);
+        request->progress = 1.0f;
+        request->state = LoadState::Loaded;
+        request->promise.set_value(LoadState::Loaded);
+        return LoadHandle(request);
+    }
+
+    this->active.insert(id, request);
+    this->queued.push_back(request);
+
+    // keep the queue bounded by dropping whatever is farthest from the viewer
+    if (this->queued.size() > this->max_queued) {
+        auto farthest = std::max_element(this->queued.begin(), this->queued.end(),
+            [this](const RequestPtr &a, const RequestPtr &b) { return this->loads_before(a, b); });
+        RequestPtr dropped = *farthest;
+        this->queued.erase(farthest);
+        LOG_WARN_F("Load queue is full, dropping {}", dropped->path);
+        this->finish(dropped, LoadState::Cancelled, "load queue is full");
+    }
+
+    this->dispatch();
+    return LoadHandle(request);
 }
 
 void AssetManager::unload_file(std::string GLTF_path) {
-    for (auto &scene: this->scenes){
-        if (scene.path == GLTF_path) {       // file found
-            if (scene.contents.has_value()){ // scene is loaded
-                scene.contents.reset();      // unload 
+    StringId id = StringId::lookup(GLTF_path);
+    if (!id.valid()) { // never seen
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->signal->mutex);
+        if (const RequestPtr *running = this->active.find(id)) { // stop any load in progress
+            (*running)->cancelled = true;
+        }
+    }
+
+    const size_t *index = this->scene_lookup.find(id);
+    if (index) {                         // file found
+        auto &scene = this->scenes[*index];
+        if (scene.contents.has_value()){ // scene is loaded
+            scene.contents.reset();      // unload
+            scene.generation++;          // outstanding keys are stale now
+            this->residency.remove(*index);
+        }
+    }
+}
+
+void AssetManager::set_viewer_position(const Eigen::Vector3f &position) {
+    std::lock_guard<std::mutex> lock(this->signal->mutex);
+    this->viewer = position;
+}
+
+void AssetManager::set_max_queued(size_t max_queued) {
+    std::lock_guard<std::mutex> lock(this->signal->mutex);
+    this->max_queued = std::max<size_t>(max_queued, 1);
+}
+
+void AssetManager::set_max_in_flight(size_t max_in_flight) {
+    std::lock_guard<std::mutex> lock(this->signal->mutex);
+    this->max_in_flight = max_in_flight;
+    this->dispatch();
+}
+
+bool AssetManager::loads_before(const RequestPtr &a, const RequestPtr &b) const {
+    float da = a->position ? (*a->position - this->viewer).squaredNorm() : -1.0f;
+    float db = b->position ? (*b->position - this->viewer).squaredNorm() : -1.0f;
+    return da < db || (da == db && a->sequence < b->sequence);
+}
+
+void AssetManager::dispatch() {
+    // drop loads that were cancelled while queued
+    auto cancelled = std::stable_partition(this->queued.begin(), this->queued.end(),
+        [](const RequestPtr &request) { return !request->cancelled; });
+    for (auto it = cancelled; it != this->queued.end(); ++it) {
+        this->finish(*it, LoadState::Cancelled, "cancelled");
+    }
+    this->queued.erase(cancelled, this->queued.end());
+
+    while (this->in_flight < this->max_in_flight && !this->queued.empty()) {
+        // distances are evaluated now so the order follows the camera
+        auto next = std::min_element(this->queued.begin(), this->queued.end(),
+            [this](const RequestPtr &a, const RequestPtr &b) { return this->loads_before(a, b); });
+        RequestPtr request = *next;
+        this->queued.erase(next);
+
+        request->state = LoadState::Decoding;
+        this->in_flight++;
+        ThreadPool::shared().submit([this, request]() { this->decode(request); });
+    }
+}
+
+void AssetManager::decode(RequestPtr request) {
+    std::unique_ptr<modeling::ImportedScene> imported;
+    std::string error;
+    try {
+        imported = modeling::ModelLoader::importScene(request->path, [&request](float progress) {
+            request->progress = progress * DECODE_PROGRESS;
+            return !request->cancelled.load();
+        });
+        if (!imported) {
+            error = "could not import " + request->path;
+        }
+    } catch (const std::exception &e) {
+        error = e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(this->signal->mutex);
+    this->in_flight--;
+    if (request->cancelled) {
+        this->finish(request, LoadState::Cancelled, "cancelled");
+    } else if (!imported) {
+        LOG_ERROR_F("Failed to load {}: {}", request->path, error);
+        this->finish(request, LoadState::Failed, error);
+    } else {
+        request->imported = std::move(imported);
+        request->progress = DECODE_PROGRESS;
+        request->state = LoadState::Decoded;
+        this->decoded.push_back(request);
+    }
+    this->dispatch();
+    this->signal->changed.notify_all();
+}
+
+void AssetManager::finish(const RequestPtr &request, LoadState state, const std::string &error) {
+    const RequestPtr *current = this->active.find(request->id);
+    if (current && *current == request) {
+        this->active.erase(request->id);
+    }
+    {
+        std::lock_guard<std::mutex> lock(request->mutex);
+        request->error = error;
+    }
+    request->imported.reset();
+    if (state == LoadState::Loaded) {
+        request->progress = 1.0f;
+    }
+    request->state = state;
+    request->promise.set_value(state);
+}
+
+size_t AssetManager::poll(size_t max_finalize) {
+    std::vector<RequestPtr> ready;
+    {
+        std::lock_guard<std::mutex> lock(this->signal->mutex);
+        this->dispatch();
+        size_t n = std::min(max_finalize, this->decoded.size());
+        ready.assign(this->decoded.begin(), this->decoded.begin() + n);
+        this->decoded.erase(this->decoded.begin(), this->decoded.begin() + n);
+    }
+
+    for (auto &request: ready) {
+        this->finalize(request);
+    }
+
+    // poll() marks the end of a frame
+    this->evict_over_budget();
+    this->residency.next_frame();
+    if (!ready.empty()) {
+        this->signal->changed.notify_all();
+    }
+    return ready.size();
+}
+
+void AssetManager::finalize(const RequestPtr &request) {
+    if (request->cancelled) {
+        std::lock_guard<std::mutex> lock(this->signal->mutex);
+        this->finish(request, LoadState::Cancelled, "cancelled");
+        return;
+    }
+
+    LoadState state = LoadState::Loaded;
+    std::string error;
+    try {
+        modeling::ImportedScene &imported = *request->imported;
+        if ((this->shader || this->variants) && !this->uploader) {
+            this->uploader = std::make_unique<modeling::TextureUploader>();
+        }
+        auto models = this->variants
+            ? modeling::ModelLoader::finalizeScene(imported, this->variants, this->uploader.get())
+            : modeling::ModelLoader::finalizeScene(imported, this->shader, this->uploader.get());
+
+        size_t index = this->scene_for(request->id);
+        SceneObjects &scene = this->scenes[index];
+        scene.contents.reset();
+        LoadedContents &contents = scene.contents.emplace();
+        contents.models = std::move(models);
+
+        // scene materials keep their order, so their index is a MaterialHandle
+        contents.materials = imported.materials;
+        for (auto &model: contents.models) {
+            for (auto &material: model->getMaterials()) {
+                if (material && std::find(contents.materials.begin(), contents.materials.end(), material) == contents.materials.end()) {
+                    contents.materials.push_back(material);
+                }
+            }
+            for (auto &mesh: model->getMeshes()) {
+                if (mesh && std::find(contents.meshes.begin(), contents.meshes.end(), mesh) == contents.meshes.end()) {
+                    contents.meshes.push_back(mesh);
+                }
             }
+        }
+        for (size_t i = 0; i < contents.materials.size(); i++) {
+            auto &material = contents.materials[i];
+            if (!material) {
+                continue;
+            }
+            StringId name(material->name);
+            if (!contents.material_lookup.contains(name)) { // first material of that name wins, like MaterialManager::find
+                contents.material_lookup.insert(name, i);
+            }
+            for (const Texture *texture: { &material->base_color, &material->normal, &material->albedo,
+                                           &material->metallic, &material->roughness, &material->ambient_occlusion }) {
+                if (std::find(contents.textures.begin(), contents.textures.end(), texture) == contents.textures.end()) {
+                    contents.textures.push_back(texture);
+                }
+            }
+        }
+
+        // sizes of shared textures are counted once per scene using them
+        size_t cpu_bytes = 0;
+        size_t gpu_bytes = 0;
+        for (auto &mesh: contents.meshes) {
+            cpu_bytes += mesh->getCpuBytes();
+            gpu_bytes += mesh->getGpuBytes();
+        }
+        for (const Texture *texture: contents.textures) {
+            size_t bytes = texture->byte_size();
+            cpu_bytes += bytes;
+            if (texture->id != 0) {
+                gpu_bytes += texture->levels > 1 ? bytes : bytes + bytes / 3; // mips generated on upload
+            }
+        }
+        this->residency.add(index, cpu_bytes, gpu_bytes);
+
+        request->scene = static_cast<int>(index);
+    } catch (const std::exception &e) {
+        LOG_ERROR_F("Failed to finalize {}: {}", request->path, e.what());
+        state = LoadState::Failed;
+        error = e.what();
+    }
+
+    std::lock_guard<std::mutex> lock(this->signal->mutex);
+    this->finish(request, state, error);
+}
+
+size_t AssetManager::scene_for(StringId path) {
+    if (const size_t *index = this->scene_lookup.find(path)) {
+        return *index;
+    }
+    this->scenes.emplace_back(path);
+    return this->scene_lookup.insert(path, this->scenes.size() - 1);
+}
+
+int AssetManager::find_scene(const std::string &GLTF_path) const {
+    const size_t *index = this->scene_lookup.find(StringId::lookup(GLTF_path));
+    return index ? static_cast<int>(*index) : -1;
+}
+
+ModelKey AssetManager::model_key(int scene, int id) const {
+    return ModelKey{ scene, id, this->scenes.at(scene).generation };
+}
+
+MeshKey AssetManager::mesh_key(int scene, int id) const {
+    return MeshKey{ scene, id, this->scenes.at(scene).generation };
+}
+
+TextureKey AssetManager::texture_key(int scene, int id) const {
+    return TextureKey{ scene, id, this->scenes.at(scene).generation };
+}
+
+MaterialKey AssetManager::material_key(int scene, const std::string &name) const {
+    const SceneObjects &objects = this->scenes.at(scene);
+    if (objects.contents.has_value()) {
+        if (const size_t *index = objects.contents->material_lookup.find(StringId::lookup(name))) {
+            return MaterialKey{ scene, MaterialHandle::new_unchecked(*index), objects.generation };
+        }
+    }
+    throw std::out_of_range(name + " is not a material of " + objects.path);
+}
+
+void AssetManager::wait_all() {
+    while (true) {
+        this->poll(std::numeric_limits<size_t>::max());
+
+        std::unique_lock<std::mutex> lock(this->signal->mutex);
+        if (this->active.empty()) {
             return;
         }
+        // nothing running and nothing may start, waiting would never end
+        auto held = [this]() {
+            return this->max_in_flight == 0 && this->in_flight == 0 && this->decoded.empty();
+        };
+        if (held()) {
+            LOG_WARN_F("wait_all: {} loads are held by set_max_in_flight(0)", this->queued.size());
+            return;
+        }
+        this->signal->changed.wait(lock, [this, &held]() {
+            return !this->decoded.empty() || this->active.empty() || held()
+                || std::any_of(this->queued.begin(), this->queued.end(),
+                               [](const RequestPtr &request) { return request->cancelled.load(); });
+        });
     }
 }
 
-const modeling::Model& AssetManager::get_model(ModelKey key) {
-    auto& contents = this->scenes[key.scene].contents;
-    if (contents.has_value()) {
-        return contents->models[key.id];
+size_t AssetManager::pending_count() const {
+    std::lock_guard<std::mutex> lock(this->signal->mutex);
+    return this->active.size();
+}
+
+LoadedContents& AssetManager::resident_contents(int scene, uint32_t generation) {
+    SceneObjects &objects = this->scenes.at(scene);
+    if (generation != objects.generation) {
+        throw std::invalid_argument("stale key into " + objects.path);
     }
-    throw std::runtime_error("should not happen");
+    if (LoadedContents *contents = this->find_resident(scene, generation)) {
+        return *contents;
+    }
+    throw std::runtime_error(objects.path + " is not resident");
 }
 
-const Material& AssetManager::get_material(MaterialKey key) {
-    auto& contents = this->scenes[key.scene].contents;
-    if (contents.has_value()) {
-        return contents->materials.get(key.id);
+LoadedContents* AssetManager::find_resident(int scene, uint32_t generation) {
+    if (scene < 0 || static_cast<size_t>(scene) >= this->scenes.size()) {
+        return nullptr;
+    }
+    SceneObjects &objects = this->scenes[scene];
+    if (generation != objects.generation) {
+        return nullptr;
+    }
+    if (this->residency.touch(scene)) {
+        return &*objects.contents;
     }
 
-    throw std::runtime_error("should not happen");
+    // miss: bring it back for a later frame
+    this->load_file(objects.path);
+    return nullptr;
 }
 
-const Texture& AssetManager::get_texture(TextureKey key) {
-    auto& contents = this->scenes[key.scene].contents;
-    if (contents.has_value()) {
-        return contents->materials.get_texture(key.id);
+const modeling::Model& AssetManager::get_model(ModelKey key) {
+    const LoadedContents &contents = this->resident_contents(key.scene, key.generation);
+    return *checked_element(contents.models, static_cast<size_t>(key.id), this->scenes[key.scene].path);
+}
+
+const Material& AssetManager::get_material(MaterialKey key) {
+    const LoadedContents &contents = this->resident_contents(key.scene, key.generation);
+    auto& material = checked_element(contents.materials, key.id.id, this->scenes[key.scene].path);
+    if (material) {
+        return *material;
     }
 
     throw std::runtime_error("should not happen");
 }
 
+const Texture& AssetManager::get_texture(TextureKey key) {
+    const LoadedContents &contents = this->resident_contents(key.scene, key.generation);
+    return *checked_element(contents.textures, static_cast<size_t>(key.id), this->scenes[key.scene].path);
+}
+
 const Mesh& AssetManager::get_mesh(MeshKey key) {
-    auto& contents = this->scenes[key.scene].contents;
-    if (contents.has_value()) {
-        return contents->loaded_meshes[key.id];
-    }
+    const LoadedContents &contents = this->resident_contents(key.scene, key.generation);
+    return *checked_element(contents.meshes, static_cast<size_t>(key.id), this->scenes[key.scene].path);
+}
 
-    throw std::runtime_error("should not happen");
+const modeling::Model* AssetManager::try_get_model(ModelKey key) {
+    LoadedContents *contents = this->find_resident(key.scene, key.generation);
+    auto *model = contents ? element(contents->models, static_cast<size_t>(key.id)) : nullptr;
+    return model ? model->get() : nullptr;
+}
+
+const Material* AssetManager::try_get_material(MaterialKey key) {
+    LoadedContents *contents = this->find_resident(key.scene, key.generation);
+    auto *material = contents ? element(contents->materials, key.id.id) : nullptr;
+    return material ? material->get() : nullptr;
+}
+
+const Texture* AssetManager::try_get_texture(TextureKey key) {
+    LoadedContents *contents = this->find_resident(key.scene, key.generation);
+    auto *texture = contents ? element(contents->textures, static_cast<size_t>(key.id)) : nullptr;
+    return texture ? *texture : nullptr;
 }
 
+const Mesh* AssetManager::try_get_mesh(MeshKey key) {
+    LoadedContents *contents = this->find_resident(key.scene, key.generation);
+    auto *mesh = contents ? element(contents->meshes, static_cast<size_t>(key.id)) : nullptr;
+    return mesh ? mesh->get() : nullptr;
+}
+
+void AssetManager::set_memory_budget(size_t cpu_bytes, size_t gpu_bytes) {
+    this->residency.set_budget(cpu_bytes, gpu_bytes);
+}
+
+void AssetManager::pin_file(std::string GLTF_path) {
+    this->residency.pin(this->scene_for(StringId(GLTF_path)));
+}
+
+void AssetManager::unpin_file(std::string GLTF_path) {
+    this->residency.unpin(this->scene_for(StringId(GLTF_path)));
+}
+
+void AssetManager::evict_over_budget() {
+    for (size_t index: this->residency.evict()) {
+        SceneObjects &scene = this->scenes[index];
+        LOG_INFO_F("Evicting {} to stay within the memory budget", scene.path);
+        scene.contents.reset();
+    }
+}
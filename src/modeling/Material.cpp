@@ -1,8 +1,66 @@
+#include <glad/glad.h>
+
 #include "modeling/Material.hpp" 
+#include "modeling/MaterialSource.hpp"
+#include "modeling/TextureLoader.hpp"
+#include "utils/Shader.hpp"
+#include <algorithm>
 #include <iostream> 
 
+Texture::~Texture() {
+    if (this->id != 0) {
+        glDeleteTextures(1, &this->id);
+    }
+}
+
+uint32_t Texture::level_width(uint32_t level) const {
+    return std::max(this->width >> level, 1u);
+}
+
+uint32_t Texture::level_height(uint32_t level) const {
+    return std::max(this->height >> level, 1u);
+}
+
+size_t Texture::level_size(uint32_t level) const {
+    return image_size(this->format, this->level_width(level), this->level_height(level), this->n_channels);
+}
+
+size_t Texture::byte_size() const {
+    size_t size = 0;
+    for (uint32_t level = 0; level < this->levels; level++) {
+        size += this->level_size(level);
+    }
+    return size;
+}
+
+size_t Texture::image_size(TextureFormat format, uint32_t width, uint32_t height, uint32_t n_channels) {
+    if (format == TextureFormat::RAW) {
+        return size_t(width) * height * n_channels;
+    }
+    // both block formats use 16 bytes per 4x4 block
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * 16;
+}
+
 Material Material::from_aiMaterial(aiMaterial *material) {
-    throw std::runtime_error("todo for model loading");
+    std::string name = "material";
+    aiString ainame;
+    if (material && material->Get(AI_MATKEY_NAME, ainame) == AI_SUCCESS && ainame.length > 0) {
+        name = ainame.C_Str();
+    }
+
+    Texture &t = modeling::TextureLoader::whiteTexture();
+    return Material(name, t, t, t, t, t, t);
+}
+
+void Material::setSamplers(Shader &shader) {
+    for (int slot = 0; slot < modeling::TEXTURE_SLOT_COUNT; slot++) {
+        const char *sampler = modeling::TEXTURE_SLOT_SAMPLERS[slot];
+        // variants without a feature have its sampler optimized out
+        GLint location = sampler ? glGetUniformLocation(shader.getProgram(), sampler) : -1;
+        if (location >= 0) {
+            shader.setUniform(location, slot);
+        }
+    }
 }
 
 MaterialManager::MaterialManager(aiScene *scene) {
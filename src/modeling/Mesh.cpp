@@ -1,71 +1,228 @@
 #include <glad/glad.h>
 
 #include "modeling/Mesh.hpp"
-#include "shared/Logger.hpp"
+#include "utils/Logger.hpp"
 
 using namespace std;
 
-Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, bool setupGL)
+Mesh::Mesh(vector<Vertex> vertices, vector<unsigned int> indices, bool setupGL,
+	VertexFormat format, MeshLodView lods)
 	: glSetup(setupGL)
 {
-	this->vertices = vertices;
-	this->indices = indices;
+	this->vertices = std::move(vertices);
+	this->indices = std::move(indices);
+	this->vertexCount = this->vertices.size();
+	this->indexCount = this->indices.size();
 
-	if (!this->validate()) {
+	if (!this->validate(this->vertices.data(), this->indices.data())) {
 		throw std::runtime_error("Bad mesh loaded");
 	}
 
+	this->encoding = chooseVertexEncoding(this->vertices.data(), this->vertexCount,
+		format, POSITION_TOLERANCE);
+	this->shortIndices = this->vertexCount <= 0x10000;
+	computeBounds(this->vertices.data());
+	setupLods(lods);
 	if (glSetup) {
-		setupMesh();
+		setupMesh(this->vertices.data(), this->indices.data(), lods);
 	}
 }
 
-void Mesh::setupMesh()
+Mesh::Mesh(const Vertex *vertices, size_t vertexCount,
+	const unsigned int *indices, size_t indexCount,
+	bool setupGL, bool keepCpuData, VertexFormat format, MeshLodView lods,
+	shared_ptr<const void> owner)
+	: glSetup(setupGL), vertexCount(vertexCount), indexCount(indexCount)
 {
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
-		&vertices[0], GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() *
-		sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-	// vertex positions
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-		(void*)0);
-
-	// vertex normals
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-		(void*)offsetof(Vertex, Normal));
-
-	// vertex texture coords
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-		(void*)offsetof(Vertex, TexCoords));
-	glBindVertexArray(0);
-}
-
-bool Mesh::validate() {
-	auto nvert = this->vertices.size();
-
-	if (nvert < 1) {
+	if (!this->validate(vertices, indices)) {
+		throw std::runtime_error("Bad mesh loaded");
+	}
+
+	this->encoding = chooseVertexEncoding(vertices, vertexCount, format, POSITION_TOLERANCE);
+	this->shortIndices = vertexCount <= 0x10000;
+	computeBounds(vertices);
+	setupLods(lods);
+
+	if (keepCpuData && owner) {
+		/* the owner outlives the mesh's use of it, no need to copy */
+		this->cpuOwner = std::move(owner);
+		this->borrowedVertices = Span<const Vertex>(vertices, vertexCount);
+		this->borrowedIndices = Span<const unsigned int>(indices, indexCount);
+	} else if (keepCpuData) {
+		this->vertices.assign(vertices, vertices + vertexCount);
+		this->indices.assign(indices, indices + indexCount);
+	}
+
+	if (glSetup) {
+		setupMesh(vertices, indices, lods);
+	}
+}
+
+Mesh::~Mesh()
+{
+	if (glSetup) {
+		modeling::GeometryArena::shared().free(geometry);
+	}
+}
+
+void Mesh::computeBounds(const Vertex *vertexData)
+{
+	boundsMin = boundsMax = vertexData[0].Position;
+	for (size_t i = 1; i < vertexCount; i++) {
+		boundsMin = glm::min(boundsMin, vertexData[i].Position);
+		boundsMax = glm::max(boundsMax, vertexData[i].Position);
+	}
+}
+
+void Mesh::releaseCpuData()
+{
+	if (!glSetup) {
+		return;
+	}
+	/* swap rather than clear, clear keeps the capacity */
+	vector<Vertex>().swap(vertices);
+	vector<unsigned int>().swap(indices);
+	cpuOwner.reset();
+	borrowedVertices = Span<const Vertex>();
+	borrowedIndices = Span<const unsigned int>();
+}
+
+size_t Mesh::getCpuBytes() const {
+	return vertices.capacity() * sizeof(Vertex) + indices.capacity() * sizeof(unsigned int) +
+		meshlets.capacity() * sizeof(Meshlet);
+}
+
+size_t Mesh::getGpuBytes() const {
+	if (!glSetup) {
+		return 0;
+	}
+	return geometry.vertexCount * encoding.stride() + geometry.indexCount * indexSize();
+}
+
+size_t Mesh::selectLod(float pixelsPerUnit, float maxPixelError) const {
+	/* errors grow with the level, keep the last one that is still small enough */
+	size_t level = 0;
+	while (level + 1 < lods.size() && lods[level + 1].error * pixelsPerUnit <= maxPixelError) {
+		level++;
+	}
+	return level;
+}
+
+void Mesh::setMeshlets(const Meshlet *meshlets, size_t count)
+{
+	for (size_t i = 0; i < count; i++) {
+		const Meshlet &meshlet = meshlets[i];
+		if ((size_t)meshlet.firstIndex + meshlet.indexCount > indexCount || meshlet.indexCount % 3 != 0) {
+			throw std::runtime_error("Bad mesh meshlets");
+		}
+	}
+	this->meshlets.assign(meshlets, meshlets + count);
+}
+
+size_t Mesh::cullMeshlets(const modeling::Frustum &frustum, const glm::vec3 &eye,
+	modeling::MeshletDrawList &list) const
+{
+	list.clear();
+	if (meshlets.empty()) {
+		/* nothing to cull with, draw level 0 whole */
+		list.counts.push_back((int)indexCount);
+		list.offsets.push_back(reinterpret_cast<const void*>(geometry.firstIndex * indexSize()));
+		list.baseVertices.push_back((int)geometry.baseVertex);
+		list.triangleCount = indexCount / 3;
+		return list.triangleCount;
+	}
+	modeling::MeshletCuller::cull(meshlets.data(), meshlets.size(), frustum, eye, list.visible);
+	modeling::MeshletCuller::buildDrawList(meshlets.data(), indexSize(), list,
+		geometry.firstIndex, (int)geometry.baseVertex);
+	return list.triangleCount;
+}
+
+void Mesh::draw(const modeling::MeshletDrawList &list) const
+{
+	if (list.counts.empty()) {
+		return;
+	}
+	glMultiDrawElementsBaseVertex(GL_TRIANGLES, list.counts.data(), getIndexType(),
+		list.offsets.data(), (GLsizei)list.counts.size(), list.baseVertices.data());
+}
+
+unsigned int Mesh::getIndexType() const {
+	return shortIndices ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+}
+
+size_t Mesh::indexSize() const {
+	return shortIndices ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+void Mesh::setupLods(const MeshLodView &lodData)
+{
+	/* coarser levels follow level 0 in the index buffer */
+	lods.assign(1, MeshLod{0, (uint32_t)indexCount, 0.f});
+	for (size_t i = 0; i < lodData.levelCount; i++) {
+		MeshLod lod = lodData.levels[i];
+		if ((size_t)lod.firstIndex + lod.indexCount > lodData.indexCount || lod.indexCount % 3 != 0) {
+			throw std::runtime_error("Bad mesh LOD");
+		}
+		for (size_t j = lod.firstIndex; j < (size_t)lod.firstIndex + lod.indexCount; j++) {
+			if (lodData.indices[j] >= vertexCount) {
+				throw std::runtime_error("Bad mesh LOD");
+			}
+		}
+		lod.firstIndex += (uint32_t)indexCount;
+		lods.push_back(lod);
+	}
+}
+
+void Mesh::setupMesh(const Vertex *vertexData, const unsigned int *indexData, const MeshLodView &lodData)
+{
+	/* FLOAT uploads straight from vertexData, other formats encode first */
+	vector<uint8_t> encoded;
+	const void *gpuData = vertexData;
+	if (encoding.format != VertexFormat::FLOAT) {
+		encoded = encodeVertices(vertexData, vertexCount, encoding);
+		gpuData = encoded.data();
+	}
+
+	/*
+	 * half the index bandwidth when the vertex count allows it. LODs are
+	 * appended after level 0, so only a mesh with LODs needs a copy of
+	 * 32 bit indices
+	 */
+	size_t totalIndices = indexCount + lodData.indexCount;
+	vector<uint16_t> narrowed;
+	vector<unsigned int> combined;
+	const void *gpuIndices = indexData;
+	if (shortIndices) {
+		narrowed.reserve(totalIndices);
+		narrowed.assign(indexData, indexData + indexCount);
+		narrowed.insert(narrowed.end(), lodData.indices, lodData.indices + lodData.indexCount);
+		gpuIndices = narrowed.data();
+	} else if (lodData.indexCount > 0) {
+		combined.reserve(totalIndices);
+		combined.assign(indexData, indexData + indexCount);
+		combined.insert(combined.end(), lodData.indices, lodData.indices + lodData.indexCount);
+		gpuIndices = combined.data();
+	}
+
+	geometry = modeling::GeometryArena::shared().allocate(encoding, shortIndices,
+		gpuData, (uint32_t)vertexCount, gpuIndices, (uint32_t)totalIndices);
+}
+
+bool Mesh::validate(const Vertex *vertexData, const unsigned int *indexData) const {
+	auto nvert = this->vertexCount;
+
+	if (nvert < 1 || vertexData == nullptr) {
 		LOG_ERROR("Bad mesh contains no vertices");
 		return false;
 	}
-	if (this->indices.size() <= 1) {
-		LOG_ERROR_F("Bad mesh has %d indices",this->indices.size());
+	if (this->indexCount <= 1 || indexData == nullptr) {
+		LOG_ERROR_F("Bad mesh has %d indices",this->indexCount);
 		return false;
 	}
 
-	for (int i=0; i<this->indices.size(); i++) {
-		if (this->indices[i] >= nvert) {
-			LOG_ERROR_F("Bad mesh: indices[%d]=%d, exceeding %d vertices",i,this->indices[i],nvert);
+	for (size_t i=0; i<this->indexCount; i++) {
+		if (indexData[i] >= nvert) {
+			LOG_ERROR_F("Bad mesh: indices[%d]=%d, exceeding %d vertices",i,indexData[i],nvert);
 			return false;
 		}
 	}
@@ -74,5 +231,15 @@ bool Mesh::validate() {
 }
 
 void Mesh::bind() const {
-	glBindVertexArray(VAO);
+	modeling::GeometryArena::shared().bind(geometry.pool);
+
+	/*
+	 * constant per mesh decode parameters, generic attribute values
+	 * are context state so they are set on every bind
+	 */
+	const glm::vec3 &scale = encoding.positionScale;
+	const glm::vec3 &offset = encoding.positionOffset;
+	float octahedral = encoding.format == VertexFormat::FLOAT ? 0.f : 1.f;
+	glVertexAttrib4f(4, scale.x, scale.y, scale.z, octahedral);
+	glVertexAttrib3f(5, offset.x, offset.y, offset.z);
 }
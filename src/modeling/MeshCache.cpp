@@ -0,0 +1,565 @@
+#include "modeling/MeshCache.hpp"
+#include "utils/AtomicFile.hpp"
+#include "utils/Logger.hpp"
+#include "utils/StringId.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <regex>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace modeling {
+
+namespace {
+
+    const char MAGIC[4] = {'S', 'M', 'C', 'H'};
+    const uint32_t VERSION = 10;
+    const uint64_t BLOB_ALIGNMENT = 16;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t importFlags;
+        uint32_t vertexStride;
+        uint32_t meshCount;
+        uint32_t materialCount;
+        uint32_t modelCount;
+        uint32_t extensionCount;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+        uint64_t optionsHash;
+        uint64_t sourceStamp;
+    };
+
+    struct MeshEntry {
+        uint64_t vertexOffset;
+        uint64_t indexOffset;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t materialIndex;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        float boundsMin[3];
+        float boundsMax[3];
+        uint32_t lodCount;
+        uint64_t lodIndexOffset;
+        uint64_t lodOffset;
+        uint32_t lodIndexCount;
+        uint32_t meshletCount;
+        uint64_t meshletOffset;
+    };
+
+    struct StringRef {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct MaterialEntry {
+        StringRef name;
+        StringRef textures[TEXTURE_SLOT_COUNT];
+        uint32_t unlit;
+    };
+
+    // one PropertyValue, <type> is its variant index. Numbers and bools
+    // are stored in <number>, which holds int and float exactly
+    struct ExtensionEntry {
+        StringRef key;
+        StringRef text;
+        uint32_t type;
+        uint32_t reserved;
+        double number;
+    };
+
+    std::mutex cacheDirectoryMutex;
+    std::string cacheDirectory;
+
+    template <typename T>
+    uint64_t hashValue(const T& value, uint64_t hash) {
+        return StringId::hashOf(std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)), hash);
+    }
+
+    bool readFile(const std::string& path, std::string& contents) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // size and modification time of a file, 0 if it can't be stat'ed
+    uint64_t stampFile(const std::filesystem::path& path, uint64_t stamp) {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(path, error);
+        if (error) {
+            return 0;
+        }
+        int64_t time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        if (error) {
+            return 0;
+        }
+        stamp = hashValue(size, stamp);
+        return hashValue(time, stamp);
+    }
+
+    // external buffers of a .gltf, the geometry lives in those
+    std::vector<std::filesystem::path> gltfBuffers(const std::filesystem::path& source, const std::string& contents) {
+        static const std::regex uriPattern("\"uri\"\\s*:\\s*\"([^\"]+)\"");
+        std::vector<std::filesystem::path> buffers;
+        for (std::sregex_iterator it(contents.begin(), contents.end(), uriPattern), end; it != end; ++it) {
+            std::string uri = (*it)[1].str();
+            if (uri.rfind("data:", 0) == 0) {
+                continue; // embedded, part of the file itself
+            }
+            buffers.push_back(source.parent_path() / uri);
+        }
+        return buffers;
+    }
+
+    uint64_t alignUp(uint64_t value) {
+        return (value + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+    }
+
+    bool inBounds(uint64_t offset, uint64_t size, uint64_t fileSize) {
+        return offset <= fileSize && size <= fileSize - offset;
+    }
+}
+
+/*
+ * Read-only memory mapping of a whole file
+ */
+struct MeshCache::Mapping {
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE view = nullptr;
+#else
+    int fd = -1;
+#endif
+
+    bool map(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return false;
+        size = static_cast<size_t>(fileSize.QuadPart);
+        view = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!view) return false;
+        data = static_cast<const char*>(MapViewOfFile(view, FILE_MAP_READ, 0, 0, 0));
+        return data != nullptr;
+#else
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) return false;
+        size = static_cast<size_t>(st.st_size);
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) return false;
+        data = static_cast<const char*>(p);
+        return true;
+#endif
+    }
+
+    ~Mapping() {
+#ifdef _WIN32
+        if (data) UnmapViewOfFile(data);
+        if (view) CloseHandle(view);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (data) munmap(const_cast<char*>(data), size);
+        if (fd >= 0) ::close(fd);
+#endif
+    }
+};
+
+MeshCache::MeshCache() = default;
+MeshCache::~MeshCache() = default;
+
+MeshCacheKey MeshCache::computeKey(const std::string& sourcePath, uint32_t importFlags) {
+    MeshCacheKey key;
+    key.importFlags = importFlags;
+
+    std::filesystem::path source(sourcePath);
+    uint64_t stamp = stampFile(source, StringId::HASH_SEED);
+    if (stamp == 0) {
+        return key;
+    }
+    if (source.extension() == ".gltf") {
+        std::string contents;
+        if (!readFile(sourcePath, contents)) {
+            return key;
+        }
+        for (const auto& buffer : gltfBuffers(source, contents)) {
+            // a missing buffer still gets a stamp, so it is noticed when it appears
+            uint64_t bufferStamp = stampFile(buffer, stamp);
+            stamp = bufferStamp ? bufferStamp : StringId::hashOf("missing", stamp);
+        }
+    }
+
+    key.sourceStamp = stamp ? stamp : 1;
+    return key;
+}
+
+uint64_t MeshCache::hashSource(const std::string& sourcePath) {
+    std::string contents;
+    if (!readFile(sourcePath, contents)) {
+        return 0;
+    }
+    uint64_t hash = StringId::hashOf(contents);
+
+    std::filesystem::path source(sourcePath);
+    if (source.extension() == ".gltf") {
+        std::string buffer;
+        for (const auto& path : gltfBuffers(source, contents)) {
+            if (readFile(path.string(), buffer)) {
+                hash = StringId::hashOf(buffer, hash);
+            }
+        }
+    }
+    return hash ? hash : 1;
+}
+
+void MeshCache::setCacheDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(cacheDirectoryMutex);
+    cacheDirectory = directory;
+}
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath, const std::string& extension) {
+    std::lock_guard<std::mutex> lock(cacheDirectoryMutex);
+    if (cacheDirectory.empty()) {
+        return sourcePath + extension;
+    }
+    // keep files from different directories apart
+    uint64_t pathHash = StringId::hashOf(sourcePath);
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), "-%016llx", static_cast<unsigned long long>(pathHash));
+    std::filesystem::path name = std::filesystem::path(sourcePath).filename();
+    return (std::filesystem::path(cacheDirectory) / (name.string() + suffix + extension)).string();
+}
+
+std::unique_ptr<MeshCache> MeshCache::open(const std::string& cachePath, const MeshCacheKey& key) {
+    std::unique_ptr<MeshCache> cache(new MeshCache());
+    cache->mapping = std::make_unique<Mapping>();
+    if (!cache->mapping->map(cachePath)) {
+        return nullptr;
+    }
+    if (!cache->parse(key)) {
+        LOG_DEBUG_F("Mesh cache {} is stale or corrupt, ignoring", cachePath);
+        return nullptr;
+    }
+    LOG_INFO_F("Loaded mesh cache {} ({} meshes)", cachePath, cache->meshes.size());
+    return cache;
+}
+
+bool MeshCache::parse(const MeshCacheKey& key) {
+    const char* data = mapping->data;
+    const uint64_t size = mapping->size;
+
+    if (size < sizeof(FileHeader)) {
+        return false;
+    }
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.vertexStride != sizeof(Vertex) ||
+        header.importFlags != key.importFlags ||
+        header.optionsHash != key.optionsHash) {
+        return false;
+    }
+    bool sameStamp = key.sourceStamp != 0 && header.sourceStamp == key.sourceStamp;
+    bool sameHash = key.sourceHash != 0 && header.sourceHash == key.sourceHash;
+    if (!sameStamp && !sameHash) {
+        return false;
+    }
+
+    uint64_t offset = sizeof(FileHeader);
+    uint64_t tablesSize = uint64_t(header.meshCount) * sizeof(MeshEntry) +
+                          uint64_t(header.materialCount) * sizeof(MaterialEntry) +
+                          uint64_t(header.modelCount) * (sizeof(uint32_t) + 16 * sizeof(float)) +
+                          uint64_t(header.extensionCount) * sizeof(ExtensionEntry);
+    if (!inBounds(offset, tablesSize, size) || !inBounds(header.stringsOffset, header.stringsSize, size)) {
+        return false;
+    }
+    const char* strings = data + header.stringsOffset;
+    auto readString = [&](uint32_t nameOffset, uint32_t nameLength, std::string& out) {
+        if (!inBounds(nameOffset, nameLength, header.stringsSize)) return false;
+        out.assign(strings + nameOffset, nameLength);
+        return true;
+    };
+
+    meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; ++i, offset += sizeof(MeshEntry)) {
+        MeshEntry entry;
+        std::memcpy(&entry, data + offset, sizeof(entry));
+        if (!inBounds(entry.vertexOffset, uint64_t(entry.vertexCount) * sizeof(Vertex), size) ||
+            !inBounds(entry.indexOffset, uint64_t(entry.indexCount) * sizeof(uint32_t), size) ||
+            !inBounds(entry.lodIndexOffset, uint64_t(entry.lodIndexCount) * sizeof(uint32_t), size) ||
+            !inBounds(entry.lodOffset, uint64_t(entry.lodCount) * sizeof(MeshLod), size) ||
+            !inBounds(entry.meshletOffset, uint64_t(entry.meshletCount) * sizeof(Meshlet), size) ||
+            entry.vertexOffset % alignof(Vertex) != 0 ||
+            entry.indexOffset % alignof(uint32_t) != 0 ||
+            entry.lodIndexOffset % alignof(uint32_t) != 0 ||
+            entry.lodOffset % alignof(MeshLod) != 0 ||
+            entry.meshletOffset % alignof(Meshlet) != 0) {
+            return false;
+        }
+        MeshView& view = meshes[i];
+        if (!readString(entry.nameOffset, entry.nameLength, view.name)) {
+            return false;
+        }
+        // mmap'd memory is page aligned and blobs are 16 byte aligned in the file
+        view.vertices = reinterpret_cast<const Vertex*>(data + entry.vertexOffset);
+        view.vertexCount = entry.vertexCount;
+        view.indices = reinterpret_cast<const uint32_t*>(data + entry.indexOffset);
+        view.indexCount = entry.indexCount;
+        view.materialIndex = entry.materialIndex;
+        view.boundsMin = glm::vec3(entry.boundsMin[0], entry.boundsMin[1], entry.boundsMin[2]);
+        view.boundsMax = glm::vec3(entry.boundsMax[0], entry.boundsMax[1], entry.boundsMax[2]);
+        view.lods.indices = reinterpret_cast<const uint32_t*>(data + entry.lodIndexOffset);
+        view.lods.indexCount = entry.lodIndexCount;
+        view.lods.levels = reinterpret_cast<const MeshLod*>(data + entry.lodOffset);
+        view.lods.levelCount = entry.lodCount;
+        view.meshlets = reinterpret_cast<const Meshlet*>(data + entry.meshletOffset);
+        view.meshletCount = entry.meshletCount;
+    }
+
+    materials.resize(header.materialCount);
+    for (uint32_t i = 0; i < header.materialCount; ++i, offset += sizeof(MaterialEntry)) {
+        MaterialEntry entry;
+        std::memcpy(&entry, data + offset, sizeof(entry));
+        MaterialSource& material = materials[i];
+        if (!readString(entry.name.offset, entry.name.length, material.name)) {
+            return false;
+        }
+        for (int slot = 0; slot < TEXTURE_SLOT_COUNT; ++slot) {
+            if (!readString(entry.textures[slot].offset, entry.textures[slot].length, material.textures[slot])) {
+                return false;
+            }
+        }
+        material.unlit = entry.unlit != 0;
+    }
+
+    modelMeshes.resize(header.modelCount);
+    std::memcpy(modelMeshes.data(), data + offset, header.modelCount * sizeof(uint32_t));
+    offset += header.modelCount * sizeof(uint32_t);
+    for (uint32_t meshIndex : modelMeshes) {
+        if (meshIndex >= header.meshCount) {
+            return false;
+        }
+    }
+    modelTransforms.resize(header.modelCount);
+    for (uint32_t i = 0; i < header.modelCount; ++i, offset += 16 * sizeof(float)) {
+        float m[16];
+        std::memcpy(m, data + offset, sizeof(m));
+        for (int c = 0; c < 4; ++c) {
+            modelTransforms[i][c] = glm::vec4(m[c * 4], m[c * 4 + 1], m[c * 4 + 2], m[c * 4 + 3]);
+        }
+    }
+
+    for (uint32_t i = 0; i < header.extensionCount; ++i, offset += sizeof(ExtensionEntry)) {
+        ExtensionEntry entry;
+        std::memcpy(&entry, data + offset, sizeof(entry));
+        std::string name;
+        std::string text;
+        if (!readString(entry.key.offset, entry.key.length, name) ||
+            !readString(entry.text.offset, entry.text.length, text)) {
+            return false;
+        }
+        PropertyValue value;
+        switch (entry.type) {
+            case 0: value = static_cast<int>(entry.number); break;
+            case 1: value = entry.number != 0.0; break;
+            case 2: value = static_cast<float>(entry.number); break;
+            case 3: value = entry.number; break;
+            case 4: value = std::move(text); break;
+            default: return false;
+        }
+        extensions[name] = std::move(value);
+    }
+    return true;
+}
+
+bool MeshCache::restamp(const std::string& cachePath, const MeshCacheKey& key) {
+    std::fstream file(cachePath, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    file.seekp(offsetof(FileHeader, sourceStamp));
+    file.write(reinterpret_cast<const char*>(&key.sourceStamp), sizeof(key.sourceStamp));
+    return file.good();
+}
+
+bool MeshCache::write(
+    const std::string& cachePath,
+    const MeshCacheKey& key,
+    const std::vector<MeshData>& meshes,
+    const std::vector<MaterialSource>& materials,
+    const std::vector<uint32_t>& modelMeshes,
+    const std::vector<glm::mat4>& modelTransforms,
+    const std::unordered_map<std::string, PropertyValue>& extensions
+) {
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceHash = key.sourceHash;
+    header.sourceStamp = key.sourceStamp;
+    header.importFlags = key.importFlags;
+    header.optionsHash = key.optionsHash;
+    header.vertexStride = sizeof(Vertex);
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.materialCount = static_cast<uint32_t>(materials.size());
+    header.modelCount = static_cast<uint32_t>(modelMeshes.size());
+    header.extensionCount = static_cast<uint32_t>(extensions.size());
+
+    std::string strings;
+    auto addString = [&strings](const std::string& s, uint32_t& nameOffset, uint32_t& nameLength) {
+        nameOffset = static_cast<uint32_t>(strings.size());
+        nameLength = static_cast<uint32_t>(s.size());
+        strings += s;
+    };
+
+    std::vector<MeshEntry> meshEntries(meshes.size());
+    std::vector<MaterialEntry> materialEntries(materials.size());
+    for (size_t i = 0; i < materials.size(); ++i) {
+        MaterialEntry& entry = materialEntries[i];
+        addString(materials[i].name, entry.name.offset, entry.name.length);
+        for (int slot = 0; slot < TEXTURE_SLOT_COUNT; ++slot) {
+            addString(materials[i].textures[slot], entry.textures[slot].offset, entry.textures[slot].length);
+        }
+        entry.unlit = materials[i].unlit ? 1 : 0;
+    }
+
+    std::vector<ExtensionEntry> extensionEntries;
+    extensionEntries.reserve(extensions.size());
+    for (const auto& [name, value] : extensions) {
+        ExtensionEntry entry{};
+        addString(name, entry.key.offset, entry.key.length);
+        entry.type = static_cast<uint32_t>(value.index());
+        switch (entry.type) {
+            case 0: entry.number = std::get<int>(value); break;
+            case 1: entry.number = std::get<bool>(value) ? 1.0 : 0.0; break;
+            case 2: entry.number = std::get<float>(value); break;
+            case 3: entry.number = std::get<double>(value); break;
+            case 4: addString(std::get<std::string>(value), entry.text.offset, entry.text.length); break;
+        }
+        extensionEntries.push_back(entry);
+    }
+
+    uint64_t offset = sizeof(FileHeader) +
+                      meshEntries.size() * sizeof(MeshEntry) +
+                      materialEntries.size() * sizeof(MaterialEntry) +
+                      modelMeshes.size() * (sizeof(uint32_t) + 16 * sizeof(float)) +
+                      extensionEntries.size() * sizeof(ExtensionEntry);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        addString(meshes[i].name, meshEntries[i].nameOffset, meshEntries[i].nameLength);
+    }
+    header.stringsOffset = offset;
+    header.stringsSize = strings.size();
+    offset += strings.size();
+
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const MeshData& mesh = meshes[i];
+        MeshEntry& entry = meshEntries[i];
+        // failed meshes are kept as empty entries so indices stay aligned with the source
+        size_t nvertices = mesh.valid ? mesh.vertices.size() : 0;
+        size_t nindices = mesh.valid ? mesh.indices.size() : 0;
+
+        entry.materialIndex = mesh.materialIndex;
+        entry.vertexCount = static_cast<uint32_t>(nvertices);
+        entry.indexCount = static_cast<uint32_t>(nindices);
+        offset = alignUp(offset);
+        entry.vertexOffset = offset;
+        offset += nvertices * sizeof(Vertex);
+        offset = alignUp(offset);
+        entry.indexOffset = offset;
+        offset += nindices * sizeof(uint32_t);
+        entry.lodIndexCount = mesh.valid ? static_cast<uint32_t>(mesh.lodIndices.size()) : 0;
+        entry.lodCount = mesh.valid ? static_cast<uint32_t>(mesh.lods.size()) : 0;
+        offset = alignUp(offset);
+        entry.lodIndexOffset = offset;
+        offset += entry.lodIndexCount * sizeof(uint32_t);
+        offset = alignUp(offset);
+        entry.lodOffset = offset;
+        offset += entry.lodCount * sizeof(MeshLod);
+        entry.meshletCount = mesh.valid ? static_cast<uint32_t>(mesh.meshlets.size()) : 0;
+        offset = alignUp(offset);
+        entry.meshletOffset = offset;
+        offset += entry.meshletCount * sizeof(Meshlet);
+
+        glm::vec3 lo(0.f), hi(0.f);
+        if (nvertices > 0) {
+            lo = hi = mesh.vertices[0].Position;
+            for (const Vertex& v : mesh.vertices) {
+                lo = glm::min(lo, v.Position);
+                hi = glm::max(hi, v.Position);
+            }
+        }
+        for (int k = 0; k < 3; ++k) {
+            entry.boundsMin[k] = lo[k];
+            entry.boundsMax[k] = hi[k];
+        }
+    }
+
+    bool written = writeFileAtomically(cachePath, [&](std::ofstream& file) {
+        auto pad = [&file]() {
+            static const char zeros[BLOB_ALIGNMENT] = {};
+            uint64_t pos = static_cast<uint64_t>(file.tellp());
+            file.write(zeros, static_cast<std::streamsize>(alignUp(pos) - pos));
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(meshEntries.data()), meshEntries.size() * sizeof(MeshEntry));
+        file.write(reinterpret_cast<const char*>(materialEntries.data()), materialEntries.size() * sizeof(MaterialEntry));
+        file.write(reinterpret_cast<const char*>(modelMeshes.data()), modelMeshes.size() * sizeof(uint32_t));
+        for (size_t i = 0; i < modelMeshes.size(); ++i) {
+            glm::mat4 transform = i < modelTransforms.size() ? modelTransforms[i] : glm::mat4(1.0f);
+            float m[16];
+            for (int c = 0; c < 4; ++c) {
+                for (int r = 0; r < 4; ++r) {
+                    m[c * 4 + r] = transform[c][r];
+                }
+            }
+            file.write(reinterpret_cast<const char*>(m), sizeof(m));
+        }
+        file.write(reinterpret_cast<const char*>(extensionEntries.data()), extensionEntries.size() * sizeof(ExtensionEntry));
+        file.write(strings.data(), strings.size());
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            pad();
+            file.write(reinterpret_cast<const char*>(meshes[i].vertices.data()), meshEntries[i].vertexCount * sizeof(Vertex));
+            pad();
+            file.write(reinterpret_cast<const char*>(meshes[i].indices.data()), meshEntries[i].indexCount * sizeof(uint32_t));
+            pad();
+            file.write(reinterpret_cast<const char*>(meshes[i].lodIndices.data()), meshEntries[i].lodIndexCount * sizeof(uint32_t));
+            pad();
+            file.write(reinterpret_cast<const char*>(meshes[i].lods.data()), meshEntries[i].lodCount * sizeof(MeshLod));
+            pad();
+            file.write(reinterpret_cast<const char*>(meshes[i].meshlets.data()), meshEntries[i].meshletCount * sizeof(Meshlet));
+        }
+        return true;
+    });
+    if (!written) {
+        return false;
+    }
+    LOG_INFO_F("Wrote mesh cache {}", cachePath);
+    return true;
+}
+
+} // namespace modeling
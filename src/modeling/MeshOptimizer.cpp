@@ -0,0 +1,387 @@
+#include "modeling/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace modeling {
+
+namespace {
+
+    // FIFO post transform cache, the model Tipsify and the ACMR figures assume
+    class FifoCache {
+    public:
+        FifoCache(size_t vertexCount, uint32_t size) : stamps(vertexCount, 0), size(size) {}
+
+        // true on a miss, the vertex is then inserted
+        bool access(unsigned int vertex) {
+            if (stamps[vertex] != 0 && time - stamps[vertex] < size) {
+                return false;
+            }
+            stamps[vertex] = ++time;
+            return true;
+        }
+
+        uint32_t accessTriangle(const unsigned int* triangle) {
+            // one statement per vertex, the order of insertion matters
+            uint32_t misses = access(triangle[0]);
+            misses += access(triangle[1]);
+            misses += access(triangle[2]);
+            return misses;
+        }
+
+        // evict everything, without touching the stamps
+        void flush() {
+            time += size;
+        }
+
+    private:
+        std::vector<uint32_t> stamps;  // insertion time, 0 if never inserted
+        uint32_t time = 0;
+        uint32_t size;
+    };
+
+    // triangles using each vertex, in compressed row form
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+    };
+
+    Adjacency buildAdjacency(const std::vector<unsigned int>& indices, size_t vertexCount) {
+        Adjacency adjacency;
+        adjacency.offsets.assign(vertexCount + 1, 0);
+        for (unsigned int index : indices) {
+            adjacency.offsets[index + 1]++;
+        }
+        std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+        adjacency.triangles.resize(indices.size());
+        std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency.triangles[fill[indices[i]]++] = uint32_t(i / 3);
+        }
+        return adjacency;
+    }
+
+    // a contiguous run of triangles, <index> is its position in the input
+    struct TrianglePart {
+        uint32_t index;
+        uint32_t start;
+        uint32_t end;
+        float sortKey;
+    };
+
+    /*
+     * order the parts starting at triangles <starts> so the ones facing away
+     * from the mesh center come first: they are in front of the rest from
+     * most directions, and drawing them first lets the depth test reject more
+     */
+    std::vector<TrianglePart> sortOutwardFirst(const std::vector<unsigned int>& indices,
+                                               const std::vector<Vertex>& vertices,
+                                               const std::vector<uint32_t>& starts) {
+        size_t triangleCount = indices.size() / 3;
+
+        // area weighted centroid and normal of every part, and of the whole mesh
+        std::vector<TrianglePart> parts(starts.size());
+        std::vector<glm::vec3> centroids(starts.size());
+        std::vector<glm::vec3> normals(starts.size());
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0.0f;
+        for (size_t p = 0; p < starts.size(); p++) {
+            TrianglePart& part = parts[p];
+            part.index = uint32_t(p);
+            part.start = starts[p];
+            part.end = p + 1 < starts.size() ? starts[p + 1] : uint32_t(triangleCount);
+            glm::vec3 normal(0.0f);
+            glm::vec3 weighted(0.0f);
+            float area = 0.0f;
+            for (uint32_t t = part.start; t < part.end; t++) {
+                const glm::vec3& a = vertices[indices[t * 3 + 0]].Position;
+                const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3& c = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 n = glm::cross(b - a, c - a);
+                float triangleArea = glm::length(n);
+                normal += n;
+                weighted += (a + b + c) * (triangleArea / 3.0f);
+                area += triangleArea;
+            }
+            normals[p] = normal;
+            centroids[p] = area > 0.0f ? weighted / area : vertices[indices[part.start * 3]].Position;
+            meshCentroid += weighted;
+            meshArea += area;
+        }
+        if (meshArea > 0.0f) {
+            meshCentroid /= meshArea;
+        }
+
+        for (size_t p = 0; p < parts.size(); p++) {
+            float length = glm::length(normals[p]);
+            parts[p].sortKey = length > 0.0f ? glm::dot(centroids[p] - meshCentroid, normals[p] / length) : 0.0f;
+        }
+        std::stable_sort(parts.begin(), parts.end(), [](const TrianglePart& a, const TrianglePart& b) {
+            return a.sortKey > b.sortKey;
+        });
+        return parts;
+    }
+
+} // namespace
+
+MeshOptimizationStats MeshOptimizer::optimize(MeshData& mesh) {
+    MeshOptimizationStats stats;
+    if (!mesh.valid || mesh.indices.size() < 3) {
+        return stats;
+    }
+    stats.before = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+    std::vector<uint32_t> clusters = optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    optimizeOverdraw(mesh.indices, mesh.vertices, clusters);
+    stats.unusedVertices = optimizeVertexFetch(mesh.vertices, mesh.indices);
+
+    stats.after = analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    return stats;
+}
+
+std::vector<uint32_t> MeshOptimizer::optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount,
+                                                         uint32_t cacheSize) {
+    std::vector<uint32_t> clusters;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return clusters;
+    }
+
+    Adjacency adjacency = buildAdjacency(indices, vertexCount);
+    // triangles of each vertex not emitted yet
+    std::vector<uint32_t> live(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    // a vertex is in the cache while time - cacheTime < cacheSize, starting with none
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    uint32_t time = cacheSize + 1;
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<unsigned int> deadEnd;
+    std::vector<unsigned int> candidates;
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    size_t cursor = 0;
+
+    // fall back to the most recent vertex with triangles left, then the next one in input order
+    auto nextFromDeadEnd = [&]() -> int64_t {
+        while (!deadEnd.empty()) {
+            unsigned int v = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[v] > 0) {
+                return v;
+            }
+        }
+        for (; cursor < vertexCount; cursor++) {
+            if (live[cursor] > 0) {
+                return int64_t(cursor);
+            }
+        }
+        return -1;
+    };
+
+    int64_t fanning = nextFromDeadEnd();
+    clusters.push_back(0);
+    while (fanning >= 0) {
+        candidates.clear();
+        for (uint32_t k = adjacency.offsets[fanning]; k < adjacency.offsets[fanning + 1]; k++) {
+            uint32_t triangle = adjacency.triangles[k];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = true;
+            for (int j = 0; j < 3; j++) {
+                unsigned int v = indices[triangle * 3 + j];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize) {
+                    cacheTime[v] = time++;
+                }
+            }
+        }
+
+        // prefer the oldest vertex that will still be cached after its remaining triangles
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (unsigned int v : candidates) {
+            if (live[v] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize) {
+                priority = time - cacheTime[v];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        if (next < 0) {
+            next = nextFromDeadEnd();
+            if (next >= 0) {
+                clusters.push_back(uint32_t(output.size() / 3));
+            }
+        }
+        fanning = next;
+    }
+
+    indices.swap(output);
+    return clusters;
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices,
+                                     const std::vector<uint32_t>& clusters, float threshold, uint32_t cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || clusters.empty()) {
+        return;
+    }
+
+    /*
+     * Tipsify clusters are large, split them wherever the part so far
+     * is already almost as cache efficient as the whole cluster. Each
+     * part restarts with a cold cache, so reordering parts costs at most
+     * <threshold> in ACMR.
+     */
+    std::vector<uint32_t> parts;
+    FifoCache cache(vertices.size(), cacheSize);
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t start = clusters[c];
+        size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+
+        cache.flush();
+        uint32_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++) {
+            clusterMisses += cache.accessTriangle(&indices[t * 3]);
+        }
+        float limit = threshold * float(clusterMisses) / float(end - start);
+
+        cache.flush();
+        parts.push_back(uint32_t(start));
+        uint32_t partMisses = 0;
+        size_t partStart = start;
+        for (size_t t = start; t < end; t++) {
+            partMisses += cache.accessTriangle(&indices[t * 3]);
+            if (t + 1 < end && float(partMisses) / float(t + 1 - partStart) <= limit) {
+                parts.push_back(uint32_t(t + 1));
+                cache.flush();
+                partMisses = 0;
+                partStart = t + 1;
+            }
+        }
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(indices.size());
+    for (const TrianglePart& part : sortOutwardFirst(indices, vertices, parts)) {
+        output.insert(output.end(), indices.begin() + part.start * 3, indices.begin() + part.end * 3);
+    }
+    indices.swap(output);
+}
+
+size_t MeshOptimizer::optimizeMeshlets(MeshData& mesh) {
+    if (!mesh.valid || mesh.meshlets.empty()) {
+        return optimizeVertexFetch(mesh.vertices, mesh.indices);
+    }
+
+    // Tipsify within each meshlet, on local vertex numbers so the cache is sized to the meshlet
+    const unsigned int NONE = ~0u;
+    std::vector<unsigned int> local(mesh.vertices.size(), NONE);
+    std::vector<unsigned int> global;
+    std::vector<unsigned int> range;
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        unsigned int* begin = mesh.indices.data() + meshlet.firstIndex;
+        range.assign(begin, begin + meshlet.indexCount);
+        global.clear();
+        for (unsigned int& index : range) {
+            if (local[index] == NONE) {
+                local[index] = unsigned(global.size());
+                global.push_back(index);
+            }
+            index = local[index];
+        }
+        optimizeVertexCache(range, global.size());
+        for (size_t i = 0; i < range.size(); i++) {
+            begin[i] = global[range[i]];
+        }
+        for (unsigned int v : global) {
+            local[v] = NONE;
+        }
+    }
+
+    // then the meshlets themselves, by the same key as the overdraw pass
+    std::vector<uint32_t> starts(mesh.meshlets.size());
+    for (size_t m = 0; m < mesh.meshlets.size(); m++) {
+        starts[m] = mesh.meshlets[m].firstIndex / 3;
+    }
+    std::vector<TrianglePart> sorted = sortOutwardFirst(mesh.indices, mesh.vertices, starts);
+
+    std::vector<unsigned int> output;
+    output.reserve(mesh.indices.size());
+    std::vector<Meshlet> meshlets;
+    meshlets.reserve(mesh.meshlets.size());
+    for (const TrianglePart& part : sorted) {
+        Meshlet meshlet = mesh.meshlets[part.index];
+        meshlet.firstIndex = uint32_t(output.size());
+        output.insert(output.end(), mesh.indices.begin() + part.start * 3, mesh.indices.begin() + part.end * 3);
+        meshlets.push_back(meshlet);
+    }
+    mesh.indices.swap(output);
+    mesh.meshlets.swap(meshlets);
+    return optimizeVertexFetch(mesh.vertices, mesh.indices);
+}
+
+size_t MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int UNUSED = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    unsigned int next = 0;
+    for (unsigned int& index : indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    std::vector<Vertex> reordered(next);
+    for (size_t v = 0; v < vertices.size(); v++) {
+        if (remap[v] != UNUSED) {
+            reordered[remap[v]] = vertices[v];
+        }
+    }
+    size_t dropped = vertices.size() - next;
+    vertices.swap(reordered);
+    return dropped;
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const unsigned int* indices, size_t indexCount,
+                                                   size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    if (indexCount < 3 || vertexCount == 0) {
+        return stats;
+    }
+
+    FifoCache cache(vertexCount, cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+    size_t misses = 0;
+    size_t unique = 0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        misses += cache.accessTriangle(&indices[i]);
+        for (int j = 0; j < 3; j++) {
+            if (!referenced[indices[i + j]]) {
+                referenced[indices[i + j]] = true;
+                unique++;
+            }
+        }
+    }
+    stats.acmr = float(misses) / float(indexCount / 3);
+    stats.atvr = float(misses) / float(unique);
+    return stats;
+}
+
+} // namespace modeling
@@ -0,0 +1,473 @@
+#include "modeling/MeshSimplifier.hpp"
+#include "modeling/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace modeling {
+
+namespace {
+
+    const uint32_t NONE = ~0u;
+
+    // open borders and seams weigh more than the surface, so outlines and UV islands keep their shape
+    const double BOUNDARY_WEIGHT = 10.0;
+
+    // largest rotation of a remaining triangle's normal a collapse may cause, as a cosine (~75 degrees)
+    const float FLIP_COSINE = 0.25f;
+
+    enum VertexKind : uint8_t {
+        // interior vertex, collapses onto any neighbour
+        KIND_MANIFOLD,
+        // on an open border, only collapses along it
+        KIND_BORDER,
+        // one side of an attribute seam, collapses along it together with the other side
+        KIND_SEAM,
+        // corner or complex topology, never moves
+        KIND_LOCKED,
+    };
+
+    // sum of squared distances to a set of weighted planes
+    struct Quadric {
+        double a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+        double b0 = 0, b1 = 0, b2 = 0;
+        double c = 0;
+        double weight = 0;
+
+        void addPlane(const glm::vec3& n, float d, double w) {
+            a00 += w * n.x * n.x; a11 += w * n.y * n.y; a22 += w * n.z * n.z;
+            a01 += w * n.x * n.y; a02 += w * n.x * n.z; a12 += w * n.y * n.z;
+            b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void add(const Quadric& q) {
+            a00 += q.a00; a11 += q.a11; a22 += q.a22;
+            a01 += q.a01; a02 += q.a02; a12 += q.a12;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        // weighted mean squared distance of <p> to the planes
+        double error(const glm::vec3& p) const {
+            if (weight <= 0) {
+                return 0;
+            }
+            double x = p.x, y = p.y, z = p.z;
+            double e = a00 * x * x + a11 * y * y + a22 * z * z
+                     + 2 * (a01 * x * y + a02 * x * z + a12 * y * z)
+                     + 2 * (b0 * x + b1 * y + b2 * z) + c;
+            return std::fabs(e) / weight;
+        }
+    };
+
+    // triangles using each vertex, in compressed row form
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        void build(const std::vector<unsigned int>& indices, size_t vertexCount) {
+            offsets.assign(vertexCount + 1, 0);
+            for (unsigned int index : indices) {
+                offsets[index + 1]++;
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            triangles.resize(indices.size());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) {
+                triangles[fill[indices[i]]++] = uint32_t(i / 3);
+            }
+        }
+    };
+
+    /*
+     * State of one simplification. topology is rebuilt every pass
+     * while the quadrics accumulate over the whole run.
+     */
+    struct Simplifier {
+        const std::vector<Vertex>& vertices;
+        std::vector<unsigned int> indices;
+        size_t vertexCount;
+
+        // first vertex with the same position, quadrics are stored there
+        std::vector<uint32_t> remap;
+        // next vertex with the same position, a ring
+        std::vector<uint32_t> wedge;
+        std::vector<Quadric> quadrics;
+
+        Adjacency adjacency;
+        std::vector<uint8_t> kind;
+        // the other end of the vertex's outgoing and incoming open edge
+        std::vector<uint32_t> openNext;
+        std::vector<uint32_t> openPrev;
+
+        Simplifier(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+            : vertices(vertices), indices(indices), vertexCount(vertices.size()) {}
+
+        const glm::vec3& position(uint32_t v) const {
+            return vertices[v].Position;
+        }
+
+        void buildPositionRings() {
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0u);
+            auto less = [this](uint32_t a, uint32_t b) {
+                const glm::vec3& p = position(a);
+                const glm::vec3& q = position(b);
+                if (p.x != q.x) return p.x < q.x;
+                if (p.y != q.y) return p.y < q.y;
+                return p.z < q.z;
+            };
+            std::sort(order.begin(), order.end(), less);
+
+            remap.resize(vertexCount);
+            wedge.resize(vertexCount);
+            for (size_t i = 0; i < vertexCount;) {
+                size_t j = i + 1;
+                while (j < vertexCount && !less(order[i], order[j])) {
+                    j++;
+                }
+                for (size_t k = i; k < j; k++) {
+                    remap[order[k]] = order[i];
+                    wedge[order[k]] = order[k + 1 < j ? k + 1 : i];
+                }
+                i = j;
+            }
+        }
+
+        bool hasEdge(uint32_t a, uint32_t b) const {
+            for (uint32_t k = adjacency.offsets[a]; k < adjacency.offsets[a + 1]; k++) {
+                const unsigned int* triangle = &indices[adjacency.triangles[k] * 3];
+                for (int j = 0; j < 3; j++) {
+                    if (triangle[j] == a && triangle[(j + 1) % 3] == b) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /*
+         * find open edges (used by one triangle only) and classify every
+         * vertex. if <addBoundaryQuadrics>, also add a plane through each
+         * open edge, perpendicular to its triangle
+         */
+        void classify(bool addBoundaryQuadrics) {
+            adjacency.build(indices, vertexCount);
+            std::vector<uint32_t> openOut(vertexCount, 0), openIn(vertexCount, 0);
+            openNext.assign(vertexCount, NONE);
+            openPrev.assign(vertexCount, NONE);
+
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int j = 0; j < 3; j++) {
+                    uint32_t a = indices[i + j];
+                    uint32_t b = indices[i + (j + 1) % 3];
+                    if (hasEdge(b, a)) {
+                        continue;
+                    }
+                    openOut[a]++;
+                    openNext[a] = b;
+                    openIn[b]++;
+                    openPrev[b] = a;
+
+                    if (addBoundaryQuadrics) {
+                        const glm::vec3& p0 = position(indices[i]);
+                        glm::vec3 normal = glm::cross(position(indices[i + 1]) - p0, position(indices[i + 2]) - p0);
+                        glm::vec3 edge = position(b) - position(a);
+                        glm::vec3 perpendicular = glm::cross(edge, normal);
+                        float length = glm::length(perpendicular);
+                        if (length > 0.0f) {
+                            perpendicular = perpendicular / length;
+                            float d = -glm::dot(perpendicular, position(a));
+                            double weight = BOUNDARY_WEIGHT * glm::dot(edge, edge);
+                            quadrics[remap[a]].addPlane(perpendicular, d, weight);
+                            quadrics[remap[b]].addPlane(perpendicular, d, weight);
+                        }
+                    }
+                }
+            }
+
+            kind.assign(vertexCount, KIND_LOCKED);
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                bool simpleOpen = openOut[v] == 1 && openIn[v] == 1;
+                bool closed = openOut[v] == 0 && openIn[v] == 0;
+                if (wedge[v] == v) {
+                    if (closed) {
+                        kind[v] = KIND_MANIFOLD;
+                    } else if (simpleOpen) {
+                        kind[v] = KIND_BORDER;
+                    }
+                } else if (wedge[wedge[v]] == v && simpleOpen) {
+                    // two vertices on one position whose open edges run along each other
+                    uint32_t w = wedge[v];
+                    if (openOut[w] == 1 && openIn[w] == 1 &&
+                        remap[openNext[v]] == remap[openPrev[w]] &&
+                        remap[openPrev[v]] == remap[openNext[w]]) {
+                        kind[v] = KIND_SEAM;
+                    }
+                }
+            }
+        }
+
+        bool alongOpenEdge(uint32_t v, uint32_t t) const {
+            return t == openNext[v] || t == openPrev[v];
+        }
+
+        bool canCollapse(uint32_t v, uint32_t t) const {
+            switch (kind[v]) {
+                case KIND_MANIFOLD:
+                    return true;
+                case KIND_BORDER:
+                    return alongOpenEdge(v, t);
+                case KIND_SEAM:
+                    // the other side must have a matching edge to collapse along
+                    return alongOpenEdge(v, t) && kind[t] == KIND_SEAM && alongOpenEdge(wedge[v], wedge[t]);
+                default:
+                    return false;
+            }
+        }
+
+        double collapseError(uint32_t v, uint32_t t) const {
+            Quadric q = quadrics[remap[v]];
+            q.add(quadrics[remap[t]]);
+            return q.error(position(t));
+        }
+
+        /*
+         * true if moving <v> onto <t> turns a remaining triangle around or
+         * squashes it, looking at the collapses already made this pass
+         */
+        bool flips(uint32_t v, uint32_t t, const std::vector<uint32_t>& collapseTo) const {
+            for (uint32_t k = adjacency.offsets[v]; k < adjacency.offsets[v + 1]; k++) {
+                const unsigned int* triangle = &indices[adjacency.triangles[k] * 3];
+                uint32_t corners[3] = { collapseTo[triangle[0]], collapseTo[triangle[1]], collapseTo[triangle[2]] };
+                if (corners[0] == t || corners[1] == t || corners[2] == t) {
+                    continue;  // removed by the collapse
+                }
+                glm::vec3 p[3] = { position(corners[0]), position(corners[1]), position(corners[2]) };
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int j = 0; j < 3; j++) {
+                    if (corners[j] == v) {
+                        p[j] = position(t);
+                    }
+                }
+                glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                float lengths = glm::length(before) * glm::length(after);
+                if (glm::length(before) > 0.0f && glm::dot(before, after) <= FLIP_COSINE * lengths) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        size_t trianglesRemoved(uint32_t v, uint32_t t, const std::vector<uint32_t>& collapseTo) const {
+            size_t removed = 0;
+            for (uint32_t k = adjacency.offsets[v]; k < adjacency.offsets[v + 1]; k++) {
+                const unsigned int* triangle = &indices[adjacency.triangles[k] * 3];
+                for (int j = 0; j < 3; j++) {
+                    if (collapseTo[triangle[j]] == t) {
+                        removed++;
+                        break;
+                    }
+                }
+            }
+            return removed;
+        }
+
+        // one round of independent collapses, returns false if nothing could be collapsed
+        bool pass(size_t targetIndexCount, double errorLimit, double& maxError) {
+            classify(false);
+
+            std::vector<uint32_t> bestTarget(vertexCount, NONE);
+            std::vector<double> bestError(vertexCount, std::numeric_limits<double>::max());
+            auto consider = [&](uint32_t v, uint32_t t) {
+                if (!canCollapse(v, t)) {
+                    return;
+                }
+                double error = collapseError(v, t);
+                if (error < bestError[v]) {
+                    bestError[v] = error;
+                    bestTarget[v] = t;
+                }
+            };
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                for (int j = 0; j < 3; j++) {
+                    uint32_t a = indices[i + j];
+                    uint32_t b = indices[i + (j + 1) % 3];
+                    consider(a, b);
+                    consider(b, a);
+                }
+            }
+
+            std::vector<uint32_t> candidates;
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                if (bestTarget[v] != NONE && bestError[v] <= errorLimit) {
+                    candidates.push_back(v);
+                }
+            }
+            std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+                return bestError[a] < bestError[b];
+            });
+
+            // collapses in one pass must not share vertices, their errors would be stale
+            std::vector<uint32_t> collapseTo(vertexCount);
+            std::iota(collapseTo.begin(), collapseTo.end(), 0u);
+            std::vector<bool> locked(vertexCount, false);
+            size_t removeGoal = (indices.size() - targetIndexCount) / 3;
+            size_t removed = 0;
+            size_t collapses = 0;
+
+            for (uint32_t v : candidates) {
+                if (removed >= removeGoal) {
+                    break;
+                }
+                uint32_t t = bestTarget[v];
+                bool seam = kind[v] == KIND_SEAM;
+                uint32_t w = seam ? wedge[v] : v;
+                uint32_t wt = seam ? wedge[t] : t;
+                if (locked[v] || locked[t] || locked[w] || locked[wt]) {
+                    continue;
+                }
+                if (flips(v, t, collapseTo) || (seam && flips(w, wt, collapseTo))) {
+                    continue;
+                }
+
+                removed += trianglesRemoved(v, t, collapseTo);
+                collapseTo[v] = t;
+                if (seam) {
+                    removed += trianglesRemoved(w, wt, collapseTo);
+                    collapseTo[w] = wt;
+                }
+                locked[v] = locked[t] = locked[w] = locked[wt] = true;
+                quadrics[remap[t]].add(quadrics[remap[v]]);
+                maxError = std::max(maxError, bestError[v]);
+                collapses++;
+            }
+            if (collapses == 0) {
+                return false;
+            }
+
+            size_t write = 0;
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                unsigned int a = collapseTo[indices[i]];
+                unsigned int b = collapseTo[indices[i + 1]];
+                unsigned int c = collapseTo[indices[i + 2]];
+                if (a != b && b != c && a != c) {
+                    indices[write++] = a;
+                    indices[write++] = b;
+                    indices[write++] = c;
+                }
+            }
+            indices.resize(write);
+            return true;
+        }
+
+        void run(size_t targetIndexCount, double errorLimit, double& maxError) {
+            buildPositionRings();
+            quadrics.assign(vertexCount, Quadric());
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                const glm::vec3& p0 = position(indices[i]);
+                glm::vec3 normal = glm::cross(position(indices[i + 1]) - p0, position(indices[i + 2]) - p0);
+                float length = glm::length(normal);
+                if (length <= 0.0f) {
+                    continue;
+                }
+                normal = normal / length;
+                float d = -glm::dot(normal, p0);
+                double area = 0.5 * length;
+                for (int j = 0; j < 3; j++) {
+                    quadrics[remap[indices[i + j]]].addPlane(normal, d, area);
+                }
+            }
+            classify(true);
+
+            while (indices.size() > targetIndexCount && pass(targetIndexCount, errorLimit, maxError)) {
+            }
+        }
+    };
+
+} // namespace
+
+uint64_t LodSettings::hash() const {
+    // FNV-1a over the fields, feeds the mesh cache key
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(&maxLevels, sizeof(maxLevels));
+    mix(&reduction, sizeof(reduction));
+    mix(&targetError, sizeof(targetError));
+    mix(&minTriangles, sizeof(minTriangles));
+    return hash;
+}
+
+std::vector<unsigned int> MeshSimplifier::simplify(
+    const std::vector<Vertex>& vertices,
+    const std::vector<unsigned int>& indices,
+    size_t targetIndexCount,
+    float targetError,
+    float* resultError
+) {
+    Simplifier simplifier(vertices, indices);
+    double maxError = 0;
+    if (indices.size() > targetIndexCount && !vertices.empty()) {
+        double limit = double(targetError) * double(targetError);
+        simplifier.run(targetIndexCount / 3 * 3, limit, maxError);
+    }
+    if (resultError) {
+        *resultError = float(std::sqrt(maxError));
+    }
+    return std::move(simplifier.indices);
+}
+
+void MeshSimplifier::generateLods(MeshData& mesh, const LodSettings& settings) {
+    mesh.lods.clear();
+    mesh.lodIndices.clear();
+    if (!mesh.valid || settings.maxLevels == 0 || mesh.indices.size() / 3 < settings.minTriangles) {
+        return;
+    }
+
+    glm::vec3 lo = mesh.vertices[0].Position, hi = lo;
+    for (const Vertex& v : mesh.vertices) {
+        lo = glm::min(lo, v.Position);
+        hi = glm::max(hi, v.Position);
+    }
+    float radius = 0.5f * glm::length(hi - lo);
+    if (radius <= 0.0f) {
+        return;
+    }
+    float errorLimit = settings.targetError * radius;
+
+    size_t previousCount = mesh.indices.size();
+    float previousError = 0.0f;
+    for (uint32_t level = 1; level <= settings.maxLevels; level++) {
+        size_t target = size_t(float(previousCount / 3) * settings.reduction) * 3;
+        if (target < 3) {
+            break;
+        }
+        float error = 0.0f;
+        std::vector<unsigned int> lod = simplify(mesh.vertices, mesh.indices, target, errorLimit, &error);
+        // the error budget is spent, another level would barely save anything
+        if (lod.empty() || lod.size() * 10 > previousCount * 9) {
+            break;
+        }
+        MeshOptimizer::optimizeVertexCache(lod, mesh.vertices.size());
+
+        // coarser levels never claim to be more accurate than finer ones
+        error = std::max(error, previousError);
+        mesh.lods.push_back(MeshLod{ uint32_t(mesh.lodIndices.size()), uint32_t(lod.size()), error });
+        mesh.lodIndices.insert(mesh.lodIndices.end(), lod.begin(), lod.end());
+        previousCount = lod.size();
+        previousError = error;
+    }
+}
+
+} // namespace modeling
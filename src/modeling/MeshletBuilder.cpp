@@ -0,0 +1,260 @@
+#include "modeling/MeshletBuilder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace modeling {
+
+namespace {
+
+    const uint32_t NONE = ~0u;
+
+    /*
+     * cosine of the widest normal deviation a cone may have and still be
+     * culled for facing away, wider cones almost never are (~84 degrees)
+     */
+    const float MIN_CONE_COSINE = 0.1f;
+
+    // triangles using each vertex, in compressed row form
+    struct Adjacency {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        void build(const std::vector<unsigned int>& indices, size_t vertexCount) {
+            offsets.assign(vertexCount + 1, 0);
+            for (unsigned int index : indices) {
+                offsets[index + 1]++;
+            }
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+            triangles.resize(indices.size());
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++) {
+                triangles[fill[indices[i]]++] = uint32_t(i / 3);
+            }
+        }
+    };
+
+    glm::vec3 triangleNormal(const unsigned int* triangle, const std::vector<Vertex>& vertices) {
+        const glm::vec3& a = vertices[triangle[0]].Position;
+        return glm::cross(vertices[triangle[1]].Position - a, vertices[triangle[2]].Position - a);
+    }
+
+} // namespace
+
+size_t MeshletBuilder::build(MeshData& mesh) {
+    mesh.meshlets.clear();
+    if (!mesh.valid) {
+        return 0;
+    }
+    mesh.meshlets = build(mesh.indices, mesh.vertices);
+    return mesh.meshlets.size();
+}
+
+std::vector<Meshlet> MeshletBuilder::build(std::vector<unsigned int>& indices, const std::vector<Vertex>& vertices) {
+    std::vector<Meshlet> meshlets;
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return meshlets;
+    }
+
+    Adjacency adjacency;
+    adjacency.build(indices, vertices.size());
+    std::vector<bool> emitted(triangleCount, false);
+    // meshlet that last took each vertex, it is in the current meshlet if that matches
+    std::vector<uint32_t> owner(vertices.size(), NONE);
+    uint32_t current = 0;
+    // triangles of each vertex not emitted yet
+    std::vector<uint32_t> live(vertices.size());
+    for (size_t v = 0; v < vertices.size(); v++) {
+        live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+    }
+
+    std::vector<unsigned int> output;
+    output.reserve(triangleCount * 3);
+    std::vector<unsigned int> meshletVertices;
+    meshletVertices.reserve(MAX_VERTICES);
+    // vertices of the last closed meshlet, the next one starts next to it
+    std::vector<unsigned int> previousVertices;
+    glm::vec3 positionSum(0.0f);
+    size_t meshletStart = 0;
+
+    auto newVertices = [&](uint32_t triangle) {
+        uint32_t count = 0;
+        for (int j = 0; j < 3; j++) {
+            count += owner[indices[triangle * 3 + j]] != current;
+        }
+        return count;
+    };
+
+    auto emit = [&](uint32_t triangle) {
+        emitted[triangle] = true;
+        for (int j = 0; j < 3; j++) {
+            unsigned int v = indices[triangle * 3 + j];
+            output.push_back(v);
+            live[v]--;
+            if (owner[v] != current) {
+                owner[v] = current;
+                meshletVertices.push_back(v);
+                positionSum += vertices[v].Position;
+            }
+        }
+    };
+
+    auto close = [&]() {
+        Meshlet meshlet{};
+        meshlet.firstIndex = uint32_t(meshletStart);
+        meshlet.indexCount = uint32_t(output.size() - meshletStart);
+        meshlet.vertexCount = uint32_t(meshletVertices.size());
+        computeBounds(meshlet, output.data(), vertices);
+        meshlets.push_back(meshlet);
+
+        previousVertices.swap(meshletVertices);
+        meshletVertices.clear();
+        positionSum = glm::vec3(0.0f);
+        meshletStart = output.size();
+        current++;
+    };
+
+    size_t cursor = 0;
+    for (size_t done = 0; done < triangleCount;) {
+        uint32_t best = NONE;
+        if (meshletVertices.empty()) {
+            /*
+             * start next to the previous meshlet, on the triangle with the
+             * fewest neighbours left, so meshlets follow the edge of what is
+             * done and don't leave small pockets behind
+             */
+            uint32_t bestLive = ~0u;
+            for (unsigned int v : previousVertices) {
+                for (uint32_t k = adjacency.offsets[v]; k < adjacency.offsets[v + 1]; k++) {
+                    uint32_t triangle = adjacency.triangles[k];
+                    if (emitted[triangle]) {
+                        continue;
+                    }
+                    const unsigned int* corners = &indices[triangle * 3];
+                    uint32_t neighbours = live[corners[0]] + live[corners[1]] + live[corners[2]];
+                    if (neighbours < bestLive) {
+                        best = triangle;
+                        bestLive = neighbours;
+                    }
+                }
+            }
+            // otherwise the next triangle in input order, which the vertex cache pass left spatially coherent
+            if (best == NONE) {
+                while (emitted[cursor]) {
+                    cursor++;
+                }
+                best = uint32_t(cursor);
+            }
+        } else {
+            /*
+             * fewest new vertices first, then triangles that finish off a
+             * vertex (they would otherwise be left as slivers), then the
+             * closest to the center
+             */
+            glm::vec3 center = positionSum / float(meshletVertices.size());
+            uint32_t bestNew = 4;
+            uint32_t bestFinished = 0;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (unsigned int v : meshletVertices) {
+                for (uint32_t k = adjacency.offsets[v]; k < adjacency.offsets[v + 1]; k++) {
+                    uint32_t triangle = adjacency.triangles[k];
+                    if (emitted[triangle]) {
+                        continue;
+                    }
+                    uint32_t added = newVertices(triangle);
+                    if (meshletVertices.size() + added > MAX_VERTICES || added > bestNew) {
+                        continue;
+                    }
+                    const unsigned int* corners = &indices[triangle * 3];
+                    uint32_t finished = (live[corners[0]] == 1) + (live[corners[1]] == 1) + (live[corners[2]] == 1);
+                    if (added == bestNew && finished < bestFinished) {
+                        continue;
+                    }
+                    glm::vec3 offset = (vertices[corners[0]].Position + vertices[corners[1]].Position +
+                                        vertices[corners[2]].Position) / 3.0f - center;
+                    float distance = glm::dot(offset, offset);
+                    if (added < bestNew || finished > bestFinished || distance < bestDistance) {
+                        best = triangle;
+                        bestNew = added;
+                        bestFinished = finished;
+                        bestDistance = distance;
+                    }
+                }
+            }
+            if (best == NONE) {
+                // nothing connected fits, the rest of this part goes into the next meshlet
+                close();
+                continue;
+            }
+        }
+
+        emit(best);
+        done++;
+        if (output.size() - meshletStart == MAX_TRIANGLES * 3) {
+            close();
+        }
+    }
+    if (!meshletVertices.empty()) {
+        close();
+    }
+
+    indices.swap(output);
+    return meshlets;
+}
+
+void MeshletBuilder::computeBounds(Meshlet& meshlet, const unsigned int* indices, const std::vector<Vertex>& vertices) {
+    const unsigned int* begin = indices + meshlet.firstIndex;
+    const unsigned int* end = begin + meshlet.indexCount;
+    meshlet.center = glm::vec3(0.0f);
+    meshlet.radius = 0.0f;
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    if (begin == end) {
+        return;
+    }
+
+    // sphere around the bounding box, cheap and within a few percent of the minimal one for compact meshlets
+    glm::vec3 lo = vertices[*begin].Position, hi = lo;
+    for (const unsigned int* i = begin; i != end; i++) {
+        lo = glm::min(lo, vertices[*i].Position);
+        hi = glm::max(hi, vertices[*i].Position);
+    }
+    meshlet.center = (lo + hi) * 0.5f;
+    for (const unsigned int* i = begin; i != end; i++) {
+        meshlet.radius = std::max(meshlet.radius, glm::length(vertices[*i].Position - meshlet.center));
+    }
+
+    // cone around the mean of the unit normals, degenerate triangles face nowhere and are ignored
+    glm::vec3 axis(0.0f);
+    for (const unsigned int* t = begin; t + 2 < end; t += 3) {
+        glm::vec3 normal = triangleNormal(t, vertices);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            axis += normal / length;
+        }
+    }
+    float axisLength = glm::length(axis);
+    if (axisLength <= 0.0f) {
+        return;
+    }
+    axis = axis / axisLength;
+
+    float minCosine = 1.0f;
+    for (const unsigned int* t = begin; t + 2 < end; t += 3) {
+        glm::vec3 normal = triangleNormal(t, vertices);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            minCosine = std::min(minCosine, glm::dot(normal, axis) / length);
+        }
+    }
+    meshlet.coneAxis = axis;
+    if (minCosine > MIN_CONE_COSINE) {
+        // back facing wherever the view direction is within 90 degrees minus the cone angle of the axis
+        meshlet.coneCutoff = std::sqrt(1.0f - minCosine * minCosine);
+    }
+}
+
+} // namespace modeling
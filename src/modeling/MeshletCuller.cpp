@@ -0,0 +1,71 @@
+#include "modeling/MeshletCuller.hpp"
+
+#include <cmath>
+
+namespace modeling {
+
+size_t MeshletCuller::cull(const Meshlet* meshlets, size_t count, const Frustum& frustum, const glm::vec3& eye,
+                           std::vector<uint32_t>& visible) {
+    visible.clear();
+    for (size_t i = 0; i < count; i++) {
+        const Meshlet& meshlet = meshlets[i];
+        if (!frustum.intersectsSphere(meshlet.center, meshlet.radius) || isBackFacing(meshlet, eye)) {
+            continue;
+        }
+        visible.push_back(uint32_t(i));
+    }
+    return visible.size();
+}
+
+bool MeshletCuller::isBackFacing(const Meshlet& meshlet, const glm::vec3& eye) {
+    if (meshlet.coneCutoff >= 1.0f) {
+        return false;
+    }
+    /*
+     * every point p of the sphere must see the cone from behind:
+     * dot(p - eye, axis) >= cutoff * |p - eye|. moving from the center
+     * to p changes the left side by at most radius and the right side by
+     * at most cutoff * radius
+     */
+    glm::vec3 view = meshlet.center - eye;
+    float distance = glm::length(view);
+    return glm::dot(view, meshlet.coneAxis) >= meshlet.coneCutoff * distance + meshlet.radius * (1.0f + meshlet.coneCutoff);
+}
+
+void MeshletCuller::buildDrawList(const Meshlet* meshlets, size_t indexSize, MeshletDrawList& list,
+                                  uint32_t firstIndex, int baseVertex) {
+    list.counts.clear();
+    list.offsets.clear();
+    list.baseVertices.clear();
+    list.triangleCount = 0;
+
+    uint32_t first = 0, end = 0;
+    auto flush = [&]() {
+        if (end > first) {
+            list.counts.push_back(int(end - first));
+            list.offsets.push_back(reinterpret_cast<const void*>((uintptr_t(firstIndex) + first) * indexSize));
+            list.baseVertices.push_back(baseVertex);
+        }
+    };
+    for (uint32_t i : list.visible) {
+        const Meshlet& meshlet = meshlets[i];
+        list.triangleCount += meshlet.indexCount / 3;
+        if (meshlet.firstIndex != end) {
+            flush();
+            first = meshlet.firstIndex;
+        }
+        end = meshlet.firstIndex + meshlet.indexCount;
+    }
+    flush();
+}
+
+void MeshletCuller::compactIndices(const unsigned int* indices, const Meshlet* meshlets,
+                                   const std::vector<uint32_t>& visible, std::vector<unsigned int>& output) {
+    output.clear();
+    for (uint32_t i : visible) {
+        const unsigned int* begin = indices + meshlets[i].firstIndex;
+        output.insert(output.end(), begin, begin + meshlets[i].indexCount);
+    }
+}
+
+} // namespace modeling
@@ -1,3 +1,5 @@
+#include <glad/glad.h>
+
 #include "modeling/Model.hpp"
 
 using namespace modeling;
@@ -7,32 +9,104 @@ Model::Model() {
 }
 
 Model::Model(std::vector<std::shared_ptr<Mesh>> meshes, std::vector<std::shared_ptr<Material>> mats, std::shared_ptr<Shader> shader)
-    : meshes(meshes), materials(mats), shader(shader) {
+    : meshes(std::move(meshes)), materials(std::move(mats)), shader(std::move(shader)) {
     // All members initialized in initializer list
 }
 
 Model::~Model() {
     // Vectors will automatically clean up their contents
     // No explicit cleanup needed for Mesh and Material objects
+    if (instanceBuffer != 0) {
+        glDeleteBuffers(1, &instanceBuffer);
+    }
 }
 
-std::vector<std::shared_ptr<Mesh>> Model::getMeshes() const {
+Span<const std::shared_ptr<Mesh>> Model::getMeshes() const {
     return meshes;
 }
 
-std::vector<std::shared_ptr<Material>> Model::getMaterials() const {
+Span<const std::shared_ptr<Material>> Model::getMaterials() const {
     return materials;
 }
 
 void Model::addMesh(std::shared_ptr<Mesh> mesh, std::shared_ptr<Material> material) {
-    meshes.push_back(mesh);
-    materials.push_back(material);
+    meshes.push_back(std::move(mesh));
+    materials.push_back(std::move(material));
+}
+
+bool Model::getBounds(glm::vec3& min, glm::vec3& max) const {
+    bool found = false;
+    for (const auto& mesh : meshes) {
+        if (!mesh) {
+            continue;
+        }
+        min = found ? glm::min(min, mesh->getBoundsMin()) : mesh->getBoundsMin();
+        max = found ? glm::max(max, mesh->getBoundsMax()) : mesh->getBoundsMax();
+        found = true;
+    }
+    return found;
+}
+
+void Model::addInstance(const glm::mat4& transform) {
+    instances.push_back(transform);
+}
+
+Span<const glm::mat4> Model::getInstances() const {
+    return instances;
+}
+
+size_t Model::getInstanceCount() const {
+    return instances.size();
+}
+
+void Model::uploadInstances() {
+    if (instances.empty()) {
+        return;
+    }
+    if (instanceBuffer == 0) {
+        glGenBuffers(1, &instanceBuffer);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::mat4), instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+bool Model::bindInstances() const {
+    if (instanceBuffer == 0) {
+        return false;
+    }
+    // a mat4 attribute takes four locations, one column each
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint column = 0; column < 4; column++) {
+        glEnableVertexAttribArray(6 + column);
+        glVertexAttribPointer(6 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void*)(column * sizeof(glm::vec4)));
+        glVertexAttribDivisor(6 + column, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void Model::unbindInstances() {
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribDivisor(6 + column, 0);
+        glDisableVertexAttribArray(6 + column);
+    }
+    // the current values are undefined after drawing from the arrays
+    glVertexAttrib4f(6, 1.f, 0.f, 0.f, 0.f);
+    glVertexAttrib4f(7, 0.f, 1.f, 0.f, 0.f);
+    glVertexAttrib4f(8, 0.f, 0.f, 1.f, 0.f);
+    glVertexAttrib4f(9, 0.f, 0.f, 0.f, 1.f);
 }
 
 std::shared_ptr<Shader> Model::getShader() {
     return shader;
 }
 
+void Model::setShader(std::shared_ptr<Shader> shader) {
+    this->shader = std::move(shader);
+}
+
 void Model::setupForRendering() {
     if (shader) {
         shader->bind();
@@ -1,13 +1,76 @@
 #include "modeling/ModelLoader.hpp"
-#include "shared/Logger.hpp"
+#include "modeling/MeshOptimizer.hpp"
+#include "modeling/MeshletBuilder.hpp"
+#include "modeling/TextureLoader.hpp"
+#include "modeling/TextureUploader.hpp"
+#include "utils/Logger.hpp"
+#include "utils/ThreadPool.hpp"
+#include <assimp/ProgressHandler.hpp>
+#include <algorithm>
+#include <atomic>
 #include <filesystem>
 #include <iostream>
+#include <mutex>
 // commented out to avoid compile errors
 // [    (bool ModelLoader::processMesh(aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)).
 // (std::shared_ptr<Material> ModelLoader::processMaterial(aiMaterial* aiMat, const aiScene* scene))]
 
 namespace modeling {
 
+    namespace {
+        // Configure import settings for optimal loading
+        const unsigned int IMPORT_FLAGS = 
+            aiProcess_Triangulate |           // Convert all faces to triangles
+            aiProcess_FlipUVs |              // Flip texture coordinates (OpenGL convention)
+            aiProcess_GenSmoothNormals |     // Generate smooth normals if missing
+            aiProcess_CalcTangentSpace |     // Calculate tangent space for normal mapping
+            aiProcess_JoinIdenticalVertices | // Remove duplicate vertices
+            aiProcess_OptimizeMeshes |       // Optimize mesh data
+            aiProcess_ValidateDataStructure;  // Validate the imported data
+            // no aiProcess_ImproveCacheLocality, MeshOptimizer reorders triangles after conversion
+
+        std::atomic<bool> meshCacheEnabled{true};
+
+        // preferred GPU vertex layout, each mesh falls back if it can't use it
+        std::atomic<VertexFormat> vertexFormat{VertexFormat::QUANTIZED};
+
+        std::atomic<bool> keepCpuData{true};
+
+        std::mutex lodSettingsMutex;
+        LodSettings lodSettings;
+
+        // share of the import progress reported while Assimp reads the file,
+        // the rest covers mesh conversion and material loading
+        const float READ_PROGRESS = 0.7f;
+
+        // forwards Assimp's read progress to an ImportProgress callback
+        class ImportProgressHandler : public Assimp::ProgressHandler {
+        public:
+            explicit ImportProgressHandler(ImportProgress progress) : progress(std::move(progress)) {}
+
+            bool Update(float percentage) override {
+                if (percentage < 0.0f) {
+                    return progress(0.0f);
+                }
+                return progress(std::min(percentage, 1.0f) * READ_PROGRESS);
+            }
+
+        private:
+            ImportProgress progress;
+        };
+
+        // aiMatrix4x4 is row major, glm column major
+        glm::mat4 toMat4(const aiMatrix4x4& m) {
+            glm::mat4 result;
+            for (int row = 0; row < 4; row++) {
+                for (int column = 0; column < 4; column++) {
+                    result[column][row] = m[row][column];
+                }
+            }
+            return result;
+        }
+    }
+
 
         /**
          * Main loading function
@@ -16,74 +79,324 @@ namespace modeling {
     std::vector<std::shared_ptr<Model>> ModelLoader::loadModels(
         const std::string& filePath, 
         std::shared_ptr<Shader> shader
+    ) {
+        std::unique_ptr<ImportedScene> imported = importScene(filePath);
+        if (!imported) {
+            return {};
+        }
+        return finalizeScene(*imported, shader);
+    }
+
+    std::unique_ptr<ImportedScene> ModelLoader::importScene(
+        const std::string& filePath,
+        ImportProgress progress
     ) {
         LOG_INFO_F("Loading models from file: %s", filePath.c_str());
         
-        // Create Assimp importer
-        Assimp::Importer importer;
+        if (!progress) {
+            progress = [](float) { return true; };
+        }
+        
+        auto imported = std::make_unique<ImportedScene>();
+        imported->filePath = filePath;
         
-        // Configure import settings for optimal loading
-        unsigned int importFlags = 
-            aiProcess_Triangulate |           // Convert all faces to triangles
-            aiProcess_FlipUVs |              // Flip texture coordinates (OpenGL convention)
-            aiProcess_GenSmoothNormals |     // Generate smooth normals if missing
-            aiProcess_CalcTangentSpace |     // Calculate tangent space for normal mapping
-            aiProcess_JoinIdenticalVertices | // Remove duplicate vertices
-            aiProcess_OptimizeMeshes |       // Optimize mesh data
-            aiProcess_ValidateDataStructure | // Validate the imported data
-            aiProcess_ImproveCacheLocality;  // Use Cache
+        // Use the cooked cache if it was made from this exact file and flags
+        bool useCache = meshCacheEnabled.load();
+        const LodSettings lods = getLodSettings();
+        MeshCacheKey cacheKey;
+        std::string cachePath;
+        if (useCache) {
+            cacheKey = MeshCache::computeKey(filePath, IMPORT_FLAGS);
+            cacheKey.optionsHash = lods.hash();
+            cachePath = MeshCache::cachePathFor(filePath);
+            if (cacheKey.sourceStamp != 0) {
+                imported->cache = MeshCache::open(cachePath, cacheKey);
+                if (!imported->cache) {
+                    // the file may only have been touched, compare contents before re-importing
+                    cacheKey.sourceHash = MeshCache::hashSource(filePath);
+                    imported->cache = MeshCache::open(cachePath, cacheKey);
+                    if (imported->cache) {
+                        MeshCache::restamp(cachePath, cacheKey);
+                    }
+                }
+                if (imported->cache) {
+                    // textures are not cooked, decode them here rather than on the GL thread
+                    imported->materialSources = imported->cache->getMaterials();
+                    imported->materials = loadMaterials(imported->materialSources, nullptr, imported->textures);
+                    imported->extensions = imported->cache->getExtensions();
+                    progress(1.0f);
+                    return imported;
+                }
+            }
+        }
+        
+        imported->importer = std::make_unique<Assimp::Importer>();
+        // the importer takes ownership of the handler
+        imported->importer->SetProgressHandler(new ImportProgressHandler(progress));
         
         // Load the scene
-        const aiScene* scene = importer.ReadFile(filePath, importFlags);
+        const aiScene* scene = imported->importer->ReadFile(filePath, IMPORT_FLAGS);
         
         // Validate the loaded scene
+        if (!progress(READ_PROGRESS)) {
+            LOG_INFO_F("Import of {} was aborted", filePath);
+            return nullptr;
+        }
         if (!validateScene(scene)) {
             LOG_ERROR_F("Failed to load model from file: %s", filePath.c_str());
-            LOG_ERROR_F("Assimp error: %s", importer.GetErrorString());
-            return {};
+            LOG_ERROR_F("Assimp error: {}", imported->importer->GetErrorString());
+            return nullptr;
         }
+        imported->scene = scene;
         
         LOG_INFO_F("Successfully loaded scene with %d meshes, %d materials", 
                 scene->mNumMeshes, scene->mNumMaterials);
         
-        // Process the scene and return models
-        return processScene(scene, shader);
+        // Convert all meshes to engine buffers, in parallel
+        imported->meshes = convertMeshes(scene, lods);
+        if (!progress(0.9f)) {
+            LOG_INFO_F("Import of {} was aborted", filePath);
+            return nullptr;
+        }
+        
+        // Load all materials, decoding their textures in parallel
+        imported->materialSources = describeMaterials(scene, getDirectoryPath(filePath));
+        imported->materials = loadMaterials(imported->materialSources, scene, imported->textures);
+        LOG_INFO_F("Loaded {} materials, {} textures", imported->materials.size(), imported->textures.size());
+        
+        // Load GLTF extensions
+        imported->extensions = loadGLTFExtensions(scene);
+        LOG_INFO_F("Loaded {} GLTF extensions", imported->extensions.size());
+        
+        // Cook the conversion result so the next run can skip Assimp entirely.
+        // Embedded textures only exist inside the aiScene, so those scenes aren't cached.
+        bool embeddedTextures = std::any_of(imported->materialSources.begin(), imported->materialSources.end(),
+            [](const MaterialSource& source) { return source.hasEmbeddedTextures(); });
+        if (useCache && cacheKey.sourceStamp != 0 && cacheKey.sourceHash != 0 && !embeddedTextures) {
+            std::vector<uint32_t> modelMeshes;
+            std::vector<glm::mat4> modelTransforms;
+            collectModelMeshes(scene->mRootNode, glm::mat4(1.0f), modelMeshes, modelTransforms);
+            MeshCache::write(cachePath, cacheKey, imported->meshes, imported->materialSources,
+                             modelMeshes, modelTransforms, imported->extensions);
+        }
+        
+        progress(1.0f);
+        return imported;
     }
 
-    std::vector<std::shared_ptr<Model>> ModelLoader::processScene(
-        const aiScene* scene, 
-        std::shared_ptr<Shader> shader
+    void ModelLoader::setMeshCacheEnabled(bool enabled) {
+        meshCacheEnabled = enabled;
+    }
+
+    void ModelLoader::setVertexFormat(VertexFormat format) {
+        vertexFormat = format;
+    }
+
+    void ModelLoader::setKeepCpuData(bool keep) {
+        keepCpuData = keep;
+    }
+
+    void ModelLoader::setLodSettings(const LodSettings& settings) {
+        std::lock_guard<std::mutex> lock(lodSettingsMutex);
+        lodSettings = settings;
+    }
+
+    LodSettings ModelLoader::getLodSettings() {
+        std::lock_guard<std::mutex> lock(lodSettingsMutex);
+        return lodSettings;
+    }
+
+    void ModelLoader::collectModelMeshes(
+        const aiNode* node,
+        const glm::mat4& parentTransform,
+        std::vector<uint32_t>& modelMeshes,
+        std::vector<glm::mat4>& modelTransforms
+    ) {
+        // mirrors the traversal order of processNode
+        glm::mat4 transform = parentTransform * toMat4(node->mTransformation);
+        for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+            modelMeshes.push_back(node->mMeshes[i]);
+            modelTransforms.push_back(transform);
+        }
+        for (unsigned int i = 0; i < node->mNumChildren; i++) {
+            collectModelMeshes(node->mChildren[i], transform, modelMeshes, modelTransforms);
+        }
+    }
+
+    std::vector<std::shared_ptr<Model>> ModelLoader::finalizeCachedScene(
+        ImportedScene& imported,
+        std::shared_ptr<Shader> shader,
+        TextureUploader* uploader
     ) {
-        LOG_DEBUG("Processing scene...");
+        const MeshCache& cache = *imported.cache;
+        const std::vector<std::shared_ptr<Material>>& materials = imported.materials;
+        
+        // Upload straight from the mapped file, no parsing or conversion.
+        // Meshes keeping CPU data view the mapping, which stays alive with them.
+        bool setupGL = (shader != nullptr);
+        bool keepCpu = !setupGL || keepCpuData.load();
+        if (setupGL) {
+            uploadTextures(imported, uploader);
+        }
+        std::vector<std::shared_ptr<Mesh>> meshes(cache.getMeshCount());
+        for (size_t i = 0; i < cache.getMeshCount(); i++) {
+            const MeshView& view = cache.getMesh(i);
+            if (view.vertexCount == 0) {
+                continue; // mesh failed to convert when the cache was cooked
+            }
+            try {
+                meshes[i] = std::make_shared<Mesh>(view.vertices, view.vertexCount,
+                                                   view.indices, view.indexCount, setupGL,
+                                                   keepCpu, vertexFormat.load(),
+                                                   view.lods, imported.cache);
+                meshes[i]->setMeshlets(view.meshlets, view.meshletCount);
+            } catch (const std::exception& e) {
+                LOG_ERROR_F("Failed to create Mesh object: {}", e.what());
+            }
+        }
         
+        // one model per mesh, every further reference is another instance of it
         std::vector<std::shared_ptr<Model>> models;
+        std::vector<std::shared_ptr<Model>> meshModels(meshes.size());
+        const std::vector<uint32_t>& modelMeshes = cache.getModelMeshes();
+        const std::vector<glm::mat4>& modelTransforms = cache.getModelTransforms();
+        for (size_t i = 0; i < modelMeshes.size(); i++) {
+            uint32_t meshIndex = modelMeshes[i];
+            if (!meshes[meshIndex]) {
+                continue;
+            }
+            std::shared_ptr<Model>& model = meshModels[meshIndex];
+            if (!model) {
+                uint32_t materialIndex = cache.getMesh(meshIndex).materialIndex;
+                std::shared_ptr<Material> material = materialIndex < materials.size() ? materials[materialIndex] : nullptr;
+                model = std::make_shared<Model>(
+                    std::vector<std::shared_ptr<Mesh>>{ meshes[meshIndex] },
+                    std::vector<std::shared_ptr<Material>>{ material },
+                    shader);
+                models.push_back(model);
+            }
+            model->addInstance(modelTransforms[i]);
+        }
+        if (setupGL) {
+            for (auto& model : models) {
+                model->uploadInstances();
+            }
+        }
         
-        // Load all materials first
-        std::vector<std::shared_ptr<Material>> materials = loadMaterials(scene);
-        LOG_INFO_F("Loaded %d materials", static_cast<int>(materials.size()));
+        // stored in the cache, the aiScene they came from isn't loaded
+        for (auto& model : models) {
+            applyGLTFExtensions(model, imported.extensions);
+        }
         
-        // Load GLTF extensions
-        std::unordered_map<std::string, PropertyValue> gltfExtensions = loadGLTFExtensions(scene);
-        LOG_INFO_F("Loaded %d GLTF extensions", static_cast<int>(gltfExtensions.size()));
+        LOG_INFO_F("Successfully loaded {} models from mesh cache", models.size());
+        return models;
+    }
+
+    std::vector<std::shared_ptr<Model>> ModelLoader::finalizeScene(
+        ImportedScene& imported,
+        std::shared_ptr<Shader> shader,
+        TextureUploader* uploader
+    ) {
+        LOG_DEBUG("Finalizing scene...");
+        
+        // the samplers read the units RenderQueue binds material textures to
+        if (shader && shader->getProgram() != 0) {
+            Material::setSamplers(*shader);
+        }
+        
+        if (imported.cache) {
+            return finalizeCachedScene(imported, shader, uploader);
+        }
+        
+        const aiScene* scene = imported.scene;
+        std::vector<std::shared_ptr<Model>> models;
+        
+        // Upload every mesh once, in one batch on this thread.
+        // Nodes referencing the same aiMesh share the resulting Mesh.
+        bool setupGL = (shader != nullptr);
+        if (setupGL) {
+            uploadTextures(imported, uploader);
+        }
+        std::vector<std::shared_ptr<Mesh>> meshes(imported.meshes.size());
+        for (size_t i = 0; i < imported.meshes.size(); i++) {
+            meshes[i] = uploadMesh(imported.meshes[i], setupGL);
+        }
         
         // Process the root node recursively
         if (scene->mRootNode) {
-            processNode(scene->mRootNode, scene, models, materials, shader);
+            std::vector<std::shared_ptr<Model>> meshModels(meshes.size());
+            processNode(scene->mRootNode, scene, glm::mat4(1.0f), models, meshModels,
+                        meshes, imported.materials, shader);
+        }
+        if (setupGL) {
+            for (auto& model : models) {
+                model->uploadInstances();
+            }
         }
         
         // Apply GLTF extensions to all models
         for (auto& model : models) {
-            applyGLTFExtensions(model, gltfExtensions);
+            applyGLTFExtensions(model, imported.extensions);
         }
         
         LOG_INFO_F("Successfully processed scene into %d models", static_cast<int>(models.size()));
         return models;
     }
 
+    std::vector<std::shared_ptr<Model>> ModelLoader::finalizeScene(
+        ImportedScene& imported,
+        std::shared_ptr<ShaderVariants> variants,
+        TextureUploader* uploader
+    ) {
+        Shader* fallback = variants ? variants->get({}) : nullptr;
+        if (!fallback) {
+            LOG_ERROR_F("No default shader variant to finalize {} with", imported.filePath);
+            return {};
+        }
+        // the shaders live as long as <variants>
+        std::vector<std::shared_ptr<Model>> models =
+            finalizeScene(imported, std::shared_ptr<Shader>(variants, fallback), uploader);
+        
+        // one variant per material, the samplers set once per scene like the fallback's
+        std::unordered_map<const Material*, std::shared_ptr<Shader>> shaders;
+        for (size_t i = 0; i < imported.materials.size() && i < imported.materialSources.size(); i++) {
+            Shader* variant = variants->get(materialDefines(imported.materialSources[i]));
+            if (!variant) {
+                continue;
+            }
+            if (variant != fallback) {
+                Material::setSamplers(*variant);
+            }
+            shaders[imported.materials[i].get()] = std::shared_ptr<Shader>(variants, variant);
+        }
+        for (auto& model : models) {
+            Span<const std::shared_ptr<Material>> materials = model->getMaterials();
+            auto found = materials.size() > 0 ? shaders.find(materials[0].get()) : shaders.end();
+            if (found != shaders.end()) {
+                model->setShader(found->second);
+            }
+        }
+        return models;
+    }
+
+    ShaderVariants::Defines ModelLoader::materialDefines(const MaterialSource& source) {
+        ShaderVariants::Defines defines;
+        if (!source.textures[TEXTURE_NORMAL].empty()) {
+            defines.push_back("NORMAL_MAP");
+        }
+        if (source.unlit) {
+            defines.push_back("UNLIT");
+        }
+        return defines;
+    }
+
     void ModelLoader::processNode(
         aiNode* node, 
         const aiScene* scene,
+        const glm::mat4& parentTransform,
         std::vector<std::shared_ptr<Model>>& models,
+        std::vector<std::shared_ptr<Model>>& meshModels,
+        const std::vector<std::shared_ptr<Mesh>>& meshes,
         const std::vector<std::shared_ptr<Material>>& materials,
         std::shared_ptr<Shader> shader
     ) {
@@ -94,15 +407,21 @@ namespace modeling {
         std::unordered_map<std::string, PropertyValue> nodeExtensions;
         processGLTFNode(node, scene, nodeExtensions);
         
+        glm::mat4 transform = parentTransform * toMat4(node->mTransformation);
+        
         // Process all meshes in this node
         for (unsigned int i = 0; i < node->mNumMeshes; i++) {
             unsigned int meshIndex = node->mMeshes[i];
             aiMesh* assimpMesh = scene->mMeshes[meshIndex];
             
-            // Load mesh data 
-            std::shared_ptr<Mesh> mesh = loadMeshFromNode(assimpMesh, scene, shader);
+            // Mesh was already converted and uploaded by finalizeScene
+            std::shared_ptr<Mesh> mesh = meshes[meshIndex];
             
-            if (mesh) {
+            if (mesh && meshModels[meshIndex]) {
+                // Mesh already has a model from another node, draw it here too
+                meshModels[meshIndex]->addInstance(transform);
+                LOG_DEBUG_F("Instanced mesh: {}", assimpMesh->mName.C_Str());
+            } else if (mesh) {
                 // Get the material for this mesh
                 std::shared_ptr<Material> material = nullptr;
                 if (assimpMesh->mMaterialIndex < materials.size()) {
@@ -110,10 +429,12 @@ namespace modeling {
                 }
                 
                 // Create a new model for this mesh
-                std::vector<std::shared_ptr<Mesh>> meshes = { mesh };
+                std::vector<std::shared_ptr<Mesh>> modelMeshes = { mesh };
                 std::vector<std::shared_ptr<Material>> modelMaterials = { material };
                 
-                auto model = std::make_shared<Model>(meshes, modelMaterials, shader);
+                auto model = std::make_shared<Model>(modelMeshes, modelMaterials, shader);
+                model->addInstance(transform);
+                meshModels[meshIndex] = model;
                 
                 // Apply node-specific GLTF extensions
                 applyGLTFExtensions(model, nodeExtensions);
@@ -128,7 +449,7 @@ namespace modeling {
         
         // Recursively process child nodes
         for (unsigned int i = 0; i < node->mNumChildren; i++) {
-            processNode(node->mChildren[i], scene, models, materials, shader);
+            processNode(node->mChildren[i], scene, transform, models, meshModels, meshes, materials, shader);
         }
     }
 
@@ -162,24 +483,58 @@ namespace modeling {
         return true;
     }
 
-    // TODO: Mesh loader 
-
-    std::shared_ptr<Mesh> ModelLoader::loadMeshFromNode(aiMesh* mesh, const aiScene* scene, std::shared_ptr<Shader> shader) {
-        LOG_DEBUG_F("Loading mesh: %s", mesh->mName.C_Str());
+    std::vector<MeshData> ModelLoader::convertMeshes(const aiScene* scene, const LodSettings& lodSettings) {
+        std::vector<MeshData> meshes(scene->mNumMeshes);
+        
+        // Each task only writes its own MeshData slot
+        ThreadPool::shared().parallelFor(meshes.size(), [&](size_t i) {
+            aiMesh* mesh = scene->mMeshes[i];
+            MeshData& data = meshes[i];
+            data.name = mesh->mName.C_Str();
+            data.materialIndex = mesh->mMaterialIndex;
+            data.valid = processMesh(mesh, data.vertices, data.indices);
+            if (!data.valid) {
+                LOG_ERROR_F("Failed to process mesh: {}", data.name);
+                return;
+            }
 
-        std::vector<Vertex> vertices;
-        std::vector<unsigned int> indices;
+            // done once per asset, the optimized order is what goes into the mesh cache.
+            // meshlets grow along the Tipsify order, then regroup the triangles, so the
+            // cache and overdraw passes run again within and between the meshlets
+            MeshOptimizationStats stats = MeshOptimizer::optimize(data);
+            size_t meshletCount = MeshletBuilder::build(data);
+            MeshOptimizer::optimizeMeshlets(data);
+            stats.after = MeshOptimizer::analyzeVertexCache(data.indices.data(), data.indices.size(),
+                                                            data.vertices.size());
+            LOG_DEBUG_F("Mesh {} optimized: ACMR {} -> {}, ATVR {} -> {}, {} unused vertices dropped, {} meshlets",
+                        data.name, stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr,
+                        stats.unusedVertices, meshletCount);
+
+            MeshSimplifier::generateLods(data, lodSettings);
+            if (!data.lods.empty()) {
+                LOG_DEBUG_F("Mesh {}: {} LODs, coarsest {} triangles with error {}", data.name, data.lods.size(),
+                            data.lods.back().indexCount / 3, data.lods.back().error);
+            }
+        });
+        
+        return meshes;
+    }
 
-        // Call the mesh processing function
-        if (!processMesh(mesh, vertices, indices)) {
-            LOG_ERROR_F("Failed to process mesh: %s", mesh->mName.C_Str());
+    std::shared_ptr<Mesh> ModelLoader::uploadMesh(MeshData& data, bool setupGL) {
+        if (!data.valid) {
             return nullptr;
         }
+        LOG_DEBUG_F("Uploading mesh: {}", data.name);
 
         // Create and return the Mesh object
         try {
-            bool setupGL = (shader != nullptr);
-            return std::make_shared<Mesh>(vertices, indices, setupGL);
+            auto mesh = std::make_shared<Mesh>(std::move(data.vertices), std::move(data.indices), setupGL,
+                                               vertexFormat.load(), data.lodView());
+            mesh->setMeshlets(data.meshlets.data(), data.meshlets.size());
+            if (!keepCpuData) {
+                mesh->releaseCpuData();
+            }
+            return mesh;
         } catch (const std::exception& e) {
             LOG_ERROR_F("Failed to create Mesh object: %s", e.what());
             return nullptr;
@@ -209,7 +564,6 @@ namespace modeling {
         *    - Ensure we have at least some vertices
         *
         */
-    Vertex v; /* vertices */
     unsigned int idx; /* indices */
     unsigned int nvertices = mesh->mNumVertices;
     unsigned int nfaces = mesh->mNumFaces;
@@ -228,9 +582,13 @@ namespace modeling {
 			return false;
 		}
 
-		/* fetch vertex/normal/UV data */
-		vertices.reserve(nvertices); // allocate space early, quick optimization
+		/*
+		 * fetch vertex/normal/UV data, written in place.
+		 * no per-vertex logging here, this loop is hot for large meshes
+		 */
+		vertices.resize(nvertices);
 		for (unsigned int i=0; i<nvertices; i++) {
+			Vertex &v = vertices[i];
 			v.Position.x=mesh->mVertices[i].x;
 			v.Position.y=mesh->mVertices[i].y;
 			v.Position.z=mesh->mVertices[i].z;
@@ -268,18 +626,29 @@ namespace modeling {
 				v.TexCoords.y=0;
 			}
 
-			vertices.push_back(v);
-			LOG_DEBUG_F("vertex {}: <{},{},{}>, UV=({}, {}), normal <{},{},{}>",i,
-					v.Position.x,v.Position.y,v.Position.z,
-					v.TexCoords.x,v.TexCoords.y,
-					v.Normal.x,v.Normal.y,v.Normal.z
-			);
+			/*
+			 * tangents from aiProcess_CalcTangentSpace, which needs UVs.
+			 * the bitangent is stored as its sign only, shaders rebuild it
+			 * as cross(normal, tangent) * w
+			 */
+			if (mesh->HasTangentsAndBitangents()) {
+				const aiVector3D &t=mesh->mTangents[i];
+				const aiVector3D &b=mesh->mBitangents[i];
+				glm::vec3 tangent(t.x, t.y, t.z);
+				glm::vec3 bitangent(b.x, b.y, b.z);
+				float w = glm::dot(glm::cross(v.Normal, tangent), bitangent) < 0.f ? -1.f : 1.f;
+				v.Tangent=glm::vec4(tangent, w);
+			}
+			else {
+				v.Tangent=glm::vec4(0.f, 0.f, 0.f, 1.f);
+			}
 		}
 
         /* fetch faces/indices */
         indices.reserve(nfaces * 3);
 		for (unsigned int i=0; i<nfaces; i++) {
-			auto f=mesh->mFaces[i];
+			/* by reference, copying an aiFace allocates a new index array */
+			const aiFace &f=mesh->mFaces[i];
 
 			/* skip points/lines, only load triangles */
 			if (f.mNumIndices!=3) {
@@ -310,91 +679,49 @@ namespace modeling {
         return true;
     }
 
-    namespace {
-        Texture& default_texture() {
-            static Texture* tex = []{
-                auto p = std::unique_ptr<const uint8_t[]>(new uint8_t[1]{255});
-                return new Texture(std::move(p), 1, 1, 4, 0);
-            }();
-            return *tex;
-        }
-
-        std::shared_ptr<Material> make_default_material(const std::string& name_hint) {
-            Texture& t = default_texture();
-            return std::shared_ptr<Material>(new Material(
-                name_hint.empty() ? std::string("material") : name_hint,
-                t, t, t, t, t, t
-            ));
-        }
-
-        Texture* loadTextureFromMaterial(aiMaterial* aiMat, const aiScene* scene, aiTextureType type, Texture& defaultTex) {
-            if (!aiMat){ 
-                return &defaultTex;
-            }
-            if (aiMat->GetTextureCount(type) == 0){
-                return &defaultTex;
-            }
-            aiString path;
-            if (aiMat->GetTexture(type, 0, &path) != AI_SUCCESS){
-                return &defaultTex;
-            }
-            
-            if (path.length > 0 && path.C_Str()[0] == '*') {
-                int idx = std::atoi(path.C_Str() + 1);
-                if (scene && idx >= 0 && static_cast<unsigned>(idx) < scene->mNumTextures) {
-                    const aiTexture* emb = scene->mTextures[idx];
-                    return &defaultTex;
-                }
-                return &defaultTex;
-            }
-            
-            return &defaultTex;
-        }
-    }
-    
-    std::vector<std::shared_ptr<Material>> ModelLoader::loadMaterials(const aiScene* scene) {
-        std::vector<std::shared_ptr<Material>> materials;
+    std::vector<MaterialSource> ModelLoader::describeMaterials(const aiScene* scene, const std::string& directory) {
+        std::vector<MaterialSource> sources;
         if (!scene || scene->mNumMaterials == 0) {
-            materials.push_back(make_default_material("default"));
-            return materials;
+            sources.emplace_back();
+            sources.back().name = "default";
+            return sources;
         }
 
-        materials.reserve(scene->mNumMaterials);
+        sources.reserve(scene->mNumMaterials);
         for (unsigned int i = 0; i < scene->mNumMaterials; i++) {
-            auto material = processMaterial(scene->mMaterials[i], scene);
-            if (!material) {
-                LOG_WARN_F("Failed to process material %d, using fallback", i);
-                material = make_default_material("fallback");
-            }
-            materials.push_back(std::move(material));
+            sources.push_back(TextureLoader::describe(scene->mMaterials[i], scene, directory));
         }
-        return materials;
+        return sources;
     }
 
-    std::shared_ptr<Material> ModelLoader::processMaterial(aiMaterial* aiMat, const aiScene* scene) {
-        if (!aiMat) {
-            LOG_WARN("Null aiMaterial, using default material");
-            return make_default_material("material");
+    std::vector<std::shared_ptr<Material>> ModelLoader::loadMaterials(
+        const std::vector<MaterialSource>& sources,
+        const aiScene* scene,
+        std::vector<std::shared_ptr<Texture>>& textures
+    ) {
+        if (sources.empty()) {
+            return { TextureLoader::makeDefaultMaterial("default", textures) };
         }
+        return TextureLoader::buildMaterials(sources, scene, textures);
+    }
 
-        aiString ainame; std::string name = "material";
-        if (aiMat->Get(AI_MATKEY_NAME, ainame) == AI_SUCCESS && ainame.length > 0){ 
-            name = ainame.C_Str();
+    void ModelLoader::uploadTextures(ImportedScene& imported, TextureUploader* uploader) {
+        if (imported.textures.empty()) {
+            return;
+        }
+        // without a long lived ring, stage through one sized for this scene
+        std::unique_ptr<TextureUploader> temporary;
+        if (!uploader) {
+            size_t bytes = 0;
+            for (const auto& texture : imported.textures) {
+                bytes += texture->byte_size();
+            }
+            temporary = std::make_unique<TextureUploader>(std::min(bytes, TextureUploader::DEFAULT_RING_SIZE));
+            uploader = temporary.get();
+        }
+        for (const auto& texture : imported.textures) {
+            uploader->upload(*texture);
         }
-
-        auto& def_tex = default_texture();
-
-        Texture* base   = loadTextureFromMaterial(aiMat, scene, aiTextureType_DIFFUSE, def_tex);
-        Texture* normal = loadTextureFromMaterial(aiMat, scene, aiTextureType_NORMALS, def_tex);
-        Texture* metal  = loadTextureFromMaterial(aiMat, scene, aiTextureType_METALNESS, def_tex);
-        Texture* rough  = loadTextureFromMaterial(aiMat, scene, aiTextureType_DIFFUSE_ROUGHNESS, def_tex);
-        Texture* ao     = loadTextureFromMaterial(aiMat, scene, aiTextureType_AMBIENT_OCCLUSION, def_tex);
-        Texture* albedo = base;
-
-        return std::shared_ptr<Material>(new Material(
-            name, *base, *normal, *albedo, *metal, *rough, *ao
-        ));
-
     }
 
     std::unordered_map<std::string, PropertyValue> ModelLoader::loadGLTFExtensions(const aiScene* scene) {
@@ -32,10 +32,11 @@ void ModelProperties::unload() {
 */
 void ModelProperties::update(const animation::AnimationProperties &animProps) {
     if (model) {
-        // Setup the model for rendering (bind shader and vertex data)
-        model->setupForRendering();
-        
+        // Vertex data is bound per visible mesh after culling, see rendering::CullingStage
         auto shader = model->getShader();
+        if (shader) {
+            shader->bind();
+        }
 
         // Set any modeling-specific uniforms
         if (shader && shader->is_bound()) {
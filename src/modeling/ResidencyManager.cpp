@@ -0,0 +1,115 @@
+#include "modeling/ResidencyManager.hpp"
+#include <algorithm>
+
+ResidencyManager::ResidencyManager(size_t cpu_budget, size_t gpu_budget):
+    cpu_limit(cpu_budget),
+    gpu_limit(gpu_budget) {}
+
+void ResidencyManager::set_budget(size_t cpu_budget, size_t gpu_budget) {
+    this->cpu_limit = cpu_budget;
+    this->gpu_limit = gpu_budget;
+}
+
+ResidencyManager::Entry& ResidencyManager::entry(size_t id) {
+    if (id >= this->entries.size()) {
+        this->entries.resize(id + 1);
+    }
+    return this->entries[id];
+}
+
+void ResidencyManager::add(size_t id, size_t cpu_bytes, size_t gpu_bytes) {
+    this->remove(id);
+
+    Entry &e = this->entry(id);
+    e.resident = true;
+    e.last_use = this->frame;
+    e.cpu_bytes = cpu_bytes;
+    e.gpu_bytes = gpu_bytes;
+    this->counters.cpu_bytes += cpu_bytes;
+    this->counters.gpu_bytes += gpu_bytes;
+}
+
+void ResidencyManager::remove(size_t id) {
+    if (!this->resident(id)) {
+        return;
+    }
+    Entry &e = this->entries[id];
+    this->counters.cpu_bytes -= e.cpu_bytes;
+    this->counters.gpu_bytes -= e.gpu_bytes;
+    e.resident = false;
+    e.cpu_bytes = 0;
+    e.gpu_bytes = 0;
+}
+
+bool ResidencyManager::resident(size_t id) const {
+    return id < this->entries.size() && this->entries[id].resident;
+}
+
+bool ResidencyManager::touch(size_t id) {
+    if (!this->resident(id)) {
+        this->counters.misses++;
+        return false;
+    }
+    this->entries[id].last_use = this->frame;
+    this->counters.hits++;
+    return true;
+}
+
+void ResidencyManager::pin(size_t id) {
+    this->entry(id).pinned = true;
+}
+
+void ResidencyManager::unpin(size_t id) {
+    if (id < this->entries.size()) {
+        this->entries[id].pinned = false;
+    }
+}
+
+bool ResidencyManager::pinned(size_t id) const {
+    return id < this->entries.size() && this->entries[id].pinned;
+}
+
+bool ResidencyManager::over_budget() const {
+    return this->counters.cpu_bytes > this->cpu_limit || this->counters.gpu_bytes > this->gpu_limit;
+}
+
+std::vector<size_t> ResidencyManager::evict() {
+    std::vector<size_t> evicted;
+    if (!this->over_budget()) {
+        return evicted;
+    }
+
+    std::vector<size_t> candidates;
+    for (size_t id = 0; id < this->entries.size(); id++) {
+        const Entry &e = this->entries[id];
+        if (e.resident && !e.pinned && e.last_use < this->frame) {
+            candidates.push_back(id);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](size_t a, size_t b) {
+        return this->entries[a].last_use < this->entries[b].last_use;
+    });
+
+    for (size_t id: candidates) {
+        if (!this->over_budget()) {
+            break;
+        }
+        // evicting something that doesn't help the exceeded budget only causes a reload
+        const Entry &e = this->entries[id];
+        bool cpu_helps = this->counters.cpu_bytes > this->cpu_limit && e.cpu_bytes > 0;
+        bool gpu_helps = this->counters.gpu_bytes > this->gpu_limit && e.gpu_bytes > 0;
+        if (!cpu_helps && !gpu_helps) {
+            continue;
+        }
+        this->remove(id);
+        this->counters.evictions++;
+        evicted.push_back(id);
+    }
+    return evicted;
+}
+
+void ResidencyManager::reset_counters() {
+    this->counters.hits = 0;
+    this->counters.misses = 0;
+    this->counters.evictions = 0;
+}
@@ -0,0 +1,369 @@
+#include "modeling/TextureCooker.hpp"
+#include "modeling/BlockCompression.hpp"
+#include "modeling/MeshCache.hpp"
+#include "utils/AtomicFile.hpp"
+#include "utils/Logger.hpp"
+#include "utils/StringId.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace modeling {
+
+namespace {
+
+    const char MAGIC[4] = {'S', 'T', 'E', 'X'};
+    const uint32_t VERSION = 1;
+
+    struct FileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        uint32_t levels;
+        uint32_t reserved;
+        uint64_t dataSize;
+    };
+
+    const float PI = 3.14159265358979f;
+
+    float sinc(float x) {
+        if (std::fabs(x) < 1e-5f) {
+            return 1.0f;
+        }
+        return std::sin(PI * x) / (PI * x);
+    }
+
+    // windowed sinc with two lobes, sharper than a box or tent and with little ringing
+    float lanczos2(float x) {
+        return std::fabs(x) < 2.0f ? sinc(x) * sinc(x * 0.5f) : 0.0f;
+    }
+
+    struct Tap {
+        uint32_t index;
+        float weight;
+    };
+
+    // filter taps of every destination texel along one axis, wrapping like GL_REPEAT
+    std::vector<std::vector<Tap>> computeTaps(uint32_t src, uint32_t dst) {
+        float scale = float(src) / float(dst);
+        float width = std::max(scale, 1.0f);  // widen the kernel when minifying
+        std::vector<std::vector<Tap>> taps(dst);
+        for (uint32_t d = 0; d < dst; d++) {
+            float center = (d + 0.5f) * scale;
+            int first = static_cast<int>(std::floor(center - 2.0f * width));
+            int last = static_cast<int>(std::ceil(center + 2.0f * width));
+            float total = 0.0f;
+            for (int i = first; i <= last; i++) {
+                float weight = lanczos2((i + 0.5f - center) / width);
+                if (weight == 0.0f) {
+                    continue;
+                }
+                int wrapped = ((i % int(src)) + int(src)) % int(src);
+                taps[d].push_back({ uint32_t(wrapped), weight });
+                total += weight;
+            }
+            for (Tap& tap : taps[d]) {
+                tap.weight /= total;
+            }
+        }
+        return taps;
+    }
+
+    // separable resample of a float image with <channels> interleaved channels
+    std::vector<float> resample(const std::vector<float>& src, uint32_t sw, uint32_t sh,
+                                uint32_t channels, uint32_t dw, uint32_t dh) {
+        auto tapsX = computeTaps(sw, dw);
+        auto tapsY = computeTaps(sh, dh);
+
+        std::vector<float> rows(size_t(dw) * sh * channels, 0.0f);
+        ThreadPool::shared().parallelFor(sh, [&](size_t y) {
+            for (uint32_t x = 0; x < dw; x++) {
+                float* out = &rows[(y * dw + x) * channels];
+                for (const Tap& tap : tapsX[x]) {
+                    const float* in = &src[(y * sw + tap.index) * channels];
+                    for (uint32_t c = 0; c < channels; c++) {
+                        out[c] += tap.weight * in[c];
+                    }
+                }
+            }
+        });
+
+        std::vector<float> dst(size_t(dw) * dh * channels, 0.0f);
+        ThreadPool::shared().parallelFor(dh, [&](size_t y) {
+            for (const Tap& tap : tapsY[y]) {
+                const float* in = &rows[size_t(tap.index) * dw * channels];
+                float* out = &dst[y * dw * channels];
+                for (size_t i = 0; i < size_t(dw) * channels; i++) {
+                    out[i] += tap.weight * in[i];
+                }
+            }
+        });
+        return dst;
+    }
+
+    float srgbToLinear(float c) {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float c) {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    // color channels of an sRGB texture, the last channel of 2 and 4 channel textures is alpha
+    uint32_t colorChannels(uint32_t channels) {
+        return (channels == 2 || channels == 4) ? channels - 1 : channels;
+    }
+
+    std::vector<float> toFloat(const uint8_t* pixels, uint32_t width, uint32_t height,
+                               uint32_t channels, TextureUsage usage) {
+        static const std::vector<float> SRGB_TO_LINEAR = [] {
+            std::vector<float> table(256);
+            for (int i = 0; i < 256; i++) {
+                table[i] = srgbToLinear(i / 255.0f);
+            }
+            return table;
+        }();
+
+        std::vector<float> image(size_t(width) * height * channels);
+        const uint32_t color = colorChannels(channels);
+        for (size_t i = 0; i < image.size(); i++) {
+            uint32_t c = uint32_t(i % channels);
+            if (usage == TextureUsage::COLOR && c < color) {
+                image[i] = SRGB_TO_LINEAR[pixels[i]];
+            } else if (usage == TextureUsage::NORMAL && c < 3) {
+                image[i] = pixels[i] / 127.5f - 1.0f;
+            } else {
+                image[i] = pixels[i] / 255.0f;
+            }
+        }
+        return image;
+    }
+
+    void toBytes(const std::vector<float>& image, uint32_t channels, TextureUsage usage, uint8_t* pixels) {
+        auto quantize = [](float v) {
+            return uint8_t(std::lround(std::clamp(v, 0.0f, 1.0f) * 255.0f));
+        };
+        const uint32_t color = colorChannels(channels);
+        for (size_t texel = 0; texel < image.size() / channels; texel++) {
+            const float* in = &image[texel * channels];
+            uint8_t* out = &pixels[texel * channels];
+            if (usage == TextureUsage::NORMAL && channels >= 3) {
+                float length = std::sqrt(in[0] * in[0] + in[1] * in[1] + in[2] * in[2]);
+                float scale = length > 1e-6f ? 1.0f / length : 0.0f;
+                for (uint32_t c = 0; c < 3; c++) {
+                    out[c] = quantize(in[c] * scale * 0.5f + 0.5f);
+                }
+                for (uint32_t c = 3; c < channels; c++) {
+                    out[c] = quantize(in[c]);
+                }
+                continue;
+            }
+            for (uint32_t c = 0; c < channels; c++) {
+                if (usage == TextureUsage::COLOR && c < color) {
+                    out[c] = quantize(linearToSrgb(std::max(in[c], 0.0f)));
+                } else if (usage == TextureUsage::NORMAL) {
+                    out[c] = quantize(in[c] * 0.5f + 0.5f);
+                } else {
+                    out[c] = quantize(in[c]);
+                }
+            }
+        }
+    }
+
+    uint32_t mipCount(uint32_t width, uint32_t height) {
+        uint32_t levels = 1;
+        while ((std::max(width, height) >> levels) > 0) {
+            levels++;
+        }
+        return levels;
+    }
+
+    // one channel of level 0 of <texture> at <width> x <height>, 1.0 if it can't be read
+    std::vector<float> extractChannel(const Texture& texture, uint32_t channel, uint32_t width, uint32_t height) {
+        if (texture.format != TextureFormat::RAW || !texture.data) {
+            return std::vector<float>(size_t(width) * height, 1.0f);
+        }
+        channel = std::min(channel, texture.n_channels - 1);
+        std::vector<float> plane(size_t(texture.width) * texture.height);
+        for (size_t i = 0; i < plane.size(); i++) {
+            plane[i] = texture.data[i * texture.n_channels + channel] / 255.0f;
+        }
+        if (texture.width == width && texture.height == height) {
+            return plane;
+        }
+        return resample(plane, texture.width, texture.height, 1, width, height);
+    }
+}
+
+std::shared_ptr<Texture> TextureCooker::generateMips(const Texture& source, TextureUsage usage) {
+    const uint32_t channels = source.n_channels;
+    const uint32_t levels = mipCount(source.width, source.height);
+
+    size_t total = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        total += Texture::image_size(TextureFormat::RAW, std::max(source.width >> level, 1u),
+                                     std::max(source.height >> level, 1u), channels);
+    }
+    std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+
+    // level 0 as is, every further level filtered from the float copy of the previous one
+    size_t offset = source.level_size(0);
+    std::memcpy(data.get(), source.data.get(), offset);
+    uint32_t width = source.width, height = source.height;
+    std::vector<float> image = toFloat(source.data.get(), width, height, channels, usage);
+    for (uint32_t level = 1; level < levels; level++) {
+        uint32_t nextWidth = std::max(width >> 1, 1u);
+        uint32_t nextHeight = std::max(height >> 1, 1u);
+        image = resample(image, width, height, channels, nextWidth, nextHeight);
+        width = nextWidth;
+        height = nextHeight;
+        toBytes(image, channels, usage, data.get() + offset);
+        offset += size_t(width) * height * channels;
+    }
+
+    return std::make_shared<Texture>(std::unique_ptr<const uint8_t[]>(std::move(data)),
+                                     source.width, source.height, channels, 0, levels, TextureFormat::RAW);
+}
+
+std::shared_ptr<Texture> TextureCooker::packOcclusionRoughnessMetallic(
+    const Texture& occlusion,
+    const Texture& roughness,
+    const Texture& metallic
+) {
+    uint32_t width = std::max({ occlusion.width, roughness.width, metallic.width });
+    uint32_t height = std::max({ occlusion.height, roughness.height, metallic.height });
+
+    const Texture* inputs[3] = { &occlusion, &roughness, &metallic };
+    std::unique_ptr<uint8_t[]> data(new uint8_t[size_t(width) * height * 3]);
+    for (uint32_t c = 0; c < 3; c++) {
+        std::vector<float> plane = extractChannel(*inputs[c], c, width, height);
+        for (size_t i = 0; i < plane.size(); i++) {
+            data[i * 3 + c] = uint8_t(std::lround(std::clamp(plane[i], 0.0f, 1.0f) * 255.0f));
+        }
+    }
+    return std::make_shared<Texture>(std::unique_ptr<const uint8_t[]>(std::move(data)), width, height, 3, 0);
+}
+
+std::shared_ptr<Texture> TextureCooker::compress(const Texture& source, TextureUsage usage) {
+    TextureFormat format = (usage == TextureUsage::NORMAL) ? TextureFormat::BC5 : TextureFormat::BC7;
+    uint32_t channels = (format == TextureFormat::BC5) ? 2 : 4;
+
+    size_t total = 0;
+    for (uint32_t level = 0; level < source.levels; level++) {
+        total += Texture::image_size(format, source.level_width(level), source.level_height(level), channels);
+    }
+    std::unique_ptr<uint8_t[]> data(new uint8_t[total]);
+
+    const uint8_t* in = source.data.get();
+    uint8_t* out = data.get();
+    for (uint32_t level = 0; level < source.levels; level++) {
+        uint32_t width = source.level_width(level);
+        uint32_t height = source.level_height(level);
+        BlockCompression::encodeImage(format, in, width, height, source.n_channels, out);
+        in += source.level_size(level);
+        out += Texture::image_size(format, width, height, channels);
+    }
+
+    return std::make_shared<Texture>(std::unique_ptr<const uint8_t[]>(std::move(data)),
+                                     source.width, source.height, channels, 0, source.levels, format);
+}
+
+std::shared_ptr<Texture> TextureCooker::cook(const Texture& source, TextureUsage usage,
+                                             const TextureCookOptions& options) {
+    std::shared_ptr<Texture> cooked = generateMips(source, usage);
+    if (options.compress) {
+        cooked = compress(*cooked, usage);
+    }
+    return cooked;
+}
+
+uint64_t TextureCooker::computeKey(const std::vector<std::string>& sourcePaths, TextureUsage usage,
+                                   const TextureCookOptions& options) {
+    uint64_t key = StringId::hashOf("stc") ^ (uint64_t(VERSION) << 32) ^
+                   (uint64_t(usage) << 8) ^ uint64_t(options.compress);
+    for (const std::string& path : sourcePaths) {
+        // path, size and modification time, the images are only read on a miss
+        std::string stamp = path;
+        if (!path.empty()) {
+            std::error_code error;
+            uint64_t size = std::filesystem::file_size(path, error);
+            if (error) {
+                return 0;
+            }
+            int64_t time = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+            if (error) {
+                return 0;
+            }
+            stamp += "|" + std::to_string(size) + "|" + std::to_string(time);
+        }
+        key = key * 1099511628211ull ^ StringId::hashOf(stamp);
+    }
+    return key ? key : 1;
+}
+
+std::string TextureCooker::cachePathFor(const std::string& name) {
+    return MeshCache::cachePathFor(name, ".stc");
+}
+
+std::shared_ptr<Texture> TextureCooker::readCache(const std::string& cachePath, uint64_t key) {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    FileHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header.version != VERSION ||
+        header.key != key ||
+        header.format > uint32_t(TextureFormat::BC7) ||
+        header.width == 0 || header.height == 0 || header.channels == 0 || header.channels > 4 ||
+        header.levels == 0 || header.levels > mipCount(header.width, header.height)) {
+        LOG_DEBUG_F("Cooked texture {} is stale or corrupt, ignoring", cachePath);
+        return nullptr;
+    }
+
+    TextureFormat format = static_cast<TextureFormat>(header.format);
+    size_t expected = 0;
+    for (uint32_t level = 0; level < header.levels; level++) {
+        expected += Texture::image_size(format, std::max(header.width >> level, 1u),
+                                        std::max(header.height >> level, 1u), header.channels);
+    }
+    if (header.dataSize != expected) {
+        return nullptr;
+    }
+    std::unique_ptr<uint8_t[]> data(new uint8_t[expected]);
+    if (!file.read(reinterpret_cast<char*>(data.get()), static_cast<std::streamsize>(expected))) {
+        return nullptr;
+    }
+    return std::make_shared<Texture>(std::unique_ptr<const uint8_t[]>(std::move(data)), header.width,
+                                     header.height, header.channels, 0, header.levels, format);
+}
+
+bool TextureCooker::writeCache(const std::string& cachePath, uint64_t key, const Texture& texture) {
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.key = key;
+    header.format = static_cast<uint32_t>(texture.format);
+    header.width = texture.width;
+    header.height = texture.height;
+    header.channels = texture.n_channels;
+    header.levels = texture.levels;
+    header.dataSize = texture.byte_size();
+
+    return writeFileAtomically(cachePath, [&](std::ofstream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(texture.data.get()), static_cast<std::streamsize>(header.dataSize));
+        return true;
+    });
+}
+
+} // namespace modeling
@@ -0,0 +1,358 @@
+#include "modeling/TextureLoader.hpp"
+#include "utils/FlatHashMap.hpp"
+#include "utils/Logger.hpp"
+#include "utils/StringId.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+
+// private copy of stb_image, so decoding here doesn't depend on which
+// library or executable happens to provide the implementation
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace modeling {
+
+namespace {
+
+    // Assimp texture types to try for each TextureSlot, first match wins.
+    // glTF occlusion maps are imported as lightmaps, and older Assimp
+    // versions report metallicRoughness as UNKNOWN.
+    const std::vector<aiTextureType> SLOT_TYPES[TEXTURE_SLOT_COUNT] = {
+        { aiTextureType_BASE_COLOR, aiTextureType_DIFFUSE },
+        { aiTextureType_NORMALS },
+        { aiTextureType_BASE_COLOR, aiTextureType_DIFFUSE },
+        { aiTextureType_METALNESS, aiTextureType_UNKNOWN },
+        { aiTextureType_DIFFUSE_ROUGHNESS, aiTextureType_UNKNOWN },
+        { aiTextureType_AMBIENT_OCCLUSION, aiTextureType_LIGHTMAP },
+    };
+
+    // how each TextureSlot is filtered and compressed
+    const TextureUsage SLOT_USAGES[TEXTURE_SLOT_COUNT] = {
+        TextureUsage::COLOR,
+        TextureUsage::NORMAL,
+        TextureUsage::COLOR,
+        TextureUsage::DATA,
+        TextureUsage::DATA,
+        TextureUsage::DATA,
+    };
+
+    std::mutex cookOptionsMutex;
+    TextureCookOptions cookOptions;
+
+    std::shared_ptr<Texture> makeTexture(const uint8_t* pixels, int width, int height, int channels) {
+        size_t size = size_t(width) * size_t(height) * size_t(channels);
+        std::unique_ptr<uint8_t[]> data(new uint8_t[size]);
+        std::memcpy(data.get(), pixels, size);
+        return std::make_shared<Texture>(std::unique_ptr<const uint8_t[]>(std::move(data)),
+                                         width, height, channels, 0);
+    }
+
+    // "*N" for embedded texture N, otherwise the normalized path
+    std::string resolve(const aiString& reference, const aiScene* scene, const std::string& directory) {
+        if (scene) {
+            if (const aiTexture* embedded = scene->GetEmbeddedTexture(reference.C_Str())) {
+                for (unsigned int i = 0; i < scene->mNumTextures; i++) {
+                    if (scene->mTextures[i] == embedded) {
+                        return "*" + std::to_string(i);
+                    }
+                }
+            }
+        }
+        if (reference.length == 0 || reference.C_Str()[0] == '*') {
+            return "";  // embedded index out of range
+        }
+        std::filesystem::path path(reference.C_Str());
+        if (path.is_relative()) {
+            path = std::filesystem::path(directory) / path;
+        }
+        return path.lexically_normal().generic_string();
+    }
+}
+
+MaterialSource TextureLoader::describe(const aiMaterial* material, const aiScene* scene, const std::string& directory) {
+    MaterialSource source;
+    source.name = "material";
+    if (!material) {
+        return source;
+    }
+
+    aiString name;
+    if (material->Get(AI_MATKEY_NAME, name) == AI_SUCCESS && name.length > 0) {
+        source.name = name.C_Str();
+    }
+    int shading = 0;
+    if (material->Get(AI_MATKEY_SHADING_MODEL, shading) == AI_SUCCESS) {
+        source.unlit = (shading == aiShadingMode_Unlit);
+    }
+
+    for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+        for (aiTextureType type : SLOT_TYPES[slot]) {
+            aiString reference;
+            if (material->GetTextureCount(type) > 0 &&
+                material->GetTexture(type, 0, &reference) == AI_SUCCESS) {
+                source.textures[slot] = resolve(reference, scene, directory);
+                break;
+            }
+        }
+    }
+    return source;
+}
+
+std::vector<std::shared_ptr<Material>> TextureLoader::buildMaterials(
+    const std::vector<MaterialSource>& sources,
+    const aiScene* scene,
+    std::vector<std::shared_ptr<Texture>>& textures
+) {
+    const TextureCookOptions options = getCookOptions();
+
+    // every distinct texture once. When cooking, the three scalar maps of a
+    // material become one packed texture, shared by materials using the same maps
+    FlatHashMap<StringId, size_t> lookup;
+    std::vector<CookUnit> units;
+    auto addUnit = [&](CookUnit unit) {
+        StringId id(unit.name);
+        if (const size_t* index = lookup.find(id)) {
+            return static_cast<int>(*index);
+        }
+        lookup.insert(id, units.size());
+        units.push_back(std::move(unit));
+        return static_cast<int>(units.size() - 1);
+    };
+
+    std::vector<std::array<int, TEXTURE_SLOT_COUNT>> slots(sources.size());
+    for (size_t m = 0; m < sources.size(); m++) {
+        const auto& paths = sources[m].textures;
+        for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+            slots[m][slot] = -1;
+            bool packed = options.enabled && slot >= TEXTURE_METALLIC;
+            if (paths[slot].empty() || packed) {
+                continue;
+            }
+            slots[m][slot] = addUnit({ paths[slot], SLOT_USAGES[slot], { paths[slot] }, false });
+        }
+
+        const std::string& occlusion = paths[TEXTURE_AMBIENT_OCCLUSION];
+        const std::string& roughness = paths[TEXTURE_ROUGHNESS];
+        const std::string& metallic = paths[TEXTURE_METALLIC];
+        if (options.enabled && !(occlusion.empty() && roughness.empty() && metallic.empty())) {
+            int index = addUnit({ "orm:" + occlusion + "|" + roughness + "|" + metallic, TextureUsage::DATA,
+                                  { occlusion, roughness, metallic }, true });
+            slots[m][TEXTURE_AMBIENT_OCCLUSION] = slots[m][TEXTURE_ROUGHNESS] = slots[m][TEXTURE_METALLIC] = index;
+        }
+    }
+
+    std::vector<std::shared_ptr<Texture>> decoded(units.size());
+    ThreadPool::shared().parallelFor(units.size(), [&](size_t i) {
+        decoded[i] = loadUnit(units[i], scene, options);
+        if (!decoded[i]) {
+            LOG_WARN_F("Could not decode texture {}, using the default", units[i].name);
+        }
+    });
+    LOG_INFO_F("Decoded {} textures for {} materials", units.size(), sources.size());
+
+    std::vector<std::shared_ptr<Material>> materials;
+    materials.reserve(sources.size());
+    std::shared_ptr<Texture> fallback;
+    for (size_t m = 0; m < sources.size(); m++) {
+        // Material only references its textures, the deleter keeps them alive
+        std::vector<std::shared_ptr<Texture>> owned;
+        Texture* bound[TEXTURE_SLOT_COUNT];
+        for (int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++) {
+            int index = slots[m][slot];
+            if (index >= 0 && decoded[index]) {
+                owned.push_back(decoded[index]);
+                bound[slot] = decoded[index].get();
+            } else {
+                if (!fallback) {
+                    fallback = makeDefaultTexture();
+                }
+                owned.push_back(fallback);
+                bound[slot] = fallback.get();
+            }
+        }
+        materials.push_back(std::shared_ptr<Material>(
+            new Material(sources[m].name,
+                         *bound[TEXTURE_BASE_COLOR], *bound[TEXTURE_NORMAL], *bound[TEXTURE_ALBEDO],
+                         *bound[TEXTURE_METALLIC], *bound[TEXTURE_ROUGHNESS], *bound[TEXTURE_AMBIENT_OCCLUSION]),
+            [owned](Material* material) { delete material; }
+        ));
+    }
+
+    if (fallback) {
+        textures.push_back(fallback);
+    }
+    for (auto& texture : decoded) {
+        if (texture) {
+            textures.push_back(texture);
+        }
+    }
+    return materials;
+}
+
+std::shared_ptr<Texture> TextureLoader::decodeSource(const std::string& source, const aiScene* scene) {
+    if (source.empty()) {
+        return nullptr;
+    }
+    if (source[0] == '*') {
+        unsigned int index = static_cast<unsigned int>(std::atoi(source.c_str() + 1));
+        if (scene && index < scene->mNumTextures) {
+            return decodeEmbedded(scene->mTextures[index]);
+        }
+        return nullptr;
+    }
+    return decodeFile(source);
+}
+
+std::shared_ptr<Texture> TextureLoader::loadUnit(const CookUnit& unit, const aiScene* scene,
+                                                 const TextureCookOptions& options) {
+    if (!options.enabled) {
+        return decodeSource(unit.sources[0], scene);
+    }
+
+    // embedded images have no file to key the cache on, they are cooked every time
+    bool cacheable = options.cache;
+    std::vector<std::string> paths;
+    for (const std::string& source : unit.sources) {
+        cacheable = cacheable && (source.empty() || source[0] != '*');
+        paths.push_back(source);
+    }
+    std::string cachePath;
+    uint64_t key = 0;
+    if (cacheable) {
+        key = TextureCooker::computeKey(paths, unit.usage, options);
+        if (key != 0) {
+            cachePath = TextureCooker::cachePathFor(cacheName(unit));
+            if (auto cooked = TextureCooker::readCache(cachePath, key)) {
+                return cooked;
+            }
+        }
+    }
+
+    std::shared_ptr<Texture> image;
+    if (unit.packed) {
+        std::shared_ptr<Texture> maps[3];
+        bool any = false;
+        for (int i = 0; i < 3; i++) {
+            maps[i] = decodeSource(unit.sources[i], scene);
+            any = any || maps[i];
+        }
+        if (!any) {
+            return nullptr;
+        }
+        // missing maps are white, like the default texture they replace
+        const Texture& white = whiteTexture();
+        image = TextureCooker::packOcclusionRoughnessMetallic(maps[0] ? *maps[0] : white,
+                                                              maps[1] ? *maps[1] : white,
+                                                              maps[2] ? *maps[2] : white);
+    } else {
+        image = decodeSource(unit.sources[0], scene);
+        if (!image) {
+            return nullptr;
+        }
+    }
+
+    std::shared_ptr<Texture> cooked = TextureCooker::cook(*image, unit.usage, options);
+    if (key != 0) {
+        TextureCooker::writeCache(cachePath, key, *cooked);
+    }
+    return cooked;
+}
+
+std::string TextureLoader::cacheName(const CookUnit& unit) {
+    if (!unit.packed) {
+        return unit.sources[0];
+    }
+    // named after one of its maps, the hash keeps different combinations apart
+    std::string base;
+    for (const std::string& source : unit.sources) {
+        if (!source.empty()) {
+            base = source;
+        }
+    }
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".orm-%08x", static_cast<unsigned int>(StringId::hashOf(unit.name)));
+    return base + suffix;
+}
+
+void TextureLoader::setCookOptions(const TextureCookOptions& options) {
+    std::lock_guard<std::mutex> lock(cookOptionsMutex);
+    cookOptions = options;
+}
+
+TextureCookOptions TextureLoader::getCookOptions() {
+    std::lock_guard<std::mutex> lock(cookOptionsMutex);
+    return cookOptions;
+}
+
+std::shared_ptr<Texture> TextureLoader::decodeFile(const std::string& path) {
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, 0);
+    if (!pixels) {
+        LOG_ERROR_F("stb_image failed on {}: {}", path, stbi_failure_reason());
+        return nullptr;
+    }
+    auto texture = makeTexture(pixels, width, height, channels);
+    stbi_image_free(pixels);
+    return texture;
+}
+
+std::shared_ptr<Texture> TextureLoader::decodeEmbedded(const aiTexture* texture) {
+    if (!texture || !texture->pcData) {
+        return nullptr;
+    }
+
+    // mHeight == 0 means pcData holds a compressed file of mWidth bytes
+    if (texture->mHeight == 0) {
+        int width, height, channels;
+        stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(texture->pcData),
+                                                static_cast<int>(texture->mWidth),
+                                                &width, &height, &channels, 0);
+        if (!pixels) {
+            LOG_ERROR_F("stb_image failed on embedded {}: {}", texture->mFilename.C_Str(), stbi_failure_reason());
+            return nullptr;
+        }
+        auto decoded = makeTexture(pixels, width, height, channels);
+        stbi_image_free(pixels);
+        return decoded;
+    }
+
+    // raw aiTexel, stored BGRA
+    size_t count = size_t(texture->mWidth) * texture->mHeight;
+    std::unique_ptr<uint8_t[]> rgba(new uint8_t[count * 4]);
+    for (size_t i = 0; i < count; i++) {
+        const aiTexel& texel = texture->pcData[i];
+        rgba[i * 4 + 0] = texel.r;
+        rgba[i * 4 + 1] = texel.g;
+        rgba[i * 4 + 2] = texel.b;
+        rgba[i * 4 + 3] = texel.a;
+    }
+    return std::make_shared<Texture>(std::unique_ptr<const uint8_t[]>(std::move(rgba)),
+                                     texture->mWidth, texture->mHeight, 4, 0);
+}
+
+std::shared_ptr<Texture> TextureLoader::makeDefaultTexture() {
+    auto pixels = std::unique_ptr<const uint8_t[]>(new uint8_t[4]{255, 255, 255, 255});
+    return std::make_shared<Texture>(std::move(pixels), 1, 1, 4, 0);
+}
+
+Texture& TextureLoader::whiteTexture() {
+    static const std::shared_ptr<Texture> texture = makeDefaultTexture();
+    return *texture;
+}
+
+std::shared_ptr<Material> TextureLoader::makeDefaultMaterial(const std::string& name,
+                                                             std::vector<std::shared_ptr<Texture>>& textures) {
+    std::shared_ptr<Texture> t = makeDefaultTexture();
+    textures.push_back(t);
+    return std::shared_ptr<Material>(
+        new Material(name.empty() ? std::string("material") : name, *t, *t, *t, *t, *t, *t),
+        [t](Material* material) { delete material; }
+    );
+}
+
+} // namespace modeling
@@ -0,0 +1,256 @@
+#include "modeling/TextureUploader.hpp"
+#include "modeling/BlockCompression.hpp"
+#include "utils/Logger.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace modeling {
+
+namespace {
+    // offsets into the ring stay aligned for any pixel format
+    const size_t REGION_ALIGNMENT = 256;
+
+    bool hasBufferStorage() {
+#ifdef GL_VERSION_4_4
+        if (GLAD_GL_VERSION_4_4) {
+            return true;
+        }
+#endif
+#ifdef GL_ARB_buffer_storage
+        if (GLAD_GL_ARB_buffer_storage) {
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    GLenum formatFor(uint32_t channels) {
+        switch (channels) {
+            case 1: return GL_RED;
+            case 2: return GL_RG;
+            case 3: return GL_RGB;
+            default: return GL_RGBA;
+        }
+    }
+
+    GLenum internalFormatFor(uint32_t channels) {
+        switch (channels) {
+            case 1: return GL_R8;
+            case 2: return GL_RG8;
+            case 3: return GL_RGB8;
+            default: return GL_RGBA8;
+        }
+    }
+}
+
+TextureUploader::TextureUploader(size_t ringSize) : size(ringSize) {
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+
+#ifdef GL_VERSION_4_4
+    if (hasBufferStorage()) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+        mapped = static_cast<uint8_t*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags));
+        persistent = (mapped != nullptr);
+        if (!persistent) {
+            // immutable storage can't be respecified, start over with a mutable buffer
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        }
+    }
+#endif
+    if (!persistent) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    LOG_DEBUG_F("Texture upload ring: {} bytes, persistent mapping {}", size, persistent ? "on" : "off");
+}
+
+TextureUploader::~TextureUploader() {
+    for (Region& region : inFlight) {
+        glDeleteSync(region.fence);
+    }
+    if (persistent) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+size_t TextureUploader::reserve(size_t bytes) {
+    size_t offset = (head + REGION_ALIGNMENT - 1) & ~(REGION_ALIGNMENT - 1);
+    if (offset + bytes > size) {
+        offset = 0; // wrap around
+    }
+
+    // wait, oldest first, until nothing still being read overlaps the region
+    auto overlaps = [&](const Region& region) {
+        return region.begin < offset + bytes && offset < region.end;
+    };
+    while (std::any_of(inFlight.begin(), inFlight.end(), overlaps)) {
+        Region& oldest = inFlight.front();
+        glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        glDeleteSync(oldest.fence);
+        inFlight.pop_front();
+    }
+
+    // drop fences that already signaled so the list stays short
+    while (!inFlight.empty()) {
+        GLenum status = glClientWaitSync(inFlight.front().fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            break;
+        }
+        glDeleteSync(inFlight.front().fence);
+        inFlight.pop_front();
+    }
+
+    head = offset + bytes;
+    return offset;
+}
+
+bool TextureUploader::supportsFormat(TextureFormat format) {
+    switch (format) {
+        case TextureFormat::RAW:
+        case TextureFormat::BC5:
+            return true; // RGTC is core since GL 3.0
+        case TextureFormat::BC7:
+            // a loader generated without the BPTC enums can't upload BC7,
+            // upload() decodes it on the CPU instead
+#ifdef GL_COMPRESSED_RGBA_BPTC_UNORM
+#ifdef GL_VERSION_4_2
+            if (GLAD_GL_VERSION_4_2) {
+                return true;
+            }
+#endif
+#ifdef GL_ARB_texture_compression_bptc
+            if (GLAD_GL_ARB_texture_compression_bptc) {
+                return true;
+            }
+#endif
+#endif
+            return false;
+    }
+    return false;
+}
+
+void TextureUploader::upload(Texture& texture) {
+    if (texture.id != 0) {
+        return;
+    }
+
+    if (!supportsFormat(texture.format)) {
+        // decode on the CPU rather than not showing the texture at all
+        LOG_WARN("Block compressed texture not supported by this context, decoding it on the CPU");
+        const uint32_t channels = (texture.format == TextureFormat::BC5) ? 2 : 4;
+        size_t total = 0;
+        for (uint32_t level = 0; level < texture.levels; level++) {
+            total += Texture::image_size(TextureFormat::RAW, texture.level_width(level), texture.level_height(level), channels);
+        }
+        std::unique_ptr<uint8_t[]> pixels(new uint8_t[total]);
+        const uint8_t* in = texture.data.get();
+        uint8_t* out = pixels.get();
+        for (uint32_t level = 0; level < texture.levels; level++) {
+            uint32_t width = texture.level_width(level);
+            uint32_t height = texture.level_height(level);
+            BlockCompression::decodeImage(texture.format, in, width, height, out);
+            in += texture.level_size(level);
+            out += size_t(width) * height * channels;
+        }
+        Texture decoded(std::unique_ptr<const uint8_t[]>(std::move(pixels)), texture.width, texture.height,
+                        channels, 0, texture.levels, TextureFormat::RAW);
+        this->upload(decoded);
+        texture.id = decoded.id;
+        decoded.id = 0; // now owned by <texture>
+        return;
+    }
+
+    size_t bytes = texture.byte_size();
+
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+    bool staged = bytes <= size;
+    size_t offset = 0;
+    if (staged) {
+        offset = reserve(bytes);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+        if (persistent) {
+            std::memcpy(mapped + offset, texture.data.get(), bytes);
+        } else {
+            void* region = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, offset, bytes,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            if (region) {
+                std::memcpy(region, texture.data.get(), bytes);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            } else {
+                LOG_WARN("Could not map the texture upload ring, uploading directly");
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                staged = false;
+            }
+        }
+    } else {
+        LOG_DEBUG_F("Texture of {} bytes exceeds the upload ring, uploading directly", bytes);
+    }
+
+    size_t position = 0;
+    for (uint32_t level = 0; level < texture.levels; level++) {
+        // with a bound unpack buffer the pointer argument is an offset into it
+        const void* pixels = staged ? reinterpret_cast<const void*>(offset + position)
+                                    : static_cast<const void*>(texture.data.get() + position);
+        GLsizei width = static_cast<GLsizei>(texture.level_width(level));
+        GLsizei height = static_cast<GLsizei>(texture.level_height(level));
+        GLsizei levelSize = static_cast<GLsizei>(texture.level_size(level));
+        switch (texture.format) {
+            case TextureFormat::RAW:
+                glTexImage2D(GL_TEXTURE_2D, level, internalFormatFor(texture.n_channels), width, height, 0,
+                             formatFor(texture.n_channels), GL_UNSIGNED_BYTE, pixels);
+                break;
+            case TextureFormat::BC5:
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RG_RGTC2, width, height, 0,
+                                       levelSize, pixels);
+                break;
+            case TextureFormat::BC7:
+#ifdef GL_COMPRESSED_RGBA_BPTC_UNORM
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGBA_BPTC_UNORM, width, height, 0,
+                                       levelSize, pixels);
+#endif
+                break;
+        }
+        position += levelSize;
+    }
+
+    if (staged) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        inFlight.push_back({ offset, offset + bytes, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+    }
+
+    if (texture.levels == 1) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+    } else {
+        // cooked textures carry their own, better filtered mips
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture.levels - 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (texture.format == TextureFormat::RAW && texture.n_channels == 1) {
+        // grayscale maps read the same from any channel, the shader picks the glTF one
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_RED);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    texture.id = id;
+}
+
+} // namespace modeling
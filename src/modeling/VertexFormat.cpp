@@ -0,0 +1,272 @@
+#include "modeling/VertexFormat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+	int8_t toSnorm8(float v) {
+		return (int8_t)std::lround(std::clamp(v, -1.f, 1.f) * 127.f);
+	}
+
+	uint16_t toUnorm16(float v) {
+		return (uint16_t)std::lround(std::clamp(v, 0.f, 1.f) * 65535.f);
+	}
+
+	/*
+	 * snorm16 octahedral normal. plain rounding can be off by a full
+	 * step, so try the 4 surrounding grid points and keep the closest
+	 */
+	void encodeNormal(const glm::vec3 &n, int16_t *out) {
+		glm::vec2 e = octEncode(n) * 32767.f;
+		float best = -2.f;
+		for (int i = 0; i < 4; i++) {
+			float x = (i & 1) ? std::ceil(e.x) : std::floor(e.x);
+			float y = (i & 2) ? std::ceil(e.y) : std::floor(e.y);
+			x = std::clamp(x, -32767.f, 32767.f);
+			y = std::clamp(y, -32767.f, 32767.f);
+			float d = glm::dot(octDecode(glm::vec2(x, y) / 32767.f), n);
+			if (d > best) {
+				best = d;
+				out[0] = (int16_t)x;
+				out[1] = (int16_t)y;
+			}
+		}
+	}
+
+	void encodeTangent(const glm::vec4 &t, int8_t *out) {
+		glm::vec3 dir(t);
+		if (glm::dot(dir, dir) < 1e-12f) {
+			/* mesh without tangents, a zero sign tells shaders to derive one */
+			out[0] = out[1] = out[2] = out[3] = 0;
+			return;
+		}
+		glm::vec2 e = octEncode(glm::normalize(dir));
+		out[0] = toSnorm8(e.x);
+		out[1] = toSnorm8(e.y);
+		out[2] = t.w < 0.f ? -127 : 127;
+		out[3] = 0;
+	}
+
+	uint16_t encodeTexCoord(float v, bool unorm) {
+		return unorm ? toUnorm16(v) : floatToHalf(v);
+	}
+
+	float decodeTexCoord(uint16_t v, bool unorm) {
+		return unorm ? v / 65535.f : halfToFloat(v);
+	}
+
+	template <typename T>
+	void encodeCommon(const Vertex &v, T &out, bool unormTexCoords) {
+		encodeNormal(v.Normal, out.Normal);
+		encodeTangent(v.Tangent, out.Tangent);
+		out.TexCoords[0] = encodeTexCoord(v.TexCoords.x, unormTexCoords);
+		out.TexCoords[1] = encodeTexCoord(v.TexCoords.y, unormTexCoords);
+	}
+
+	template <typename T>
+	void decodeCommon(const T &in, Vertex &v, bool unormTexCoords) {
+		v.Normal = octDecode(glm::vec2(in.Normal[0], in.Normal[1]) / 32767.f);
+		if (in.Tangent[2] == 0) {
+			v.Tangent = glm::vec4(0.f, 0.f, 0.f, 1.f);
+		} else {
+			v.Tangent = glm::vec4(octDecode(glm::vec2(in.Tangent[0], in.Tangent[1]) / 127.f),
+				in.Tangent[2] < 0 ? -1.f : 1.f);
+		}
+		v.TexCoords.x = decodeTexCoord(in.TexCoords[0], unormTexCoords);
+		v.TexCoords.y = decodeTexCoord(in.TexCoords[1], unormTexCoords);
+	}
+}
+
+size_t VertexEncoding::stride() const {
+	switch (format) {
+		case VertexFormat::PACKED: return sizeof(PackedVertex);
+		case VertexFormat::QUANTIZED: return sizeof(QuantizedVertex);
+		default: return sizeof(Vertex);
+	}
+}
+
+VertexEncoding chooseVertexEncoding(const Vertex *vertices, size_t count,
+	VertexFormat preferred, float positionTolerance)
+{
+	VertexEncoding encoding;
+	encoding.format = preferred;
+	if (preferred == VertexFormat::FLOAT || count == 0) {
+		encoding.format = VertexFormat::FLOAT;
+		return encoding;
+	}
+
+	glm::vec3 lo = vertices[0].Position, hi = vertices[0].Position;
+	bool uvInUnitRange = true;
+	for (size_t i = 0; i < count; i++) {
+		lo = glm::min(lo, vertices[i].Position);
+		hi = glm::max(hi, vertices[i].Position);
+		const glm::vec2 &uv = vertices[i].TexCoords;
+		uvInUnitRange = uvInUnitRange && uv.x >= 0.f && uv.x <= 1.f && uv.y >= 0.f && uv.y <= 1.f;
+	}
+	encoding.unormTexCoords = uvInUnitRange;
+
+	if (preferred == VertexFormat::QUANTIZED) {
+		/* worst case error is half a quantization step */
+		glm::vec3 extent = hi - lo;
+		float step = std::max(extent.x, std::max(extent.y, extent.z)) / 65535.f;
+		if (step * 0.5f <= positionTolerance) {
+			encoding.positionOffset = lo;
+			encoding.positionScale = extent;
+		} else {
+			encoding.format = VertexFormat::PACKED;
+		}
+	}
+	return encoding;
+}
+
+std::vector<uint8_t> encodeVertices(const Vertex *vertices, size_t count,
+	const VertexEncoding &encoding)
+{
+	std::vector<uint8_t> data(count * encoding.stride());
+	switch (encoding.format) {
+		case VertexFormat::FLOAT:
+			std::memcpy(data.data(), vertices, data.size());
+			break;
+
+		case VertexFormat::PACKED: {
+			PackedVertex *out = reinterpret_cast<PackedVertex *>(data.data());
+			for (size_t i = 0; i < count; i++) {
+				out[i].Position = vertices[i].Position;
+				encodeCommon(vertices[i], out[i], encoding.unormTexCoords);
+			}
+			break;
+		}
+
+		case VertexFormat::QUANTIZED: {
+			QuantizedVertex *out = reinterpret_cast<QuantizedVertex *>(data.data());
+			const glm::vec3 &offset = encoding.positionOffset;
+			const glm::vec3 &scale = encoding.positionScale;
+			for (size_t i = 0; i < count; i++) {
+				for (int c = 0; c < 3; c++) {
+					float unorm = scale[c] > 0.f ? (vertices[i].Position[c] - offset[c]) / scale[c] : 0.f;
+					out[i].Position[c] = toUnorm16(unorm);
+				}
+				out[i].Position[3] = 0;
+				encodeCommon(vertices[i], out[i], encoding.unormTexCoords);
+			}
+			break;
+		}
+	}
+	return data;
+}
+
+Vertex decodeVertex(const uint8_t *data, size_t index, const VertexEncoding &encoding)
+{
+	Vertex v{};
+	const uint8_t *p = data + index * encoding.stride();
+	switch (encoding.format) {
+		case VertexFormat::FLOAT:
+			std::memcpy(&v, p, sizeof(Vertex));
+			break;
+
+		case VertexFormat::PACKED: {
+			PackedVertex in;
+			std::memcpy(&in, p, sizeof(in));
+			v.Position = in.Position;
+			decodeCommon(in, v, encoding.unormTexCoords);
+			break;
+		}
+
+		case VertexFormat::QUANTIZED: {
+			QuantizedVertex in;
+			std::memcpy(&in, p, sizeof(in));
+			for (int c = 0; c < 3; c++) {
+				v.Position[c] = encoding.positionOffset[c] + in.Position[c] / 65535.f * encoding.positionScale[c];
+			}
+			decodeCommon(in, v, encoding.unormTexCoords);
+			break;
+		}
+	}
+	return v;
+}
+
+glm::vec2 octEncode(glm::vec3 n)
+{
+	float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+	if (sum < 1e-20f) {
+		return glm::vec2(0.f);
+	}
+	n /= sum;
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.f) {
+		/* fold the lower hemisphere over the diagonals */
+		e.x = (1.f - std::fabs(n.y)) * (n.x >= 0.f ? 1.f : -1.f);
+		e.y = (1.f - std::fabs(n.x)) * (n.y >= 0.f ? 1.f : -1.f);
+	}
+	return e;
+}
+
+glm::vec3 octDecode(glm::vec2 e)
+{
+	glm::vec3 n(e.x, e.y, 1.f - std::fabs(e.x) - std::fabs(e.y));
+	float t = std::max(-n.z, 0.f);
+	n.x += n.x >= 0.f ? -t : t;
+	n.y += n.y >= 0.f ? -t : t;
+	return glm::normalize(n);
+}
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int32_t exponent = int32_t((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	if (((bits >> 23) & 0xff) == 0xff) {
+		return uint16_t(sign | 0x7c00 | (mantissa ? 0x200 : 0)); /* inf, nan */
+	}
+	if (exponent >= 31) {
+		return uint16_t(sign | 0x7c00); /* too large, inf */
+	}
+	if (exponent <= 0) {
+		/* subnormal half, or zero */
+		if (exponent < -10) {
+			return uint16_t(sign);
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = uint32_t(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1))) {
+			half++;
+		}
+		return uint16_t(sign | half);
+	}
+
+	uint32_t half = sign | (uint32_t(exponent) << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	/* a carry out of the mantissa correctly bumps the exponent */
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+		half++;
+	}
+	return uint16_t(half);
+}
+
+float halfToFloat(uint16_t value)
+{
+	uint32_t sign = uint32_t(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	if (exponent == 0) {
+		float magnitude = std::ldexp(float(mantissa), -24);
+		return sign ? -magnitude : magnitude;
+	}
+	uint32_t bits;
+	if (exponent == 31) {
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	} else {
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+	}
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
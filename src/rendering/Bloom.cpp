@@ -13,11 +13,37 @@
 namespace
 {
     // Shaders
-    // uniforms: image, horizontal, kernelSize, weights[], texelSize
+    // uniforms: image, horizontal, tapCount, offsets[], weights[]
     Shader blurShader;
+    // GL 4.3 only. uniforms: image, result, horizontal, radius, weights[]
+    Shader blurComputeShader;
     // uniforms: scene, bloomBlur, bloom, exposure
     Shader combineShader;
+    // uniforms: source, sourceTexelSize, karisAverage
+    Shader downsampleShader;
+    // uniforms: source, filterRadius
+    Shader upsampleShader;
     bool shadersReady = false;
+    bool computeBlurReady = false;
+    bool computeBlurEnabled = true;
+
+    // Must match TILE in blur.comp
+    const int COMPUTE_TILE = 128;
+    // Must match the array sizes in blur.frag
+    const int MAX_LINEAR_TAPS = 33;
+
+    // Uniform handles, resolved once the shaders are linked
+    GLint blurHorizontalLoc = -1;
+    GLint blurTapCountLoc = -1;
+    GLint blurOffsetsLoc = -1;
+    GLint blurWeightsLoc = -1;
+    GLint computeHorizontalLoc = -1;
+    GLint computeRadiusLoc = -1;
+    GLint computeWeightsLoc = -1;
+    GLint combineExposureLoc = -1;
+    GLint downsampleTexelSizeLoc = -1;
+    GLint downsampleKarisLoc = -1;
+    GLint upsampleRadiusLoc = -1;
 
     // Fixed-size resources -- set by initBloom(width, height)
     GLuint pingFbo[2] = {0, 0};
@@ -27,6 +53,17 @@ namespace
     int widthFixed = 0;
     int heightFixed = 0;
 
+    // Mip pyramid for applyBloomMipChain, level 0 is half resolution
+    struct BloomMip
+    {
+        GLuint fbo = 0;
+        GLuint tex = 0;
+        int width = 0;
+        int height = 0;
+    };
+    const int MAX_BLOOM_MIPS = 6;
+    std::vector<BloomMip> mips;
+
     /**
      * @brief Allocates a color texture with RGBA16F format.
      *
@@ -118,6 +155,87 @@ namespace
         return true;
     }
 
+    /**
+     * @brief Create the downsample/upsample mip pyramid, halving the size per
+     *        level until MAX_BLOOM_MIPS levels or a side would drop below 2.
+     *
+     * @return true if creation was successful, false otherwise.
+     */
+    bool createMipChain()
+    {
+        int mipWidth = widthFixed;
+        int mipHeight = heightFixed;
+        size_t count = 0;
+        while (count < static_cast<size_t>(MAX_BLOOM_MIPS) && mipWidth / 2 >= 2 && mipHeight / 2 >= 2)
+        {
+            mipWidth /= 2;
+            mipHeight /= 2;
+            if (mips.size() <= count)
+                mips.emplace_back();
+            BloomMip &mip = mips[count];
+            mip.width = mipWidth;
+            mip.height = mipHeight;
+
+            if (mip.fbo == 0)
+                glGenFramebuffers(1, &mip.fbo);
+            glBindFramebuffer(GL_FRAMEBUFFER, mip.fbo);
+
+            if (!allocateColorTextureRGBA16F(&mip.tex, mipWidth, mipHeight))
+            {
+                LOG_ERROR(("Bloom: failed to allocate mip texture " + std::to_string(count)).c_str());
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                return false;
+            }
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mip.tex, 0);
+            glDrawBuffer(GL_COLOR_ATTACHMENT0);
+
+            GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+            if (status != GL_FRAMEBUFFER_COMPLETE)
+            {
+                LOG_ERROR(("Bloom: mip FBO " + std::to_string(count) + " incomplete (0x" +
+                           std::to_string(static_cast<unsigned int>(status)) + ")")
+                              .c_str());
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                return false;
+            }
+            ++count;
+        }
+
+        // A smaller target than last time leaves levels over
+        for (size_t i = count; i < mips.size(); ++i)
+        {
+            glDeleteTextures(1, &mips[i].tex);
+            glDeleteFramebuffers(1, &mips[i].fbo);
+        }
+        mips.resize(count);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return true;
+    }
+
+    /**
+     * @brief Load the compute blur where the context has GL 4.3. Failing is
+     *        not an error, the fragment blur is used instead.
+     */
+    void loadComputeBlur()
+    {
+        computeBlurReady = false;
+        if (!GLAD_GL_VERSION_4_3)
+        {
+            LOG_INFO("Bloom: GL 4.3 not available, using the fragment blur");
+            return;
+        }
+        if (!blurComputeShader.loadFromFiles({{COMPUTE, "shaders/bloom/blur.comp"}}))
+        {
+            LOG_WARN("Bloom: failed to load compute blur, using the fragment blur");
+            return;
+        }
+        computeHorizontalLoc = blurComputeShader.getUniformLocation("horizontal");
+        computeRadiusLoc = blurComputeShader.getUniformLocation("radius");
+        computeWeightsLoc = blurComputeShader.getUniformLocation("weights[0]");
+        computeBlurReady = true;
+    }
+
     /**
      * @brief Ensure that all required shaders are loaded.
      *
@@ -134,24 +252,45 @@ namespace
         const std::unordered_map<SHADER_TYPE, std::string> combineFiles = {
             {VERTEX, "shaders/bloom/bloom.vert"},
             {FRAGMENT, "shaders/bloom/bloom_blend.frag"}};
-
-        bool ok = blurShader.loadFromFiles(blurFiles) && combineShader.loadFromFiles(combineFiles);
+        const std::unordered_map<SHADER_TYPE, std::string> downsampleFiles = {
+            {VERTEX, "shaders/bloom/bloom.vert"},
+            {FRAGMENT, "shaders/bloom/downsample.frag"}};
+        const std::unordered_map<SHADER_TYPE, std::string> upsampleFiles = {
+            {VERTEX, "shaders/bloom/bloom.vert"},
+            {FRAGMENT, "shaders/bloom/upsample.frag"}};
+
+        // All programs compile at once where the driver supports it
+        bool begun = blurShader.beginLoadFromFiles(blurFiles) && combineShader.beginLoadFromFiles(combineFiles) &&
+                     downsampleShader.beginLoadFromFiles(downsampleFiles) &&
+                     upsampleShader.beginLoadFromFiles(upsampleFiles);
+        bool ok = begun && blurShader.finishLoad() && combineShader.finishLoad() && downsampleShader.finishLoad() &&
+                  upsampleShader.finishLoad();
         if (!ok)
         {
-            LOG_ERROR("Bloom: failed to load blur/combine shaders. Check asset paths.");
+            LOG_ERROR("Bloom: failed to load blur/combine/mip shaders. Check asset paths.");
             return false;
         }
         shadersReady = true;
 
-        blurShader.bind();
+        // Samplers never change, the rest is set per pass by handle
         blurShader.setUniform("image", 0);
-        blurShader.unbind();
+        blurHorizontalLoc = blurShader.getUniformLocation("horizontal");
+        blurTapCountLoc = blurShader.getUniformLocation("tapCount");
+        blurOffsetsLoc = blurShader.getUniformLocation("offsets[0]");
+        blurWeightsLoc = blurShader.getUniformLocation("weights[0]");
 
-        combineShader.bind();
         combineShader.setUniform("scene", 0);
         combineShader.setUniform("bloomBlur", 1);
-        combineShader.unbind();
+        combineExposureLoc = combineShader.getUniformLocation("exposure");
+
+        downsampleShader.setUniform("source", 0);
+        downsampleTexelSizeLoc = downsampleShader.getUniformLocation("sourceTexelSize");
+        downsampleKarisLoc = downsampleShader.getUniformLocation("karisAverage");
 
+        upsampleShader.setUniform("source", 0);
+        upsampleRadiusLoc = upsampleShader.getUniformLocation("filterRadius");
+
+        loadComputeBlur();
         return true;
     }
 
@@ -203,63 +342,37 @@ namespace
     }
 
     /**
-     * @brief Upload Gaussian kernel parameters to the shader.
+     * @brief Upload Gaussian kernel parameters to the fragment blur, merged
+     *        into bilinear taps.
      *
-     * @param shader The shader to upload to.
-     * @param kernelRadius The radius of the kernel.
-     * @param weights The kernel weights.
+     * @param weights The kernel weights, weights[0] is the center.
      * @return true if successful, false otherwise.
      */
-    bool uploadKernelToShader(Shader *shader, int kernelRadius, std::vector<float> *weights)
+    bool uploadKernelToShader(const std::vector<float> &weights)
     {
-        if (!shader || !weights)
+        std::vector<float> offsets;
+        std::vector<float> merged;
+        if (!mergeLinearTaps(weights, &offsets, &merged) || merged.size() > static_cast<size_t>(MAX_LINEAR_TAPS))
             return false;
 
-        int kernelSize = kernelRadius * 2 + 1;
-        shader->setUniform("kernelSize", kernelSize);
-
-        // weights array is declared as weights[64]; we set 0..radius
-        for (int i = 0; i <= kernelRadius; ++i)
-        {
-            shader->setUniform("weights[" + std::to_string(i) + "]", (*weights)[static_cast<size_t>(i)]);
-        }
-
+        GLsizei tapCount = static_cast<GLsizei>(merged.size());
+        blurShader.setUniform(blurTapCountLoc, static_cast<int>(tapCount));
+        blurShader.setUniformArray(blurOffsetsLoc, offsets.data(), tapCount);
+        blurShader.setUniformArray(blurWeightsLoc, merged.data(), tapCount);
         return true;
     }
 
     /**
-     * @brief Run a separable Gaussian blur on the given texture.
-     *        Performs two passes: horizontal and vertical.
+     * @brief Fragment blur: two fullscreen passes over the ping-pong targets.
      *
      * @param sourceTex The source texture to blur.
-     * @param kernelRadius The radius of the Gaussian kernel.
-     * @param sigma The standard deviation of the Gaussian.
+     * @param weights The kernel weights, weights[0] is the center.
      * @return GLuint The ID of the blurred texture, or 0 on failure.
      */
-    GLuint runSeparableGaussianBlur(GLuint sourceTex, int kernelRadius, float sigma)
+    GLuint runFragmentBlur(GLuint sourceTex, const std::vector<float> &weights)
     {
-        if (!shadersReady)
-            return 0;
-        if (sourceTex == 0)
-        {
-            LOG_ERROR("Bloom: runSeparableGaussianBlur sourceTex == 0");
-            return 0;
-        }
-        if (kernelRadius < 0)
-            kernelRadius = 0;
-        if (kernelRadius > 63)
-            kernelRadius = 63;
-
         blurShader.bind();
-
-        std::vector<float> weights;
-        if (!buildGaussianKernel(kernelRadius, sigma, &weights))
-        {
-            LOG_ERROR("Bloom: buildGaussianKernel failed.");
-            blurShader.unbind();
-            return 0;
-        }
-        if (!uploadKernelToShader(&blurShader, kernelRadius, &weights))
+        if (!uploadKernelToShader(weights))
         {
             LOG_ERROR("Bloom: uploadKernelToShader failed.");
             blurShader.unbind();
@@ -272,10 +385,9 @@ namespace
         glBindFramebuffer(GL_FRAMEBUFFER, pingFbo[1]);
         glViewport(0, 0, widthFixed, heightFixed);
 
-        blurShader.setUniform("horizontal", true);
+        blurShader.setUniform(blurHorizontalLoc, 1);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, sourceTex);
-        blurShader.setUniform("image", 0);
 
         renderQuad();
 
@@ -283,10 +395,9 @@ namespace
         glBindFramebuffer(GL_FRAMEBUFFER, pingFbo[0]);
         glViewport(0, 0, widthFixed, heightFixed);
 
-        blurShader.setUniform("horizontal", false);
+        blurShader.setUniform(blurHorizontalLoc, 0);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, pingTex[1]);
-        blurShader.setUniform("image", 0);
 
         renderQuad();
 
@@ -297,6 +408,145 @@ namespace
         return pingTex[0];
     }
 
+    /**
+     * @brief Compute blur: each work group caches a tile of one row or column
+     *        plus its apron in shared memory and convolves from there.
+     *
+     * @param sourceTex The source texture to blur.
+     * @param weights The kernel weights, weights[0] is the center.
+     * @return GLuint The ID of the blurred texture, or 0 on failure.
+     */
+    GLuint runComputeBlur(GLuint sourceTex, const std::vector<float> &weights)
+    {
+        int radius = static_cast<int>(weights.size()) - 1;
+
+        blurComputeShader.bind();
+        blurComputeShader.setUniform(computeRadiusLoc, radius);
+        blurComputeShader.setUniformArray(computeWeightsLoc, weights.data(), radius + 1);
+
+        GLuint rowGroups = static_cast<GLuint>((widthFixed + COMPUTE_TILE - 1) / COMPUTE_TILE);
+        GLuint columnGroups = static_cast<GLuint>((heightFixed + COMPUTE_TILE - 1) / COMPUTE_TILE);
+        glActiveTexture(GL_TEXTURE0);
+
+        // Pass 1: Horizontal, sourceTex -> pingTex[1]
+        blurComputeShader.setUniform(computeHorizontalLoc, 1);
+        glBindTexture(GL_TEXTURE_2D, sourceTex);
+        glBindImageTexture(0, pingTex[1], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute(rowGroups, static_cast<GLuint>(heightFixed), 1);
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        // Pass 2: Vertical, pingTex[1] -> pingTex[0]
+        blurComputeShader.setUniform(computeHorizontalLoc, 0);
+        glBindTexture(GL_TEXTURE_2D, pingTex[1]);
+        glBindImageTexture(0, pingTex[0], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute(columnGroups, static_cast<GLuint>(widthFixed), 1);
+        // The composite samples the result, a later pass may render into it
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+
+        glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        blurComputeShader.unbind();
+
+        // Result is now in pingTex[0]
+        return pingTex[0];
+    }
+
+    /**
+     * @brief Run a separable Gaussian blur on the given texture.
+     *        Performs two passes: horizontal and vertical, in a compute
+     *        shader where available and enabled, in a fragment shader
+     *        otherwise.
+     *
+     * @param sourceTex The source texture to blur.
+     * @param kernelRadius The radius of the Gaussian kernel.
+     * @param sigma The standard deviation of the Gaussian.
+     * @return GLuint The ID of the blurred texture, or 0 on failure.
+     */
+    GLuint runSeparableGaussianBlur(GLuint sourceTex, int kernelRadius, float sigma)
+    {
+        if (!shadersReady)
+            return 0;
+        if (sourceTex == 0)
+        {
+            LOG_ERROR("Bloom: runSeparableGaussianBlur sourceTex == 0");
+            return 0;
+        }
+
+        std::vector<float> weights;
+        if (!buildGaussianKernel(kernelRadius, sigma, &weights))
+        {
+            LOG_ERROR("Bloom: buildGaussianKernel failed.");
+            return 0;
+        }
+
+        if (computeBlurReady && computeBlurEnabled)
+            return runComputeBlur(sourceTex, weights);
+        return runFragmentBlur(sourceTex, weights);
+    }
+
+    /**
+     * @brief Progressively downsample <sourceTex> through the mip pyramid with
+     *        the 13-tap filter. The first level uses a Karis average against
+     *        fireflies.
+     *
+     * @param sourceTex The full resolution bright parts texture.
+     * @param width Width of sourceTex.
+     * @param height Height of sourceTex.
+     */
+    void downsampleMipChain(GLuint sourceTex, int width, int height)
+    {
+        downsampleShader.bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, sourceTex);
+
+        glm::vec2 texelSize(1.0f / width, 1.0f / height);
+        for (size_t i = 0; i < mips.size(); ++i)
+        {
+            const BloomMip &mip = mips[i];
+            glBindFramebuffer(GL_FRAMEBUFFER, mip.fbo);
+            glViewport(0, 0, mip.width, mip.height);
+
+            downsampleShader.setUniform(downsampleTexelSizeLoc, texelSize.x, texelSize.y);
+            downsampleShader.setUniform(downsampleKarisLoc, i == 0 ? 1 : 0);
+            renderQuad();
+
+            // This level is the source of the next one
+            texelSize = glm::vec2(1.0f / mip.width, 1.0f / mip.height);
+            glBindTexture(GL_TEXTURE_2D, mip.tex);
+        }
+        downsampleShader.unbind();
+    }
+
+    /**
+     * @brief Walk back up the pyramid, tent filtering each level and adding
+     *        it onto the next larger one. The sum ends up in mips[0].
+     *
+     * @param filterRadius Tent radius in texture coordinates.
+     */
+    void upsampleMipChain(float filterRadius)
+    {
+        upsampleShader.bind();
+        upsampleShader.setUniform(upsampleRadiusLoc, filterRadius);
+
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBlendEquation(GL_FUNC_ADD);
+        glActiveTexture(GL_TEXTURE0);
+
+        for (size_t i = mips.size() - 1; i > 0; --i)
+        {
+            const BloomMip &source = mips[i];
+            const BloomMip &target = mips[i - 1];
+            glBindTexture(GL_TEXTURE_2D, source.tex);
+
+            glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+            glViewport(0, 0, target.width, target.height);
+            renderQuad();
+        }
+
+        glDisable(GL_BLEND);
+        upsampleShader.unbind();
+    }
+
     /**
      * @brief Composite (additively blend) the scene and bloom textures.
      *
@@ -313,9 +563,7 @@ namespace
         glViewport(0, 0, widthFixed, heightFixed);
         glDisable(GL_DEPTH_TEST);
 
-        combineShader.setUniform("scene", 0);
-        combineShader.setUniform("bloomBlur", 1);
-        combineShader.setUniform("exposure", exposure);
+        combineShader.setUniform(combineExposureLoc, exposure);
 
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, sceneTex);
@@ -348,6 +596,8 @@ bool initBloom(int width, int height)
         return false;
     if (!createOutputTarget())
         return false;
+    if (!createMipChain())
+        return false;
 
     return true;
 }
@@ -424,6 +674,77 @@ GLuint applyBloomWithKernel(GLuint sceneTex,
     return outTex;
 }
 
+bool mergeLinearTaps(const std::vector<float> &weights,
+                     std::vector<float> *offsetsOut,
+                     std::vector<float> *weightsOut)
+{
+    if (!offsetsOut || !weightsOut || weights.empty())
+        return false;
+    offsetsOut->clear();
+    weightsOut->clear();
+
+    // The center tap stays on its own
+    offsetsOut->push_back(0.0f);
+    weightsOut->push_back(weights[0]);
+
+    // Texels i and i + 1 become one fetch at their weighted centroid, where
+    // bilinear filtering blends them in the ratio of their weights
+    for (size_t i = 1; i < weights.size(); i += 2)
+    {
+        float w1 = weights[i];
+        float w2 = i + 1 < weights.size() ? weights[i + 1] : 0.0f;
+        float w = w1 + w2;
+        float offset = w > 0.0f ? (i * w1 + (i + 1) * w2) / w : static_cast<float>(i);
+        offsetsOut->push_back(offset);
+        weightsOut->push_back(w);
+    }
+    return true;
+}
+
+bool setBloomComputeBlur(bool enabled)
+{
+    computeBlurEnabled = enabled;
+    return isBloomComputeBlurActive();
+}
+
+bool isBloomComputeBlurActive()
+{
+    return computeBlurReady && computeBlurEnabled;
+}
+
+GLuint applyBloomMipChain(GLuint sceneTex,
+                          GLuint brightTex,
+                          float filterRadius,
+                          float exposure)
+{
+    if (sceneTex == 0 || brightTex == 0)
+    {
+        LOG_ERROR(("applyBloomMipChain: invalid inputs (sceneTex=" + std::to_string(sceneTex) + ", brightTex=" + std::to_string(brightTex) + ").").c_str());
+        return 0;
+    }
+    if (!shadersReady || outFbo == 0 || mips.empty())
+    {
+        LOG_ERROR("applyBloomMipChain: bloom not initialized. Call initBloom(width, height) first.");
+        return 0;
+    }
+    if (filterRadius <= 0.0f)
+        filterRadius = 0.005f;
+
+    glDisable(GL_DEPTH_TEST);
+
+    downsampleMipChain(brightTex, widthFixed, heightFixed);
+    upsampleMipChain(filterRadius);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // The composite samples the half resolution result bilinearly
+    if (!compositeSceneAndBloom(sceneTex, mips[0].tex, exposure))
+    {
+        LOG_ERROR("applyBloomMipChain: composite failed.");
+        return 0;
+    }
+    return outTex;
+}
+
 void destroyBloomResources()
 {
     for (int i = 0; i < 2; ++i)
@@ -449,7 +770,19 @@ void destroyBloomResources()
         glDeleteFramebuffers(1, &outFbo);
         outFbo = 0;
     }
+    for (BloomMip &mip : mips)
+    {
+        if (mip.tex)
+            glDeleteTextures(1, &mip.tex);
+        if (mip.fbo)
+            glDeleteFramebuffers(1, &mip.fbo);
+    }
+    mips.clear();
 
     widthFixed = heightFixed = 0;
     shadersReady = false;
+    computeBlurReady = false;
+    blurHorizontalLoc = blurTapCountLoc = blurOffsetsLoc = blurWeightsLoc = combineExposureLoc = -1;
+    computeHorizontalLoc = computeRadiusLoc = computeWeightsLoc = -1;
+    downsampleTexelSizeLoc = downsampleKarisLoc = upsampleRadiusLoc = -1;
 }
@@ -0,0 +1,291 @@
+#include "rendering/CullingStage.hpp"
+#include "modeling/Model.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define CULL_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define CULL_SSE
+#endif
+
+using namespace rendering;
+
+namespace {
+
+    /*
+     * For each plane, the coordinate arrays of the box corner farthest
+     * along its normal and of the one nearest to it. A box is outside if
+     * its far corner is behind the plane, and crosses the plane if only
+     * its near corner is
+     */
+    struct PlaneCorners {
+        float nx, ny, nz, w;
+        const float *farX, *farY, *farZ;
+        const float *nearX, *nearY, *nearZ;
+    };
+
+    void selectCorners(const modeling::Frustum &frustum, const BoxList &boxes, PlaneCorners *corners) {
+        for (int p = 0; p < modeling::Frustum::PLANE_COUNT; p++) {
+            const glm::vec4 &plane = frustum.planes[p];
+            PlaneCorners &c = corners[p];
+            c.nx = plane.x; c.ny = plane.y; c.nz = plane.z; c.w = plane.w;
+            c.farX = plane.x >= 0.f ? boxes.maxX.data() : boxes.minX.data();
+            c.farY = plane.y >= 0.f ? boxes.maxY.data() : boxes.minY.data();
+            c.farZ = plane.z >= 0.f ? boxes.maxZ.data() : boxes.minZ.data();
+            c.nearX = plane.x >= 0.f ? boxes.minX.data() : boxes.maxX.data();
+            c.nearY = plane.y >= 0.f ? boxes.minY.data() : boxes.maxY.data();
+            c.nearZ = plane.z >= 0.f ? boxes.minZ.data() : boxes.maxZ.data();
+        }
+    }
+
+    // one box, bit 0 set if outside, bit 1 if crossing a plane
+    unsigned testBox(const PlaneCorners *corners, size_t i) {
+        bool crossing = false;
+        for (int p = 0; p < modeling::Frustum::PLANE_COUNT; p++) {
+            const PlaneCorners &c = corners[p];
+            if (c.nx * c.farX[i] + c.ny * c.farY[i] + c.nz * c.farZ[i] + c.w < 0.f) {
+                return 1;
+            }
+            crossing = crossing || c.nx * c.nearX[i] + c.ny * c.nearY[i] + c.nz * c.nearZ[i] + c.w < 0.f;
+        }
+        return crossing ? 2 : 0;
+    }
+
+#if defined(CULL_AVX)
+    const size_t GROUP = 8;
+
+    // signed distances of eight corners to a plane
+    __m256 planeDistance(const PlaneCorners &c, const float *x, const float *y, const float *z) {
+        __m256 d = _mm256_mul_ps(_mm256_set1_ps(c.nx), _mm256_loadu_ps(x));
+        d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(c.ny), _mm256_loadu_ps(y)));
+        d = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(c.nz), _mm256_loadu_ps(z)));
+        return _mm256_add_ps(d, _mm256_set1_ps(c.w));
+    }
+
+    // eight boxes from <i>, one bit per box in <outside> and <crossing>
+    void testGroup(const PlaneCorners *corners, size_t i, unsigned &outside, unsigned &crossing) {
+        const __m256 zero = _mm256_setzero_ps();
+        __m256 out = zero;
+        __m256 cross = zero;
+        for (int p = 0; p < modeling::Frustum::PLANE_COUNT; p++) {
+            const PlaneCorners &c = corners[p];
+            __m256 farDistance = planeDistance(c, c.farX + i, c.farY + i, c.farZ + i);
+            __m256 nearDistance = planeDistance(c, c.nearX + i, c.nearY + i, c.nearZ + i);
+            out = _mm256_or_ps(out, _mm256_cmp_ps(farDistance, zero, _CMP_LT_OQ));
+            cross = _mm256_or_ps(cross, _mm256_cmp_ps(nearDistance, zero, _CMP_LT_OQ));
+        }
+        outside = unsigned(_mm256_movemask_ps(out));
+        crossing = unsigned(_mm256_movemask_ps(cross));
+    }
+#elif defined(CULL_SSE)
+    const size_t GROUP = 4;
+
+    // signed distances of four corners to a plane
+    __m128 planeDistance(const PlaneCorners &c, const float *x, const float *y, const float *z) {
+        __m128 d = _mm_mul_ps(_mm_set1_ps(c.nx), _mm_loadu_ps(x));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(c.ny), _mm_loadu_ps(y)));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(c.nz), _mm_loadu_ps(z)));
+        return _mm_add_ps(d, _mm_set1_ps(c.w));
+    }
+
+    // four boxes from <i>, one bit per box in <outside> and <crossing>
+    void testGroup(const PlaneCorners *corners, size_t i, unsigned &outside, unsigned &crossing) {
+        const __m128 zero = _mm_setzero_ps();
+        __m128 out = zero;
+        __m128 cross = zero;
+        for (int p = 0; p < modeling::Frustum::PLANE_COUNT; p++) {
+            const PlaneCorners &c = corners[p];
+            __m128 farDistance = planeDistance(c, c.farX + i, c.farY + i, c.farZ + i);
+            __m128 nearDistance = planeDistance(c, c.nearX + i, c.nearY + i, c.nearZ + i);
+            out = _mm_or_ps(out, _mm_cmplt_ps(farDistance, zero));
+            cross = _mm_or_ps(cross, _mm_cmplt_ps(nearDistance, zero));
+        }
+        outside = unsigned(_mm_movemask_ps(out));
+        crossing = unsigned(_mm_movemask_ps(cross));
+    }
+#endif
+
+}
+
+void BoxList::add(const glm::vec3 &min, const glm::vec3 &max) {
+    minX.push_back(min.x); minY.push_back(min.y); minZ.push_back(min.z);
+    maxX.push_back(max.x); maxY.push_back(max.y); maxZ.push_back(max.z);
+}
+
+void BoxList::clear() {
+    minX.clear(); minY.clear(); minZ.clear();
+    maxX.clear(); maxY.clear(); maxZ.clear();
+}
+
+CullingStage::CullingStage() {
+    // no planes, everything is visible until a camera is set
+    for (glm::vec4 &plane : frustum.planes) {
+        plane = glm::vec4(0.f);
+    }
+}
+
+CullingStage &CullingStage::shared() {
+    static CullingStage stage;
+    return stage;
+}
+
+void CullingStage::setCamera(Camera &camera, float aspect, float nearPlane, float farPlane) {
+    Eigen::Matrix4f clip = camera.getProjection(aspect, nearPlane, farPlane) * camera.getView();
+    glm::mat4 clipFromWorld;
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            clipFromWorld[c][r] = clip(r, c);
+        }
+    }
+    frustum = modeling::Frustum::fromMatrix(clipFromWorld);
+}
+
+uint32_t CullingStage::addObject(const modeling::Model &model, const glm::mat4 &transform) {
+    Span<const glm::mat4> instances = model.getInstances();
+    glm::mat4 placement = instances.size() == 1 ? transform * instances[0] : transform;
+    bool instanced = instances.size() > 1;
+
+    glm::vec3 min, max;
+    if (model.getBounds(min, max)) {
+        if (instanced) {
+            // per instance culling would need a per frame instance buffer
+            glm::vec3 instanceMin, instanceMax, unionMin, unionMax;
+            for (size_t i = 0; i < instances.size(); i++) {
+                transformBox(transform * instances[i], min, max, instanceMin, instanceMax);
+                unionMin = i == 0 ? instanceMin : glm::min(unionMin, instanceMin);
+                unionMax = i == 0 ? instanceMax : glm::max(unionMax, instanceMax);
+            }
+            min = unionMin;
+            max = unionMax;
+        } else {
+            transformBox(placement, min, max, min, max);
+        }
+    } else {
+        // no meshes, a point keeps the object indices in step with the boxes
+        min = max = glm::vec3(placement[3]);
+    }
+    objects.push_back(Entry{ &model, placement, instanced });
+    objectBoxes.add(min, max);
+    return uint32_t(objects.size() - 1);
+}
+
+void CullingStage::clear() {
+    objects.clear();
+    objectBoxes.clear();
+    visible.clear();
+}
+
+size_t CullingStage::cull() {
+    visible.clear();
+    cullBoxes(frustum, objectBoxes, visibleObjects, &insideObjects);
+    testedBoxes = objectBoxes.size();
+
+    // objects inside the frustum take all their meshes, the others are tested mesh by mesh
+    meshBoxes.clear();
+    meshIndices.clear();
+    size_t nextInside = 0;
+    for (uint32_t object : visibleObjects) {
+        bool inside = nextInside < insideObjects.size() && insideObjects[nextInside] == object;
+        nextInside += inside;
+
+        Span<const std::shared_ptr<Mesh>> meshes = objects[object].model->getMeshes();
+        for (uint32_t m = 0; m < meshes.size(); m++) {
+            if (!meshes[m]) {
+                continue;
+            }
+            if (inside || meshes.size() == 1 || objects[object].instanced) {
+                visible.push_back(VisibleMesh{ object, m });
+                continue;
+            }
+            glm::vec3 min, max;
+            transformBox(objects[object].transform, meshes[m]->getBoundsMin(), meshes[m]->getBoundsMax(), min, max);
+            meshBoxes.add(min, max);
+            meshIndices.push_back(uint32_t(visible.size()));
+            visible.push_back(VisibleMesh{ object, m });
+        }
+    }
+    if (meshBoxes.size() == 0) {
+        return visible.size();
+    }
+
+    // drop the meshes that failed, keeping the order
+    cullBoxes(frustum, meshBoxes, visibleMeshes);
+    testedBoxes += meshBoxes.size();
+    size_t write = 0;
+    size_t nextTested = 0;
+    size_t nextVisible = 0;
+    for (size_t read = 0; read < visible.size(); read++) {
+        if (nextTested < meshIndices.size() && meshIndices[nextTested] == read) {
+            bool passed = nextVisible < visibleMeshes.size() && visibleMeshes[nextVisible] == nextTested;
+            nextVisible += passed;
+            nextTested++;
+            if (!passed) {
+                continue;
+            }
+        }
+        visible[write++] = visible[read];
+    }
+    visible.resize(write);
+    return visible.size();
+}
+
+void CullingStage::cullBoxes(const modeling::Frustum &frustum, const BoxList &boxes,
+                             std::vector<uint32_t> &visible, std::vector<uint32_t> *inside) {
+    visible.clear();
+    if (inside) {
+        inside->clear();
+    }
+    PlaneCorners corners[modeling::Frustum::PLANE_COUNT];
+    selectCorners(frustum, boxes, corners);
+
+    size_t count = boxes.size();
+    size_t i = 0;
+#if defined(CULL_AVX) || defined(CULL_SSE)
+    for (; i + GROUP <= count; i += GROUP) {
+        unsigned outside, crossing;
+        testGroup(corners, i, outside, crossing);
+        if (outside == (1u << GROUP) - 1) {
+            continue;
+        }
+        for (unsigned lane = 0; lane < GROUP; lane++) {
+            if (outside & (1u << lane)) {
+                continue;
+            }
+            visible.push_back(uint32_t(i + lane));
+            if (inside && !(crossing & (1u << lane))) {
+                inside->push_back(uint32_t(i + lane));
+            }
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        unsigned result = testBox(corners, i);
+        if (result & 1) {
+            continue;
+        }
+        visible.push_back(uint32_t(i));
+        if (inside && result == 0) {
+            inside->push_back(uint32_t(i));
+        }
+    }
+}
+
+void CullingStage::transformBox(const glm::mat4 &transform, const glm::vec3 &min, const glm::vec3 &max,
+                                glm::vec3 &outMin, glm::vec3 &outMax) {
+    // Arvo 1990: transform the center, the extent grows by the absolute rotation and scale
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extent = (max - min) * 0.5f;
+    glm::vec3 newCenter = glm::vec3(transform * glm::vec4(center, 1.f));
+    glm::vec3 newExtent(0.f);
+    for (int c = 0; c < 3; c++) {
+        for (int r = 0; r < 3; r++) {
+            newExtent[r] += std::fabs(transform[c][r]) * extent[c];
+        }
+    }
+    outMin = newCenter - newExtent;
+    outMax = newCenter + newExtent;
+}
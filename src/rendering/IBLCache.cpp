@@ -0,0 +1,280 @@
+#include "rendering/IBLCache.hpp"
+#include "utils/AtomicFile.hpp"
+#include "utils/Logger.hpp"
+#include "utils/StringId.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+using namespace rendering;
+
+namespace {
+
+    const char MAGIC[4] = { 'I', 'B', 'L', '1' };
+    const uint32_t VERSION = 1;
+
+    // the default is resolved on first use, temp_directory_path() can throw
+    std::mutex directoryMutex;
+    std::string directory;
+    bool directoryResolved = false;
+
+    template <typename T>
+    uint64_t hashValue(const T &value, uint64_t hash) {
+        return StringId::hashOf(std::string_view(reinterpret_cast<const char *>(&value), sizeof(value)), hash);
+    }
+
+    // format and bytes per pixel to read back <internalFormat> with, 0 if not a float format we know
+    uint32_t halfFloatFormat(GLint internalFormat, GLenum &format) {
+        switch (internalFormat) {
+        case GL_R16F: case GL_R32F:
+            format = GL_RED;
+            return 2;
+        case GL_RG16F: case GL_RG32F:
+            format = GL_RG;
+            return 4;
+        case GL_RGB16F: case GL_RGB32F:
+            format = GL_RGB;
+            return 6;
+        case GL_RGBA16F: case GL_RGBA32F:
+            format = GL_RGBA;
+            return 8;
+        }
+        return 0;
+    }
+
+    template <typename T>
+    void writeValue(std::ofstream &file, const T &value) {
+        file.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    bool readValue(std::ifstream &file, T &value) {
+        file.read(reinterpret_cast<char *>(&value), sizeof(value));
+        return bool(file);
+    }
+
+}
+
+uint64_t IBLCache::hashFile(const std::string &path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return 0;
+    }
+    uint64_t hash = StringId::HASH_SEED;
+    char buffer[1 << 16];
+    while (file) {
+        file.read(buffer, sizeof(buffer));
+        hash = StringId::hashOf(std::string_view(buffer, size_t(file.gcount())), hash);
+    }
+    // never 0, that is the BRDF LUT's source
+    return hash != 0 ? hash : 1;
+}
+
+uint64_t IBLCache::computeKey(Kind kind, uint64_t sourceHash, uint32_t size) {
+    uint32_t kindValue = kind;
+    uint64_t hash = hashValue(kindValue, StringId::HASH_SEED);
+    hash = hashValue(sourceHash, hash);
+    return hashValue(size, hash);
+}
+
+void IBLCache::setDirectory(const std::string &path) {
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    directory = path;
+    directoryResolved = true;
+}
+
+std::string IBLCache::getDirectory() {
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    if (!directoryResolved) {
+        directoryResolved = true;
+        std::error_code error;
+        std::filesystem::path temp = std::filesystem::temp_directory_path(error);
+        if (error) {
+            LOG_WARN_F("No temporary directory ({}), IBL cache disabled", error.message());
+        } else {
+            directory = (temp / "ibl-cache").string();
+        }
+    }
+    return directory;
+}
+
+std::string IBLCache::pathFor(uint64_t key) {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.ibl", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(getDirectory()) / name).string();
+}
+
+GLuint IBLCache::load(uint64_t key, GLenum target) {
+    if (getDirectory().empty()) {
+        return 0;
+    }
+    IBLTextureData data;
+    if (!readFile(pathFor(key), key, data)) {
+        return 0;
+    }
+    uint32_t faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    if (data.faces != faces) {
+        LOG_WARN_F("IBL cache entry {} has {} faces, expected {}", pathFor(key), data.faces, faces);
+        return 0;
+    }
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(target, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (uint32_t level = 0; level < data.levels; ++level) {
+        GLsizei width = GLsizei(std::max(data.width >> level, 1u));
+        GLsizei height = GLsizei(std::max(data.height >> level, 1u));
+        for (uint32_t face = 0; face < faces; ++face) {
+            GLenum imageTarget = faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+            const std::vector<uint8_t> &image = data.images[level * faces + face];
+            if (data.compressed()) {
+                glCompressedTexImage2D(imageTarget, GLint(level), data.internalFormat, width, height, 0,
+                                       GLsizei(image.size()), image.data());
+            } else {
+                glTexImage2D(imageTarget, GLint(level), GLint(data.internalFormat), width, height, 0,
+                             data.format, data.type, image.data());
+            }
+        }
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    if (target == GL_TEXTURE_CUBE_MAP) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    }
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, data.levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, GLint(data.levels - 1));
+    glBindTexture(target, 0);
+    return texture;
+}
+
+bool IBLCache::store(GLuint texture, GLenum target, uint64_t key) {
+    std::string dir = getDirectory();
+    if (dir.empty() || texture == 0) {
+        return false;
+    }
+    IBLTextureData data;
+    data.faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+    GLenum baseTarget = data.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+
+    glBindTexture(target, texture);
+    GLint width = 0, height = 0, internalFormat = 0, compressed = 0;
+    glGetTexLevelParameteriv(baseTarget, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(baseTarget, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(baseTarget, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+    glGetTexLevelParameteriv(baseTarget, 0, GL_TEXTURE_COMPRESSED, &compressed);
+
+    GLenum format = 0;
+    uint32_t pixelSize = compressed ? 0 : halfFloatFormat(internalFormat, format);
+    if (width <= 0 || height <= 0 || (!compressed && pixelSize == 0)) {
+        glBindTexture(target, 0);
+        return false;
+    }
+    data.internalFormat = uint32_t(internalFormat);
+    data.format = compressed ? 0 : format;
+    data.type = compressed ? 0 : GL_HALF_FLOAT;
+    data.width = uint32_t(width);
+    data.height = uint32_t(height);
+
+    // levels that were allocated, the chain ends at the first empty one
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (GLint level = 0; ; ++level) {
+        GLint levelWidth = 0, levelHeight = 0;
+        glGetTexLevelParameteriv(baseTarget, level, GL_TEXTURE_WIDTH, &levelWidth);
+        glGetTexLevelParameteriv(baseTarget, level, GL_TEXTURE_HEIGHT, &levelHeight);
+        if (levelWidth <= 0 || levelHeight <= 0) {
+            break;
+        }
+        for (uint32_t face = 0; face < data.faces; ++face) {
+            GLenum imageTarget = data.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+            std::vector<uint8_t> image;
+            if (compressed) {
+                GLint imageSize = 0;
+                glGetTexLevelParameteriv(imageTarget, level, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &imageSize);
+                image.resize(size_t(std::max(imageSize, 0)));
+                glGetCompressedTexImage(imageTarget, level, image.data());
+            } else {
+                image.resize(size_t(levelWidth) * size_t(levelHeight) * pixelSize);
+                glGetTexImage(imageTarget, level, format, GL_HALF_FLOAT, image.data());
+            }
+            data.images.push_back(std::move(image));
+        }
+        ++data.levels;
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(target, 0);
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    return writeFile(pathFor(key), key, data);
+}
+
+bool IBLCache::writeFile(const std::string &path, uint64_t key, const IBLTextureData &data) {
+    if (data.images.size() != size_t(data.levels) * data.faces) {
+        return false;
+    }
+    return writeFileAtomically(path, [&](std::ofstream &file) {
+        file.write(MAGIC, sizeof(MAGIC));
+        writeValue(file, VERSION);
+        writeValue(file, key);
+        writeValue(file, data.internalFormat);
+        writeValue(file, data.format);
+        writeValue(file, data.type);
+        writeValue(file, data.width);
+        writeValue(file, data.height);
+        writeValue(file, data.faces);
+        writeValue(file, data.levels);
+        for (const std::vector<uint8_t> &image : data.images) {
+            writeValue(file, uint32_t(image.size()));
+            file.write(reinterpret_cast<const char *>(image.data()), std::streamsize(image.size()));
+        }
+        return true;
+    });
+}
+
+bool IBLCache::readFile(const std::string &path, uint64_t key, IBLTextureData &data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    file.read(magic, sizeof(magic));
+    bool ok = readValue(file, version) && readValue(file, storedKey) &&
+              readValue(file, data.internalFormat) && readValue(file, data.format) && readValue(file, data.type) &&
+              readValue(file, data.width) && readValue(file, data.height) &&
+              readValue(file, data.faces) && readValue(file, data.levels);
+    if (!ok || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION || storedKey != key) {
+        return false;
+    }
+    // a full mip chain of a 64k texture has 17 levels
+    if ((data.faces != 1 && data.faces != 6) || data.levels == 0 || data.levels > 17 ||
+        data.width == 0 || data.height == 0) {
+        return false;
+    }
+
+    data.images.assign(size_t(data.levels) * data.faces, {});
+    for (std::vector<uint8_t> &image : data.images) {
+        uint32_t size = 0;
+        if (!readValue(file, size) || size == 0) {
+            return false;
+        }
+        image.resize(size);
+        file.read(reinterpret_cast<char *>(image.data()), std::streamsize(size));
+        if (file.gcount() != std::streamsize(size)) {
+            return false;
+        }
+    }
+    return true;
+}
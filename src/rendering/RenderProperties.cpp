@@ -1,4 +1,6 @@
 #include "rendering/RenderProperties.hpp"
+#include "rendering/CullingStage.hpp"
+#include "modeling/Model.hpp"
 
 using namespace rendering;
 
@@ -28,8 +30,12 @@ void RenderProperties::unload() {
 }
 
 /**
- * Run shaders for this object
+ * Submit this object's model to CullingStage::shared(),
+ * the renderer draws what survives culling
 */
 void RenderProperties::update(const modeling::ModelProperties &modelProps, const animation::AnimationProperties &animProps) {
-    
+    std::shared_ptr<modeling::Model> model = modelProps.getModel();
+    if (model) {
+        CullingStage::shared().addObject(*model, transform);
+    }
 }
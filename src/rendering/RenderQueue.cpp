@@ -0,0 +1,211 @@
+#include <glad/glad.h>
+
+#include "rendering/RenderQueue.hpp"
+#include "modeling/GeometryArena.hpp"
+#include "modeling/MaterialSource.hpp"
+#include "modeling/Model.hpp"
+#include "utils/Shader.hpp"
+
+#include <cstring>
+
+using namespace rendering;
+
+static_assert(RenderQueue::MATERIAL_TEXTURES == modeling::TEXTURE_SLOT_COUNT,
+              "every material texture has a unit");
+
+namespace {
+
+    uint64_t field(uint32_t value, int bits) {
+        uint32_t max = (1u << bits) - 1;
+        return uint64_t(value < max ? value : max);
+    }
+
+    // top DEPTH_BITS of the float, non-negative floats order like their bit patterns
+    uint32_t depthBits(float depth) {
+        uint32_t bits;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> (32 - RenderQueue::DEPTH_BITS);
+    }
+
+}
+
+uint64_t RenderQueue::makeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t geometry, float depth) {
+    uint32_t depthField = depthBits(depth > 0.f ? depth : 0.f);
+    uint64_t key = field(pass, PASS_BITS);
+    if (pass == PASS_TRANSPARENT) {
+        // back to front first, state only breaks ties
+        key = (key << DEPTH_BITS) | ((1u << DEPTH_BITS) - 1 - depthField);
+        key = (key << SHADER_BITS) | field(shader, SHADER_BITS);
+        key = (key << MATERIAL_BITS) | field(material, MATERIAL_BITS);
+        return (key << GEOMETRY_BITS) | field(geometry, GEOMETRY_BITS);
+    }
+    key = (key << SHADER_BITS) | field(shader, SHADER_BITS);
+    key = (key << MATERIAL_BITS) | field(material, MATERIAL_BITS);
+    key = (key << GEOMETRY_BITS) | field(geometry, GEOMETRY_BITS);
+    return (key << DEPTH_BITS) | depthField;
+}
+
+uint32_t RenderQueue::numberOf(IdMap &ids, const void *object, int bits) {
+    if (const uint32_t *id = ids.find(object)) {
+        return *id;
+    }
+    uint32_t id = uint32_t(field(uint32_t(ids.size()), bits));
+    ids.insert(object, id);
+    return id;
+}
+
+void RenderQueue::add(RenderPass pass, Shader &shader, const Material *material, const Mesh &mesh,
+                      float depth, uint32_t object, size_t lod,
+                      const modeling::Model *instances) {
+    uint32_t shaderId = numberOf(shaderIds, &shader, SHADER_BITS);
+    // no material sorts first within its shader
+    uint32_t materialId = material ? numberOf(materialIds, material, MATERIAL_BITS) + 1 : 0;
+    uint32_t pool = mesh.getGeometry().pool;
+
+    DrawItem item;
+    item.key = makeKey(pass, shaderId, materialId, pool, depth);
+    item.shader = &shader;
+    item.material = material;
+    item.mesh = &mesh;
+    item.lod = uint32_t(lod);
+    item.object = object;
+    item.instances = instances;
+    items.push_back(item);
+    sorted = false;
+}
+
+void RenderQueue::sort() {
+    if (!sorted) {
+        radixSort(items, scratch);
+        sorted = true;
+    }
+}
+
+void RenderQueue::clear() {
+    items.clear();
+    shaderIds.clear();
+    materialIds.clear();
+    sorted = true;
+}
+
+void RenderQueue::radixSort(std::vector<DrawItem> &items, std::vector<DrawItem> &scratch) {
+    size_t count = items.size();
+    if (count < 2) {
+        return;
+    }
+    scratch.resize(count);
+
+    // all eight histograms in one read of the keys
+    size_t histograms[8][256] = {};
+    for (const DrawItem &item : items) {
+        for (int byte = 0; byte < 8; byte++) {
+            histograms[byte][(item.key >> (byte * 8)) & 0xFF]++;
+        }
+    }
+
+    DrawItem *from = items.data();
+    DrawItem *to = scratch.data();
+    for (int byte = 0; byte < 8; byte++) {
+        size_t *histogram = histograms[byte];
+        // every key has the same byte here, the pass would not move anything
+        if (histogram[(from[0].key >> (byte * 8)) & 0xFF] == count) {
+            continue;
+        }
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+        for (size_t i = 0; i < count; i++) {
+            to[histogram[(from[i].key >> (byte * 8)) & 0xFF]++] = from[i];
+        }
+        std::swap(from, to);
+    }
+    if (from != items.data()) {
+        items.swap(scratch);
+    }
+}
+
+size_t RenderQueue::submit(const DrawCallback &beforeDraw) {
+    sort();
+    stats = Stats();
+
+    modeling::GeometryArena &arena = modeling::GeometryArena::shared();
+    GLuint program = 0;
+    const Material *material = nullptr;
+    GLuint textures[MATERIAL_TEXTURES] = {};
+    uint32_t pool = modeling::GeometryRange::NO_POOL;
+    const VertexEncoding *encoding = nullptr;
+
+    for (const DrawItem &item : items) {
+        const modeling::GeometryRange &geometry = item.mesh->getGeometry();
+        if (!geometry.valid() || item.lod >= item.mesh->getLodCount()) {
+            continue;
+        }
+
+        if (item.shader->getProgram() != program) {
+            program = item.shader->getProgram();
+            glUseProgram(program);
+            stats.programBinds++;
+        }
+
+        if (item.material && item.material != material) {
+            material = item.material;
+            const Texture *materialTextures[MATERIAL_TEXTURES] = {
+                &material->base_color, &material->normal, &material->albedo,
+                &material->metallic, &material->roughness, &material->ambient_occlusion,
+            };
+            // unit N is TextureSlot N, the samplers Material::setSamplers sets.
+            // materials share textures, the default one above all
+            for (int unit = 0; unit < MATERIAL_TEXTURES; unit++) {
+                GLuint id = materialTextures[unit]->id;
+                if (id != textures[unit]) {
+                    glActiveTexture(GL_TEXTURE0 + unit);
+                    glBindTexture(GL_TEXTURE_2D, id);
+                    textures[unit] = id;
+                    stats.textureBinds++;
+                }
+            }
+        }
+
+        if (geometry.pool != pool) {
+            pool = geometry.pool;
+            arena.bind(pool);
+            stats.vertexArrayBinds++;
+        }
+
+        // the constant attributes Mesh::bind sets, only when the decode parameters differ
+        const VertexEncoding &meshEncoding = item.mesh->getVertexEncoding();
+        if (!encoding || encoding->format != meshEncoding.format ||
+            encoding->positionScale != meshEncoding.positionScale ||
+            encoding->positionOffset != meshEncoding.positionOffset) {
+            encoding = &meshEncoding;
+            const glm::vec3 &scale = meshEncoding.positionScale;
+            const glm::vec3 &offset = meshEncoding.positionOffset;
+            float octahedral = meshEncoding.format == VertexFormat::FLOAT ? 0.f : 1.f;
+            glVertexAttrib4f(4, scale.x, scale.y, scale.z, octahedral);
+            glVertexAttrib3f(5, offset.x, offset.y, offset.z);
+        }
+
+        if (beforeDraw) {
+            beforeDraw(item);
+        }
+        const MeshLod &level = item.mesh->getLod(item.lod);
+        size_t offset = (geometry.firstIndex + level.firstIndex) * arena.getIndexSize(pool);
+        if (item.instances && item.instances->bindInstances()) {
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, GLsizei(level.indexCount), arena.getIndexType(pool),
+                                              (void*)offset, GLsizei(item.instances->getInstanceCount()),
+                                              GLint(geometry.baseVertex));
+            modeling::Model::unbindInstances();
+        } else {
+            glDrawElementsBaseVertex(GL_TRIANGLES, GLsizei(level.indexCount), arena.getIndexType(pool),
+                                     (void*)offset, GLint(geometry.baseVertex));
+        }
+        stats.draws++;
+    }
+    if (pool != modeling::GeometryRange::NO_POOL) {
+        glBindVertexArray(0);
+    }
+    return stats.draws;
+}
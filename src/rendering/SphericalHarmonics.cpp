@@ -0,0 +1,183 @@
+#include "rendering/SphericalHarmonics.hpp"
+#include "utils/Shader.hpp"
+#include "utils/ThreadPool.hpp"
+
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+    #include <emmintrin.h>
+    #define SH_SSE
+#endif
+
+using namespace rendering;
+
+namespace {
+
+    const float PI_F = 3.14159265358979323846f;
+
+    // real SH basis constants for l = 0, 1, 2
+    const float Y0 = 0.282095f;
+    const float Y1 = 0.488603f;
+    const float Y2 = 1.092548f;
+    const float Y20 = 0.315392f;
+    const float Y22 = 0.546274f;
+
+    // clamped cosine convolution divided by PI, per coefficient: 1, 2/3 and 1/4 by band
+    const float BAND[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    // basis constant of each coefficient, folded in at the end so evaluate() needs none
+    const float SCALE[9] = { Y0, Y1, Y1, Y1, Y2, Y2, Y20, Y2, Y22 };
+
+    /*
+     * One row of the image split into planar channels, padded with zeros
+     * to a multiple of four pixels. Padding has no colour and adds nothing
+     */
+    struct Row {
+        std::vector<float> r, g, b;
+    };
+
+    /*
+     * Sum colour * basis over the pixels of a row, without the basis
+     * constants and the solid angle. <cosPhi> and <sinPhi> give the
+     * longitude of each column, <cosLat> and <y> the latitude of the row
+     */
+    void sumRow(const Row &row, const float *cosPhi, const float *sinPhi, size_t count,
+                float cosLat, float y, float sums[9][3]) {
+        size_t i = 0;
+#if defined(SH_SSE)
+        __m128 acc[9][3];
+        for (auto &coefficient : acc) {
+            for (__m128 &channel : coefficient) {
+                channel = _mm_setzero_ps();
+            }
+        }
+        const __m128 vy = _mm_set1_ps(y);
+        const __m128 vCosLat = _mm_set1_ps(cosLat);
+        const __m128 three = _mm_set1_ps(3.0f);
+        const __m128 one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = _mm_mul_ps(vCosLat, _mm_loadu_ps(cosPhi + i));
+            __m128 z = _mm_mul_ps(vCosLat, _mm_loadu_ps(sinPhi + i));
+            __m128 basis[9] = {
+                one,
+                vy,
+                z,
+                x,
+                _mm_mul_ps(x, vy),
+                _mm_mul_ps(vy, z),
+                _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(z, z)), one),
+                _mm_mul_ps(x, z),
+                _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(vy, vy)),
+            };
+            __m128 colour[3] = { _mm_loadu_ps(&row.r[i]), _mm_loadu_ps(&row.g[i]), _mm_loadu_ps(&row.b[i]) };
+            for (int k = 0; k < 9; ++k) {
+                for (int c = 0; c < 3; ++c) {
+                    acc[k][c] = _mm_add_ps(acc[k][c], _mm_mul_ps(colour[c], basis[k]));
+                }
+            }
+        }
+        for (int k = 0; k < 9; ++k) {
+            for (int c = 0; c < 3; ++c) {
+                float lanes[4];
+                _mm_storeu_ps(lanes, acc[k][c]);
+                sums[k][c] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            }
+        }
+#else
+        for (int k = 0; k < 9; ++k) {
+            sums[k][0] = sums[k][1] = sums[k][2] = 0.0f;
+        }
+#endif
+        for (; i < count; ++i) {
+            float x = cosLat * cosPhi[i];
+            float z = cosLat * sinPhi[i];
+            float basis[9] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+            float colour[3] = { row.r[i], row.g[i], row.b[i] };
+            for (int k = 0; k < 9; ++k) {
+                for (int c = 0; c < 3; ++c) {
+                    sums[k][c] += colour[c] * basis[k];
+                }
+            }
+        }
+    }
+
+}
+
+void SHIrradiance::evaluate(float x, float y, float z, float out[3]) const {
+    float basis[9] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+    for (int c = 0; c < 3; ++c) {
+        out[c] = 0.0f;
+        for (int k = 0; k < 9; ++k) {
+            out[c] += rgb[k][c] * basis[k];
+        }
+    }
+}
+
+SHIrradiance rendering::projectEquirectSH(const float *pixels, int width, int height, int components) {
+    SHIrradiance sh;
+    if (!pixels || width <= 0 || height <= 0 || components <= 0) {
+        return sh;
+    }
+    size_t w = size_t(width);
+    size_t padded = (w + 3) & ~size_t(3);
+
+    // longitude of each column, the same for every row: u = atan(z, x) / 2PI + 0.5
+    std::vector<float> cosPhi(padded, 0.0f), sinPhi(padded, 0.0f);
+    for (size_t i = 0; i < w; ++i) {
+        float phi = ((float(i) + 0.5f) / float(width) - 0.5f) * 2.0f * PI_F;
+        cosPhi[i] = std::cos(phi);
+        sinPhi[i] = std::sin(phi);
+    }
+
+    // rows summed in parallel, reduced in order so the result doesn't depend on scheduling
+    std::vector<float> rowSums(size_t(height) * 27);
+    ThreadPool::shared().parallelFor(size_t(height), [&](size_t j) {
+        // v = asin(y) / PI + 0.5, row 0 at the bottom
+        float latitude = ((float(j) + 0.5f) / float(height) - 0.5f) * PI_F;
+        float cosLat = std::cos(latitude);
+        float y = std::sin(latitude);
+
+        Row row;
+        row.r.assign(padded, 0.0f);
+        row.g.assign(padded, 0.0f);
+        row.b.assign(padded, 0.0f);
+        const float *in = pixels + j * w * size_t(components);
+        for (size_t i = 0; i < w; ++i, in += components) {
+            row.r[i] = in[0];
+            row.g[i] = components >= 3 ? in[1] : in[0];
+            row.b[i] = components >= 3 ? in[2] : in[0];
+        }
+
+        float sums[9][3];
+        sumRow(row, cosPhi.data(), sinPhi.data(), padded, cosLat, y, sums);
+
+        // solid angle of a pixel of this row
+        float solidAngle = (2.0f * PI_F / float(width)) * (PI_F / float(height)) * cosLat;
+        float *out = &rowSums[j * 27];
+        for (int k = 0; k < 9; ++k) {
+            for (int c = 0; c < 3; ++c) {
+                out[k * 3 + c] = sums[k][c] * solidAngle;
+            }
+        }
+    });
+
+    double total[27] = {};
+    for (size_t j = 0; j < size_t(height); ++j) {
+        for (int i = 0; i < 27; ++i) {
+            total[i] += rowSums[j * 27 + size_t(i)];
+        }
+    }
+    // projection L = sum(colour * SCALE * basis * dw), coefficient = BAND * SCALE * L
+    for (int k = 0; k < 9; ++k) {
+        for (int c = 0; c < 3; ++c) {
+            sh.rgb[k][c] = float(total[k * 3 + c]) * SCALE[k] * SCALE[k] * BAND[k];
+        }
+    }
+    return sh;
+}
+
+void rendering::setIrradianceSH(Shader &shader, const SHIrradiance &sh) {
+    // array elements have consecutive locations, all 9 go up in one call
+    GLint location = shader.getUniformLocation("shIrradiance[0]");
+    shader.setUniformVec3Array(location, &sh.rgb[0][0], 9);
+}
@@ -1,4 +1,7 @@
 #include "rendering/pbrPreProcessing.hpp"
+#include "rendering/IBLCache.hpp"
+#include "rendering/SphericalHarmonics.hpp"
+#include "utils/Logger.hpp"
 #include "utils/Shader.hpp"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
@@ -11,7 +14,6 @@
 
 using namespace rendering;
 
-
 /**
  * helper: inits/returns framebuffer and renderbuffer
  * @return tuple of OpenGL IDs of the framebuffer and renderbuffer
@@ -36,6 +38,21 @@ createBuffers()
     return {captureFBO, captureRBO};
 }
 
+/**
+ * helper: decodes hdr environment map pixels, bottom row first
+ * @param hdrEnvMap path to the HDR environment map
+ * @param width pointer to store the width of the loaded image
+ * @param height pointer to store the height of the loaded image
+ * @param nrComponents pointer to store the number of color components in the loaded image
+ * @return the pixels, free with stbi_image_free. nullptr on failure
+ */
+static float*
+loadHDRPixels(const std::string& hdrEnvMap, int* width, int* height, int* nrComponents)
+{
+    stbi_set_flip_vertically_on_load(true);
+    return stbi_loadf(hdrEnvMap.c_str(), width, height, nrComponents, 0);
+}
+
 /**
  * helper: loads hdr environment map data
  * @param hdrEnvMap path to the HDR environment map
@@ -49,8 +66,7 @@ createBuffers()
 static std::tuple<float*, GLuint>
 loadHDRData(const std::string& hdrEnvMap, int* width, int* height, int* nrComponents)
 {
-    stbi_set_flip_vertically_on_load(true);
-    float *data = stbi_loadf(hdrEnvMap.c_str(), width, height, nrComponents, 0);
+    float *data = loadHDRPixels(hdrEnvMap, width, height, nrComponents);
     GLuint hdrTexture;
     if (!data) { std::cout << "Failed to load HDR image." << std::endl; }
     else {
@@ -321,10 +337,23 @@ renderQuad()
 /**
  * given an HDR environment map, generate a cubemap
  * @param hdrEnvMap path to the HDR environment map
+ * @param sourceHash where to store the hash of the HDR file, may be null
  * @return the OpenGL ID of the cubemap texture
  */
 GLuint
-genEnvCubemap(const std::string hdrEnvMap) {
+genEnvCubemap(const std::string hdrEnvMap, uint64_t* sourceHash) {
+
+    const int SIZE = 512;
+
+    // a cached cubemap skips the HDR load and all six passes
+    uint64_t hash = IBLCache::hashFile(hdrEnvMap);
+    if (sourceHash) { *sourceHash = hash; }
+    uint64_t cacheKey = IBLCache::computeKey(IBLCache::ENVIRONMENT, hash, SIZE);
+    if (hash != 0) {
+        if (GLuint cached = IBLCache::load(cacheKey, GL_TEXTURE_CUBE_MAP)) {
+            return cached;
+        }
+    }
 
     // create shader programs
     static Shader equirectToCubemap;
@@ -340,7 +369,6 @@ genEnvCubemap(const std::string hdrEnvMap) {
 
     // create buffers
     // note we don't use the rbo
-    const int SIZE = 512;
     auto [captureFBO, captureRBO] = createBuffers();
     
     // create hdr texture
@@ -379,20 +407,54 @@ genEnvCubemap(const std::string hdrEnvMap) {
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
     glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
 
+    if (hash != 0) {
+        IBLCache::store(envCubemap, GL_TEXTURE_CUBE_MAP, cacheKey);
+    }
     return envCubemap;
 }
 
+/**
+ * given an HDR environment map, project its irradiance into 9 SH coefficients
+ * @param hdrEnvMap path to the HDR environment map
+ * @param irradiance where to store the coefficients
+ * @return true if the map could be loaded
+ */
+bool
+rendering::genIrradianceSH(const std::string hdrEnvMap, SHIrradiance* irradiance)
+{
+    if (!irradiance) { return false; }
+
+    // no GL here, only decoding and the projection
+    int width, height, nrComponents;
+    float *data = loadHDRPixels(hdrEnvMap, &width, &height, &nrComponents);
+    if (!data) {
+        LOG_ERROR_F("Failed to load HDR image {} for SH irradiance", hdrEnvMap);
+        return false;
+    }
+    *irradiance = projectEquirectSH(data, width, height, nrComponents);
+    stbi_image_free(data);
+    return true;
+}
+
 /**
  * given an environment cubemap, generate an irradiance map
  * @param envCubemap the OpenGL ID of the environment cubemap texture
+ * @param sourceHash hash of the HDR file from genEnvCubemap, 0 skips the cache
  * @return the OpenGL ID of the irradiance cubemap texture
  */
 GLuint
-genIrradianceMap(const GLuint envCubemap)
+genIrradianceMap(const GLuint envCubemap, const uint64_t sourceHash)
 {
     // using a small 32x32 cubemap as irradiance map
     const uint IRRADIANCE_SIZE = 32;
 
+    uint64_t cacheKey = IBLCache::computeKey(IBLCache::IRRADIANCE, sourceHash, IRRADIANCE_SIZE);
+    if (sourceHash != 0) {
+        if (GLuint cached = IBLCache::load(cacheKey, GL_TEXTURE_CUBE_MAP)) {
+            return cached;
+        }
+    }
+
     // get framebuffer/renderbuffer
     auto [captureFBO, captureRBO] = createBuffers();
 
@@ -442,17 +504,32 @@ genIrradianceMap(const GLuint envCubemap)
 
     irradianceShader.unbind();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (sourceHash != 0) {
+        IBLCache::store(irradianceMap, GL_TEXTURE_CUBE_MAP, cacheKey);
+    }
     return irradianceMap;
 }
 
 /**
  * given an environment cubemap, generate an irradiance map
  * @param envCubemap the OpenGL ID of the environment cubemap texture
+ * @param sourceHash hash of the HDR file from genEnvCubemap, 0 skips the cache
  * @return the OpenGL ID of the irradiance cubemap texture
  */
 GLuint
-genPrefilterMap(const GLuint envCubemap)
+genPrefilterMap(const GLuint envCubemap, const uint64_t sourceHash)
 {
+    const uint PREFILTER_SIZE = 128;
+
+    // every mip level is cached, roughness 0 to 1
+    uint64_t cacheKey = IBLCache::computeKey(IBLCache::PREFILTER, sourceHash, PREFILTER_SIZE);
+    if (sourceHash != 0) {
+        if (GLuint cached = IBLCache::load(cacheKey, GL_TEXTURE_CUBE_MAP)) {
+            return cached;
+        }
+    }
+
     // Load and compile the pre-filter shader program (only once)
     static Shader prefilterShader;
     static bool initialized = false;
@@ -464,7 +541,6 @@ genPrefilterMap(const GLuint envCubemap)
     }
 
     // Create the destination pre-filter cubemap texture
-    const uint PREFILTER_SIZE = 128;
     GLuint prefilterMap = setupPrefilterMap(PREFILTER_SIZE);
 
     // get framebuffer/renderbuffer
@@ -509,6 +585,10 @@ genPrefilterMap(const GLuint envCubemap)
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     prefilterShader.unbind();
+
+    if (sourceHash != 0) {
+        IBLCache::store(prefilterMap, GL_TEXTURE_CUBE_MAP, cacheKey);
+    }
     return prefilterMap;
 }
 
@@ -520,8 +600,15 @@ genPrefilterMap(const GLuint envCubemap)
 GLuint
 genBRDFLUT(const GLuint envCubemap)
 {
-    // create BRDF LUT texture
     const uint LUT_SIZE = 512;
+
+    // the LUT doesn't depend on the environment, one entry serves them all
+    uint64_t cacheKey = IBLCache::computeKey(IBLCache::BRDF_LUT, 0, LUT_SIZE);
+    if (GLuint cached = IBLCache::load(cacheKey, GL_TEXTURE_2D)) {
+        return cached;
+    }
+
+    // create BRDF LUT texture
     GLuint brdfLUTTexture = setupBRDFLUT(LUT_SIZE);
 
     // get framebuffer/renderbuffer
@@ -540,7 +627,11 @@ genBRDFLUT(const GLuint envCubemap)
         initialized = true;
     }
 
-    // render
+    // render into the LUT
+    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, LUT_SIZE, LUT_SIZE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, brdfLUTTexture, 0);
     glViewport(0, 0, 512, 512);
     brdfShader.bind();
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -548,5 +639,7 @@ genBRDFLUT(const GLuint envCubemap)
 
     brdfShader.unbind();
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    IBLCache::store(brdfLUTTexture, GL_TEXTURE_2D, cacheKey);
     return brdfLUTTexture;
 }
\ No newline at end of file
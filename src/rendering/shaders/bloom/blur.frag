@@ -6,18 +6,22 @@ in vec2 TexCoords;
 uniform sampler2D image;
 uniform bool horizontal;
 
-uniform int kernelSize;
-uniform float weights[64];
+// Gaussian taps merged in pairs (see mergeLinearTaps): one bilinear fetch at
+// offsets[i] texels returns the weighted sum of two neighbouring texels, so
+// a radius r kernel takes 1 + ceil(r / 2) fetches per side instead of 1 + r
+uniform int tapCount;
+uniform float offsets[33];
+uniform float weights[33];
 
 void main()
 {
     vec2 texelSize = 1.0 / vec2(textureSize(image, 0));
-    int radius = (kernelSize - 1) / 2;
+    vec2 direction = horizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
 
     vec3 sum = texture(image, TexCoords).rgb * weights[0];
 
-    for (int i = 1; i <= radius; ++i) {
-        vec2 offset = horizontal ? vec2(float(i) * texelSize.x, 0.0) : vec2(0.0, float(i) * texelSize.y);
+    for (int i = 1; i < tapCount; ++i) {
+        vec2 offset = direction * offsets[i];
         float w = weights[i];
         sum += texture(image, TexCoords + offset).rgb * w;
         sum += texture(image, TexCoords - offset).rgb * w;
@@ -0,0 +1,75 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// previous, twice as large level of the pyramid (the bright pass for the first)
+uniform sampler2D source;
+uniform vec2 sourceTexelSize;
+// first level only: weight each 2x2 group by 1 / (1 + luma) so single
+// very bright texels don't flicker into large blobs
+uniform bool karisAverage;
+
+float karisWeight(vec3 c)
+{
+    float luma = dot(c, vec3(0.2126, 0.7152, 0.0722));
+    return 1.0 / (1.0 + luma);
+}
+
+// 13 bilinear taps covering a 6x6 texel footprint, five overlapping 2x2
+// boxes: the inner one weighted 0.5, the four corner ones 0.125 each
+void main()
+{
+    vec2 t = sourceTexelSize;
+
+    vec3 a = texture(source, TexCoords + vec2(-2.0,  2.0) * t).rgb;
+    vec3 b = texture(source, TexCoords + vec2( 0.0,  2.0) * t).rgb;
+    vec3 c = texture(source, TexCoords + vec2( 2.0,  2.0) * t).rgb;
+
+    vec3 d = texture(source, TexCoords + vec2(-2.0,  0.0) * t).rgb;
+    vec3 e = texture(source, TexCoords).rgb;
+    vec3 f = texture(source, TexCoords + vec2( 2.0,  0.0) * t).rgb;
+
+    vec3 g = texture(source, TexCoords + vec2(-2.0, -2.0) * t).rgb;
+    vec3 h = texture(source, TexCoords + vec2( 0.0, -2.0) * t).rgb;
+    vec3 i = texture(source, TexCoords + vec2( 2.0, -2.0) * t).rgb;
+
+    vec3 j = texture(source, TexCoords + vec2(-1.0,  1.0) * t).rgb;
+    vec3 k = texture(source, TexCoords + vec2( 1.0,  1.0) * t).rgb;
+    vec3 l = texture(source, TexCoords + vec2(-1.0, -1.0) * t).rgb;
+    vec3 m = texture(source, TexCoords + vec2( 1.0, -1.0) * t).rgb;
+
+    vec3 result;
+    if (karisAverage)
+    {
+        vec3 inner       = (j + k + l + m) * 0.25;
+        vec3 topLeft     = (a + b + d + e) * 0.25;
+        vec3 topRight    = (b + c + e + f) * 0.25;
+        vec3 bottomLeft  = (d + e + g + h) * 0.25;
+        vec3 bottomRight = (e + f + h + i) * 0.25;
+
+        float wInner = 0.5   * karisWeight(inner);
+        float wTL    = 0.125 * karisWeight(topLeft);
+        float wTR    = 0.125 * karisWeight(topRight);
+        float wBL    = 0.125 * karisWeight(bottomLeft);
+        float wBR    = 0.125 * karisWeight(bottomRight);
+
+        result = (inner * wInner + topLeft * wTL + topRight * wTR + bottomLeft * wBL + bottomRight * wBR) /
+                 (wInner + wTL + wTR + wBL + wBR);
+    }
+    else
+    {
+        result  = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+
+    // keep the chain finite: a NaN or Inf would spread over the whole
+    // pyramid, so drop the texel instead. max() alone doesn't catch NaN
+    if (any(isnan(result)) || any(isinf(result)))
+    {
+        result = vec3(0.0);
+    }
+    FragColor = vec4(max(result, vec3(0.0)), 1.0);
+}
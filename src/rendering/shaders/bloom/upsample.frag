@@ -0,0 +1,35 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// next, half as large level of the pyramid; added onto the bound level by blending
+uniform sampler2D source;
+// tent radius in texture coordinates
+uniform float filterRadius;
+
+// 3x3 tent filter, weights 1 2 1 / 2 4 2 / 1 2 1 over 16
+void main()
+{
+    float x = filterRadius;
+    float y = filterRadius;
+
+    vec3 a = texture(source, vec2(TexCoords.x - x, TexCoords.y + y)).rgb;
+    vec3 b = texture(source, vec2(TexCoords.x,     TexCoords.y + y)).rgb;
+    vec3 c = texture(source, vec2(TexCoords.x + x, TexCoords.y + y)).rgb;
+
+    vec3 d = texture(source, vec2(TexCoords.x - x, TexCoords.y)).rgb;
+    vec3 e = texture(source, vec2(TexCoords.x,     TexCoords.y)).rgb;
+    vec3 f = texture(source, vec2(TexCoords.x + x, TexCoords.y)).rgb;
+
+    vec3 g = texture(source, vec2(TexCoords.x - x, TexCoords.y - y)).rgb;
+    vec3 h = texture(source, vec2(TexCoords.x,     TexCoords.y - y)).rgb;
+    vec3 i = texture(source, vec2(TexCoords.x + x, TexCoords.y - y)).rgb;
+
+    vec3 result = e * 4.0;
+    result += (b + d + f + h) * 2.0;
+    result += (a + c + g + i);
+    result *= 1.0 / 16.0;
+
+    FragColor = vec4(result, 1.0);
+}
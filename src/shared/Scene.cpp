@@ -1,5 +1,6 @@
 #include "shared/Scene.hpp"
 #include "shared/Logger.hpp"
+#include "rendering/CullingStage.hpp"
 
 Scene::Scene() {
     Scene::instance = this;
@@ -33,12 +34,18 @@ void Scene::unload() {
 }
 
 /**
- * Update the Animation properties <timestep> seconds into the future
+ * Update the Animation properties <timestep> seconds into the future.
+ * Objects submit their models to CullingStage::shared() as they update,
+ * the stage is cleared before and culled after, so it only ever holds
+ * this frame's models and getVisible() stays valid until the next update
 */
 void Scene::update(double timestep) {
+    rendering::CullingStage &culling = rendering::CullingStage::shared();
+    culling.clear();
     for (auto object: this->objects) {
         object.update(timestep);
     }
+    culling.cull();
 }
 
 void Scene::set_camera(std::shared_ptr<Camera> cam) {
@@ -0,0 +1,33 @@
+#include "utils/AtomicFile.hpp"
+#include "utils/Logger.hpp"
+
+#include <filesystem>
+
+bool writeFileAtomically(const std::string& path, const std::function<bool(std::ofstream&)>& write) {
+    std::string temporary = path + ".tmp";
+    std::error_code error;
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARN_F("Could not write {}", temporary);
+            return false;
+        }
+        bool written = write(file);
+        if (written && !file.good()) {
+            LOG_WARN_F("Failed writing {}", temporary);
+        }
+        if (!written || !file.good()) {
+            file.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        LOG_WARN_F("Could not move {} into place: {}", path, error.message());
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
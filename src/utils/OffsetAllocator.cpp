@@ -0,0 +1,77 @@
+#include "utils/OffsetAllocator.hpp"
+
+#include <cassert>
+
+OffsetAllocator::OffsetAllocator(uint32_t capacity) {
+    grow(capacity);
+}
+
+uint32_t OffsetAllocator::allocate(uint32_t size) {
+    if (size == 0) {
+        return NO_SPACE;
+    }
+    // smallest free range that fits, the rest of it stays free
+    auto fit = bySize.lower_bound(size);
+    if (fit == bySize.end()) {
+        return NO_SPACE;
+    }
+    uint32_t offset = fit->second;
+    uint32_t rangeSize = fit->first;
+    eraseFree(byOffset.find(offset));
+    if (rangeSize > size) {
+        insertFree(offset + size, rangeSize - size);
+    }
+    allocated += size;
+    return offset;
+}
+
+void OffsetAllocator::free(uint32_t offset, uint32_t size) {
+    if (size == 0) {
+        return;
+    }
+    assert(offset + size <= total && allocated >= size);
+    allocated -= size;
+
+    // merge with the free ranges right after and right before
+    auto next = byOffset.lower_bound(offset);
+    if (next != byOffset.end() && next->first == offset + size) {
+        size += next->second.size;
+        next = std::next(next);
+        eraseFree(std::prev(next));
+    }
+    if (next != byOffset.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second.size == offset) {
+            offset = previous->first;
+            size += previous->second.size;
+            eraseFree(previous);
+        }
+    }
+    insertFree(offset, size);
+}
+
+void OffsetAllocator::grow(uint32_t capacity) {
+    if (capacity <= total) {
+        return;
+    }
+    uint32_t added = capacity - total;
+    uint32_t offset = total;
+    total = capacity;
+    // counts as allocated until free() merges it with a free range at the end
+    allocated += added;
+    free(offset, added);
+}
+
+uint32_t OffsetAllocator::largestFree() const {
+    return bySize.empty() ? 0 : bySize.rbegin()->first;
+}
+
+void OffsetAllocator::insertFree(uint32_t offset, uint32_t size) {
+    auto bySizeEntry = bySize.emplace(size, offset);
+    byOffset.emplace(offset, FreeRange{ size, bySizeEntry });
+}
+
+void OffsetAllocator::eraseFree(std::map<uint32_t, FreeRange>::iterator range) {
+    bySize.erase(range->second.bySizeEntry);
+    byOffset.erase(range);
+}
@@ -0,0 +1,185 @@
+#include "utils/ProgramCache.hpp"
+#include "utils/AtomicFile.hpp"
+#include "utils/Logger.hpp"
+#include "utils/StringId.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+
+namespace {
+
+    const char MAGIC[4] = { 'S', 'P', 'B', '1' };
+    const uint32_t VERSION = 1;
+
+    // the default is resolved on first use, temp_directory_path() can throw
+    std::mutex directoryMutex;
+    std::string directory;
+    bool directoryResolved = false;
+
+    template <typename T>
+    uint64_t hashValue(const T& value, uint64_t hash) {
+        return StringId::hashOf(std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)), hash);
+    }
+
+    uint64_t hashString(const std::string& text, uint64_t hash) {
+        // the length keeps "ab"+"c" and "a"+"bc" apart
+        uint64_t length = text.size();
+        return StringId::hashOf(text, hashValue(length, hash));
+    }
+
+    std::string glString(GLenum name) {
+        const GLubyte* value = glGetString(name);
+        return value ? reinterpret_cast<const char*>(value) : "";
+    }
+
+}
+
+uint64_t ProgramCache::computeKey(const std::unordered_map<SHADER_TYPE, std::string>& sources,
+                                  const std::string& defines, const std::string& driver) {
+    std::vector<SHADER_TYPE> types;
+    for (const auto& pair : sources) {
+        types.push_back(pair.first);
+    }
+    std::sort(types.begin(), types.end());
+
+    uint64_t hash = hashString(driver, StringId::HASH_SEED);
+    hash = hashString(defines, hash);
+    for (SHADER_TYPE type : types) {
+        int32_t stage = type;
+        hash = hashValue(stage, hash);
+        hash = hashString(sources.at(type), hash);
+    }
+    return hash;
+}
+
+std::string ProgramCache::driverString() {
+    return glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+}
+
+bool ProgramCache::isSupported() {
+    if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary) {
+        return false;
+    }
+    // some drivers expose the entry points without any format
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+void ProgramCache::setDirectory(const std::string& path) {
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    directory = path;
+    directoryResolved = true;
+}
+
+std::string ProgramCache::getDirectory() {
+    std::lock_guard<std::mutex> lock(directoryMutex);
+    if (!directoryResolved) {
+        directoryResolved = true;
+        std::error_code error;
+        std::filesystem::path temp = std::filesystem::temp_directory_path(error);
+        if (error) {
+            LOG_WARN_F("No temporary directory ({}), program cache disabled", error.message());
+        } else {
+            directory = (temp / "shader-cache").string();
+        }
+    }
+    return directory;
+}
+
+std::string ProgramCache::pathFor(uint64_t key) {
+    char name[24];
+    std::snprintf(name, sizeof(name), "%016llx.spb", static_cast<unsigned long long>(key));
+    return (std::filesystem::path(getDirectory()) / name).string();
+}
+
+bool ProgramCache::load(GLuint program, uint64_t key) {
+    if (getDirectory().empty()) {
+        return false;
+    }
+    GLenum format;
+    std::vector<uint8_t> binary;
+    std::string path = pathFor(key);
+    if (!readFile(path, key, format, binary)) {
+        return false;
+    }
+    glProgramBinary(program, format, binary.data(), GLsizei(binary.size()));
+
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        // the driver changed under the same version string, or the file is bad
+        LOG_WARN_F("Cached program binary {} rejected, compiling from source", path);
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return false;
+    }
+    return true;
+}
+
+bool ProgramCache::store(GLuint program, uint64_t key) {
+    std::string dir = getDirectory();
+    if (dir.empty()) {
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    std::vector<uint8_t> binary(static_cast<size_t>(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, binary.data());
+    if (written <= 0) {
+        return false;
+    }
+    binary.resize(static_cast<size_t>(written));
+
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    return writeFile(pathFor(key), key, format, binary);
+}
+
+bool ProgramCache::writeFile(const std::string& path, uint64_t key, GLenum format, const std::vector<uint8_t>& binary) {
+    return writeFileAtomically(path, [&](std::ofstream& file) {
+        uint32_t binaryFormat = format;
+        uint32_t size = static_cast<uint32_t>(binary.size());
+        file.write(MAGIC, sizeof(MAGIC));
+        file.write(reinterpret_cast<const char*>(&VERSION), sizeof(VERSION));
+        file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+        file.write(reinterpret_cast<const char*>(&binaryFormat), sizeof(binaryFormat));
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(reinterpret_cast<const char*>(binary.data()), std::streamsize(binary.size()));
+        return true;
+    });
+}
+
+bool ProgramCache::readFile(const std::string& path, uint64_t key, GLenum& format, std::vector<uint8_t>& binary) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    char magic[4];
+    uint32_t version = 0, binaryFormat = 0, size = 0;
+    uint64_t storedKey = 0;
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    file.read(reinterpret_cast<char*>(&binaryFormat), sizeof(binaryFormat));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    if (!file || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || version != VERSION || storedKey != key || size == 0) {
+        return false;
+    }
+    binary.resize(size);
+    file.read(reinterpret_cast<char*>(binary.data()), std::streamsize(size));
+    if (file.gcount() != std::streamsize(size)) {
+        return false;
+    }
+    format = binaryFormat;
+    return true;
+}
@@ -1,9 +1,21 @@
 #include "utils/Shader.hpp"
 #include "utils/Logger.hpp"
+#include "utils/ProgramCache.hpp"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 
+namespace {
+    // Let the driver pick its compiler thread count, once per process
+    void enableParallelCompile() {
+        static bool enabled = false;
+        if (!enabled && GLAD_GL_KHR_parallel_shader_compile) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+        enabled = true;
+    }
+}
+
 // Converts our SHADER TYPE to GL name
 GLenum Shader::getGLShaderType(SHADER_TYPE type) {
     switch (type) {
@@ -18,9 +30,10 @@ GLenum Shader::getGLShaderType(SHADER_TYPE type) {
 
 /*
     Compiles a shader of the given type from the provided source shader.
-    Will do full error checking for you.
+    Will do full error checking for you, unless <checkStatus> is false:
+    then the compile may still be running when this returns.
 */
-bool Shader::compileShader(GLuint& shader, SHADER_TYPE shaderType, const std::string& source) {
+bool Shader::compileShader(GLuint& shader, SHADER_TYPE shaderType, const std::string& source, bool checkStatus) {
     GLenum glType = getGLShaderType(shaderType);
     if (glType == 0) return false;
     
@@ -28,6 +41,9 @@ bool Shader::compileShader(GLuint& shader, SHADER_TYPE shaderType, const std::st
     const char* src = source.c_str();
     glShaderSource(shader, 1, &src, NULL);
     glCompileShader(shader);
+    if (!checkStatus) {
+        return true;
+    }
     
     // Check for compilation errors
     GLint success;
@@ -66,6 +82,7 @@ void Shader::checkCompileErrors(GLuint shader, const std::string& type) {
 // Attach new type of shader to this program
 // See SHADER_TYPE in /include/shared/Shader.hpp
 bool Shader::addShader(SHADER_TYPE shaderType, const std::string& source) {
+    compileCachedSources();
     // Check if this shader type already exists
     if (shaderMap.find(shaderType) != shaderMap.end()) {
         LOG_WARN("Shader type already exists. Use replaceShader() to replace it.");
@@ -86,6 +103,7 @@ bool Shader::addShader(SHADER_TYPE shaderType, const std::string& source) {
     If you want to on the fly replace a shader src you can do it here.
 */
 bool Shader::replaceShader(SHADER_TYPE shaderType, const std::string& source) {
+    compileCachedSources();
     // Remove existing shader of this type if it exists
     removeShader(shaderType);
     
@@ -107,6 +125,7 @@ bool Shader::replaceShader(SHADER_TYPE shaderType, const std::string& source) {
     De-attaches given shader type from its program.
 */
 bool Shader::removeShader(SHADER_TYPE shaderType) {
+    compileCachedSources();
     auto it = shaderMap.find(shaderType);
     if (it != shaderMap.end()) {
         GLuint shaderToRemove = it->second;
@@ -181,6 +200,10 @@ bool Shader::linkProgram() {
  * };
  */
 bool Shader::loadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& shaderFiles) {
+    return beginLoadFromFiles(shaderFiles) && finishLoad();
+}
+
+bool Shader::beginLoadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& shaderFiles) {
     std::unordered_map<SHADER_TYPE, std::string> sources;
     
     for (const auto& pair : shaderFiles) {
@@ -195,7 +218,7 @@ bool Shader::loadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& s
         sources[pair.first] = buffer.str();
     }
     
-    return loadFromSources(sources);
+    return beginLoadFromSources(sources);
 }
 
 /**
@@ -204,25 +227,183 @@ bool Shader::loadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& s
  * Bool return denotes compile and link success.
  */
 bool Shader::loadFromSources(const std::unordered_map<SHADER_TYPE, std::string>& shaderSources) {
+    return beginLoadFromSources(shaderSources) && finishLoad();
+}
+
+void Shader::setDefines(const std::vector<std::string>& defines) {
+    programDefines = buildDefineBlock(defines);
+}
+
+std::string Shader::buildDefineBlock(const std::vector<std::string>& defines) {
+    std::vector<std::string> sorted(defines);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    std::string block;
+    for (const std::string& define : sorted) {
+        if (define.empty()) {
+            continue;
+        }
+        std::string line = define;
+        size_t equals = line.find('=');
+        if (equals != std::string::npos) {
+            line[equals] = ' ';
+        }
+        block += "#define " + line + "\n";
+    }
+    return block;
+}
+
+/*
+ * #version has to stay the first directive, so defines go right after it.
+ * A #line directive puts the following lines back at their original
+ * numbers, compile errors still point at the file.
+ */
+std::string Shader::injectDefines(const std::string& source, const std::string& defineBlock) {
+    if (defineBlock.empty()) {
+        return source;
+    }
+    size_t version = source.find("#version");
+    if (version == std::string::npos) {
+        return defineBlock + "#line 1\n" + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + defineBlock;
+    }
+    size_t nextLine = std::count(source.begin(), source.begin() + lineEnd, '\n') + 2;
+    return source.substr(0, lineEnd + 1) + defineBlock + "#line " + std::to_string(nextLine) + "\n" +
+           source.substr(lineEnd + 1);
+}
+
+/*
+ * Start building a program from sources.
+ * A program binary cached under the same sources, defines and driver is
+ * linked straight away. Otherwise every shader is compiled and the program
+ * linked without waiting for the results, finishLoad() checks them and
+ * caches the binary.
+ */
+bool Shader::beginLoadFromSources(const std::unordered_map<SHADER_TYPE, std::string>& shaderSources) {
     // Clear existing shaders
     for (GLuint shader : shaders) {
         glDeleteShader(shader);
     }
     shaders.clear();
     shaderMap.clear();
-    
+    uniformCache.clear();
+    if (shaderProgram != 0) {
+        glDeleteProgram(shaderProgram);
+        shaderProgram = 0;
+    }
+    programSources = shaderSources;
+    loadedFromCache = false;
+    linkPending = false;
+    enableParallelCompile();
+
+    storeBinary = ProgramCache::isSupported() && !ProgramCache::getDirectory().empty();
+    if (storeBinary) {
+        programKey = ProgramCache::computeKey(shaderSources, programDefines, ProgramCache::driverString());
+        shaderProgram = glCreateProgram();
+        if (ProgramCache::load(shaderProgram, programKey)) {
+            loadedFromCache = true;
+            LOG_DEBUG_F("Shader program {} loaded from program cache", shaderProgram);
+            return true;
+        }
+        glDeleteProgram(shaderProgram);
+        shaderProgram = 0;
+    }
+
     // Add all provided shaders
     for (const auto& pair : shaderSources) {
         GLuint shader;
-        if (compileShader(shader, pair.first, pair.second)) {
+        if (compileShader(shader, pair.first, injectDefines(pair.second, programDefines), false)) {
             shaders.push_back(shader);
             shaderMap[pair.first] = shader;
         } else {
             return false;
         }
     }
-    
-    return linkProgram();
+    if (shaders.empty()) {
+        LOG_ERROR("No shaders to link");
+        return false;
+    }
+
+    shaderProgram = glCreateProgram();
+    for (GLuint shader : shaders) {
+        glAttachShader(shaderProgram, shader);
+    }
+    if (storeBinary) {
+        glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glLinkProgram(shaderProgram);
+    linkPending = true;
+    return true;
+}
+
+/*
+ * Wait for a begun load and check it, blocks if the driver is still compiling.
+ */
+bool Shader::finishLoad() {
+    if (!linkPending) {
+        return shaderProgram != 0;
+    }
+    linkPending = false;
+
+    bool compiled = true;
+    for (const auto& pair : shaderMap) {
+        GLint success;
+        glGetShaderiv(pair.second, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            checkCompileErrors(pair.second, "Type " + std::to_string(pair.first));
+            compiled = false;
+        }
+    }
+    GLint linked;
+    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &linked);
+    if (!compiled || !linked) {
+        if (compiled) {
+            checkCompileErrors(shaderProgram, "PROGRAM");
+        }
+        return false;
+    }
+
+    // Detach shaders after linking
+    for (GLuint shader : shaders) {
+        glDetachShader(shaderProgram, shader);
+    }
+    if (storeBinary) {
+        ProgramCache::store(shaderProgram, programKey);
+    }
+    return true;
+}
+
+bool Shader::isLoadReady() {
+    if (!linkPending || !GLAD_GL_KHR_parallel_shader_compile) {
+        return true;
+    }
+    GLint done = GL_FALSE;
+    glGetProgramiv(shaderProgram, GL_COMPLETION_STATUS_KHR, &done);
+    return done == GL_TRUE;
+}
+
+/*
+ * A program linked from the cache has no shader objects. Compile them from
+ * the kept sources before anything edits the shader list.
+ */
+bool Shader::compileCachedSources() {
+    if (!loadedFromCache) {
+        return true;
+    }
+    loadedFromCache = false;
+    for (const auto& pair : programSources) {
+        GLuint shader;
+        if (!compileShader(shader, pair.first, injectDefines(pair.second, programDefines))) {
+            return false;
+        }
+        shaders.push_back(shader);
+        shaderMap[pair.first] = shader;
+    }
+    return true;
 }
 
 /*
@@ -283,52 +464,174 @@ void Shader::ensureShaderActive(std::function<void()> uniformSetter) {
 
 /* Sets float uniform */
 void Shader::setUniform(const std::string& name, float value) {
-    GLint location = getUniformLocation(name);
-    if (location != -1) {
-        ensureShaderActive([&]() {
-            glUniform1f(location, value);
-        });
-    }
+    setUniform(getUniformLocation(name), value);
 }
 
 /* Sets int uniform */
 void Shader::setUniform(const std::string& name, int value) {
-    GLint location = getUniformLocation(name);
-    if (location != -1) {
-        ensureShaderActive([&]() {
-            glUniform1i(location, value);
-        });
-    }
+    setUniform(getUniformLocation(name), value);
 }
 
 /* Set bool uniform */
 void Shader::setUniform(const std::string& name, bool value) {
-    GLint location = getUniformLocation(name);
-    if (location != -1) {
-        ensureShaderActive([&]() {
-            glUniform1i(location, value ? 1 : 0);
-        });
-    }
+    setUniform(getUniformLocation(name), value ? 1 : 0);
 }
 
 /* Vec3f uniform */
 void Shader::setUniform(const std::string& name, float x, float y, float z) {
-    GLint location = getUniformLocation(name);
-    if (location != -1) {
-        ensureShaderActive([&]() {
-            glUniform3f(location, x, y, z);
-        });
-    }
+    setUniform(getUniformLocation(name), x, y, z);
 }
 
 /* Vec4f uniform */
 void Shader::setUniform(const std::string& name, float x, float y, float z, float w) {
-    GLint location = getUniformLocation(name);
-    if (location != -1) {
-        ensureShaderActive([&]() {
-            glUniform4f(location, x, y, z, w);
-        });
+    setUniform(getUniformLocation(name), x, y, z, w);
+}
+
+/*
+    Setters by handle. glProgramUniform writes straight into this program,
+    so the glGetIntegerv and the two program switches of ensureShaderActive
+    are only paid on contexts older than 4.1.
+*/
+void Shader::setUniform(GLint location, float value) {
+    if (location == -1) return;
+    if (GLAD_GL_VERSION_4_1) {
+        glProgramUniform1f(shaderProgram, location, value);
+        return;
     }
+    ensureShaderActive([&]() {
+        glUniform1f(location, value);
+    });
+}
+
+void Shader::setUniform(GLint location, int value) {
+    if (location == -1) return;
+    if (GLAD_GL_VERSION_4_1) {
+        glProgramUniform1i(shaderProgram, location, value);
+        return;
+    }
+    ensureShaderActive([&]() {
+        glUniform1i(location, value);
+    });
+}
+
+void Shader::setUniform(GLint location, float x, float y) {
+    if (location == -1) return;
+    if (GLAD_GL_VERSION_4_1) {
+        glProgramUniform2f(shaderProgram, location, x, y);
+        return;
+    }
+    ensureShaderActive([&]() {
+        glUniform2f(location, x, y);
+    });
+}
+
+void Shader::setUniform(GLint location, float x, float y, float z) {
+    if (location == -1) return;
+    if (GLAD_GL_VERSION_4_1) {
+        glProgramUniform3f(shaderProgram, location, x, y, z);
+        return;
+    }
+    ensureShaderActive([&]() {
+        glUniform3f(location, x, y, z);
+    });
+}
+
+void Shader::setUniform(GLint location, float x, float y, float z, float w) {
+    if (location == -1) return;
+    if (GLAD_GL_VERSION_4_1) {
+        glProgramUniform4f(shaderProgram, location, x, y, z, w);
+        return;
+    }
+    ensureShaderActive([&]() {
+        glUniform4f(location, x, y, z, w);
+    });
+}
+
+void Shader::setUniformArray(GLint location, const float* values, GLsizei count) {
+    if (location == -1 || count <= 0) return;
+    if (GLAD_GL_VERSION_4_1) {
+        glProgramUniform1fv(shaderProgram, location, count, values);
+        return;
+    }
+    ensureShaderActive([&]() {
+        glUniform1fv(location, count, values);
+    });
+}
+
+void Shader::setUniformVec3Array(GLint location, const float* values, GLsizei count) {
+    if (location == -1 || count <= 0) return;
+    if (GLAD_GL_VERSION_4_1) {
+        glProgramUniform3fv(shaderProgram, location, count, values);
+        return;
+    }
+    ensureShaderActive([&]() {
+        glUniform3fv(location, count, values);
+    });
+}
+
+/*
+    Uniform blocks are looked up once, then only the buffer bound to
+    <binding> changes between draws.
+*/
+bool Shader::bindUniformBlock(const std::string& blockName, GLuint binding) {
+    if (shaderProgram == 0) {
+        LOG_WARN("Cannot bind uniform block - no shader program created");
+        return false;
+    }
+    GLuint index = glGetUniformBlockIndex(shaderProgram, blockName.c_str());
+    if (index == GL_INVALID_INDEX) {
+        LOG_WARN_F("Uniform block '{}' not found for shader program {}", blockName.c_str(), shaderProgram);
+        return false;
+    }
+    glUniformBlockBinding(shaderProgram, index, binding);
+    return true;
+}
+
+bool Shader::getUniformBlockLayout(const std::string& blockName, UniformBlockLayout& layout) {
+    layout = UniformBlockLayout();
+    if (shaderProgram == 0) {
+        return false;
+    }
+    layout.index = glGetUniformBlockIndex(shaderProgram, blockName.c_str());
+    if (layout.index == GL_INVALID_INDEX) {
+        return false;
+    }
+    glGetActiveUniformBlockiv(shaderProgram, layout.index, GL_UNIFORM_BLOCK_DATA_SIZE, &layout.size);
+
+    GLint memberCount = 0;
+    glGetActiveUniformBlockiv(shaderProgram, layout.index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+    if (memberCount <= 0) {
+        return true;
+    }
+    std::vector<GLint> indices(memberCount);
+    glGetActiveUniformBlockiv(shaderProgram, layout.index, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+    std::vector<GLuint> uniforms(indices.begin(), indices.end());
+
+    // one query per property for all members at once
+    std::vector<GLint> offsets(memberCount), arrayStrides(memberCount), matrixStrides(memberCount);
+    std::vector<GLint> sizes(memberCount), types(memberCount);
+    glGetActiveUniformsiv(shaderProgram, memberCount, uniforms.data(), GL_UNIFORM_OFFSET, offsets.data());
+    glGetActiveUniformsiv(shaderProgram, memberCount, uniforms.data(), GL_UNIFORM_ARRAY_STRIDE, arrayStrides.data());
+    glGetActiveUniformsiv(shaderProgram, memberCount, uniforms.data(), GL_UNIFORM_MATRIX_STRIDE, matrixStrides.data());
+    glGetActiveUniformsiv(shaderProgram, memberCount, uniforms.data(), GL_UNIFORM_SIZE, sizes.data());
+    glGetActiveUniformsiv(shaderProgram, memberCount, uniforms.data(), GL_UNIFORM_TYPE, types.data());
+
+    GLint maxNameLength = 0;
+    glGetProgramiv(shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<GLchar> name(std::max(maxNameLength, 1));
+    for (GLint i = 0; i < memberCount; i++) {
+        GLsizei length = 0;
+        glGetActiveUniformName(shaderProgram, uniforms[i], GLsizei(name.size()), &length, name.data());
+
+        UniformMember member;
+        member.offset = offsets[i];
+        member.arrayStride = arrayStrides[i];
+        member.matrixStride = matrixStrides[i];
+        member.arraySize = sizes[i];
+        member.type = GLenum(types[i]);
+        layout.members[std::string(name.data(), length)] = member;
+    }
+    return true;
 }
 
 
@@ -0,0 +1,109 @@
+#include "utils/ShaderVariants.hpp"
+#include "utils/Logger.hpp"
+#include "utils/StringId.hpp"
+
+#include <fstream>
+#include <sstream>
+
+bool ShaderVariants::loadFromFiles(const std::unordered_map<SHADER_TYPE, std::string>& shaderFiles) {
+    std::unordered_map<SHADER_TYPE, std::string> read;
+    for (const auto& pair : shaderFiles) {
+        std::ifstream file(pair.second);
+        if (!file.is_open()) {
+            LOG_ERROR_F("Failed to open shader file: {}", pair.second);
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        read[pair.first] = buffer.str();
+    }
+    setSources(read);
+    return true;
+}
+
+void ShaderVariants::setSources(const std::unordered_map<SHADER_TYPE, std::string>& shaderSources) {
+    sources = shaderSources;
+    variants.clear();
+    byKey.clear();
+}
+
+uint64_t ShaderVariants::variantKey(const Defines& defines) {
+    std::string block = Shader::buildDefineBlock(defines);
+    return StringId::hashOf(block);
+}
+
+ShaderVariants::Variant* ShaderVariants::beginVariant(uint64_t key, const std::string& defineBlock,
+                                                      const Defines& defines, bool& begun) {
+    begun = false;
+    if (const uint32_t* index = byKey.find(key)) {
+        Variant& variant = variants[*index];
+        if (variant.defineBlock == defineBlock) {
+            return &variant;
+        }
+        // two define sets with the same 64 bit hash, never expected in practice
+        LOG_ERROR_F("Shader variant key collision between\n{}and\n{}", variant.defineBlock, defineBlock);
+        return nullptr;
+    }
+
+    Variant variant;
+    variant.defineBlock = defineBlock;
+    variant.shader = std::make_unique<Shader>();
+    variant.shader->setDefines(defines);
+    variant.failed = !variant.shader->beginLoadFromSources(sources);
+    begun = !variant.failed;
+
+    byKey.insert(key, uint32_t(variants.size()));
+    variants.push_back(std::move(variant));
+    return &variants.back();
+}
+
+Shader* ShaderVariants::get(const Defines& defines) {
+    std::string block = Shader::buildDefineBlock(defines);
+    uint64_t key = StringId::hashOf(block);
+    bool begun;
+    Variant* variant = beginVariant(key, block, defines, begun);
+    if (!variant) {
+        return nullptr;
+    }
+    if (begun && !variant->shader->finishLoad()) {
+        LOG_ERROR_F("Shader variant failed to build with defines:\n{}", block);
+        variant->failed = true;
+    }
+    return variant->failed ? nullptr : variant->shader.get();
+}
+
+Shader* ShaderVariants::find(uint64_t key) const {
+    const uint32_t* index = byKey.find(key);
+    if (!index || variants[*index].failed) {
+        return nullptr;
+    }
+    return variants[*index].shader.get();
+}
+
+size_t ShaderVariants::precompile(const std::vector<Defines>& list) {
+    // begin every new variant first, then wait for them
+    std::vector<uint32_t> pending;
+    for (const Defines& defines : list) {
+        std::string block = Shader::buildDefineBlock(defines);
+        uint64_t key = StringId::hashOf(block);
+        bool begun;
+        beginVariant(key, block, defines, begun);
+        if (begun) {
+            pending.push_back(*byKey.find(key));
+        }
+    }
+
+    for (uint32_t index : pending) {
+        Variant& variant = variants[index];
+        if (!variant.shader->finishLoad()) {
+            LOG_ERROR_F("Shader variant failed to build with defines:\n{}", variant.defineBlock);
+            variant.failed = true;
+        }
+    }
+    size_t failed = 0;
+    for (const Defines& defines : list) {
+        failed += find(variantKey(defines)) == nullptr;
+    }
+    LOG_DEBUG_F("Precompiled {} shader variants, {} failed", pending.size(), failed);
+    return failed;
+}
@@ -0,0 +1,74 @@
+#include "utils/StringId.hpp"
+#include "utils/FlatHashMap.hpp"
+
+#include <deque>
+#include <mutex>
+
+namespace {
+    // table key, carries the hash so it's computed once per intern call
+    struct InternKey {
+        uint64_t hash = 0;
+        std::string_view text;
+    };
+
+    struct InternKeyHash {
+        size_t operator()(const InternKey& key) const { return static_cast<size_t>(key.hash); }
+    };
+
+    struct InternKeyEqual {
+        bool operator()(const InternKey& a, const InternKey& b) const {
+            return a.hash == b.hash && a.text == b.text;
+        }
+    };
+
+    const std::string EMPTY;
+}
+
+struct StringTable {
+    std::mutex mutex;
+    std::deque<StringId::Entry> entries; // stable addresses, keys view into them
+    FlatHashMap<InternKey, const StringId::Entry*, InternKeyHash, InternKeyEqual> lookup;
+
+    static StringTable& instance() {
+        // leaked on purpose, ids may be used during static destruction
+        static StringTable* table = new StringTable();
+        return *table;
+    }
+};
+
+uint64_t StringId::hashOf(std::string_view text, uint64_t seed) {
+    uint64_t hash = seed;
+    for (char c : text) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+StringId::StringId(std::string_view text) {
+    InternKey key{ hashOf(text), text };
+    StringTable& table = StringTable::instance();
+
+    std::lock_guard<std::mutex> lock(table.mutex);
+    if (const Entry* const* found = table.lookup.find(key)) {
+        entry = *found;
+        return;
+    }
+    table.entries.push_back(Entry{ std::string(text), key.hash });
+    const Entry* created = &table.entries.back();
+    table.lookup.insert(InternKey{ key.hash, created->text }, created);
+    entry = created;
+}
+
+StringId StringId::lookup(std::string_view text) {
+    InternKey key{ hashOf(text), text };
+    StringTable& table = StringTable::instance();
+
+    std::lock_guard<std::mutex> lock(table.mutex);
+    const Entry* const* found = table.lookup.find(key);
+    return found ? StringId(*found) : StringId();
+}
+
+const std::string& StringId::str() const {
+    return entry ? entry->text : EMPTY;
+}
@@ -0,0 +1,215 @@
+#include "utils/UniformBuffer.hpp"
+#include "utils/Logger.hpp"
+
+#include <algorithm>
+
+namespace {
+
+    bool hasBufferStorage() {
+#ifdef GL_VERSION_4_4
+        if (GLAD_GL_VERSION_4_4) {
+            return true;
+        }
+#endif
+#ifdef GL_ARB_buffer_storage
+        if (GLAD_GL_ARB_buffer_storage) {
+            return true;
+        }
+#endif
+        return false;
+    }
+
+    size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // base alignment and size of a single element, std140 section 7.6.2.2
+    void std140Element(Std140Type type, size_t &alignment, size_t &size) {
+        switch (type) {
+        case Std140Type::FLOAT:
+        case Std140Type::INT:
+            alignment = size = 4;
+            return;
+        case Std140Type::VEC2:
+            alignment = size = 8;
+            return;
+        case Std140Type::VEC3:
+            alignment = 16;
+            size = 12;
+            return;
+        case Std140Type::VEC4:
+            alignment = size = 16;
+            return;
+        case Std140Type::MAT3:
+            // three columns, each padded to a vec4
+            alignment = 16;
+            size = 48;
+            return;
+        case Std140Type::MAT4:
+            alignment = 16;
+            size = 64;
+            return;
+        }
+        alignment = size = 0;
+    }
+
+}
+
+size_t Std140Layout::add(Std140Type type, size_t count) {
+    size_t alignment, size;
+    std140Element(type, alignment, size);
+    Member member;
+    if (count > 1) {
+        // every array element is rounded up to a vec4
+        member.arrayStride = alignUp(size, 16);
+        member.offset = alignUp(end, 16);
+        end = member.offset + member.arrayStride * count;
+    } else {
+        member.arrayStride = 0;
+        member.offset = alignUp(end, alignment);
+        end = member.offset + size;
+    }
+    members.push_back(member);
+    return member.offset;
+}
+
+size_t Std140Layout::size() const {
+    return alignUp(end, 16);
+}
+
+const UniformMember *UniformBlockLayout::find(const std::string &name) const {
+    auto it = members.find(name);
+    return it != members.end() ? &it->second : nullptr;
+}
+
+UniformRing::~UniformRing() {
+    destroy();
+}
+
+bool UniformRing::create(size_t bytesPerFrame, int frames) {
+    destroy();
+    if (bytesPerFrame == 0 || frames < 1) {
+        LOG_ERROR("UniformRing: empty ring requested");
+        return false;
+    }
+
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    alignment = size_t(std::max(offsetAlignment, 1));
+    frameSize = alignUp(bytesPerFrame, alignment);
+    fences.assign(size_t(frames), nullptr);
+    size_t total = frameSize * size_t(frames);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+#ifdef GL_VERSION_4_4
+    persistent = hasBufferStorage();
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, GLsizeiptr(total), nullptr, flags);
+        mapped = static_cast<uint8_t *>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, GLsizeiptr(total), flags));
+        if (!mapped) {
+            // storage is immutable now, start over with a plain buffer
+            LOG_WARN("UniformRing: persistent mapping failed, falling back to glBufferSubData");
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            persistent = false;
+        }
+    }
+#endif
+    if (!persistent) {
+        glBufferData(GL_UNIFORM_BUFFER, GLsizeiptr(total), nullptr, GL_DYNAMIC_DRAW);
+        shadow.resize(total);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    frame = 0;
+    head = 0;
+    LOG_DEBUG_F("UniformRing: {} frames of {} bytes, {}", frames, frameSize,
+                persistent ? "persistently mapped" : "glBufferSubData");
+    return true;
+}
+
+void UniformRing::destroy() {
+    for (GLsync &fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    fences.clear();
+    if (buffer != 0) {
+        if (mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+    mapped = nullptr;
+    shadow.clear();
+    shadow.shrink_to_fit();
+    persistent = false;
+    frameSize = 0;
+    head = 0;
+}
+
+void UniformRing::beginFrame() {
+    if (fences.empty()) {
+        return;
+    }
+    frame = (frame + 1) % int(fences.size());
+    head = 0;
+
+    GLsync &fence = fences[size_t(frame)];
+    if (fence) {
+        // usually signalled long ago, only a GPU several frames behind waits
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+void UniformRing::endFrame() {
+    if (fences.empty()) {
+        return;
+    }
+    GLsync &fence = fences[size_t(frame)];
+    if (fence) {
+        glDeleteSync(fence);
+    }
+    fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+UniformAllocation UniformRing::allocate(size_t size) {
+    UniformAllocation allocation;
+    if (size == 0 || head + size > frameSize) {
+        if (frameSize != 0) {
+            LOG_WARN_F("UniformRing: frame region of {} bytes is full", frameSize);
+        }
+        return allocation;
+    }
+    size_t offset = size_t(frame) * frameSize + head;
+    allocation.data = (persistent ? mapped : shadow.data()) + offset;
+    allocation.offset = GLintptr(offset);
+    allocation.size = GLsizeiptr(size);
+    head = std::min(alignUp(head + size, alignment), frameSize);
+    return allocation;
+}
+
+void UniformRing::bind(GLuint binding, const UniformAllocation &allocation) {
+    if (!allocation.data) {
+        return;
+    }
+    if (!persistent) {
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, allocation.offset, allocation.size, allocation.data);
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, allocation.offset, allocation.size);
+}
@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <vector>
+#include "animation/SpatialHashGrid.hpp"
+
+using namespace animation;
+
+namespace {
+
+std::vector<Eigen::Vector3d> randomPositions(size_t count, double extent, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> dist(-extent, extent);
+    std::vector<Eigen::Vector3d> positions(count);
+    for (auto &p : positions) {
+        p = Eigen::Vector3d(dist(rng), dist(rng), dist(rng));
+    }
+    return positions;
+}
+
+BodyPairList bruteForcePairs(const std::vector<Eigen::Vector3d> &positions, double radius) {
+    BodyPairList pairs;
+    for (uint32_t i = 0; i < positions.size(); ++i) {
+        for (uint32_t j = i + 1; j < positions.size(); ++j) {
+            if ((positions[i] - positions[j]).squaredNorm() < 4.0 * radius * radius) {
+                pairs.push_back({i, j});
+            }
+        }
+    }
+    return pairs;
+}
+
+} // namespace
+
+TEST(SpatialHashGridTest, EmptyGridHasNoPairs) {
+    SpatialHashGrid grid(1.0, 1);
+    grid.build({});
+
+    BodyPairList pairs;
+    grid.findPairs(0.5, pairs);
+    EXPECT_TRUE(pairs.empty());
+    EXPECT_EQ(grid.getBodyCount(), 0u);
+}
+
+TEST(SpatialHashGridTest, TwoTouchingBodies) {
+    SpatialHashGrid grid(1.0, 1);
+    grid.build({Eigen::Vector3d(0.0, 0.0, 0.0), Eigen::Vector3d(0.9, 0.0, 0.0), Eigen::Vector3d(5.0, 0.0, 0.0)});
+
+    BodyPairList pairs;
+    grid.findPairs(0.5, pairs);
+    ASSERT_EQ(pairs.size(), 1u);
+    EXPECT_EQ(pairs[0].a, 0u);
+    EXPECT_EQ(pairs[0].b, 1u);
+}
+
+TEST(SpatialHashGridTest, PairsAcrossCellBoundaries) {
+    // bodies either side of the x = 0 and y = 0 planes
+    SpatialHashGrid grid(1.0, 1);
+    grid.build({Eigen::Vector3d(-0.1, -0.1, 0.0), Eigen::Vector3d(0.1, 0.1, 0.0)});
+
+    BodyPairList pairs;
+    grid.findPairs(0.5, pairs);
+    ASSERT_EQ(pairs.size(), 1u);
+}
+
+TEST(SpatialHashGridTest, MatchesBruteForce) {
+    const double radius = 0.25;
+    auto positions = randomPositions(2000, 5.0, 42);
+
+    SpatialHashGrid grid(2.0 * radius, 1);
+    grid.build(positions);
+
+    BodyPairList pairs;
+    grid.findPairs(radius, pairs);
+    std::sort(pairs.begin(), pairs.end());
+
+    EXPECT_EQ(pairs, bruteForcePairs(positions, radius));
+}
+
+TEST(SpatialHashGridTest, MultithreadedBuildMatchesSingleThreaded) {
+    const double radius = 0.1;
+    auto positions = randomPositions(5000, 3.0, 7);
+
+    SpatialHashGrid serial(2.0 * radius, 1);
+    SpatialHashGrid parallel(2.0 * radius, 4);
+    serial.build(positions);
+    parallel.build(positions);
+
+    // the counting sort is stable, so both orders must be identical
+    EXPECT_EQ(serial.getSortedBodies(), parallel.getSortedBodies());
+
+    BodyPairList serialPairs, parallelPairs;
+    serial.findPairs(radius, serialPairs);
+    parallel.findPairs(radius, parallelPairs);
+    std::sort(serialPairs.begin(), serialPairs.end());
+    std::sort(parallelPairs.begin(), parallelPairs.end());
+    EXPECT_EQ(serialPairs, parallelPairs);
+}
+
+TEST(SpatialHashGridTest, RebuildWithFewerBodies) {
+    // buffers are reused between builds, nothing may leak from the larger one
+    const double radius = 0.25;
+    SpatialHashGrid grid(2.0 * radius, 4);
+    grid.build(randomPositions(5000, 5.0, 3));
+
+    auto positions = randomPositions(300, 2.0, 11);
+    grid.build(positions);
+    EXPECT_EQ(grid.getBodyCount(), 300u);
+
+    BodyPairList pairs;
+    grid.findPairs(radius, pairs);
+    std::sort(pairs.begin(), pairs.end());
+    EXPECT_EQ(pairs, bruteForcePairs(positions, radius));
+}
+
+TEST(SpatialHashGridTest, ForEachNeighbourVisitsAdjacentBodies) {
+    SpatialHashGrid grid(1.0, 1);
+    std::vector<Eigen::Vector3d> positions = {
+        Eigen::Vector3d(0.5, 0.5, 0.5),
+        Eigen::Vector3d(1.5, 1.5, 1.5),   // diagonal neighbour cell
+        Eigen::Vector3d(-0.5, 0.5, 0.5),  // face neighbour cell
+        Eigen::Vector3d(10.5, 0.5, 0.5)   // far away
+    };
+    grid.build(positions);
+
+    std::set<uint32_t> seen;
+    grid.forEachNeighbour(0, [&](uint32_t other) { seen.insert(other); });
+
+    EXPECT_TRUE(seen.count(1));
+    EXPECT_TRUE(seen.count(2));
+    EXPECT_FALSE(seen.count(0));
+}
+
+TEST(SpatialHashGridTest, InvalidArguments) {
+    EXPECT_THROW(SpatialHashGrid(0.0), std::invalid_argument);
+    EXPECT_THROW(SpatialHashGrid(-1.0), std::invalid_argument);
+
+    SpatialHashGrid grid(1.0, 1);
+    grid.build({Eigen::Vector3d::Zero()});
+    BodyPairList pairs;
+    EXPECT_THROW(grid.findPairs(0.75, pairs), std::invalid_argument);
+}
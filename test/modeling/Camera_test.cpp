@@ -51,3 +51,30 @@ TEST_F(CameraTest, Rotation) {
     EXPECT_NEAR(c.getDirection()(1),0.f,0.00000005f);
     EXPECT_NEAR(c.getDirection()(2),-1.f,0.00000005f);
 }
+
+TEST_F(CameraTest, PixelsPerUnit) {
+    auto c = Camera(Vector3f(0.f,0.f,0.f), Vector3f(1.f,0.f,0.f));
+    c.setFOV(90.f); // tan(45 degrees) = 1, so the viewport spans 2 units at distance 1
+    EXPECT_NEAR(c.getPixelsPerUnit(Vector3f(1.f,0.f,0.f), 100.f), 50.f, 0.0001f);
+    EXPECT_NEAR(c.getPixelsPerUnit(Vector3f(0.f,0.f,-4.f), 100.f), 12.5f, 0.0001f); // only distance matters
+}
+
+TEST_F(CameraTest, ViewAndProjection) {
+    auto c = Camera(Vector3f(1.f,2.f,3.f), Vector3f(1.f,0.f,0.f));
+    Matrix4f view = c.getView();
+    // the camera sits at the view space origin, looking down +z
+    EXPECT_NEAR((view * Vector4f(1.f,2.f,3.f,1.f)).head<3>().norm(), 0.f, 1e-6f);
+    Vector4f ahead = view * Vector4f(6.f,2.f,3.f,1.f);
+    EXPECT_NEAR(ahead(2), 5.f, 1e-6f);
+
+    c.setFOV(90.f);
+    Matrix4f projection = c.getProjection(2.f, 1.f, 10.f);
+    Vector4f nearPoint = projection * Vector4f(0.f,0.f,1.f,1.f);
+    Vector4f farPoint = projection * Vector4f(0.f,0.f,10.f,1.f);
+    EXPECT_NEAR(nearPoint(2) / nearPoint(3), -1.f, 1e-6f);
+    EXPECT_NEAR(farPoint(2) / farPoint(3), 1.f, 1e-6f);
+    // at distance 1 the view spans y in [-1, 1] and x in [-2, 2]
+    Vector4f corner = projection * Vector4f(2.f,1.f,1.f,1.f);
+    EXPECT_NEAR(corner(0) / corner(3), 1.f, 1e-6f);
+    EXPECT_NEAR(corner(1) / corner(3), 1.f, 1e-6f);
+}
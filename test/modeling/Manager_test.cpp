@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <modeling/Manager.hpp>
+#include <modeling/ModelLoader.hpp>
+
+using namespace std;
+
+/* no GL context: the manager is created without a shader so nothing is uploaded */
+class AssetManagerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        modeling::ModelLoader::setMeshCacheEnabled(false);
+    }
+
+    void TearDown() override {
+        modeling::ModelLoader::setMeshCacheEnabled(true);
+    }
+};
+
+TEST_F(AssetManagerTest, LoadsInBackground) {
+    AssetManager manager;
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+    ASSERT_TRUE(handle.valid());
+    EXPECT_FALSE(handle.done());
+
+    manager.wait_all();
+
+    ASSERT_EQ(handle.state(), LoadState::Loaded) << handle.error();
+    EXPECT_FLOAT_EQ(handle.progress(), 1.0f);
+    EXPECT_EQ(handle.future().get(), LoadState::Loaded);
+    EXPECT_EQ(manager.pending_count(), 0u);
+
+    ASSERT_GE(handle.scene(), 0);
+    const modeling::Model &model = manager.get_model(manager.model_key(handle.scene(), 0));
+    ASSERT_EQ(model.getMeshes().size(), 1u);
+    EXPECT_EQ(manager.get_mesh(manager.mesh_key(handle.scene(), 0)).getIndexCount(), 36u);
+}
+
+TEST_F(AssetManagerTest, NothingFinishesOutsidePoll) {
+    AssetManager manager;
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+
+    /* the import can complete on a worker, but only poll() publishes it */
+    handle.future().wait_for(chrono::milliseconds(200));
+    EXPECT_NE(handle.state(), LoadState::Loaded);
+
+    while (!handle.done()) {
+        manager.poll();
+    }
+    EXPECT_EQ(handle.state(), LoadState::Loaded);
+}
+
+TEST_F(AssetManagerTest, SameFileSharesHandle) {
+    AssetManager manager;
+    LoadHandle a = manager.load_file("test/assets/unitcube.gltf");
+    LoadHandle b = manager.load_file("test/assets/unitcube.gltf");
+    manager.wait_all();
+
+    EXPECT_EQ(a.scene(), b.scene());
+
+    /* loading an already loaded file finishes immediately */
+    LoadHandle c = manager.load_file("test/assets/unitcube.gltf");
+    EXPECT_EQ(c.state(), LoadState::Loaded);
+    EXPECT_EQ(c.scene(), a.scene());
+}
+
+TEST_F(AssetManagerTest, MissingFileFails) {
+    AssetManager manager;
+    LoadHandle handle = manager.load_file("test/assets/does_not_exist.gltf");
+    manager.wait_all();
+
+    EXPECT_EQ(handle.state(), LoadState::Failed);
+    EXPECT_FALSE(handle.error().empty());
+    EXPECT_EQ(handle.scene(), -1);
+}
+
+TEST_F(AssetManagerTest, FullQueueDropsFarthest) {
+    AssetManager manager;
+    manager.set_max_in_flight(0); /* hold every load in the queue */
+    manager.set_max_queued(2);
+    manager.set_viewer_position(Eigen::Vector3f(0.f, 0.f, 0.f));
+
+    /* <busy> has no position and goes first, <far> and <near> compete for the last slot */
+    LoadHandle busy = manager.load_file("test/assets/unitcube.gltf");
+    LoadHandle far = manager.load_file("far.gltf", Eigen::Vector3f(100.f, 0.f, 0.f));
+    LoadHandle near = manager.load_file("near.gltf", Eigen::Vector3f(1.f, 0.f, 0.f));
+
+    EXPECT_EQ(busy.state(), LoadState::Queued);
+    EXPECT_EQ(far.state(), LoadState::Cancelled);
+    EXPECT_EQ(near.state(), LoadState::Queued);
+
+    manager.set_max_in_flight(1);
+    manager.wait_all();
+    EXPECT_EQ(busy.state(), LoadState::Loaded);
+    EXPECT_EQ(near.state(), LoadState::Failed); /* doesn't exist, but was attempted */
+}
+
+TEST_F(AssetManagerTest, CancelBeforeUpload) {
+    AssetManager manager;
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+    handle.cancel();
+    manager.wait_all();
+
+    EXPECT_EQ(handle.state(), LoadState::Cancelled);
+    EXPECT_EQ(handle.scene(), -1);
+}
+
+TEST_F(AssetManagerTest, WaitAllReturnsWhileHeld) {
+    AssetManager manager;
+    manager.set_max_in_flight(0);
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+
+    /* nothing can start, so this must not block */
+    manager.wait_all();
+    EXPECT_EQ(handle.state(), LoadState::Queued);
+    EXPECT_EQ(manager.pending_count(), 1u);
+
+    handle.cancel();
+    manager.wait_all();
+    EXPECT_EQ(handle.state(), LoadState::Cancelled);
+    EXPECT_EQ(manager.pending_count(), 0u);
+}
+
+TEST_F(AssetManagerTest, EvictsOverBudget) {
+    AssetManager manager;
+    manager.set_memory_budget(1, ResidencyManager::UNLIMITED);
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+    manager.wait_all();
+    int scene = handle.scene();
+    ASSERT_GE(scene, 0);
+    EXPECT_GT(manager.residency_stats().cpu_bytes, 0u);
+
+    /* still usable in the frame it was loaded */
+    EXPECT_NO_THROW(manager.get_model(manager.model_key(scene, 0)));
+    EXPECT_EQ(manager.residency_stats().hits, 1u);
+
+    manager.poll();
+    manager.poll();
+    EXPECT_EQ(manager.residency_stats().evictions, 1u);
+    EXPECT_EQ(manager.residency_stats().cpu_bytes, 0u);
+
+    /* a miss queues the file again */
+    EXPECT_THROW(manager.get_model(manager.model_key(scene, 0)), std::runtime_error);
+    EXPECT_EQ(manager.residency_stats().misses, 1u);
+    EXPECT_EQ(manager.pending_count(), 1u);
+    manager.wait_all();
+    EXPECT_NO_THROW(manager.get_model(manager.model_key(scene, 0)));
+}
+
+TEST_F(AssetManagerTest, TryGetDoesNotThrow) {
+    AssetManager manager;
+    manager.set_memory_budget(1, ResidencyManager::UNLIMITED);
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+    manager.wait_all();
+    int scene = handle.scene();
+    ASSERT_GE(scene, 0);
+    EXPECT_NE(manager.try_get_model(manager.model_key(scene, 0)), nullptr);
+    EXPECT_NE(manager.try_get_mesh(manager.mesh_key(scene, 0)), nullptr);
+
+    manager.poll();
+    manager.poll();
+    ASSERT_EQ(manager.residency_stats().evictions, 1u);
+
+    /* evicted: nullptr instead of an exception, and the file is queued again */
+    EXPECT_EQ(manager.try_get_model(manager.model_key(scene, 0)), nullptr);
+    EXPECT_EQ(manager.residency_stats().misses, 1u);
+    EXPECT_EQ(manager.pending_count(), 1u);
+    manager.wait_all();
+    EXPECT_NE(manager.try_get_model(manager.model_key(scene, 0)), nullptr);
+
+    /* stale keys too */
+    ModelKey key = manager.model_key(scene, 0);
+    manager.unload_file("test/assets/unitcube.gltf");
+    EXPECT_EQ(manager.try_get_model(key), nullptr);
+}
+
+TEST_F(AssetManagerTest, PinnedNotEvicted) {
+    AssetManager manager;
+    manager.set_memory_budget(1, 1);
+    manager.pin_file("test/assets/unitcube.gltf");
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+    manager.wait_all();
+    manager.poll();
+    manager.poll();
+
+    EXPECT_EQ(manager.residency_stats().evictions, 0u);
+    EXPECT_NO_THROW(manager.get_model(manager.model_key(handle.scene(), 0)));
+}
+
+TEST_F(AssetManagerTest, StaleKeysRejected) {
+    AssetManager manager;
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+    manager.wait_all();
+    int scene = handle.scene();
+    EXPECT_EQ(manager.find_scene("test/assets/unitcube.gltf"), scene);
+    EXPECT_EQ(manager.find_scene("test/assets/never_loaded.gltf"), -1);
+
+    ModelKey key = manager.model_key(scene, 0);
+    EXPECT_NO_THROW(manager.get_model(key));
+
+    manager.unload_file("test/assets/unitcube.gltf");
+    manager.load_file("test/assets/unitcube.gltf");
+    manager.wait_all();
+
+    /* same slot, but the key predates the unload */
+    EXPECT_EQ(manager.find_scene("test/assets/unitcube.gltf"), scene);
+    EXPECT_THROW(manager.get_model(key), std::invalid_argument);
+    EXPECT_NO_THROW(manager.get_model(manager.model_key(scene, 0)));
+
+    /* default constructed keys never match a scene's generation */
+    ModelKey blank{ scene, 0 };
+    EXPECT_THROW(manager.get_model(blank), std::invalid_argument);
+    EXPECT_EQ(manager.try_get_model(blank), nullptr);
+}
+
+TEST_F(AssetManagerTest, OutOfRangeIdsRejected) {
+    AssetManager manager;
+    LoadHandle handle = manager.load_file("test/assets/unitcube.gltf");
+    manager.wait_all();
+    int scene = handle.scene();
+    ASSERT_GE(scene, 0);
+
+    EXPECT_THROW(manager.get_model(manager.model_key(scene, 1000)), std::out_of_range);
+    EXPECT_THROW(manager.get_mesh(manager.mesh_key(scene, -1)), std::out_of_range);
+    EXPECT_THROW(manager.get_texture(manager.texture_key(scene, 1000)), std::out_of_range);
+    EXPECT_EQ(manager.try_get_model(manager.model_key(scene, 1000)), nullptr);
+    EXPECT_EQ(manager.try_get_mesh(manager.mesh_key(scene, -1)), nullptr);
+}
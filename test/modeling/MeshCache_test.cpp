@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "modeling/MeshCache.hpp"
+
+using namespace std;
+using namespace modeling;
+
+class MeshCacheTest : public ::testing::Test {
+protected:
+    string cachePath;
+    MeshCacheKey key;
+    vector<MeshData> meshes;
+    vector<MaterialSource> materials;
+    vector<uint32_t> modelMeshes;
+
+    void SetUp() override {
+        cachePath = (filesystem::temp_directory_path() / "MeshCacheTest.smc").string();
+        key.sourceHash = 0x1234567890abcdefull;
+        key.importFlags = 42;
+
+        MeshData triangle;
+        triangle.name = "triangle";
+        triangle.valid = true;
+        triangle.materialIndex = 1;
+        for (int i = 0; i < 3; i++) {
+            Vertex v{};
+            v.Position = glm::vec3(float(i), float(i * 2), -float(i));
+            v.TexCoords = glm::vec2(0.5f * i, 1.0f);
+            triangle.vertices.push_back(v);
+            triangle.indices.push_back(i);
+        }
+        triangle.lodIndices = { 2, 1, 0 };
+        triangle.lods.push_back(MeshLod{ 0, 3, 0.25f });
+        Meshlet meshlet{};
+        meshlet.indexCount = 3;
+        meshlet.vertexCount = 3;
+        meshlet.center = glm::vec3(1.f, 2.f, -1.f);
+        meshlet.radius = 2.5f;
+        meshlet.coneCutoff = 1.f;
+        triangle.meshlets.push_back(meshlet);
+
+        MeshData broken; // failed conversion, stored empty
+        broken.name = "broken";
+
+        meshes.push_back(triangle);
+        meshes.push_back(broken);
+        materials.resize(2);
+        materials[0].name = "first";
+        materials[0].textures[TEXTURE_BASE_COLOR] = "textures/albedo.png";
+        materials[0].textures[TEXTURE_ALBEDO] = "textures/albedo.png";
+        materials[1].name = "second";
+        materials[1].unlit = true;
+        modelMeshes = { 0, 0 };
+    }
+
+    void TearDown() override {
+        remove(cachePath.c_str());
+    }
+};
+
+TEST_F(MeshCacheTest, RoundTrip) {
+    ASSERT_TRUE(MeshCache::write(cachePath, key, meshes, materials, modelMeshes));
+
+    auto cache = MeshCache::open(cachePath, key);
+    ASSERT_NE(cache, nullptr);
+    ASSERT_EQ(cache->getMeshCount(), 2u);
+    ASSERT_EQ(cache->getMaterials().size(), 2u);
+    for (size_t i = 0; i < materials.size(); i++) {
+        EXPECT_EQ(cache->getMaterials()[i].name, materials[i].name);
+        EXPECT_EQ(cache->getMaterials()[i].textures, materials[i].textures);
+        EXPECT_EQ(cache->getMaterials()[i].unlit, materials[i].unlit);
+    }
+    EXPECT_EQ(cache->getModelMeshes(), modelMeshes);
+
+    const MeshView& view = cache->getMesh(0);
+    EXPECT_EQ(view.name, "triangle");
+    EXPECT_EQ(view.materialIndex, 1u);
+    ASSERT_EQ(view.vertexCount, 3u);
+    ASSERT_EQ(view.indexCount, 3u);
+    for (int i = 0; i < 3; i++) {
+        EXPECT_EQ(view.vertices[i].Position, meshes[0].vertices[i].Position);
+        EXPECT_EQ(view.vertices[i].TexCoords, meshes[0].vertices[i].TexCoords);
+        EXPECT_EQ(view.indices[i], meshes[0].indices[i]);
+    }
+    EXPECT_EQ(view.boundsMin, glm::vec3(0.f, 0.f, -2.f));
+    EXPECT_EQ(view.boundsMax, glm::vec3(2.f, 4.f, 0.f));
+    ASSERT_EQ(view.lods.levelCount, 1u);
+    ASSERT_EQ(view.lods.indexCount, 3u);
+    EXPECT_EQ(view.lods.levels[0].indexCount, 3u);
+    EXPECT_EQ(view.lods.levels[0].error, 0.25f);
+    EXPECT_EQ(view.lods.indices[0], 2u);
+    ASSERT_EQ(view.meshletCount, 1u);
+    EXPECT_EQ(view.meshlets[0].indexCount, 3u);
+    EXPECT_EQ(view.meshlets[0].center, glm::vec3(1.f, 2.f, -1.f));
+    EXPECT_EQ(view.meshlets[0].radius, 2.5f);
+
+    EXPECT_EQ(cache->getMesh(1).vertexCount, 0u);
+    EXPECT_EQ(cache->getMesh(1).indexCount, 0u);
+}
+
+TEST_F(MeshCacheTest, ModelTransformsRoundTrip) {
+    glm::mat4 moved(1.f);
+    moved[3] = glm::vec4(4.f, -2.f, 7.f, 1.f);
+    moved[0][1] = 0.5f;
+    ASSERT_TRUE(MeshCache::write(cachePath, key, meshes, materials, modelMeshes, { glm::mat4(1.f), moved }));
+
+    auto cache = MeshCache::open(cachePath, key);
+    ASSERT_NE(cache, nullptr);
+    ASSERT_EQ(cache->getModelTransforms().size(), 2u);
+    for (int c = 0; c < 4; c++) {
+        for (int r = 0; r < 4; r++) {
+            EXPECT_EQ(cache->getModelTransforms()[0][c][r], c == r ? 1.f : 0.f);
+            EXPECT_EQ(cache->getModelTransforms()[1][c][r], moved[c][r]);
+        }
+    }
+}
+
+TEST_F(MeshCacheTest, ExtensionsRoundTrip) {
+    unordered_map<string, PropertyValue> extensions;
+    extensions["KHR_materials_unlit"] = true;
+    extensions["gltf.count"] = 7;
+    extensions["gltf.scale"] = 0.25f;
+    extensions["gltf.weight"] = 1.5;
+    extensions["gltf.generator"] = string("exporter");
+    ASSERT_TRUE(MeshCache::write(cachePath, key, meshes, materials, modelMeshes, {}, extensions));
+
+    auto cache = MeshCache::open(cachePath, key);
+    ASSERT_NE(cache, nullptr);
+    EXPECT_EQ(cache->getExtensions(), extensions);
+}
+
+TEST_F(MeshCacheTest, StaleKeyRejected) {
+    ASSERT_TRUE(MeshCache::write(cachePath, key, meshes, materials, modelMeshes));
+
+    MeshCacheKey other = key;
+    other.sourceHash++;
+    EXPECT_EQ(MeshCache::open(cachePath, other), nullptr);
+
+    other = key;
+    other.importFlags++;
+    EXPECT_EQ(MeshCache::open(cachePath, other), nullptr);
+
+    other = key;
+    other.optionsHash++;
+    EXPECT_EQ(MeshCache::open(cachePath, other), nullptr);
+}
+
+TEST_F(MeshCacheTest, MissingFile) {
+    EXPECT_EQ(MeshCache::open(cachePath, key), nullptr);
+}
+
+TEST_F(MeshCacheTest, TruncatedFileRejected) {
+    ASSERT_TRUE(MeshCache::write(cachePath, key, meshes, materials, modelMeshes));
+    auto size = filesystem::file_size(cachePath);
+    filesystem::resize_file(cachePath, size - 8);
+    EXPECT_EQ(MeshCache::open(cachePath, key), nullptr);
+}
+
+TEST_F(MeshCacheTest, CorruptMagicRejected) {
+    ASSERT_TRUE(MeshCache::write(cachePath, key, meshes, materials, modelMeshes));
+    {
+        fstream file(cachePath, ios::in | ios::out | ios::binary);
+        file.write("XXXX", 4);
+    }
+    EXPECT_EQ(MeshCache::open(cachePath, key), nullptr);
+}
+
+TEST_F(MeshCacheTest, StampMatchSkipsHash) {
+    key.sourceStamp = 5;
+    ASSERT_TRUE(MeshCache::write(cachePath, key, meshes, materials, modelMeshes));
+
+    MeshCacheKey stamped = key;
+    stamped.sourceHash = 0;
+    EXPECT_NE(MeshCache::open(cachePath, stamped), nullptr);
+
+    // touched but unchanged, only the hash still matches
+    MeshCacheKey touched = stamped;
+    touched.sourceStamp = 6;
+    EXPECT_EQ(MeshCache::open(cachePath, touched), nullptr);
+    touched.sourceHash = key.sourceHash;
+    EXPECT_NE(MeshCache::open(cachePath, touched), nullptr);
+
+    ASSERT_TRUE(MeshCache::restamp(cachePath, touched));
+    touched.sourceHash = 0;
+    EXPECT_NE(MeshCache::open(cachePath, touched), nullptr);
+    EXPECT_EQ(MeshCache::open(cachePath, stamped), nullptr);
+}
+
+TEST_F(MeshCacheTest, KeyTracksFileContents) {
+    string sourcePath = (filesystem::temp_directory_path() / "MeshCacheTest.obj").string();
+    {
+        ofstream file(sourcePath);
+        file << "v 0 0 0\n";
+    }
+    MeshCacheKey a = MeshCache::computeKey(sourcePath, 1);
+    MeshCacheKey b = MeshCache::computeKey(sourcePath, 2);
+    uint64_t hashA = MeshCache::hashSource(sourcePath);
+    {
+        ofstream file(sourcePath);
+        file << "v 1 0 0\nv 0 1 0\n";
+    }
+    MeshCacheKey c = MeshCache::computeKey(sourcePath, 1);
+    uint64_t hashC = MeshCache::hashSource(sourcePath);
+    remove(sourcePath.c_str());
+
+    EXPECT_NE(a.sourceStamp, 0u);
+    EXPECT_EQ(a.sourceHash, 0u);
+    EXPECT_EQ(a.sourceStamp, b.sourceStamp);
+    EXPECT_FALSE(a == b);
+    EXPECT_NE(a.sourceStamp, c.sourceStamp);
+    EXPECT_NE(hashA, 0u);
+    EXPECT_NE(hashA, hashC);
+    EXPECT_EQ(MeshCache::computeKey(sourcePath, 1).sourceStamp, 0u);
+    EXPECT_EQ(MeshCache::hashSource(sourcePath), 0u);
+}
@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+#include "modeling/MeshOptimizer.hpp"
+#include "modeling/MeshletBuilder.hpp"
+#include "TestMeshes.hpp"
+
+using namespace std;
+using namespace modeling;
+
+namespace {
+    // n x n quads on the unit square, triangles in random order
+    MeshData makeShuffledGrid(int n) {
+        MeshData mesh;
+        mesh.valid = true;
+        for (int y = 0; y <= n; y++) {
+            for (int x = 0; x <= n; x++) {
+                Vertex v{};
+                v.Position = glm::vec3(float(x) / n, float(y) / n, 0.0f);
+                v.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+                mesh.vertices.push_back(v);
+            }
+        }
+        vector<array<unsigned int, 3>> triangles;
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                unsigned int i = y * (n + 1) + x;
+                triangles.push_back({ i, i + 1, i + n + 2 });
+                triangles.push_back({ i, i + n + 2, i + n + 1 });
+            }
+        }
+        shuffle(triangles.begin(), triangles.end(), mt19937(42));
+        for (const auto& t : triangles) {
+            mesh.indices.insert(mesh.indices.end(), t.begin(), t.end());
+        }
+        return mesh;
+    }
+
+    // triangles by position, rotated to start at the smallest corner so winding is kept
+    vector<array<float, 9>> canonicalTriangles(const MeshData& mesh) {
+        vector<array<float, 9>> result;
+        for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+            array<array<float, 3>, 3> corners;
+            for (int j = 0; j < 3; j++) {
+                const glm::vec3& p = mesh.vertices[mesh.indices[i + j]].Position;
+                corners[j] = { p.x, p.y, p.z };
+            }
+            rotate(corners.begin(), min_element(corners.begin(), corners.end()), corners.end());
+            array<float, 9> flat;
+            for (int j = 0; j < 9; j++) {
+                flat[j] = corners[j / 3][j % 3];
+            }
+            result.push_back(flat);
+        }
+        sort(result.begin(), result.end());
+        return result;
+    }
+}
+
+TEST(MeshOptimizerTest, AnalyzeVertexCache) {
+    // two triangles sharing an edge: 4 transforms for 2 triangles and 4 vertices
+    const unsigned int quad[6] = { 0, 1, 2, 2, 1, 3 };
+    VertexCacheStats stats = MeshOptimizer::analyzeVertexCache(quad, 6, 4);
+    EXPECT_FLOAT_EQ(stats.acmr, 2.0f);
+    EXPECT_FLOAT_EQ(stats.atvr, 1.0f);
+
+    // a single entry cache only keeps vertex 2 across the triangles
+    stats = MeshOptimizer::analyzeVertexCache(quad, 6, 4, 1);
+    EXPECT_FLOAT_EQ(stats.acmr, 2.5f);
+    EXPECT_FLOAT_EQ(stats.atvr, 1.25f);
+}
+
+TEST(MeshOptimizerTest, VertexCacheImprovesShuffledGrid) {
+    MeshData mesh = makeShuffledGrid(32);
+    auto before = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+    auto triangles = canonicalTriangles(mesh);
+
+    vector<uint32_t> clusters = MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    auto after = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+    EXPECT_GT(before.acmr, 2.0f);
+    EXPECT_LT(after.acmr, 0.8f);
+    EXPECT_LT(after.atvr, 1.5f);
+    ASSERT_FALSE(clusters.empty());
+    EXPECT_EQ(clusters[0], 0u);
+    EXPECT_TRUE(is_sorted(clusters.begin(), clusters.end()));
+    EXPECT_EQ(canonicalTriangles(mesh), triangles);
+}
+
+TEST(MeshOptimizerTest, OverdrawKeepsTrianglesAndCacheEfficiency) {
+    MeshData mesh = makeShuffledGrid(24);
+    auto triangles = canonicalTriangles(mesh);
+    vector<uint32_t> clusters = MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+    auto cacheOrder = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+    MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.vertices, clusters);
+    auto sorted = MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size());
+
+    EXPECT_EQ(canonicalTriangles(mesh), triangles);
+    // parts restart with a cold cache, so the loss is bounded by the threshold
+    EXPECT_LE(sorted.acmr, cacheOrder.acmr * MeshOptimizer::OVERDRAW_THRESHOLD + 0.01f);
+}
+
+TEST(MeshOptimizerTest, OverdrawDrawsOutwardFacingFirst) {
+    // two lids facing away from the center, and an inner plate facing it that should come last
+    MeshData mesh;
+    mesh.valid = true;
+    auto addQuad = [&](float z, bool up) {
+        unsigned int base = (unsigned int)mesh.vertices.size();
+        for (int i = 0; i < 4; i++) {
+            Vertex v{};
+            v.Position = glm::vec3(float(i & 1), float(i >> 1), z);
+            mesh.vertices.push_back(v);
+        }
+        if (up) {
+            mesh.indices.insert(mesh.indices.end(), { base, base + 1, base + 3, base, base + 3, base + 2 });
+        } else {
+            mesh.indices.insert(mesh.indices.end(), { base, base + 3, base + 1, base, base + 2, base + 3 });
+        }
+    };
+    addQuad(0.4f, false);  // inner plate just above the center, facing it
+    addQuad(1.0f, true);
+    addQuad(-1.0f, false);
+
+    vector<uint32_t> clusters = { 0, 2, 4 };
+    MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.vertices, clusters, 1.0f, 3);
+    ASSERT_EQ(mesh.indices.size(), 18u);
+    EXPECT_EQ(mesh.vertices[mesh.indices[15]].Position.z, 0.4f);
+    EXPECT_NE(mesh.vertices[mesh.indices[0]].Position.z, 0.4f);
+}
+
+TEST(MeshOptimizerTest, VertexFetchFollowsFirstUse) {
+    MeshData mesh;
+    mesh.vertices.resize(5);
+    for (int i = 0; i < 5; i++) {
+        mesh.vertices[i].Position = glm::vec3(float(i), 0.0f, 0.0f);
+    }
+    mesh.indices = { 4, 2, 0, 0, 2, 3 };  // vertex 1 unused
+
+    size_t dropped = MeshOptimizer::optimizeVertexFetch(mesh.vertices, mesh.indices);
+    EXPECT_EQ(dropped, 1u);
+    ASSERT_EQ(mesh.vertices.size(), 4u);
+    EXPECT_EQ(mesh.indices, (vector<unsigned int>{ 0, 1, 2, 2, 1, 3 }));
+    EXPECT_EQ(mesh.vertices[0].Position.x, 4.0f);
+    EXPECT_EQ(mesh.vertices[1].Position.x, 2.0f);
+    EXPECT_EQ(mesh.vertices[2].Position.x, 0.0f);
+    EXPECT_EQ(mesh.vertices[3].Position.x, 3.0f);
+}
+
+TEST(MeshOptimizerTest, OptimizeReportsStats) {
+    MeshData mesh = makeShuffledGrid(16);
+    auto triangles = canonicalTriangles(mesh);
+    MeshOptimizationStats stats = MeshOptimizer::optimize(mesh);
+
+    EXPECT_GT(stats.before.acmr, stats.after.acmr);
+    EXPECT_EQ(stats.unusedVertices, 0u);
+    EXPECT_EQ(canonicalTriangles(mesh), triangles);
+    // after the fetch pass the vertex buffer is in first use order
+    unsigned int highest = 0;
+    for (unsigned int index : mesh.indices) {
+        EXPECT_LE(index, highest + 1);
+        highest = max(highest, index);
+    }
+
+    MeshData invalid;
+    stats = MeshOptimizer::optimize(invalid);
+    EXPECT_EQ(stats.after.acmr, 0.0f);
+}
+
+TEST(MeshOptimizerTest, MeshletsKeepTheirTrianglesAndCacheOrder) {
+    MeshData mesh = test_meshes::makeSphere(32, 64);
+    MeshOptimizer::optimize(mesh);
+    size_t meshletCount = MeshletBuilder::build(mesh);
+    ASSERT_GT(meshletCount, 1u);
+
+    // the triangles of each meshlet, found again by its unchanged bounds
+    auto meshletTriangles = [](const MeshData& source, const Meshlet& meshlet) {
+        MeshData part;
+        part.vertices = source.vertices;
+        part.indices.assign(source.indices.begin() + meshlet.firstIndex,
+                            source.indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+        return canonicalTriangles(part);
+    };
+    vector<pair<Meshlet, vector<array<float, 9>>>> before;
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        before.emplace_back(meshlet, meshletTriangles(mesh, meshlet));
+    }
+
+    EXPECT_EQ(MeshOptimizer::optimizeMeshlets(mesh), 0u);
+    ASSERT_EQ(mesh.meshlets.size(), meshletCount);
+    uint32_t next = 0;
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        EXPECT_EQ(meshlet.firstIndex, next);
+        next += meshlet.indexCount;
+        auto match = find_if(before.begin(), before.end(), [&](const auto& entry) {
+            return entry.first.center == meshlet.center && entry.first.indexCount == meshlet.indexCount;
+        });
+        ASSERT_NE(match, before.end());
+        EXPECT_EQ(meshletTriangles(mesh, meshlet), match->second);
+    }
+    EXPECT_EQ(next, mesh.indices.size());
+
+    // each meshlet misses every one of its vertices at least once, 64 / 124 ~ 0.52
+    EXPECT_LT(MeshOptimizer::analyzeVertexCache(mesh.indices.data(), mesh.indices.size(), mesh.vertices.size()).acmr,
+              1.0f);
+}
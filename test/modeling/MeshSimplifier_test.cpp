@@ -0,0 +1,135 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <set>
+
+#include "modeling/Mesh.hpp"
+#include "modeling/MeshSimplifier.hpp"
+#include "TestMeshes.hpp"
+
+using namespace std;
+using namespace modeling;
+using namespace test_meshes;
+
+namespace {
+    float area(const MeshData& mesh, const vector<unsigned int>& indices) {
+        float total = 0.0f;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const glm::vec3& a = mesh.vertices[indices[i]].Position;
+            total += 0.5f * glm::length(glm::cross(mesh.vertices[indices[i + 1]].Position - a,
+                                                   mesh.vertices[indices[i + 2]].Position - a));
+        }
+        return total;
+    }
+}
+
+TEST(MeshSimplifierTest, FlatPlaneCollapsesWithoutError) {
+    MeshData plane = makePlane(16);
+    float error = -1.0f;
+    auto result = MeshSimplifier::simplify(plane.vertices, plane.indices, 0, 1e-4f, &error);
+
+    EXPECT_LT(result.size(), plane.indices.size() / 10);
+    EXPECT_GE(result.size(), 6u);
+    EXPECT_LT(error, 1e-4f);
+    // the border only slides along itself, so the outline and area are kept
+    EXPECT_NEAR(area(plane, result), 1.0f, 1e-4f);
+}
+
+TEST(MeshSimplifierTest, StopsAtTargetCount) {
+    MeshData plane = makePlane(16);
+    auto result = MeshSimplifier::simplify(plane.vertices, plane.indices, plane.indices.size() / 2, 1.0f);
+    EXPECT_LE(result.size(), plane.indices.size() / 2);
+    EXPECT_GT(result.size(), plane.indices.size() / 4);
+
+    // nothing to do
+    auto same = MeshSimplifier::simplify(plane.vertices, plane.indices, plane.indices.size(), 1.0f);
+    EXPECT_EQ(same, plane.indices);
+}
+
+TEST(MeshSimplifierTest, ErrorBoundIsRespected) {
+    MeshData sphere = makeSphere(24, 48);
+    float loose = 0.0f, tight = 0.0f;
+    auto coarse = MeshSimplifier::simplify(sphere.vertices, sphere.indices, 0, 0.05f, &loose);
+    auto fine = MeshSimplifier::simplify(sphere.vertices, sphere.indices, 0, 0.005f, &tight);
+
+    EXPECT_LE(loose, 0.05f);
+    EXPECT_LE(tight, 0.005f);
+    EXPECT_LT(coarse.size(), fine.size());
+    EXPECT_LT(fine.size(), sphere.indices.size());
+    for (unsigned int index : coarse) {
+        EXPECT_LT(index, sphere.vertices.size());
+    }
+}
+
+TEST(MeshSimplifierTest, SeamSidesCollapseTogether) {
+    const int rings = 16, segments = 32;
+    MeshData sphere = makeSphere(rings, segments);
+    auto result = MeshSimplifier::simplify(sphere.vertices, sphere.indices, 0, 0.05f);
+    ASSERT_LT(result.size(), sphere.indices.size() / 2);
+
+    // the u = 0 and u = 1 copies of a seam vertex are either both kept or both gone
+    set<unsigned int> used(result.begin(), result.end());
+    for (int r = 1; r < rings; r++) {
+        unsigned int first = r * (segments + 1);
+        unsigned int last = first + segments;
+        EXPECT_EQ(used.count(first), used.count(last)) << "ring " << r;
+    }
+    // and no triangle connects the two sides across the seam
+    for (size_t i = 0; i < result.size(); i += 3) {
+        bool low = false, high = false;
+        for (int j = 0; j < 3; j++) {
+            float u = sphere.vertices[result[i + j]].TexCoords.x;
+            low = low || u < 0.25f;
+            high = high || u > 0.75f;
+        }
+        EXPECT_FALSE(low && high) << "triangle " << i / 3;
+    }
+}
+
+TEST(MeshSimplifierTest, GeneratedLodsShrinkWithGrowingError) {
+    MeshData sphere = makeSphere(32, 64);
+    LodSettings settings;
+    MeshSimplifier::generateLods(sphere, settings);
+
+    ASSERT_GE(sphere.lods.size(), 2u);
+    ASSERT_LE(sphere.lods.size(), settings.maxLevels);
+    size_t previous = sphere.indices.size();
+    float previousError = 0.0f;
+    uint32_t offset = 0;
+    for (const MeshLod& lod : sphere.lods) {
+        EXPECT_EQ(lod.firstIndex, offset);
+        EXPECT_LT(lod.indexCount, previous);
+        EXPECT_GE(lod.error, previousError);
+        EXPECT_LE(lod.error, settings.targetError * sqrt(3.0f));  // half the diagonal of the unit sphere's bounds
+        offset += lod.indexCount;
+        previous = lod.indexCount;
+        previousError = lod.error;
+    }
+    EXPECT_EQ(offset, sphere.lodIndices.size());
+
+    // small meshes are left alone
+    MeshData plane = makePlane(4);
+    MeshSimplifier::generateLods(plane, settings);
+    EXPECT_TRUE(plane.lods.empty());
+}
+
+TEST(MeshSimplifierTest, MeshSelectsLodByProjectedError) {
+    MeshData sphere = makeSphere(32, 64);
+    MeshSimplifier::generateLods(sphere, LodSettings());
+    ASSERT_GE(sphere.lods.size(), 2u);
+
+    Mesh mesh(sphere.vertices, sphere.indices, false, VertexFormat::FLOAT, sphere.lodView());
+    ASSERT_EQ(mesh.getLodCount(), sphere.lods.size() + 1);
+    EXPECT_EQ(mesh.getLod(0).indexCount, sphere.indices.size());
+    EXPECT_EQ(mesh.getLod(1).firstIndex, sphere.indices.size());
+
+    // up close every error is visible, far away the coarsest level is enough
+    EXPECT_EQ(mesh.selectLod(1e6f), 0u);
+    EXPECT_EQ(mesh.selectLod(1e-3f), mesh.getLodCount() - 1);
+    // just enough resolution for level 1
+    float pixelsPerUnit = 1.0f / mesh.getLod(1).error;
+    size_t level = mesh.selectLod(pixelsPerUnit);
+    EXPECT_GE(level, 1u);
+    EXPECT_LE(mesh.getLod(level).error * pixelsPerUnit, 1.0f);
+}
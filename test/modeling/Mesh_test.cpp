@@ -3,6 +3,7 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <modeling/GeometryArena.hpp>
 #include <modeling/Mesh.hpp>
 
 using namespace std;
@@ -54,6 +55,7 @@ protected:
     void TearDown() override {
         // Cleanup OpenGL context
         if (window) {
+            modeling::GeometryArena::shared().shutdown();
             glfwDestroyWindow(window);
         }
         glfwTerminate();
@@ -111,3 +113,28 @@ TEST_F(MeshTest, GoodConstructors) {
 	Mesh mesh3(unitcubev,unitcubei);
 	EXPECT_EQ(1,1); // expect no throw
 }
+
+TEST_F(MeshTest, ArenaShutdown) {
+	vector<Vertex> vertices = {
+		{glm::vec3(0.0f, 0.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),    glm::vec2(0.f, 0.f)},
+		{glm::vec3(1.0f, 0.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),    glm::vec2(1.f, 0.f)},
+		{glm::vec3(0.0f, 1.0f, 0.0f),  glm::vec3(0.0f, 0.0f, 1.0f),    glm::vec2(0.f, 1.f)},
+	};
+	vector<unsigned int> indices = { 0, 1, 2 };
+	modeling::GeometryArena &arena = modeling::GeometryArena::shared();
+
+	auto stale = make_unique<Mesh>(vertices, indices);
+	EXPECT_GT(arena.getPoolCount(), 0u);
+	arena.shutdown();
+	EXPECT_EQ(arena.getPoolCount(), 0u);
+
+	/*
+	 * a mesh uploaded afterwards gets a fresh pool, and freeing the stale
+	 * range must not give its space away
+	 */
+	Mesh fresh(vertices, indices);
+	size_t used = arena.getUsedBytes();
+	EXPECT_GT(used, 0u);
+	stale.reset();
+	EXPECT_EQ(arena.getUsedBytes(), used);
+}
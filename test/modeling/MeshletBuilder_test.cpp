@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <set>
+
+#include "modeling/Mesh.hpp"
+#include "modeling/MeshletBuilder.hpp"
+#include "modeling/MeshletCuller.hpp"
+#include "TestMeshes.hpp"
+
+using namespace std;
+using namespace modeling;
+using namespace test_meshes;
+
+namespace {
+    // triangles rotated to start at their smallest index, so winding is kept
+    multiset<array<unsigned int, 3>> triangleSet(const vector<unsigned int>& indices) {
+        multiset<array<unsigned int, 3>> result;
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            array<unsigned int, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+            rotate(t.begin(), min_element(t.begin(), t.end()), t.end());
+            result.insert(t);
+        }
+        return result;
+    }
+
+    glm::vec3 normalOf(const MeshData& mesh, const unsigned int* t) {
+        const glm::vec3& a = mesh.vertices[t[0]].Position;
+        return glm::cross(mesh.vertices[t[1]].Position - a, mesh.vertices[t[2]].Position - a);
+    }
+
+    // clip space is the box [-extent, extent]^3, orthographic
+    Frustum boxFrustum(float extent) {
+        glm::mat4 clip(1.0f / extent);
+        clip[3][3] = 1.0f;
+        return Frustum::fromMatrix(clip);
+    }
+}
+
+TEST(MeshletBuilderTest, MeshletsRespectLimitsAndCoverTheMesh) {
+    MeshData sphere = makeSphere(32, 64);
+    auto triangles = triangleSet(sphere.indices);
+    size_t count = MeshletBuilder::build(sphere);
+
+    ASSERT_GT(count, 1u);
+    ASSERT_EQ(count, sphere.meshlets.size());
+    EXPECT_EQ(triangleSet(sphere.indices), triangles);
+
+    uint32_t next = 0;
+    for (const Meshlet& meshlet : sphere.meshlets) {
+        EXPECT_EQ(meshlet.firstIndex, next);
+        EXPECT_LE(meshlet.indexCount, MeshletBuilder::MAX_TRIANGLES * 3);
+        set<unsigned int> unique(sphere.indices.begin() + meshlet.firstIndex,
+                                 sphere.indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+        EXPECT_EQ(unique.size(), meshlet.vertexCount);
+        EXPECT_LE(meshlet.vertexCount, MeshletBuilder::MAX_VERTICES);
+        next += meshlet.indexCount;
+    }
+    EXPECT_EQ(next, sphere.indices.size());
+}
+
+TEST(MeshletBuilderTest, GridMeshletsAreFull) {
+    MeshData plane = makePlane(48);
+    MeshletBuilder::build(plane);
+    // an 8 x 8 vertex patch holds 98 triangles, growing by fewest new vertices should get close
+    float average = float(plane.indices.size() / 3) / float(plane.meshlets.size());
+    EXPECT_GT(average, 85.0f);
+}
+
+TEST(MeshletBuilderTest, BoundsContainTrianglesAndNormals) {
+    MeshData sphere = makeSphere(24, 48);
+    MeshletBuilder::build(sphere);
+    for (const Meshlet& meshlet : sphere.meshlets) {
+        float coneCosine = sqrt(1.0f - meshlet.coneCutoff * meshlet.coneCutoff);
+        EXPECT_LT(meshlet.coneCutoff, 1.0f);  // a patch of a sphere is never that bent
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+            for (int j = 0; j < 3; j++) {
+                const glm::vec3& p = sphere.vertices[sphere.indices[i + j]].Position;
+                EXPECT_LE(glm::length(p - meshlet.center), meshlet.radius * 1.0001f);
+            }
+            glm::vec3 normal = normalOf(sphere, &sphere.indices[i]);
+            if (glm::length(normal) > 0.0f) {
+                EXPECT_GE(glm::dot(glm::normalize(normal), meshlet.coneAxis), coneCosine - 1e-4f);
+            }
+        }
+    }
+}
+
+TEST(MeshletCullerTest, FrustumPlanes) {
+    Frustum frustum = boxFrustum(2.0f);
+    EXPECT_TRUE(frustum.intersectsSphere(glm::vec3(0.0f), 0.1f));
+    EXPECT_TRUE(frustum.intersectsSphere(glm::vec3(2.5f, 0.0f, 0.0f), 0.6f));
+    EXPECT_FALSE(frustum.intersectsSphere(glm::vec3(2.5f, 0.0f, 0.0f), 0.4f));
+    EXPECT_FALSE(frustum.intersectsSphere(glm::vec3(0.0f, -3.0f, 0.0f), 0.5f));
+    EXPECT_FALSE(frustum.intersectsSphere(glm::vec3(0.0f, 0.0f, 3.0f), 0.5f));
+    for (const glm::vec4& plane : frustum.planes) {
+        EXPECT_NEAR(glm::length(glm::vec3(plane.x, plane.y, plane.z)), 1.0f, 1e-6f);
+    }
+}
+
+TEST(MeshletCullerTest, BackFacingMeshletsAreCulledConservatively) {
+    MeshData sphere = makeSphere(32, 64);
+    MeshletBuilder::build(sphere);
+    const glm::vec3 eye(0.0f, 0.0f, 4.0f);
+
+    vector<uint32_t> visible;
+    size_t passed = MeshletCuller::cull(sphere.meshlets.data(), sphere.meshlets.size(), boxFrustum(100.0f), eye, visible);
+    EXPECT_EQ(passed, visible.size());
+    // roughly the far half faces away, the cone test gets a good part of it
+    EXPECT_LT(passed, sphere.meshlets.size() * 3 / 4);
+    EXPECT_GT(passed, sphere.meshlets.size() / 3);
+
+    set<uint32_t> kept(visible.begin(), visible.end());
+    for (uint32_t m = 0; m < sphere.meshlets.size(); m++) {
+        if (kept.count(m)) {
+            continue;
+        }
+        const Meshlet& meshlet = sphere.meshlets[m];
+        for (uint32_t i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.indexCount; i += 3) {
+            const glm::vec3& p = sphere.vertices[sphere.indices[i]].Position;
+            EXPECT_GE(glm::dot(p - eye, normalOf(sphere, &sphere.indices[i])), 0.0f) << "meshlet " << m;
+        }
+    }
+}
+
+TEST(MeshletCullerTest, OutsideMeshletsAreCulledAndListsCompacted) {
+    // a 4 x 4 plane seen from the front, only the corner inside [-1, 1]^3 is visible
+    MeshData plane = makePlane(64, 4.0f);
+    MeshletBuilder::build(plane);
+    const glm::vec3 eye(0.5f, 0.5f, 0.9f);
+
+    MeshletDrawList list;
+    MeshletCuller::cull(plane.meshlets.data(), plane.meshlets.size(), boxFrustum(1.0f), eye, list.visible);
+    ASSERT_FALSE(list.visible.empty());
+    EXPECT_LT(list.visible.size(), plane.meshlets.size() / 4);
+    for (uint32_t m : list.visible) {
+        const Meshlet& meshlet = plane.meshlets[m];
+        EXPECT_LE(meshlet.center.x - meshlet.radius, 1.0f);
+        EXPECT_LE(meshlet.center.y - meshlet.radius, 1.0f);
+    }
+
+    MeshletCuller::buildDrawList(plane.meshlets.data(), sizeof(uint16_t), list);
+    vector<unsigned int> compacted;
+    MeshletCuller::compactIndices(plane.indices.data(), plane.meshlets.data(), list.visible, compacted);
+    EXPECT_EQ(compacted.size(), list.triangleCount * 3);
+    EXPECT_LE(list.counts.size(), list.visible.size());
+
+    // the draw ranges cover exactly the compacted triangles
+    vector<unsigned int> drawn;
+    for (size_t d = 0; d < list.counts.size(); d++) {
+        size_t first = reinterpret_cast<uintptr_t>(list.offsets[d]) / sizeof(uint16_t);
+        drawn.insert(drawn.end(), plane.indices.begin() + first, plane.indices.begin() + first + list.counts[d]);
+    }
+    EXPECT_EQ(drawn, compacted);
+}
+
+TEST(MeshletCullerTest, MeshCullsItsMeshlets) {
+    MeshData sphere = makeSphere(32, 64);
+    MeshletBuilder::build(sphere);
+    Mesh mesh(sphere.vertices, sphere.indices, false);
+
+    // without meshlets the whole mesh is one draw
+    MeshletDrawList list;
+    EXPECT_EQ(mesh.cullMeshlets(boxFrustum(100.0f), glm::vec3(0.0f, 0.0f, 4.0f), list), sphere.indices.size() / 3);
+    ASSERT_EQ(list.counts.size(), 1u);
+
+    mesh.setMeshlets(sphere.meshlets.data(), sphere.meshlets.size());
+    size_t triangles = mesh.cullMeshlets(boxFrustum(100.0f), glm::vec3(0.0f, 0.0f, 4.0f), list);
+    EXPECT_LT(triangles, sphere.indices.size() / 3);
+    EXPECT_GT(triangles, 0u);
+
+    Meshlet outside = sphere.meshlets.back();
+    outside.firstIndex = uint32_t(sphere.indices.size());
+    EXPECT_THROW(mesh.setMeshlets(&outside, 1), std::runtime_error);
+}
@@ -3,7 +3,14 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <filesystem>
+#include <fstream>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <modeling/GeometryArena.hpp>
 #include <modeling/ModelLoader.hpp>
+#include <modeling/TextureLoader.hpp>
 
 using namespace std;
 
@@ -59,6 +66,7 @@ protected:
     void TearDown() override {
         // Cleanup OpenGL context
         if (window) {
+            modeling::GeometryArena::shared().shutdown();
             glfwDestroyWindow(window);
         }
         glfwTerminate();
@@ -116,11 +124,103 @@ TEST_F(MeshLoadTest, UnitCube) {
 	};
 
 	for (int i=0; i<v.size(); i++) {
-		EXPECT_EQ(models[0]->getMeshes()[0]->vertices[i].Position,v[i].Position);
-		EXPECT_EQ(models[0]->getMeshes()[0]->vertices[i].Normal,v[i].Normal);
-		EXPECT_EQ(models[0]->getMeshes()[0]->vertices[i].TexCoords,v[i].TexCoords);
+		EXPECT_EQ(models[0]->getMeshes()[0]->getVertices()[i].Position,v[i].Position);
+		EXPECT_EQ(models[0]->getMeshes()[0]->getVertices()[i].Normal,v[i].Normal);
+		EXPECT_EQ(models[0]->getMeshes()[0]->getVertices()[i].TexCoords,v[i].TexCoords);
 	}
 	for (int i=0; i<ind.size(); i++) {
-		EXPECT_EQ(models[0]->getMeshes()[0]->indices[i],ind[i]);
+		EXPECT_EQ(models[0]->getMeshes()[0]->getIndices()[i],ind[i]);
+	}
+}
+
+TEST_F(MeshLoadTest, MeshSharedByTwoNodes) {
+	using namespace modeling;
+	ModelLoader::setMeshCacheEnabled(false);
+
+	/* the unit cube placed by two nodes, at -3 and 2 on x */
+	filesystem::path directory = filesystem::temp_directory_path() / "MeshLoadTestShared";
+	filesystem::create_directories(directory);
+	filesystem::copy_file("test/assets/unitcube.bin", directory / "unitcube.bin",
+	                      filesystem::copy_options::overwrite_existing);
+	{
+		ifstream source("test/assets/unitcube.gltf");
+		string gltf((istreambuf_iterator<char>(source)), istreambuf_iterator<char>());
+		size_t at = gltf.find("\"nodes\":[");
+		ASSERT_NE(at, string::npos);
+		at = gltf.find(']', at);
+		gltf.insert(at, ",1");
+		at = gltf.find("\"nodes\":[", at);
+		ASSERT_NE(at, string::npos);
+		gltf.insert(at + 9, "{\"mesh\":0,\"name\":\"Copy\",\"translation\":[-3,0,0]},");
+		at = gltf.find("\"name\":\"Cube\"", at);
+		ASSERT_NE(at, string::npos);
+		gltf.insert(at, "\"translation\":[2,0,0],");
+		ofstream(directory / "twocubes.gltf") << gltf;
+	}
+
+	auto models = ModelLoader::loadModels((directory / "twocubes.gltf").string(), make_shared<Shader>());
+	ASSERT_EQ(models.size(), 1u);
+	EXPECT_EQ(models[0]->getMeshes().size(), 1u);
+	ASSERT_EQ(models[0]->getInstanceCount(), 2u);
+	EXPECT_EQ(models[0]->getInstances()[0], glm::translate(glm::mat4(1.f), glm::vec3(-3.f, 0.f, 0.f)));
+	EXPECT_EQ(models[0]->getInstances()[1], glm::translate(glm::mat4(1.f), glm::vec3(2.f, 0.f, 0.f)));
+
+	models.clear();
+	filesystem::remove_all(directory);
+	ModelLoader::setMeshCacheEnabled(true);
+}
+
+TEST_F(MeshLoadTest, MaterialVariants) {
+	using namespace modeling;
+	MaterialSource plain, unlit;
+	unlit.unlit = true;
+	unlit.textures[TEXTURE_NORMAL] = "normal.png";
+	EXPECT_TRUE(ModelLoader::materialDefines(plain).empty());
+	EXPECT_EQ(ModelLoader::materialDefines(unlit), ShaderVariants::Defines({ "NORMAL_MAP", "UNLIT" }));
+
+	TextureCookOptions options;
+	options.enabled = false;
+	TextureLoader::setCookOptions(options);
+	ModelLoader::setMeshCacheEnabled(false);
+
+	/* the unit cube with a normal map */
+	filesystem::path directory = filesystem::temp_directory_path() / "MeshLoadTestVariants";
+	filesystem::create_directories(directory);
+	filesystem::copy_file("test/assets/unitcube.bin", directory / "unitcube.bin",
+	                      filesystem::copy_options::overwrite_existing);
+	{
+		ofstream image(directory / "normal.ppm", ios::binary);
+		image << "P6 2 2 255\n";
+		for (int i = 0; i < 4; i++) {
+			const char texel[3] = { char(128), char(128), char(255) };
+			image.write(texel, sizeof(texel));
+		}
+	}
+	{
+		ifstream source("test/assets/unitcube.gltf");
+		string gltf((istreambuf_iterator<char>(source)), istreambuf_iterator<char>());
+		size_t at = gltf.find("\"pbrMetallicRoughness\"");
+		ASSERT_NE(at, string::npos);
+		gltf.insert(at, "\"normalTexture\":{\"index\":0},\n");
+		at = gltf.find("\"meshes\"");
+		ASSERT_NE(at, string::npos);
+		gltf.insert(at, "\"textures\":[{\"source\":0}],\n\"images\":[{\"uri\":\"normal.ppm\"}],\n");
+		ofstream(directory / "normalcube.gltf") << gltf;
 	}
+
+	auto variants = make_shared<ShaderVariants>();
+	ASSERT_TRUE(variants->loadFromFiles({ { VERTEX, "assets/default.vert" }, { FRAGMENT, "assets/default.frag" } }));
+	auto imported = ModelLoader::importScene((directory / "normalcube.gltf").string());
+	ASSERT_NE(imported, nullptr);
+	auto models = ModelLoader::finalizeScene(*imported, variants);
+	ASSERT_EQ(models.size(), 1u);
+	Shader* normalMapped = variants->get({ "NORMAL_MAP" });
+	ASSERT_NE(normalMapped, nullptr);
+	EXPECT_EQ(models[0]->getShader().get(), normalMapped);
+
+	models.clear();
+	imported.reset();
+	filesystem::remove_all(directory);
+	ModelLoader::setMeshCacheEnabled(true);
+	TextureLoader::setCookOptions(TextureCookOptions());
 }
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <modeling/ResidencyManager.hpp>
+
+using namespace std;
+
+TEST(ResidencyManagerTest, TracksBytes) {
+    ResidencyManager residency;
+    residency.add(0, 100, 10);
+    residency.add(3, 50, 5);
+    EXPECT_TRUE(residency.resident(0));
+    EXPECT_FALSE(residency.resident(1));
+    EXPECT_TRUE(residency.resident(3));
+    EXPECT_EQ(residency.stats().cpu_bytes, 150u);
+    EXPECT_EQ(residency.stats().gpu_bytes, 15u);
+
+    /* re-adding replaces the old sizes */
+    residency.add(0, 20, 2);
+    EXPECT_EQ(residency.stats().cpu_bytes, 70u);
+
+    residency.remove(3);
+    residency.remove(3);
+    EXPECT_EQ(residency.stats().cpu_bytes, 20u);
+    EXPECT_EQ(residency.stats().gpu_bytes, 2u);
+}
+
+TEST(ResidencyManagerTest, HitsAndMisses) {
+    ResidencyManager residency;
+    residency.add(0, 1, 1);
+    EXPECT_TRUE(residency.touch(0));
+    EXPECT_TRUE(residency.touch(0));
+    EXPECT_FALSE(residency.touch(1));
+    EXPECT_EQ(residency.stats().hits, 2u);
+    EXPECT_EQ(residency.stats().misses, 1u);
+
+    residency.reset_counters();
+    EXPECT_EQ(residency.stats().hits, 0u);
+    EXPECT_EQ(residency.stats().cpu_bytes, 1u);
+}
+
+TEST(ResidencyManagerTest, EvictsLeastRecentlyUsed) {
+    ResidencyManager residency(250, ResidencyManager::UNLIMITED);
+    residency.add(0, 100, 0);
+    residency.next_frame();
+    residency.add(1, 100, 0);
+    residency.next_frame();
+    residency.add(2, 100, 0);
+    residency.touch(0); /* 1 is now the oldest */
+    residency.next_frame();
+
+    EXPECT_TRUE(residency.over_budget());
+    EXPECT_EQ(residency.evict(), vector<size_t>{ 1 });
+    EXPECT_FALSE(residency.over_budget());
+    EXPECT_FALSE(residency.resident(1));
+    EXPECT_EQ(residency.stats().evictions, 1u);
+
+    /* within budget, nothing to do */
+    EXPECT_TRUE(residency.evict().empty());
+}
+
+TEST(ResidencyManagerTest, PinnedAndCurrentFrameAreKept) {
+    ResidencyManager residency(100, ResidencyManager::UNLIMITED);
+    residency.pin(0);
+    residency.add(0, 100, 0);
+    residency.next_frame();
+    residency.add(1, 100, 0); /* used this frame */
+
+    EXPECT_TRUE(residency.evict().empty());
+    EXPECT_TRUE(residency.over_budget());
+
+    residency.next_frame();
+    EXPECT_EQ(residency.evict(), vector<size_t>{ 1 });
+    EXPECT_TRUE(residency.resident(0));
+
+    /* pins survive unloading */
+    residency.remove(0);
+    EXPECT_TRUE(residency.pinned(0));
+    residency.unpin(0);
+    EXPECT_FALSE(residency.pinned(0));
+}
+
+TEST(ResidencyManagerTest, OnlyEvictsForExceededBudget) {
+    ResidencyManager residency(ResidencyManager::UNLIMITED, 100);
+    residency.add(0, 1000, 0);  /* CPU only, evicting it frees no GPU memory */
+    residency.add(1, 10, 150);
+    residency.next_frame();
+
+    EXPECT_EQ(residency.evict(), vector<size_t>{ 1 });
+    EXPECT_TRUE(residency.resident(0));
+}
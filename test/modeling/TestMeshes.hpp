@@ -0,0 +1,67 @@
+#ifndef TEST_MESHES_HPP
+#define TEST_MESHES_HPP
+
+#include <cmath>
+
+#include "modeling/MeshData.hpp"
+
+/*
+ * procedural meshes shared by the modeling tests
+ */
+namespace test_meshes {
+
+    // n x n quads on [0, size]^2 at z = 0 facing +z, UVs over the unit square, an open border all around
+    inline MeshData makePlane(int n, float size = 1.0f) {
+        MeshData mesh;
+        mesh.valid = true;
+        for (int y = 0; y <= n; y++) {
+            for (int x = 0; x <= n; x++) {
+                Vertex v{};
+                v.Position = glm::vec3(size * x / n, size * y / n, 0.0f);
+                v.Normal = glm::vec3(0.0f, 0.0f, 1.0f);
+                v.TexCoords = glm::vec2(float(x) / n, float(y) / n);
+                mesh.vertices.push_back(v);
+            }
+        }
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                unsigned int i = y * (n + 1) + x;
+                mesh.indices.insert(mesh.indices.end(), { i, i + 1, i + n + 2, i, i + n + 2, i + n + 1 });
+            }
+        }
+        return mesh;
+    }
+
+    // unit UV sphere, outward facing. The u = 0 and u = 1 columns are separate vertices on the same positions
+    inline MeshData makeSphere(int rings, int segments) {
+        MeshData mesh;
+        mesh.valid = true;
+        const float pi = 3.14159265f;
+        for (int r = 0; r <= rings; r++) {
+            for (int s = 0; s <= segments; s++) {
+                float u = float(s) / segments, v = float(r) / rings;
+                float theta = (s == segments ? 0.0f : u) * 2.0f * pi, phi = v * pi;
+                Vertex vertex{};
+                vertex.Position = glm::vec3(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+                vertex.Normal = vertex.Position;
+                vertex.TexCoords = glm::vec2(u, v);
+                mesh.vertices.push_back(vertex);
+            }
+        }
+        for (int r = 0; r < rings; r++) {
+            for (int s = 0; s < segments; s++) {
+                unsigned int i = r * (segments + 1) + s;
+                unsigned int below = i + segments + 1;
+                if (r != 0) {
+                    mesh.indices.insert(mesh.indices.end(), { i, i + 1, below });
+                }
+                if (r != rings - 1) {
+                    mesh.indices.insert(mesh.indices.end(), { i + 1, below + 1, below });
+                }
+            }
+        }
+        return mesh;
+    }
+}
+
+#endif
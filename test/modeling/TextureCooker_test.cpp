@@ -0,0 +1,180 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+
+#include "modeling/BlockCompression.hpp"
+#include "modeling/TextureCooker.hpp"
+
+using namespace std;
+using namespace modeling;
+
+namespace {
+    shared_ptr<Texture> makeTexture(uint32_t width, uint32_t height, uint32_t channels,
+                                    const function<uint8_t(uint32_t, uint32_t, uint32_t)>& texel) {
+        unique_ptr<uint8_t[]> data(new uint8_t[size_t(width) * height * channels]);
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                for (uint32_t c = 0; c < channels; c++) {
+                    data[(size_t(y) * width + x) * channels + c] = texel(x, y, c);
+                }
+            }
+        }
+        return make_shared<Texture>(unique_ptr<const uint8_t[]>(move(data)), width, height, channels, 0);
+    }
+}
+
+TEST(TextureCookerTest, MipChainLayout) {
+    auto source = makeTexture(8, 4, 3, [](uint32_t, uint32_t, uint32_t c) { return uint8_t(60 * c + 10); });
+    auto mipped = TextureCooker::generateMips(*source, TextureUsage::DATA);
+
+    ASSERT_EQ(mipped->levels, 4u); // 8x4, 4x2, 2x1, 1x1
+    EXPECT_EQ(mipped->format, TextureFormat::RAW);
+    EXPECT_EQ(mipped->level_width(3), 1u);
+    EXPECT_EQ(mipped->level_height(2), 1u);
+    EXPECT_EQ(mipped->byte_size(), size_t(8 * 4 + 4 * 2 + 2 * 1 + 1) * 3);
+
+    // a constant image stays constant at every level, the filter is normalized
+    for (size_t i = 0; i < mipped->byte_size(); i++) {
+        EXPECT_EQ(mipped->data[i], 60 * (i % 3) + 10) << "byte " << i;
+    }
+}
+
+TEST(TextureCookerTest, ColorFilteredInLinearLight) {
+    // black and white stripes average to ~188 in sRGB, not the naive 128
+    auto source = makeTexture(2, 2, 4, [](uint32_t x, uint32_t, uint32_t c) {
+        return c == 3 ? uint8_t(255) : uint8_t(x == 0 ? 0 : 255);
+    });
+    auto mipped = TextureCooker::generateMips(*source, TextureUsage::COLOR);
+    ASSERT_EQ(mipped->levels, 2u);
+    const uint8_t* texel = mipped->data.get() + mipped->level_size(0);
+    EXPECT_NEAR(texel[0], 188, 2);
+    EXPECT_EQ(texel[3], 255);
+}
+
+TEST(TextureCookerTest, NormalsStayUnitLength) {
+    auto source = makeTexture(4, 4, 3, [](uint32_t x, uint32_t, uint32_t c) {
+        // alternating normals tilted left and right
+        const uint8_t left[3] = { 38, 128, 218 }, right[3] = { 218, 128, 218 };
+        return x % 2 ? right[c] : left[c];
+    });
+    auto mipped = TextureCooker::generateMips(*source, TextureUsage::NORMAL);
+    const uint8_t* texel = mipped->data.get() + mipped->level_size(0);
+    float n[3];
+    for (int c = 0; c < 3; c++) {
+        n[c] = texel[c] / 127.5f - 1.0f;
+    }
+    EXPECT_NEAR(n[0] * n[0] + n[1] * n[1] + n[2] * n[2], 1.0f, 0.03f);
+    EXPECT_NEAR(n[2], 1.0f, 0.03f);
+}
+
+TEST(TextureCookerTest, PacksOcclusionRoughnessMetallic) {
+    auto occlusion = makeTexture(4, 4, 1, [](uint32_t, uint32_t, uint32_t) { return uint8_t(50); });
+    // glTF metallicRoughness: roughness in green, metallic in blue
+    auto metallicRoughness = makeTexture(2, 2, 3, [](uint32_t, uint32_t, uint32_t c) {
+        return uint8_t(c == 1 ? 100 : (c == 2 ? 200 : 7));
+    });
+
+    auto packed = TextureCooker::packOcclusionRoughnessMetallic(*occlusion, *metallicRoughness, *metallicRoughness);
+    ASSERT_EQ(packed->width, 4u);
+    ASSERT_EQ(packed->height, 4u);
+    ASSERT_EQ(packed->n_channels, 3u);
+    for (size_t i = 0; i < 16; i++) {
+        EXPECT_EQ(packed->data[i * 3 + 0], 50);
+        EXPECT_EQ(packed->data[i * 3 + 1], 100);
+        EXPECT_EQ(packed->data[i * 3 + 2], 200);
+    }
+}
+
+TEST(TextureCookerTest, BC7RoundTrip) {
+    srand(7);
+    auto source = makeTexture(16, 12, 4, [](uint32_t x, uint32_t y, uint32_t c) {
+        return uint8_t(c == 3 ? 255 - 4 * y : x * 6 + y * 5 + c * 30 + rand() % 6);
+    });
+    auto compressed = TextureCooker::compress(*source, TextureUsage::COLOR);
+    ASSERT_EQ(compressed->format, TextureFormat::BC7);
+    ASSERT_EQ(compressed->byte_size(), size_t(4 * 3 * 16));
+
+    vector<uint8_t> decoded(16 * 12 * 4);
+    ASSERT_TRUE(BlockCompression::decodeImage(TextureFormat::BC7, compressed->data.get(), 16, 12, decoded.data()));
+    double squared = 0;
+    for (size_t i = 0; i < decoded.size(); i++) {
+        double d = double(decoded[i]) - source->data[i];
+        squared += d * d;
+    }
+    double psnr = 10 * log10(255.0 * 255.0 / (squared / decoded.size()));
+    EXPECT_GT(psnr, 32.0);
+}
+
+TEST(TextureCookerTest, BC7SolidBlockIsNearlyExact) {
+    uint8_t rgba[64], block[16], decoded[64];
+    for (int t = 0; t < 16; t++) {
+        rgba[t * 4 + 0] = 201; rgba[t * 4 + 1] = 13; rgba[t * 4 + 2] = 77; rgba[t * 4 + 3] = 255;
+    }
+    BlockCompression::encodeBC7Block(rgba, block);
+    ASSERT_TRUE(BlockCompression::decodeBC7Block(block, decoded));
+    for (int i = 0; i < 64; i++) {
+        EXPECT_NEAR(decoded[i], rgba[i], 1);
+    }
+}
+
+TEST(TextureCookerTest, BC5RoundTrip) {
+    uint8_t rg[32], block[16], decoded[32];
+    for (int t = 0; t < 16; t++) {
+        rg[t * 2 + 0] = uint8_t(10 + t * 14);
+        rg[t * 2 + 1] = uint8_t(128);
+    }
+    BlockCompression::encodeBC5Block(rg, block);
+    BlockCompression::decodeBC5Block(block, decoded);
+    for (int i = 0; i < 32; i++) {
+        EXPECT_NEAR(decoded[i], rg[i], 18);
+    }
+    EXPECT_EQ(decoded[0], 10);
+    EXPECT_EQ(decoded[30], 220);
+    EXPECT_EQ(decoded[1], 128);
+}
+
+TEST(TextureCookerTest, CacheRoundTrip) {
+    string path = (filesystem::temp_directory_path() / "TextureCookerTest.stc").string();
+    auto source = makeTexture(8, 8, 4, [](uint32_t x, uint32_t y, uint32_t c) { return uint8_t(x * 30 + y + c); });
+    TextureCookOptions options;
+    options.compress = true;
+    auto cooked = TextureCooker::cook(*source, TextureUsage::COLOR, options);
+    ASSERT_EQ(cooked->levels, 4u);
+
+    ASSERT_TRUE(TextureCooker::writeCache(path, 42, *cooked));
+    EXPECT_EQ(TextureCooker::readCache(path, 43), nullptr);
+    auto read = TextureCooker::readCache(path, 42);
+    remove(path.c_str());
+
+    ASSERT_NE(read, nullptr);
+    EXPECT_EQ(read->format, TextureFormat::BC7);
+    EXPECT_EQ(read->levels, cooked->levels);
+    EXPECT_EQ(read->width, 8u);
+    ASSERT_EQ(read->byte_size(), cooked->byte_size());
+    EXPECT_EQ(memcmp(read->data.get(), cooked->data.get(), read->byte_size()), 0);
+}
+
+TEST(TextureCookerTest, KeyFollowsSourceStamp) {
+    string path = (filesystem::temp_directory_path() / "TextureCookerTest.ppm").string();
+    ofstream(path, ios::binary) << "P6 1 1 255\n" << string(3, char(9));
+    TextureCookOptions options;
+
+    uint64_t key = TextureCooker::computeKey({ path, "" }, TextureUsage::DATA, options);
+    EXPECT_NE(key, 0u);
+    EXPECT_EQ(TextureCooker::computeKey({ path, "" }, TextureUsage::DATA, options), key);
+    EXPECT_NE(TextureCooker::computeKey({ path, "" }, TextureUsage::COLOR, options), key);
+    EXPECT_NE(TextureCooker::computeKey({ "", path }, TextureUsage::DATA, options), key);
+
+    ofstream(path, ios::binary) << "P6 2 1 255\n" << string(6, char(9));
+    EXPECT_NE(TextureCooker::computeKey({ path, "" }, TextureUsage::DATA, options), key);
+
+    remove(path.c_str());
+    EXPECT_EQ(TextureCooker::computeKey({ path }, TextureUsage::DATA, options), 0u);
+}
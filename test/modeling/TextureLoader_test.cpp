@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+#include "modeling/MeshCache.hpp"
+#include "modeling/TextureLoader.hpp"
+
+using namespace std;
+using namespace modeling;
+
+class TextureLoaderTest : public ::testing::Test {
+protected:
+    string imagePath;
+    string cacheDirectory;
+
+    void SetUp() override {
+        // plain decoding unless a test turns cooking on
+        TextureCookOptions options;
+        options.enabled = false;
+        TextureLoader::setCookOptions(options);
+        cacheDirectory = (filesystem::temp_directory_path() / "TextureLoaderTestCache").string();
+        filesystem::create_directories(cacheDirectory);
+        MeshCache::setCacheDirectory(cacheDirectory);
+
+        // 2x1 binary PPM: one red and one blue pixel
+        imagePath = (filesystem::temp_directory_path() / "TextureLoaderTest.ppm").string();
+        ofstream file(imagePath, ios::binary);
+        file << "P6 2 1 255\n";
+        const unsigned char pixels[6] = { 255, 0, 0, 0, 0, 255 };
+        file.write(reinterpret_cast<const char*>(pixels), sizeof(pixels));
+    }
+
+    void TearDown() override {
+        remove(imagePath.c_str());
+        MeshCache::setCacheDirectory("");
+        filesystem::remove_all(cacheDirectory);
+        TextureLoader::setCookOptions(TextureCookOptions());
+    }
+};
+
+TEST_F(TextureLoaderTest, DecodeFile) {
+    auto texture = TextureLoader::decodeFile(imagePath);
+    ASSERT_NE(texture, nullptr);
+    EXPECT_EQ(texture->width, 2u);
+    EXPECT_EQ(texture->height, 1u);
+    EXPECT_EQ(texture->n_channels, 3u);
+    EXPECT_EQ(texture->id, 0u);
+    EXPECT_EQ(texture->data[0], 255);
+    EXPECT_EQ(texture->data[5], 255);
+
+    EXPECT_EQ(TextureLoader::decodeFile(imagePath + ".missing"), nullptr);
+}
+
+TEST_F(TextureLoaderTest, DecodeRawEmbeddedAsRGBA) {
+    aiTexel texels[2] = {};
+    texels[0].r = 10; texels[0].g = 20; texels[0].b = 30; texels[0].a = 40;
+    texels[1].r = 50; texels[1].g = 60; texels[1].b = 70; texels[1].a = 80;
+    aiTexture embedded;
+    embedded.mWidth = 2;
+    embedded.mHeight = 1;
+    embedded.pcData = texels;
+
+    auto texture = TextureLoader::decodeEmbedded(&embedded);
+    embedded.pcData = nullptr; // not owned by aiTexture here
+    ASSERT_NE(texture, nullptr);
+    EXPECT_EQ(texture->n_channels, 4u);
+    const uint8_t expected[8] = { 10, 20, 30, 40, 50, 60, 70, 80 };
+    for (int i = 0; i < 8; i++) {
+        EXPECT_EQ(texture->data[i], expected[i]);
+    }
+}
+
+TEST_F(TextureLoaderTest, SharedTexturesDecodedOnce) {
+    vector<MaterialSource> sources(3);
+    sources[0].name = "a";
+    sources[0].textures[TEXTURE_BASE_COLOR] = imagePath;
+    sources[0].textures[TEXTURE_ALBEDO] = imagePath;
+    sources[1].name = "b";
+    sources[1].textures[TEXTURE_ROUGHNESS] = imagePath;
+    sources[1].textures[TEXTURE_NORMAL] = imagePath + ".missing";
+    sources[2].name = "c";
+
+    vector<shared_ptr<Texture>> textures;
+    auto materials = TextureLoader::buildMaterials(sources, nullptr, textures);
+    ASSERT_EQ(materials.size(), 3u);
+    // the decoded image, and one shared fallback for every missing texture
+    ASSERT_EQ(textures.size(), 2u);
+
+    const Texture* fallback = textures[0].get();
+    const Texture* decoded = textures[1].get();
+    EXPECT_EQ(fallback->width, 1u);
+    EXPECT_EQ(fallback->height, 1u);
+    EXPECT_NE(fallback, &TextureLoader::whiteTexture());
+    EXPECT_EQ(materials[0]->name, "a");
+    EXPECT_EQ(&materials[0]->base_color, decoded);
+    EXPECT_EQ(&materials[0]->albedo, decoded);
+    EXPECT_EQ(&materials[0]->normal, fallback);
+    EXPECT_EQ(&materials[1]->roughness, decoded);
+    EXPECT_EQ(&materials[1]->normal, fallback);
+    EXPECT_EQ(&materials[2]->base_color, fallback);
+
+    // materials keep their textures alive
+    weak_ptr<Texture> weak = textures[1];
+    textures.clear();
+    EXPECT_FALSE(weak.expired());
+    materials.clear();
+    EXPECT_TRUE(weak.expired());
+}
+
+TEST_F(TextureLoaderTest, EmbeddedSourcesDetected) {
+    MaterialSource source;
+    EXPECT_FALSE(source.hasEmbeddedTextures());
+    source.textures[TEXTURE_NORMAL] = "textures/normal.png";
+    EXPECT_FALSE(source.hasEmbeddedTextures());
+    source.textures[TEXTURE_METALLIC] = "*0";
+    EXPECT_TRUE(source.hasEmbeddedTextures());
+}
+
+TEST_F(TextureLoaderTest, CookedScalarMapsPackedAndCached) {
+    TextureLoader::setCookOptions(TextureCookOptions());
+
+    vector<MaterialSource> sources(2);
+    sources[0].name = "a";
+    sources[0].textures[TEXTURE_BASE_COLOR] = imagePath;
+    sources[0].textures[TEXTURE_ROUGHNESS] = imagePath;
+    sources[0].textures[TEXTURE_METALLIC] = imagePath;
+    sources[1] = sources[0];
+    sources[1].name = "b";
+
+    vector<shared_ptr<Texture>> textures;
+    auto materials = TextureLoader::buildMaterials(sources, nullptr, textures);
+    ASSERT_EQ(textures.size(), 2u); // base color, packed maps
+    const Texture& packed = materials[0]->roughness;
+    EXPECT_EQ(&materials[0]->metallic, &packed);
+    EXPECT_EQ(&materials[0]->ambient_occlusion, &packed);
+    EXPECT_EQ(&materials[1]->roughness, &packed);
+    EXPECT_EQ(packed.n_channels, 3u);
+    EXPECT_EQ(packed.levels, 2u);
+    EXPECT_EQ(materials[0]->base_color.levels, 2u);
+    // red/blue pixel: white occlusion, roughness from green, metallic from blue
+    EXPECT_EQ(packed.data[0], 255);
+    EXPECT_EQ(packed.data[1], 0);
+    EXPECT_EQ(packed.data[2], 0);
+    EXPECT_EQ(packed.data[5], 255);
+
+    // one cooked file per texture, read back by the second load
+    size_t cooked = distance(filesystem::directory_iterator(cacheDirectory), filesystem::directory_iterator());
+    EXPECT_EQ(cooked, 2u);
+    vector<shared_ptr<Texture>> again;
+    auto reloaded = TextureLoader::buildMaterials(sources, nullptr, again);
+    ASSERT_EQ(again.size(), 2u);
+    EXPECT_EQ(reloaded[0]->roughness.byte_size(), packed.byte_size());
+}
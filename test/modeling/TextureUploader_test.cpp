@@ -0,0 +1,275 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <regex>
+
+#include "modeling/GeometryArena.hpp"
+#include "modeling/ModelLoader.hpp"
+#include "modeling/TextureLoader.hpp"
+#include "modeling/TextureUploader.hpp"
+
+using namespace std;
+using namespace modeling;
+
+class TextureUploadTest : public ::testing::Test {
+protected:
+    GLFWwindow* window = nullptr;
+
+    void SetUp() override {
+        if (!glfwInit()) {
+            FAIL() << "Failed to initialize GLFW";
+        }
+
+        // 3.3 has no buffer storage, so the ring maps every region
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        window = glfwCreateWindow(1, 1, "Test Window", NULL, NULL);
+        if (!window) {
+            glfwTerminate();
+            FAIL() << "Failed to create GLFW window";
+        }
+        glfwMakeContextCurrent(window);
+
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            FAIL() << "Failed to initialize GLAD";
+        }
+    }
+
+    void TearDown() override {
+        if (window) {
+            GeometryArena::shared().shutdown();
+            glfwDestroyWindow(window);
+        }
+        glfwTerminate();
+    }
+
+    // <width> x <height> RGBA texture, every byte derived from <seed>
+    static shared_ptr<Texture> makeTexture(uint32_t width, uint32_t height, uint8_t seed) {
+        size_t bytes = size_t(width) * height * 4;
+        unique_ptr<uint8_t[]> pixels(new uint8_t[bytes]);
+        for (size_t i = 0; i < bytes; i++) {
+            pixels[i] = static_cast<uint8_t>(seed + i * 7);
+        }
+        return make_shared<Texture>(unique_ptr<const uint8_t[]>(std::move(pixels)), width, height, 4, 0);
+    }
+
+    // level 0 of the GL texture of <texture>, read back as <channels> bytes per texel
+    static vector<uint8_t> readBack(const Texture& texture, uint32_t channels) {
+        vector<uint8_t> pixels(size_t(texture.width) * texture.height * channels);
+        glBindTexture(GL_TEXTURE_2D, texture.id);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glGetTexImage(GL_TEXTURE_2D, 0, channels == 3 ? GL_RGB : GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return pixels;
+    }
+
+    // the channel default.frag reads from each material map, "metallicMap" -> 2
+    static map<string, int> shaderChannels() {
+        ifstream file("assets/default.frag");
+        string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+        static const regex pattern("texture\\((\\w+Map), TexCoord\\)\\.([rgba])\\b");
+        map<string, int> channels;
+        for (sregex_iterator it(source.begin(), source.end(), pattern), end; it != end; ++it) {
+            channels[(*it)[1].str()] = int(string("rgba").find((*it)[2].str()));
+        }
+        return channels;
+    }
+
+    static void expectUploaded(const Texture& texture) {
+        ASSERT_NE(texture.id, 0u);
+        vector<uint8_t> pixels = readBack(texture, texture.n_channels);
+        ASSERT_EQ(pixels.size(), size_t(texture.width) * texture.height * texture.n_channels);
+        for (size_t i = 0; i < pixels.size(); i++) {
+            ASSERT_EQ(pixels[i], texture.data[i]) << "byte " << i;
+        }
+    }
+};
+
+TEST_F(TextureUploadTest, RingWrapsAround) {
+    // 256 byte textures in a 1 KiB ring: the fifth one wraps to the start,
+    // onto regions the earlier uploads may still be reading
+    TextureUploader uploader(1024);
+    vector<shared_ptr<Texture>> textures;
+    for (uint8_t i = 0; i < 10; i++) {
+        textures.push_back(makeTexture(8, 8, i * 16));
+        uploader.upload(*textures.back());
+    }
+    for (auto& texture : textures) {
+        expectUploaded(*texture);
+    }
+}
+
+TEST_F(TextureUploadTest, LargerThanRing) {
+    TextureUploader uploader(1024);
+    auto small = makeTexture(8, 8, 1);
+    auto large = makeTexture(64, 64, 2);
+    auto after = makeTexture(8, 8, 3);
+    uploader.upload(*small);
+    uploader.upload(*large);
+    uploader.upload(*after);
+    expectUploaded(*small);
+    expectUploaded(*large);
+    expectUploaded(*after);
+}
+
+TEST_F(TextureUploadTest, TexturedAsset) {
+    TextureCookOptions options;
+    options.enabled = false;
+    TextureLoader::setCookOptions(options);
+    ModelLoader::setMeshCacheEnabled(false);
+
+    // the unit cube with a 16x16 base color image
+    filesystem::path directory = filesystem::temp_directory_path() / "TextureUploadTest";
+    filesystem::create_directories(directory);
+    filesystem::copy_file("test/assets/unitcube.bin", directory / "unitcube.bin",
+                          filesystem::copy_options::overwrite_existing);
+    {
+        ofstream image(directory / "checker.ppm", ios::binary);
+        image << "P6 16 16 255\n";
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                const char texel[3] = { char(x * 16), char(y * 16), char(((x ^ y) & 1) * 255) };
+                image.write(texel, sizeof(texel));
+            }
+        }
+    }
+    {
+        ifstream source("test/assets/unitcube.gltf");
+        string gltf((istreambuf_iterator<char>(source)), istreambuf_iterator<char>());
+        const string factor = "\"baseColorFactor\"";
+        size_t at = gltf.find(factor);
+        ASSERT_NE(at, string::npos);
+        gltf.insert(at, "\"baseColorTexture\":{\"index\":0},\n");
+        at = gltf.find("\"meshes\"");
+        ASSERT_NE(at, string::npos);
+        gltf.insert(at, "\"textures\":[{\"source\":0}],\n\"images\":[{\"uri\":\"checker.ppm\"}],\n");
+        ofstream(directory / "texturedcube.gltf") << gltf;
+    }
+
+    auto imported = ModelLoader::importScene((directory / "texturedcube.gltf").string());
+    ASSERT_NE(imported, nullptr);
+
+    // smaller than the image: it is uploaded directly, the fallback through the ring
+    TextureUploader uploader(512);
+    auto models = ModelLoader::finalizeScene(*imported, make_shared<Shader>(), &uploader);
+    ASSERT_EQ(models.size(), 1u);
+    const Material& material = *models[0]->getMaterials()[0];
+
+    EXPECT_EQ(material.base_color.width, 16u);
+    expectUploaded(material.base_color);
+
+    // missing maps use the scene's own fallback, uploaded with it
+    EXPECT_NE(&material.normal, &TextureLoader::whiteTexture());
+    expectUploaded(material.normal);
+    EXPECT_EQ(TextureLoader::whiteTexture().id, 0u);
+
+    models.clear();
+    imported.reset();
+    filesystem::remove_all(directory);
+    ModelLoader::setMeshCacheEnabled(true);
+    TextureLoader::setCookOptions(TextureCookOptions());
+}
+
+TEST_F(TextureUploadTest, GrayscaleSwizzled) {
+    auto gray = make_shared<Texture>(unique_ptr<const uint8_t[]>(new uint8_t[16]()), 4, 4, 1, 0);
+    TextureUploader uploader(1024);
+    uploader.upload(*gray);
+
+    GLint green = 0, blue = 0;
+    glBindTexture(GL_TEXTURE_2D, gray->id);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, &green);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, &blue);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    EXPECT_EQ(green, GL_RED);
+    EXPECT_EQ(blue, GL_RED);
+}
+
+TEST_F(TextureUploadTest, OcclusionRoughnessMetallicChannels) {
+    map<string, int> channels = shaderChannels();
+    ASSERT_EQ(channels.count("metallicMap"), 1u);
+    ASSERT_EQ(channels.count("roughnessMap"), 1u);
+    ASSERT_EQ(channels.count("aoMap"), 1u);
+
+    // separate glTF maps: grayscale occlusion, roughness in green and metallic in blue
+    filesystem::path directory = filesystem::temp_directory_path() / "TextureUploadTestOrm";
+    filesystem::create_directories(directory);
+    filesystem::copy_file("test/assets/unitcube.bin", directory / "unitcube.bin",
+                          filesystem::copy_options::overwrite_existing);
+    {
+        ofstream occlusion(directory / "occlusion.pgm", ios::binary);
+        occlusion << "P5 4 4 255\n" << string(16, char(50));
+        ofstream metallicRoughness(directory / "metallicRoughness.ppm", ios::binary);
+        metallicRoughness << "P6 4 4 255\n";
+        for (int i = 0; i < 16; i++) {
+            const char texel[3] = { char(7), char(100), char(200) };
+            metallicRoughness.write(texel, sizeof(texel));
+        }
+    }
+    {
+        ifstream source("test/assets/unitcube.gltf");
+        string gltf((istreambuf_iterator<char>(source)), istreambuf_iterator<char>());
+        const string factor = "\"baseColorFactor\"";
+        size_t at = gltf.find(factor);
+        ASSERT_NE(at, string::npos);
+        gltf.insert(at, "\"metallicRoughnessTexture\":{\"index\":1},\n");
+        at = gltf.find("\"pbrMetallicRoughness\"");
+        ASSERT_NE(at, string::npos);
+        gltf.insert(at, "\"occlusionTexture\":{\"index\":0},\n");
+        at = gltf.find("\"meshes\"");
+        ASSERT_NE(at, string::npos);
+        gltf.insert(at, "\"textures\":[{\"source\":0},{\"source\":1}],\n"
+                        "\"images\":[{\"uri\":\"occlusion.pgm\"},{\"uri\":\"metallicRoughness.ppm\"}],\n");
+        ofstream(directory / "ormcube.gltf") << gltf;
+    }
+
+    ModelLoader::setMeshCacheEnabled(false);
+    // packed by the cooker into one texture, and the maps as they are
+    for (bool cook : { true, false }) {
+        SCOPED_TRACE(cook ? "cooked" : "not cooked");
+        TextureCookOptions options;
+        options.enabled = cook;
+        options.cache = false;
+        TextureLoader::setCookOptions(options);
+
+        auto imported = ModelLoader::importScene((directory / "ormcube.gltf").string());
+        ASSERT_NE(imported, nullptr);
+        TextureUploader uploader(1024);
+        auto models = ModelLoader::finalizeScene(*imported, make_shared<Shader>(), &uploader);
+        ASSERT_EQ(models.size(), 1u);
+        const Material& material = *models[0]->getMaterials()[0];
+        if (cook) {
+            EXPECT_EQ(&material.metallic, &material.ambient_occlusion);
+            EXPECT_EQ(&material.roughness, &material.ambient_occlusion);
+        }
+
+        const pair<const Texture*, const char*> maps[3] = {
+            { &material.metallic, "metallicMap" },
+            { &material.roughness, "roughnessMap" },
+            { &material.ambient_occlusion, "aoMap" },
+        };
+        const uint8_t expected[3] = { 200, 100, 50 };
+        for (int i = 0; i < 3; i++) {
+            vector<uint8_t> pixels = readBack(*maps[i].first, 4);
+            EXPECT_EQ(pixels[channels[maps[i].second]], expected[i]) << maps[i].second;
+        }
+
+        models.clear();
+        imported.reset();
+    }
+
+    filesystem::remove_all(directory);
+    ModelLoader::setMeshCacheEnabled(true);
+    TextureLoader::setCookOptions(TextureCookOptions());
+}
@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <cmath>
+
+#include "modeling/VertexFormat.hpp"
+
+using namespace std;
+
+namespace {
+    vector<Vertex> makeGrid(float size, int n, glm::vec2 uvScale) {
+        vector<Vertex> vertices;
+        for (int y = 0; y < n; y++) {
+            for (int x = 0; x < n; x++) {
+                float u = float(x) / (n - 1), v = float(y) / (n - 1);
+                Vertex vertex{};
+                vertex.Position = glm::vec3(u * size, v * size * 0.5f, -u * size * 0.25f);
+                vertex.Normal = glm::normalize(glm::vec3(u - 0.5f, v - 0.5f, x % 2 ? 0.3f : -0.7f));
+                vertex.Tangent = glm::vec4(glm::normalize(glm::vec3(1.0f, v, u)), y % 2 ? 1.0f : -1.0f);
+                vertex.TexCoords = glm::vec2(u, v) * uvScale;
+                vertices.push_back(vertex);
+            }
+        }
+        return vertices;
+    }
+}
+
+TEST(VertexFormatTest, LayoutSizes) {
+    EXPECT_EQ(sizeof(Vertex), 48u);
+    VertexEncoding encoding;
+    EXPECT_EQ(encoding.stride(), sizeof(Vertex));
+    encoding.format = VertexFormat::PACKED;
+    EXPECT_EQ(encoding.stride(), 24u);
+    encoding.format = VertexFormat::QUANTIZED;
+    EXPECT_EQ(encoding.stride(), 20u);
+}
+
+TEST(VertexFormatTest, HalfFloatRoundTrip) {
+    const float exact[] = { 0.0f, -0.0f, 1.0f, -2.5f, 0.5f, 65504.0f, 6.103515625e-05f, 5.9604645e-08f };
+    for (float value : exact) {
+        EXPECT_EQ(halfToFloat(floatToHalf(value)), value);
+    }
+    EXPECT_TRUE(isinf(halfToFloat(floatToHalf(1e6f))));
+    EXPECT_TRUE(isnan(halfToFloat(floatToHalf(NAN))));
+    for (float value = -8.0f; value < 8.0f; value += 0.013f) {
+        EXPECT_NEAR(halfToFloat(floatToHalf(value)), value, fabs(value) / 2048.0f + 1e-7f);
+    }
+}
+
+TEST(VertexFormatTest, OctahedralRoundTrip) {
+    const glm::vec3 axes[] = { {1, 0, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+    for (const glm::vec3& axis : axes) {
+        glm::vec3 decoded = octDecode(octEncode(axis));
+        EXPECT_GT(glm::dot(decoded, axis), 0.99999f);
+    }
+    for (int i = 0; i < 200; i++) {
+        float theta = i * 0.173f, phi = i * 0.091f;
+        glm::vec3 n(sin(phi) * cos(theta), sin(phi) * sin(theta), cos(phi));
+        glm::vec2 e = octEncode(n);
+        EXPECT_LE(fabs(e.x) + fabs(e.y), 1.0001f + (n.z < 0 ? 1.0f : 0.0f));
+        EXPECT_GT(glm::dot(octDecode(e), n), 0.99999f);
+    }
+}
+
+TEST(VertexFormatTest, QuantizedOnlyWithinTolerance) {
+    auto small = makeGrid(2.0f, 8, glm::vec2(1.0f));
+    EXPECT_EQ(chooseVertexEncoding(small.data(), small.size(), VertexFormat::QUANTIZED, 1e-4f).format,
+              VertexFormat::QUANTIZED);
+
+    // 100 units need a step of ~1.5e-3, too coarse for the tolerance
+    auto large = makeGrid(100.0f, 8, glm::vec2(1.0f));
+    EXPECT_EQ(chooseVertexEncoding(large.data(), large.size(), VertexFormat::QUANTIZED, 1e-4f).format,
+              VertexFormat::PACKED);
+    EXPECT_EQ(chooseVertexEncoding(large.data(), large.size(), VertexFormat::QUANTIZED, 1e-3f).format,
+              VertexFormat::QUANTIZED);
+
+    EXPECT_EQ(chooseVertexEncoding(small.data(), small.size(), VertexFormat::FLOAT, 1e-4f).format,
+              VertexFormat::FLOAT);
+}
+
+TEST(VertexFormatTest, TexCoordEncodingFollowsRange) {
+    auto unit = makeGrid(1.0f, 4, glm::vec2(1.0f));
+    EXPECT_TRUE(chooseVertexEncoding(unit.data(), unit.size(), VertexFormat::PACKED, 1e-4f).unormTexCoords);
+    auto tiled = makeGrid(1.0f, 4, glm::vec2(4.0f));
+    EXPECT_FALSE(chooseVertexEncoding(tiled.data(), tiled.size(), VertexFormat::PACKED, 1e-4f).unormTexCoords);
+}
+
+TEST(VertexFormatTest, EncodeDecodeWithinBounds) {
+    const VertexFormat formats[] = { VertexFormat::FLOAT, VertexFormat::PACKED, VertexFormat::QUANTIZED };
+    for (VertexFormat format : formats) {
+        for (float uvScale : { 1.0f, 3.0f }) {
+            auto vertices = makeGrid(3.0f, 9, glm::vec2(uvScale));
+            VertexEncoding encoding = chooseVertexEncoding(vertices.data(), vertices.size(), format, 1e-4f);
+            ASSERT_EQ(encoding.format, format);
+            auto data = encodeVertices(vertices.data(), vertices.size(), encoding);
+            ASSERT_EQ(data.size(), vertices.size() * encoding.stride());
+
+            for (size_t i = 0; i < vertices.size(); i++) {
+                const Vertex& in = vertices[i];
+                Vertex out = decodeVertex(data.data(), i, encoding);
+                for (int c = 0; c < 3; c++) {
+                    EXPECT_NEAR(out.Position[c], in.Position[c], 1e-4f);
+                }
+                EXPECT_GT(glm::dot(out.Normal, in.Normal), 0.99999f);
+                EXPECT_GT(glm::dot(glm::vec3(out.Tangent), glm::vec3(in.Tangent)), 0.999f);
+                EXPECT_EQ(out.Tangent.w, in.Tangent.w);
+                EXPECT_NEAR(out.TexCoords.x, in.TexCoords.x, 2e-3f);
+                EXPECT_NEAR(out.TexCoords.y, in.TexCoords.y, 2e-3f);
+            }
+        }
+    }
+}
+
+TEST(VertexFormatTest, MissingTangentStaysZero) {
+    // the loader's placeholder for meshes without UVs, shaders derive a tangent instead
+    auto vertices = makeGrid(1.0f, 2, glm::vec2(1.0f));
+    for (Vertex& vertex : vertices) {
+        vertex.Tangent = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    for (VertexFormat format : { VertexFormat::PACKED, VertexFormat::QUANTIZED }) {
+        VertexEncoding encoding = chooseVertexEncoding(vertices.data(), vertices.size(), format, 1e-4f);
+        auto data = encodeVertices(vertices.data(), vertices.size(), encoding);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            Vertex out = decodeVertex(data.data(), i, encoding);
+            EXPECT_EQ(out.Tangent, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+        }
+    }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "rendering/Bloom.hpp"
+
+using namespace std;
+
+namespace {
+
+    vector<float> gaussian(int radius) {
+        float sigma = radius * 0.5f + 0.5f;
+        vector<float> weights;
+        float sum = 0.f;
+        for (int i = 0; i <= radius; ++i) {
+            weights.push_back(exp(-(i * i) / (2.f * sigma * sigma)));
+            sum += i == 0 ? weights.back() : 2.f * weights.back();
+        }
+        for (float &w : weights) {
+            w /= sum;
+        }
+        return weights;
+    }
+
+    // 1D texture with GL_LINEAR and GL_CLAMP_TO_EDGE, sampled <x> texels from texel <center>
+    float sampleLinear(const vector<float> &texels, int center, float x) {
+        float position = center + x;
+        int left = int(floor(position));
+        float t = position - left;
+        auto texel = [&](int i) { return texels[size_t(clamp(i, 0, int(texels.size()) - 1))]; };
+        return texel(left) * (1.f - t) + texel(left + 1) * t;
+    }
+
+}
+
+TEST(BloomTest, MergedTapsHalveTheFetches) {
+    vector<float> offsets, weights;
+    for (int radius : {0, 1, 4, 7, 63}) {
+        ASSERT_TRUE(mergeLinearTaps(gaussian(radius), &offsets, &weights));
+        EXPECT_EQ(weights.size(), size_t(1 + (radius + 1) / 2)) << "radius " << radius;
+        EXPECT_EQ(offsets.size(), weights.size());
+        EXPECT_EQ(offsets[0], 0.f);
+    }
+    // 33 taps at radius 63, the size of the arrays in blur.frag
+    EXPECT_EQ(weights.size(), 33u);
+
+    EXPECT_FALSE(mergeLinearTaps({}, &offsets, &weights));
+    EXPECT_FALSE(mergeLinearTaps({1.f}, nullptr, &weights));
+}
+
+TEST(BloomTest, MergedTapsMatchTheDiscreteKernel) {
+    mt19937 rng(7);
+    uniform_real_distribution<float> value(0.f, 8.f);
+    vector<float> texels(96);
+    for (float &t : texels) {
+        t = value(rng);
+    }
+
+    for (int radius : {1, 4, 9, 63}) {
+        vector<float> kernel = gaussian(radius);
+        vector<float> offsets, weights;
+        ASSERT_TRUE(mergeLinearTaps(kernel, &offsets, &weights));
+
+        for (int x = 0; x < int(texels.size()); ++x) {
+            float discrete = texels[size_t(x)] * kernel[0];
+            for (int i = 1; i <= radius; ++i) {
+                discrete += sampleLinear(texels, x, float(i)) * kernel[size_t(i)];
+                discrete += sampleLinear(texels, x, -float(i)) * kernel[size_t(i)];
+            }
+            float merged = texels[size_t(x)] * weights[0];
+            for (size_t i = 1; i < weights.size(); ++i) {
+                merged += sampleLinear(texels, x, offsets[i]) * weights[i];
+                merged += sampleLinear(texels, x, -offsets[i]) * weights[i];
+            }
+            EXPECT_NEAR(merged, discrete, 1e-4f) << "radius " << radius << " texel " << x;
+        }
+    }
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <random>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "modeling/Model.hpp"
+#include "rendering/CullingStage.hpp"
+
+using namespace std;
+using namespace rendering;
+
+namespace {
+    // the frustum of a camera at the origin looking down +z, 90 degrees wide, from 1 to 100
+    modeling::Frustum makeFrustum() {
+        Camera camera(Eigen::Vector3f(0.f, 0.f, 0.f), Eigen::Vector3f(0.f, 0.f, 1.f));
+        camera.setFOV(90.f);
+        CullingStage stage;
+        stage.setCamera(camera, 1.f, 1.f, 100.f);
+        return stage.getFrustum();
+    }
+
+    // a unit cube mesh around <center>, CPU only
+    shared_ptr<Mesh> makeCube(const glm::vec3 &center) {
+        vector<Vertex> vertices(8);
+        for (int i = 0; i < 8; i++) {
+            vertices[i].Position = center + glm::vec3(i & 1, (i >> 1) & 1, i >> 2) - glm::vec3(0.5f);
+        }
+        vector<unsigned int> indices = { 0, 1, 3, 0, 3, 2, 4, 7, 5, 4, 6, 7 };
+        return make_shared<Mesh>(move(vertices), move(indices), false);
+    }
+}
+
+TEST(CullingStageTest, BoxesAgainstFrustum) {
+    modeling::Frustum frustum = makeFrustum();
+    BoxList boxes;
+    boxes.add(glm::vec3(-1.f, -1.f, 10.f), glm::vec3(1.f, 1.f, 12.f));    // 0 inside
+    boxes.add(glm::vec3(-1.f, -1.f, -12.f), glm::vec3(1.f, 1.f, -10.f));  // 1 behind
+    boxes.add(glm::vec3(9.f, -1.f, 5.f), glm::vec3(11.f, 1.f, 7.f));      // 2 right of the view
+    boxes.add(glm::vec3(4.f, -1.f, 4.f), glm::vec3(6.f, 1.f, 6.f));       // 3 crossing the right plane
+    boxes.add(glm::vec3(-1.f, -1.f, 99.f), glm::vec3(1.f, 1.f, 101.f));   // 4 crossing the far plane
+    boxes.add(glm::vec3(-1.f, -1.f, 150.f), glm::vec3(1.f, 1.f, 160.f));  // 5 beyond it
+
+    vector<uint32_t> visible, inside;
+    CullingStage::cullBoxes(frustum, boxes, visible, &inside);
+    EXPECT_EQ(visible, (vector<uint32_t>{ 0, 3, 4 }));
+    EXPECT_EQ(inside, (vector<uint32_t>{ 0 }));
+}
+
+TEST(CullingStageTest, SimdMatchesScalarTest) {
+    modeling::Frustum frustum = makeFrustum();
+    mt19937 random(7);
+    uniform_real_distribution<float> position(-120.f, 120.f), size(0.f, 20.f);
+    BoxList boxes;
+    // not a multiple of the SIMD width, so the scalar tail runs too
+    for (int i = 0; i < 1003; i++) {
+        glm::vec3 min(position(random), position(random), position(random));
+        boxes.add(min, min + glm::vec3(size(random), size(random), size(random)));
+    }
+
+    vector<uint32_t> visible, inside;
+    CullingStage::cullBoxes(frustum, boxes, visible, &inside);
+    ASSERT_FALSE(visible.empty());
+    ASSERT_LT(visible.size(), boxes.size());
+
+    // a box is outside if its farthest corner along a plane's normal is behind it
+    size_t next = 0, nextInside = 0;
+    for (uint32_t i = 0; i < boxes.size(); i++) {
+        bool outside = false, crossing = false;
+        for (const glm::vec4 &plane : frustum.planes) {
+            float farthest = -INFINITY, nearest = INFINITY;
+            for (int corner = 0; corner < 8; corner++) {
+                glm::vec3 p(corner & 1 ? boxes.maxX[i] : boxes.minX[i],
+                            corner & 2 ? boxes.maxY[i] : boxes.minY[i],
+                            corner & 4 ? boxes.maxZ[i] : boxes.minZ[i]);
+                float d = glm::dot(glm::vec3(plane), p) + plane.w;
+                farthest = max(farthest, d);
+                nearest = min(nearest, d);
+            }
+            outside = outside || farthest < 0.f;
+            crossing = crossing || nearest < 0.f;
+        }
+        bool listed = next < visible.size() && visible[next] == i;
+        EXPECT_EQ(listed, !outside) << "box " << i;
+        next += listed;
+        bool listedInside = nextInside < inside.size() && inside[nextInside] == i;
+        EXPECT_EQ(listedInside, !outside && !crossing) << "box " << i;
+        nextInside += listedInside;
+    }
+}
+
+TEST(CullingStageTest, TransformedBoxesEncloseCorners) {
+    glm::mat4 transform = glm::translate(glm::mat4(1.f), glm::vec3(5.f, 0.f, 0.f));
+    transform = glm::rotate(transform, 0.7f, glm::vec3(0.f, 1.f, 0.f));
+    transform = glm::scale(transform, glm::vec3(2.f));
+    glm::vec3 min, max;
+    CullingStage::transformBox(transform, glm::vec3(-1.f), glm::vec3(1.f), min, max);
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 p = glm::vec3(transform * glm::vec4(corner & 1 ? 1.f : -1.f, corner & 2 ? 1.f : -1.f,
+                                                      corner & 4 ? 1.f : -1.f, 1.f));
+        for (int c = 0; c < 3; c++) {
+            EXPECT_GE(p[c], min[c] - 1e-5f);
+            EXPECT_LE(p[c], max[c] + 1e-5f);
+        }
+    }
+    // a rotation about y leaves the height alone
+    EXPECT_NEAR(max.y - min.y, 4.f, 1e-5f);
+}
+
+TEST(CullingStageTest, ObjectsThenMeshes) {
+    modeling::Model inFront, straddling, behind;
+    inFront.addMesh(makeCube(glm::vec3(0.f, 0.f, 10.f)), nullptr);
+    inFront.addMesh(makeCube(glm::vec3(1.f, 0.f, 10.f)), nullptr);
+    // one mesh in view, one far to the right of it
+    straddling.addMesh(makeCube(glm::vec3(0.f, 0.f, 0.f)), nullptr);
+    straddling.addMesh(makeCube(glm::vec3(40.f, 0.f, 0.f)), nullptr);
+    behind.addMesh(makeCube(glm::vec3(0.f)), nullptr);
+
+    CullingStage stage;
+    stage.setFrustum(makeFrustum());
+    glm::mat4 forward = glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, 20.f));
+    uint32_t a = stage.addObject(inFront, glm::mat4(1.f));
+    uint32_t b = stage.addObject(straddling, forward);
+    stage.addObject(behind, glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -20.f)));
+
+    ASSERT_EQ(stage.cull(), 3u);
+    Span<const VisibleMesh> visible = stage.getVisible();
+    EXPECT_EQ(visible[0].object, a);
+    EXPECT_EQ(visible[0].mesh, 0u);
+    EXPECT_EQ(visible[1].object, a);
+    EXPECT_EQ(visible[1].mesh, 1u);
+    EXPECT_EQ(visible[2].object, b);
+    EXPECT_EQ(visible[2].mesh, 0u);
+    EXPECT_EQ(&stage.getModel(b), &straddling);
+    // three objects, then only the meshes of the one crossing the border
+    EXPECT_EQ(stage.getTestedBoxes(), 5u);
+
+    stage.clear();
+    EXPECT_EQ(stage.getObjectCount(), 0u);
+    EXPECT_EQ(stage.cull(), 0u);
+}
+
+TEST(CullingStageTest, InstancesShareOneBox) {
+    modeling::Model single, instanced;
+    single.addMesh(makeCube(glm::vec3(0.f)), nullptr);
+    single.addMesh(makeCube(glm::vec3(1.f, 0.f, 0.f)), nullptr);
+    // a lone instance moves the model in view
+    single.addInstance(glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, 10.f)));
+    instanced.addMesh(makeCube(glm::vec3(0.f)), nullptr);
+    instanced.addMesh(makeCube(glm::vec3(40.f, 0.f, 0.f)), nullptr);
+    instanced.addInstance(glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, -20.f)));
+    instanced.addInstance(glm::translate(glm::mat4(1.f), glm::vec3(0.f, 0.f, 20.f)));
+
+    CullingStage stage;
+    stage.setFrustum(makeFrustum());
+    uint32_t a = stage.addObject(single, glm::mat4(1.f));
+    uint32_t b = stage.addObject(instanced, glm::mat4(1.f));
+    EXPECT_FLOAT_EQ(stage.getTransform(a)[3].z, 10.f);
+
+    // the second model crosses the border but keeps both meshes, one box covers every instance
+    ASSERT_EQ(stage.cull(), 4u);
+    EXPECT_EQ(stage.getVisible()[2].object, b);
+    EXPECT_EQ(stage.getVisible()[3].mesh, 1u);
+    EXPECT_EQ(stage.getTestedBoxes(), 2u);
+}
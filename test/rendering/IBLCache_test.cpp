@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "rendering/IBLCache.hpp"
+
+using namespace std;
+using namespace rendering;
+
+namespace {
+
+    // a 4x4 cubemap with its 2x2 and 1x1 levels, every image filled with its index
+    IBLTextureData cubemap() {
+        IBLTextureData data;
+        data.internalFormat = GL_RGB16F;
+        data.format = GL_RGB;
+        data.type = GL_HALF_FLOAT;
+        data.width = data.height = 4;
+        data.faces = 6;
+        data.levels = 3;
+        for (uint32_t level = 0; level < data.levels; ++level) {
+            size_t side = size_t(4 >> level);
+            for (uint32_t face = 0; face < data.faces; ++face) {
+                data.images.emplace_back(side * side * 6, uint8_t(level * data.faces + face));
+            }
+        }
+        return data;
+    }
+
+}
+
+TEST(IBLCacheTest, KeyCoversKindSourceAndSize) {
+    uint64_t key = IBLCache::computeKey(IBLCache::IRRADIANCE, 0x1234, 32);
+    EXPECT_EQ(key, IBLCache::computeKey(IBLCache::IRRADIANCE, 0x1234, 32));
+
+    EXPECT_NE(key, IBLCache::computeKey(IBLCache::PREFILTER, 0x1234, 32));
+    EXPECT_NE(key, IBLCache::computeKey(IBLCache::IRRADIANCE, 0x1235, 32));
+    EXPECT_NE(key, IBLCache::computeKey(IBLCache::IRRADIANCE, 0x1234, 64));
+}
+
+TEST(IBLCacheTest, HashFollowsFileContents) {
+    string path = (filesystem::temp_directory_path() / "IBLCacheTest.hdr").string();
+    {
+        ofstream file(path, ios::binary);
+        file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n";
+    }
+    uint64_t hash = IBLCache::hashFile(path);
+    EXPECT_NE(hash, 0u);
+    EXPECT_EQ(hash, IBLCache::hashFile(path));
+
+    {
+        ofstream file(path, ios::binary | ios::app);
+        file << "-Y 1 +X 1\n";
+    }
+    EXPECT_NE(hash, IBLCache::hashFile(path));
+
+    filesystem::remove(path);
+    EXPECT_EQ(IBLCache::hashFile(path), 0u);
+}
+
+TEST(IBLCacheTest, FileRoundTrip) {
+    string path = (filesystem::temp_directory_path() / "IBLCacheTest.ibl").string();
+    IBLTextureData data = cubemap();
+    ASSERT_TRUE(IBLCache::writeFile(path, 0x1234, data));
+
+    IBLTextureData read;
+    ASSERT_TRUE(IBLCache::readFile(path, 0x1234, read));
+    EXPECT_EQ(read.internalFormat, data.internalFormat);
+    EXPECT_EQ(read.format, data.format);
+    EXPECT_EQ(read.type, data.type);
+    EXPECT_EQ(read.width, 4u);
+    EXPECT_EQ(read.height, 4u);
+    EXPECT_EQ(read.faces, 6u);
+    EXPECT_EQ(read.levels, 3u);
+    EXPECT_FALSE(read.compressed());
+    EXPECT_EQ(read.images, data.images);
+
+    // another key is a miss, not another environment's map
+    EXPECT_FALSE(IBLCache::readFile(path, 0x1235, read));
+
+    // a truncated file is rejected
+    filesystem::resize_file(path, filesystem::file_size(path) - 2);
+    EXPECT_FALSE(IBLCache::readFile(path, 0x1234, read));
+
+    filesystem::remove(path);
+    EXPECT_FALSE(IBLCache::readFile(path, 0x1234, read));
+}
+
+TEST(IBLCacheTest, InconsistentDataIsNotWritten) {
+    string path = (filesystem::temp_directory_path() / "IBLCacheTest.ibl").string();
+    IBLTextureData data = cubemap();
+    data.images.pop_back();
+    EXPECT_FALSE(IBLCache::writeFile(path, 0x1234, data));
+    EXPECT_FALSE(filesystem::exists(path));
+}
+
+TEST(IBLCacheTest, DirectorySetting) {
+    string previous = IBLCache::getDirectory();
+    IBLCache::setDirectory("cache-dir");
+    EXPECT_EQ(IBLCache::pathFor(0xabcull), (filesystem::path("cache-dir") / "0000000000000abc.ibl").string());
+
+    // turned off, nothing is loaded
+    IBLCache::setDirectory("");
+    EXPECT_EQ(IBLCache::load(0xabcull, GL_TEXTURE_2D), 0u);
+    IBLCache::setDirectory(previous);
+}
@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <regex>
+#include <set>
+
+#include "modeling/GeometryArena.hpp"
+#include "modeling/MaterialSource.hpp"
+#include "modeling/ModelLoader.hpp"
+#include "rendering/RenderQueue.hpp"
+#include "utils/Shader.hpp"
+
+using namespace std;
+using namespace rendering;
+
+TEST(RenderQueueTest, KeysOrderByPassThenState) {
+    // the pass decides first, whatever the rest
+    EXPECT_LT(RenderQueue::makeKey(PASS_OPAQUE, 100, 100, 100, 1000.f),
+              RenderQueue::makeKey(PASS_MASKED, 0, 0, 0, 0.f));
+    // then shader, material and geometry
+    EXPECT_LT(RenderQueue::makeKey(PASS_OPAQUE, 1, 9, 9, 1000.f),
+              RenderQueue::makeKey(PASS_OPAQUE, 2, 0, 0, 0.f));
+    EXPECT_LT(RenderQueue::makeKey(PASS_OPAQUE, 1, 1, 9, 1000.f),
+              RenderQueue::makeKey(PASS_OPAQUE, 1, 2, 0, 0.f));
+    EXPECT_LT(RenderQueue::makeKey(PASS_OPAQUE, 1, 1, 1, 1000.f),
+              RenderQueue::makeKey(PASS_OPAQUE, 1, 1, 2, 0.f));
+    // and front to back within the same state
+    EXPECT_LT(RenderQueue::makeKey(PASS_OPAQUE, 1, 1, 1, 2.f),
+              RenderQueue::makeKey(PASS_OPAQUE, 1, 1, 1, 2.5f));
+    EXPECT_LT(RenderQueue::makeKey(PASS_OPAQUE, 1, 1, 1, 0.f),
+              RenderQueue::makeKey(PASS_OPAQUE, 1, 1, 1, 1e-3f));
+}
+
+TEST(RenderQueueTest, TransparentKeysOrderBackToFront) {
+    EXPECT_LT(RenderQueue::makeKey(PASS_TRANSPARENT, 5, 5, 5, 20.f),
+              RenderQueue::makeKey(PASS_TRANSPARENT, 0, 0, 0, 10.f));
+    // still after every opaque draw, before overlays
+    EXPECT_GT(RenderQueue::makeKey(PASS_TRANSPARENT, 0, 0, 0, 1e30f),
+              RenderQueue::makeKey(PASS_MASKED, 4095, 65535, 255, 1e30f));
+    EXPECT_LT(RenderQueue::makeKey(PASS_TRANSPARENT, 0, 0, 0, 0.f),
+              RenderQueue::makeKey(PASS_OVERLAY, 0, 0, 0, 0.f));
+}
+
+TEST(RenderQueueTest, FieldsSaturateInsteadOfOverflowing) {
+    // a shader number past its 12 bits must not spill into the pass
+    EXPECT_LT(RenderQueue::makeKey(PASS_OPAQUE, 1u << 20, 0, 0, 0.f),
+              RenderQueue::makeKey(PASS_MASKED, 0, 0, 0, 0.f));
+    EXPECT_EQ(RenderQueue::makeKey(PASS_OPAQUE, 1u << 20, 0, 0, 0.f),
+              RenderQueue::makeKey(PASS_OPAQUE, 4095, 0, 0, 0.f));
+}
+
+TEST(RenderQueueTest, RadixSortIsStable) {
+    mt19937_64 random(3);
+    vector<DrawItem> items(5000);
+    for (size_t i = 0; i < items.size(); i++) {
+        // few distinct keys so there are plenty of ties, spread over every byte
+        uint64_t key = random() % 64;
+        items[i] = DrawItem{ key * 0x0101010101010101ull, nullptr, nullptr, nullptr, 0, uint32_t(i) };
+    }
+    vector<DrawItem> expected = items;
+    stable_sort(expected.begin(), expected.end(), [](const DrawItem &a, const DrawItem &b) {
+        return a.key < b.key;
+    });
+
+    vector<DrawItem> scratch;
+    RenderQueue::radixSort(items, scratch);
+    ASSERT_EQ(items.size(), expected.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        EXPECT_EQ(items[i].key, expected[i].key);
+        EXPECT_EQ(items[i].object, expected[i].object);
+    }
+}
+
+TEST(RenderQueueTest, RadixSortSkipsUniformBytes) {
+    // only the depth byte differs, one pass leaves the result in the scratch buffer
+    vector<DrawItem> items;
+    for (uint32_t i = 0; i < 10; i++) {
+        items.push_back(DrawItem{ RenderQueue::makeKey(PASS_OPAQUE, 3, 7, 1, float(10 - i)), nullptr, nullptr, nullptr, 0, i });
+    }
+    vector<DrawItem> scratch;
+    RenderQueue::radixSort(items, scratch);
+    for (uint32_t i = 0; i < 10; i++) {
+        EXPECT_EQ(items[i].object, 9 - i);
+    }
+}
+
+class RenderQueueGLTest : public ::testing::Test {
+protected:
+    GLFWwindow* window = nullptr;
+
+    void SetUp() override {
+        if (!glfwInit()) {
+            FAIL() << "Failed to initialize GLFW";
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        window = glfwCreateWindow(1, 1, "Test Window", NULL, NULL);
+        if (!window) {
+            glfwTerminate();
+            FAIL() << "Failed to create GLFW window";
+        }
+        glfwMakeContextCurrent(window);
+
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            FAIL() << "Failed to initialize GLAD";
+        }
+    }
+
+    void TearDown() override {
+        if (window) {
+            modeling::GeometryArena::shared().shutdown();
+            glfwDestroyWindow(window);
+        }
+        glfwTerminate();
+    }
+};
+
+TEST_F(RenderQueueGLTest, SamplersReadTheirTextureUnits) {
+    // every material sampler of the shader has a slot
+    ifstream file("assets/default.frag");
+    string source((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    static const regex pattern("uniform sampler2D (\\w+Map);");
+    set<string> slotted;
+    for (const char* sampler : modeling::TEXTURE_SLOT_SAMPLERS) {
+        if (sampler) {
+            slotted.insert(sampler);
+        }
+    }
+    int samplers = 0;
+    for (sregex_iterator it(source.begin(), source.end(), pattern), end; it != end; ++it, samplers++) {
+        EXPECT_EQ(slotted.count((*it)[1].str()), 1u) << (*it)[1].str();
+    }
+    EXPECT_EQ(samplers, int(slotted.size()));
+
+    Shader shader;
+    shader.setDefines({ "NORMAL_MAP" });
+    ASSERT_TRUE(shader.loadFromFiles({ { VERTEX, "assets/default.vert" }, { FRAGMENT, "assets/default.frag" } }));
+    Material::setSamplers(shader);
+
+    // slot N is drawn from unit N by submit
+    for (int slot = 0; slot < RenderQueue::MATERIAL_TEXTURES; slot++) {
+        const char* sampler = modeling::TEXTURE_SLOT_SAMPLERS[slot];
+        if (!sampler) {
+            continue;
+        }
+        GLint location = glGetUniformLocation(shader.getProgram(), sampler);
+        ASSERT_GE(location, 0) << sampler;
+        GLint unit = -1;
+        glGetUniformiv(shader.getProgram(), location, &unit);
+        EXPECT_EQ(unit, slot) << sampler;
+    }
+}
+
+TEST_F(RenderQueueGLTest, InstancedDraw) {
+    auto shader = make_shared<Shader>();
+    ASSERT_TRUE(shader->loadFromFiles({ { VERTEX, "assets/default.vert" }, { FRAGMENT, "assets/default.frag" } }));
+    auto models = modeling::ModelLoader::loadModels("test/assets/unitcube.gltf", shader);
+    ASSERT_EQ(models.size(), 1u);
+    const modeling::Model &model = *models[0];
+    const Mesh &mesh = *model.getMeshes()[0];
+
+    RenderQueue queue;
+    queue.add(PASS_OPAQUE, *shader, model.getMaterials()[0].get(), mesh, 1.f, 0, 0, &model);
+    queue.add(PASS_OPAQUE, *shader, model.getMaterials()[0].get(), mesh, 2.f);
+    EXPECT_EQ(queue.submit(), 2u);
+    EXPECT_EQ(glGetError(), GLenum(GL_NO_ERROR));
+
+    // the pool's vertex array reads the identity again
+    modeling::GeometryArena::shared().bind(mesh.getGeometry().pool);
+    GLint enabled = 1, divisor = 1;
+    glGetVertexAttribiv(6, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+    glGetVertexAttribiv(6, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &divisor);
+    glBindVertexArray(0);
+    EXPECT_EQ(enabled, 0);
+    EXPECT_EQ(divisor, 0);
+}
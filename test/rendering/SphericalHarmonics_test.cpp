@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <array>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "rendering/SphericalHarmonics.hpp"
+
+using namespace std;
+using namespace rendering;
+
+namespace {
+
+    const float PI_F = 3.14159265358979323846f;
+
+    // equirectangular image, bottom row first, laid out like equirect_to_cube.frag samples it
+    vector<float> equirect(int width, int height, int components, const function<float(float, float, float)> &radiance) {
+        vector<float> pixels;
+        for (int j = 0; j < height; ++j) {
+            float latitude = ((j + 0.5f) / height - 0.5f) * PI_F;
+            for (int i = 0; i < width; ++i) {
+                float phi = ((i + 0.5f) / width - 0.5f) * 2.f * PI_F;
+                float x = cos(latitude) * cos(phi), y = sin(latitude), z = cos(latitude) * sin(phi);
+                float value = radiance(x, y, z);
+                for (int c = 0; c < components; ++c) {
+                    pixels.push_back(c == 1 ? 2.f * value : value);
+                }
+            }
+        }
+        return pixels;
+    }
+
+}
+
+TEST(SphericalHarmonicsTest, ConstantSkyIsUniform) {
+    // odd width, the last group of four pixels is padding
+    vector<float> pixels = equirect(250, 125, 3, [](float, float, float) { return 1.f; });
+    SHIrradiance sh = projectEquirectSH(pixels.data(), 250, 125, 3);
+
+    // irradiance / PI of a unit sky is 1 whatever the normal
+    float out[3];
+    for (auto n : vector<array<float, 3>>{{1, 0, 0}, {0, 1, 0}, {0, 0, -1}, {0.6f, 0.f, 0.8f}}) {
+        sh.evaluate(n[0], n[1], n[2], out);
+        EXPECT_NEAR(out[0], 1.f, 2e-3f);
+        EXPECT_NEAR(out[1], 2.f, 4e-3f);
+        EXPECT_NEAR(out[2], 1.f, 2e-3f);
+    }
+    for (int k = 1; k < 9; ++k) {
+        EXPECT_NEAR(sh.rgb[k][0], 0.f, 2e-3f) << "coefficient " << k;
+    }
+}
+
+TEST(SphericalHarmonicsTest, LinearSkyMatchesTheCosineIntegral) {
+    // L = 1 + d.y gives E / PI = 1 + 2/3 n.y exactly
+    vector<float> pixels = equirect(256, 128, 4, [](float, float y, float) { return 1.f + y; });
+    SHIrradiance sh = projectEquirectSH(pixels.data(), 256, 128, 4);
+
+    float out[3];
+    for (auto n : vector<array<float, 3>>{{0, 1, 0}, {0, -1, 0}, {1, 0, 0}, {0.f, 0.6f, 0.8f}}) {
+        sh.evaluate(n[0], n[1], n[2], out);
+        EXPECT_NEAR(out[0], 1.f + 2.f / 3.f * n[1], 3e-3f);
+    }
+}
+
+TEST(SphericalHarmonicsTest, SkyMatchesBruteForceIrradiance) {
+    // a sun-like lobe along +x: SH9 keeps the low frequencies the diffuse term needs
+    auto radiance = [](float x, float, float) { return x > 0.f ? x * x : 0.f; };
+    int width = 128, height = 64;
+    vector<float> pixels = equirect(width, height, 1, radiance);
+    SHIrradiance sh = projectEquirectSH(pixels.data(), width, height, 1);
+
+    for (auto n : vector<array<float, 3>>{{1, 0, 0}, {0, 1, 0}, {-1, 0, 0}, {0.6f, 0.8f, 0.f}}) {
+        double irradiance = 0.0;
+        for (int j = 0; j < height; ++j) {
+            float latitude = ((j + 0.5f) / height - 0.5f) * PI_F;
+            for (int i = 0; i < width; ++i) {
+                float phi = ((i + 0.5f) / width - 0.5f) * 2.f * PI_F;
+                float x = cos(latitude) * cos(phi), y = sin(latitude), z = cos(latitude) * sin(phi);
+                float cosine = max(0.f, x * n[0] + y * n[1] + z * n[2]);
+                irradiance += radiance(x, y, z) * cosine * (2.f * PI_F / width) * (PI_F / height) * cos(latitude);
+            }
+        }
+        float out[3];
+        sh.evaluate(n[0], n[1], n[2], out);
+        // L2 truncation error of the clamped cosine stays within a few percent of the peak
+        EXPECT_NEAR(out[0], irradiance / PI_F, 0.03f) << n[0] << " " << n[1] << " " << n[2];
+    }
+}
+
+TEST(SphericalHarmonicsTest, EmptyImageIsBlack) {
+    SHIrradiance sh = projectEquirectSH(nullptr, 0, 0, 3);
+    float out[3];
+    sh.evaluate(0.f, 1.f, 0.f, out);
+    EXPECT_EQ(out[0], 0.f);
+    EXPECT_EQ(out[1], 0.f);
+    EXPECT_EQ(out[2], 0.f);
+}
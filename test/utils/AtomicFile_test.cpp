@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "utils/AtomicFile.hpp"
+
+using namespace std;
+
+namespace {
+
+    string readAll(const string& path) {
+        ifstream file(path, ios::binary);
+        return string((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    }
+
+}
+
+TEST(AtomicFileTest, ReplacesTheFile) {
+    string path = (filesystem::temp_directory_path() / "AtomicFileTest.bin").string();
+    filesystem::remove(path);
+
+    EXPECT_TRUE(writeFileAtomically(path, [](ofstream& file) {
+        file << "first";
+        return true;
+    }));
+    EXPECT_EQ(readAll(path), "first");
+
+    EXPECT_TRUE(writeFileAtomically(path, [](ofstream& file) {
+        file << "second";
+        return true;
+    }));
+    EXPECT_EQ(readAll(path), "second");
+    EXPECT_FALSE(filesystem::exists(path + ".tmp"));
+    filesystem::remove(path);
+}
+
+TEST(AtomicFileTest, AbandonedWriteKeepsTheOldFile) {
+    string path = (filesystem::temp_directory_path() / "AtomicFileTestAbandoned.bin").string();
+    ofstream(path) << "old";
+
+    EXPECT_FALSE(writeFileAtomically(path, [](ofstream& file) {
+        file << "half";
+        return false;
+    }));
+    EXPECT_EQ(readAll(path), "old");
+    EXPECT_FALSE(filesystem::exists(path + ".tmp"));
+    filesystem::remove(path);
+}
+
+TEST(AtomicFileTest, MissingDirectoryFails) {
+    string path = (filesystem::temp_directory_path() / "AtomicFileTestMissing" / "file.bin").string();
+    filesystem::remove_all(filesystem::path(path).parent_path());
+    EXPECT_FALSE(writeFileAtomically(path, [](ofstream&) { return true; }));
+}
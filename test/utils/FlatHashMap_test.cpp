@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <unordered_map>
+#include <random>
+
+#include "utils/FlatHashMap.hpp"
+#include "utils/StringId.hpp"
+
+using namespace std;
+
+TEST(FlatHashMapTest, InsertFindErase) {
+    FlatHashMap<int, string> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(1), nullptr);
+
+    map.insert(1, "one");
+    map[2] = "two";
+    EXPECT_EQ(map.size(), 2u);
+    ASSERT_NE(map.find(1), nullptr);
+    EXPECT_EQ(*map.find(1), "one");
+    EXPECT_EQ(map[2], "two");
+
+    map.insert(1, "uno"); // overwrites
+    EXPECT_EQ(*map.find(1), "uno");
+    EXPECT_EQ(map.size(), 2u);
+
+    EXPECT_TRUE(map.erase(1));
+    EXPECT_FALSE(map.erase(1));
+    EXPECT_FALSE(map.contains(1));
+    EXPECT_TRUE(map.contains(2));
+    EXPECT_EQ(map.size(), 1u);
+}
+
+/* every key lands in the same bucket, so lookups and erases walk probe chains */
+struct CollidingHash {
+    size_t operator()(int) const { return 7; }
+};
+
+TEST(FlatHashMapTest, EraseKeepsProbeChains) {
+    FlatHashMap<int, int, CollidingHash> map;
+    for (int i = 0; i < 10; i++) {
+        map.insert(i, i * 10);
+    }
+    EXPECT_TRUE(map.erase(3));
+    EXPECT_TRUE(map.erase(0));
+    for (int i = 0; i < 10; i++) {
+        if (i == 0 || i == 3) {
+            EXPECT_FALSE(map.contains(i));
+        } else {
+            ASSERT_NE(map.find(i), nullptr) << i;
+            EXPECT_EQ(*map.find(i), i * 10);
+        }
+    }
+}
+
+TEST(FlatHashMapTest, MatchesUnorderedMap) {
+    FlatHashMap<uint32_t, uint32_t> map;
+    unordered_map<uint32_t, uint32_t> reference;
+    mt19937 rng(1234);
+
+    for (int step = 0; step < 20000; step++) {
+        uint32_t key = rng() % 512;
+        if (rng() % 3 == 0) {
+            EXPECT_EQ(map.erase(key), reference.erase(key) == 1);
+        } else {
+            map.insert(key, step);
+            reference[key] = step;
+        }
+    }
+
+    EXPECT_EQ(map.size(), reference.size());
+    for (auto &entry : reference) {
+        ASSERT_NE(map.find(entry.first), nullptr);
+        EXPECT_EQ(*map.find(entry.first), entry.second);
+    }
+    size_t visited = 0;
+    map.forEach([&](uint32_t key, uint32_t value) {
+        EXPECT_EQ(reference.at(key), value);
+        visited++;
+    });
+    EXPECT_EQ(visited, reference.size());
+}
+
+TEST(StringIdTest, Interning) {
+    StringId a("models/tree.gltf");
+    StringId b(string("models/") + "tree.gltf");
+    StringId c("models/rock.gltf");
+
+    EXPECT_TRUE(a.valid());
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ(a.str(), "models/tree.gltf");
+    EXPECT_EQ(a.hash(), StringId::hashOf("models/tree.gltf"));
+
+    EXPECT_EQ(StringId::lookup("models/rock.gltf"), c);
+    EXPECT_FALSE(StringId::lookup("models/never_interned.gltf").valid());
+    EXPECT_FALSE(StringId().valid());
+    EXPECT_EQ(StringId().str(), "");
+
+    FlatHashMap<StringId, int> byName;
+    byName.insert(a, 1);
+    byName.insert(c, 2);
+    EXPECT_EQ(*byName.find(b), 1);
+    EXPECT_EQ(byName.find(StringId()), nullptr);
+}
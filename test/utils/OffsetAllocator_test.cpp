@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <random>
+#include <vector>
+
+#include "utils/OffsetAllocator.hpp"
+
+using namespace std;
+
+TEST(OffsetAllocatorTest, AllocateAndFree) {
+    OffsetAllocator allocator(100);
+    EXPECT_EQ(allocator.capacity(), 100u);
+    EXPECT_EQ(allocator.largestFree(), 100u);
+
+    uint32_t a = allocator.allocate(30);
+    uint32_t b = allocator.allocate(30);
+    uint32_t c = allocator.allocate(40);
+    EXPECT_EQ(a, 0u);
+    EXPECT_EQ(b, 30u);
+    EXPECT_EQ(c, 60u);
+    EXPECT_EQ(allocator.used(), 100u);
+    EXPECT_EQ(allocator.allocate(1), OffsetAllocator::NO_SPACE);
+    EXPECT_EQ(allocator.allocate(0), OffsetAllocator::NO_SPACE);
+
+    allocator.free(b, 30);
+    EXPECT_EQ(allocator.used(), 70u);
+    EXPECT_EQ(allocator.allocate(20), 30u);
+}
+
+TEST(OffsetAllocatorTest, BestFitAndMerging) {
+    OffsetAllocator allocator(100);
+    uint32_t a = allocator.allocate(10);
+    uint32_t b = allocator.allocate(20);
+    uint32_t c = allocator.allocate(10);
+    uint32_t d = allocator.allocate(30);
+    allocator.allocate(30);
+    allocator.free(b, 20);
+    allocator.free(d, 30);
+
+    // the 20 unit hole fits better than the 30 unit one
+    EXPECT_EQ(allocator.allocate(15), b);
+    allocator.free(b, 15);
+
+    // freeing c joins b..d into one 60 unit range
+    allocator.free(c, 10);
+    EXPECT_EQ(allocator.freeRangeCount(), 1u);
+    EXPECT_EQ(allocator.largestFree(), 60u);
+    EXPECT_EQ(allocator.allocate(60), 10u);
+
+    allocator.free(a, 10);
+    allocator.free(10, 60);
+    EXPECT_EQ(allocator.freeRangeCount(), 1u);
+    EXPECT_EQ(allocator.largestFree(), 70u);
+}
+
+TEST(OffsetAllocatorTest, GrowExtendsTheLastFreeRange) {
+    OffsetAllocator allocator(10);
+    EXPECT_EQ(allocator.allocate(8), 0u);
+    EXPECT_EQ(allocator.allocate(8), OffsetAllocator::NO_SPACE);
+
+    allocator.grow(20);
+    EXPECT_EQ(allocator.capacity(), 20u);
+    EXPECT_EQ(allocator.used(), 8u);
+    EXPECT_EQ(allocator.freeRangeCount(), 1u);
+    EXPECT_EQ(allocator.allocate(12), 8u);
+
+    allocator.grow(5);  // never shrinks
+    EXPECT_EQ(allocator.capacity(), 20u);
+}
+
+TEST(OffsetAllocatorTest, RandomAllocationsNeverOverlap) {
+    const uint32_t capacity = 1 << 16;
+    OffsetAllocator allocator(capacity);
+    vector<uint8_t> owner(capacity, 0);
+    vector<pair<uint32_t, uint32_t>> live;
+    mt19937 rng(7);
+
+    for (int step = 0; step < 5000; step++) {
+        if (live.empty() || rng() % 3 != 0) {
+            uint32_t size = 1 + rng() % 500;
+            uint32_t offset = allocator.allocate(size);
+            if (offset == OffsetAllocator::NO_SPACE) {
+                EXPECT_LT(allocator.largestFree(), size);
+                continue;
+            }
+            ASSERT_LE(offset + size, capacity);
+            for (uint32_t i = offset; i < offset + size; i++) {
+                ASSERT_EQ(owner[i], 0) << "overlap at " << i;
+                owner[i] = 1;
+            }
+            live.push_back({ offset, size });
+        } else {
+            size_t pick = rng() % live.size();
+            auto range = live[pick];
+            live[pick] = live.back();
+            live.pop_back();
+            for (uint32_t i = range.first; i < range.first + range.second; i++) {
+                owner[i] = 0;
+            }
+            allocator.free(range.first, range.second);
+        }
+    }
+
+    for (auto range : live) {
+        allocator.free(range.first, range.second);
+    }
+    EXPECT_EQ(allocator.used(), 0u);
+    EXPECT_EQ(allocator.freeRangeCount(), 1u);
+    EXPECT_EQ(allocator.largestFree(), capacity);
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "utils/ProgramCache.hpp"
+
+using namespace std;
+
+TEST(ProgramCacheTest, KeyCoversSourcesDefinesAndDriver) {
+    unordered_map<SHADER_TYPE, string> sources = {
+        {VERTEX, "void main() {}"},
+        {FRAGMENT, "out vec4 c; void main() { c = vec4(1.0); }"},
+    };
+    uint64_t key = ProgramCache::computeKey(sources, "", "vendor|renderer|4.5");
+    EXPECT_EQ(key, ProgramCache::computeKey(sources, "", "vendor|renderer|4.5"));
+
+    EXPECT_NE(key, ProgramCache::computeKey(sources, "#define ALPHA_TEST\n", "vendor|renderer|4.5"));
+    EXPECT_NE(key, ProgramCache::computeKey(sources, "", "vendor|renderer|4.6"));
+
+    unordered_map<SHADER_TYPE, string> edited = sources;
+    edited[FRAGMENT] += " ";
+    EXPECT_NE(key, ProgramCache::computeKey(edited, "", "vendor|renderer|4.5"));
+
+    // the same text as another stage is a different program
+    unordered_map<SHADER_TYPE, string> swapped = {
+        {FRAGMENT, sources[VERTEX]},
+        {VERTEX, sources[FRAGMENT]},
+    };
+    EXPECT_NE(key, ProgramCache::computeKey(swapped, "", "vendor|renderer|4.5"));
+}
+
+TEST(ProgramCacheTest, FileRoundTrip) {
+    string path = (filesystem::temp_directory_path() / "ProgramCacheTest.spb").string();
+    vector<uint8_t> binary = { 1, 2, 3, 4, 5, 250 };
+    ASSERT_TRUE(ProgramCache::writeFile(path, 0x1234, 0x8E21, binary));
+
+    GLenum format = 0;
+    vector<uint8_t> read;
+    ASSERT_TRUE(ProgramCache::readFile(path, 0x1234, format, read));
+    EXPECT_EQ(format, 0x8E21u);
+    EXPECT_EQ(read, binary);
+
+    // another key is a miss, not someone else's program
+    EXPECT_FALSE(ProgramCache::readFile(path, 0x1235, format, read));
+
+    // a truncated file is rejected
+    filesystem::resize_file(path, filesystem::file_size(path) - 2);
+    EXPECT_FALSE(ProgramCache::readFile(path, 0x1234, format, read));
+
+    filesystem::remove(path);
+    EXPECT_FALSE(ProgramCache::readFile(path, 0x1234, format, read));
+}
+
+TEST(ProgramCacheTest, DirectorySetting) {
+    string previous = ProgramCache::getDirectory();
+    ProgramCache::setDirectory("cache-dir");
+    EXPECT_EQ(ProgramCache::pathFor(0xabcull), (filesystem::path("cache-dir") / "0000000000000abc.spb").string());
+    ProgramCache::setDirectory(previous);
+    EXPECT_EQ(ProgramCache::getDirectory(), previous);
+}
@@ -0,0 +1,28 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "utils/ShaderVariants.hpp"
+
+using namespace std;
+
+TEST(ShaderVariantsTest, DefineBlockIsNormalized) {
+    EXPECT_EQ(Shader::buildDefineBlock({ "UNLIT", "ALPHA_TEST", "UNLIT", "" }),
+              "#define ALPHA_TEST\n#define UNLIT\n");
+    EXPECT_EQ(Shader::buildDefineBlock({ "LIGHT_COUNT=4" }), "#define LIGHT_COUNT 4\n");
+    EXPECT_EQ(Shader::buildDefineBlock({}), "");
+
+    EXPECT_EQ(ShaderVariants::variantKey({ "NORMAL_MAP", "ALPHA_TEST" }),
+              ShaderVariants::variantKey({ "ALPHA_TEST", "NORMAL_MAP", "ALPHA_TEST" }));
+    EXPECT_NE(ShaderVariants::variantKey({ "NORMAL_MAP" }), ShaderVariants::variantKey({ "ALPHA_TEST" }));
+    EXPECT_NE(ShaderVariants::variantKey({ "NORMAL_MAP" }), ShaderVariants::variantKey({}));
+}
+
+TEST(ShaderVariantsTest, DefinesFollowVersion) {
+    string source = "// header\n#version 330 core\nout vec4 c;\nvoid main() {}\n";
+    string injected = Shader::injectDefines(source, "#define UNLIT\n");
+    // the rest keeps its line numbers: "out vec4 c;" is still line 3
+    EXPECT_EQ(injected, "// header\n#version 330 core\n#define UNLIT\n#line 3\nout vec4 c;\nvoid main() {}\n");
+
+    EXPECT_EQ(Shader::injectDefines(source, ""), source);
+    EXPECT_EQ(Shader::injectDefines("void main() {}", "#define A\n"), "#define A\n#line 1\nvoid main() {}");
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <cstring>
+
 #include "utils/Shader.hpp"
+#include "utils/ShaderVariants.hpp"
 #include "glad/glad.h"
 #include <GLFW/glfw3.h>
 
@@ -523,4 +526,134 @@ TEST_F(ShaderTest, MultipleShaderTypesOfSameKind) {
     
     // But replacing should work
     EXPECT_TRUE(shader.replaceShader(VERTEX, secondVertexShader));
-}
\ No newline at end of file
+}
+
+TEST_F(ShaderTest, UniformBlockReflection) {
+    Shader shader;
+
+    std::string vertexShader = R"(
+        #version 330 core
+        layout (location = 0) in vec3 aPos;
+        layout (std140) uniform Frame {
+            mat4 view;
+            vec3 eye;
+            float time;
+            float weights[4];
+            vec2 jitter;
+        };
+        void main() {
+            gl_Position = view * vec4(aPos + eye * (time + weights[3] + jitter.x), 1.0);
+        }
+    )";
+    std::string fragmentShader = R"(
+        #version 330 core
+        out vec4 FragColor;
+        void main() {
+            FragColor = vec4(1.0);
+        }
+    )";
+    ASSERT_TRUE(shader.loadFromSources({{VERTEX, vertexShader}, {FRAGMENT, fragmentShader}}));
+
+    UniformBlockLayout layout;
+    ASSERT_TRUE(shader.getUniformBlockLayout("Frame", layout));
+    EXPECT_FALSE(shader.getUniformBlockLayout("Missing", layout));
+    ASSERT_TRUE(shader.getUniformBlockLayout("Frame", layout));
+
+    // the driver's std140 offsets match the ones computed on the CPU
+    Std140Layout expected;
+    expected.add(Std140Type::MAT4);
+    expected.add(Std140Type::VEC3);
+    expected.add(Std140Type::FLOAT);
+    expected.add(Std140Type::FLOAT, 4);
+    expected.add(Std140Type::VEC2);
+    const char* names[] = { "view", "eye", "time", "weights[0]", "jitter" };
+    for (size_t i = 0; i < 5; i++) {
+        const UniformMember* member = layout.find(names[i]);
+        ASSERT_NE(member, nullptr) << names[i];
+        EXPECT_EQ(size_t(member->offset), expected.getOffset(i)) << names[i];
+    }
+    EXPECT_EQ(size_t(layout.find("weights[0]")->arrayStride), expected.getArrayStride(3));
+    EXPECT_EQ(layout.find("weights[0]")->arraySize, 4);
+    EXPECT_EQ(size_t(layout.size), expected.size());
+
+    EXPECT_TRUE(shader.bindUniformBlock("Frame", 2));
+    EXPECT_FALSE(shader.bindUniformBlock("Missing", 2));
+}
+
+TEST_F(ShaderTest, UniformRingAllocations) {
+    UniformRing ring;
+    ASSERT_TRUE(ring.create(1000, 2));
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    UniformAllocation first = ring.allocate(64);
+    UniformAllocation second = ring.allocate(16);
+    ASSERT_NE(first.data, nullptr);
+    ASSERT_NE(second.data, nullptr);
+    EXPECT_EQ(second.offset % alignment, 0);
+    EXPECT_GE(second.offset, first.offset + 64);
+    // the region is at least 1000 bytes, never more than that plus the alignment
+    EXPECT_EQ(ring.allocate(1000 + size_t(alignment)).data, nullptr);
+
+    float values[16] = { 1.0f };
+    std::memcpy(first.data, values, sizeof(values));
+    ring.bind(0, first);
+    ring.endFrame();
+
+    // the next frame writes to its own region
+    ring.beginFrame();
+    EXPECT_EQ(ring.getUsed(), 0u);
+    UniformAllocation next = ring.allocate(64);
+    ASSERT_NE(next.data, nullptr);
+    EXPECT_NE(next.offset, first.offset);
+    ring.endFrame();
+    ring.destroy();
+    EXPECT_EQ(ring.getBuffer(), 0u);
+}
+
+TEST_F(ShaderTest, ShaderVariantsCompileOnce) {
+    std::string vertexShader = R"(#version 330 core
+        layout (location = 0) in vec3 aPos;
+        void main() {
+            gl_Position = vec4(aPos, 1.0);
+        }
+    )";
+    std::string fragmentShader = R"(#version 330 core
+        out vec4 FragColor;
+        #ifdef RED
+        uniform float red;
+        #endif
+        void main() {
+        #ifdef RED
+            FragColor = vec4(red, 0.0, 0.0, 1.0);
+        #else
+            FragColor = vec4(1.0);
+        #endif
+        #ifdef BROKEN
+            this does not compile;
+        #endif
+        }
+    )";
+    ShaderVariants variants;
+    variants.setSources({{VERTEX, vertexShader}, {FRAGMENT, fragmentShader}});
+    EXPECT_EQ(variants.precompile({{}, {"RED"}}), 0u);
+    EXPECT_EQ(variants.size(), 2u);
+
+    Shader* plain = variants.get({});
+    Shader* red = variants.get({"RED"});
+    ASSERT_NE(plain, nullptr);
+    ASSERT_NE(red, nullptr);
+    EXPECT_NE(plain, red);
+    EXPECT_EQ(variants.get({"RED", "RED"}), red);
+    EXPECT_EQ(variants.find(ShaderVariants::variantKey({"RED"})), red);
+    EXPECT_EQ(variants.size(), 2u);
+
+    // the uniform only exists in the variant that declares it
+    EXPECT_NE(red->getUniformLocation("red"), -1);
+    EXPECT_EQ(plain->getUniformLocation("red"), -1);
+
+    // failures are remembered, not retried
+    EXPECT_EQ(variants.get({"BROKEN"}), nullptr);
+    EXPECT_EQ(variants.get({"BROKEN"}), nullptr);
+    EXPECT_EQ(variants.size(), 3u);
+}
@@ -0,0 +1,47 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "utils/Span.hpp"
+
+using namespace std;
+
+TEST(SpanTest, ViewsVectorWithoutCopying) {
+    vector<int> values(8);
+    iota(values.begin(), values.end(), 0);
+
+    Span<const int> view = values;
+    EXPECT_EQ(view.data(), values.data());
+    ASSERT_EQ(view.size(), 8u);
+    EXPECT_EQ(view.front(), 0);
+    EXPECT_EQ(view.back(), 7);
+    EXPECT_EQ(accumulate(view.begin(), view.end(), 0), 28);
+
+    // a mutable view writes through
+    Span<int> mutableView = values;
+    mutableView[3] = 42;
+    EXPECT_EQ(values[3], 42);
+    EXPECT_EQ(view[3], 42);
+}
+
+TEST(SpanTest, EmptyAndPartialViews) {
+    Span<const float> none;
+    EXPECT_TRUE(none.empty());
+    EXPECT_EQ(none.begin(), none.end());
+
+    const float values[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    Span<const float> tail(values + 2, 2);
+    EXPECT_EQ(tail.size(), 2u);
+    EXPECT_EQ(tail.front(), 3.0f);
+}
+
+TEST(SpanTest, SharedPointersKeepTheirCount) {
+    vector<shared_ptr<int>> owners = { make_shared<int>(1), make_shared<int>(2) };
+    Span<const shared_ptr<int>> view = owners;
+    for (const auto& owner : view) {
+        EXPECT_EQ(owner.use_count(), 1);
+    }
+}
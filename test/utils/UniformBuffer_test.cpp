@@ -0,0 +1,34 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include "utils/UniformBuffer.hpp"
+
+using namespace std;
+
+TEST(UniformBufferTest, Std140Alignment) {
+    Std140Layout layout;
+    EXPECT_EQ(layout.add(Std140Type::FLOAT), 0u);
+    // vec3 aligns to 16, a scalar may fill its last 4 bytes
+    EXPECT_EQ(layout.add(Std140Type::VEC3), 16u);
+    EXPECT_EQ(layout.add(Std140Type::FLOAT), 28u);
+    EXPECT_EQ(layout.add(Std140Type::VEC2), 32u);
+    EXPECT_EQ(layout.add(Std140Type::INT), 40u);
+    EXPECT_EQ(layout.add(Std140Type::MAT4), 48u);
+    EXPECT_EQ(layout.add(Std140Type::MAT3), 112u);
+    EXPECT_EQ(layout.add(Std140Type::VEC4), 160u);
+    EXPECT_EQ(layout.size(), 176u);
+    EXPECT_EQ(layout.getMemberCount(), 8u);
+}
+
+TEST(UniformBufferTest, Std140ArraysPadElements) {
+    Std140Layout layout;
+    layout.add(Std140Type::VEC2);
+    // float[64] is 64 vec4 slots, the reason Bloom's weights cost 1KB
+    EXPECT_EQ(layout.add(Std140Type::FLOAT, 64), 16u);
+    EXPECT_EQ(layout.getArrayStride(1), 16u);
+    EXPECT_EQ(layout.add(Std140Type::FLOAT), 16u + 64u * 16u);
+    EXPECT_EQ(layout.add(Std140Type::MAT4, 2), 16u + 64u * 16u + 16u);
+    EXPECT_EQ(layout.getArrayStride(3), 64u);
+    EXPECT_EQ(layout.getArrayStride(0), 0u);
+    EXPECT_EQ(layout.size(), 16u + 64u * 16u + 16u + 128u);
+}